@@ -0,0 +1,110 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  See the enclosed file LICENSE for a copy or if
+ * that was not distributed with this file, You can obtain one at
+ * http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2017 Max H. Gerlach
+ *
+ * */
+
+/*
+ * asyncwriter.cpp
+ */
+
+#include <iostream>
+#include "asyncwriter.h"
+
+AsyncWriter::AsyncWriter(uint32_t maxQueued_)
+    : maxQueued(maxQueued_), queue(), busy(false), stopping(false), error(),
+      mutex(), queueChanged(), worker()
+{
+    if (maxQueued > 0) {
+        worker = std::thread(&AsyncWriter::workerLoop, this);
+    }
+}
+
+AsyncWriter::~AsyncWriter() {
+    if (worker.joinable()) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        queueChanged.notify_all();
+        // the worker drains the queue before it exits
+        worker.join();
+    }
+    if (error) {
+        try {
+            std::rethrow_exception(error);
+        } catch (std::exception& e) {
+            std::cerr << "Error in asynchronous output: " << e.what() << std::endl;
+        } catch (...) {
+            std::cerr << "Unknown error in asynchronous output" << std::endl;
+        }
+    }
+}
+
+void AsyncWriter::rethrowError() {
+    if (error) {
+        std::exception_ptr e = error;
+        error = std::exception_ptr();
+        std::rethrow_exception(e);
+    }
+}
+
+void AsyncWriter::submit(const Task& task) {
+    if (maxQueued == 0) {
+        task();
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    rethrowError();
+    while (queue.size() >= maxQueued) {
+        queueChanged.wait(lock);
+    }
+    queue.push_back(task);
+    lock.unlock();
+    queueChanged.notify_all();
+}
+
+void AsyncWriter::flush() {
+    if (maxQueued == 0) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    while (busy or not queue.empty()) {
+        queueChanged.wait(lock);
+    }
+    rethrowError();
+}
+
+void AsyncWriter::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        while (queue.empty() and not stopping) {
+            queueChanged.wait(lock);
+        }
+        if (queue.empty()) {
+            // stopping and nothing left to do
+            break;
+        }
+        Task task = queue.front();
+        queue.pop_front();
+        busy = true;
+        lock.unlock();
+        queueChanged.notify_all();   // there is space in the queue again
+
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard<std::mutex> errorLock(mutex);
+            if (not error) {
+                error = std::current_exception();
+            }
+        }
+
+        lock.lock();
+        busy = false;
+        queueChanged.notify_all();   // flush() may be waiting
+    }
+}
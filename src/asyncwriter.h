@@ -0,0 +1,73 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  See the enclosed file LICENSE for a copy or if
+ * that was not distributed with this file, You can obtain one at
+ * http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2017 Max H. Gerlach
+ *
+ * */
+
+/*
+ * asyncwriter.h
+ *
+ * Execute output tasks (writing files to disk) one after the other on
+ * a dedicated thread, so that the simulation does not have to wait
+ * for a slow file system.
+ *
+ * - Tasks are run in the order they have been submitted.
+ * - At most maxQueued tasks are pending: submit() blocks while the
+ *   queue is full (back-pressure).
+ * - flush() blocks until all submitted tasks are done.  The
+ *   destructor flushes, too.
+ * - An exception thrown by a task is rethrown by the next call to
+ *   submit() or flush() on the submitting thread.
+ * - With maxQueued == 0 no thread is started and submit() executes
+ *   the task immediately.
+ *
+ * Tasks must not share mutable data with the submitting thread: pass
+ * copies (or shared pointers to data no longer touched by the
+ * submitter).
+ */
+
+#ifndef ASYNCWRITER_H_
+#define ASYNCWRITER_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <exception>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+class AsyncWriter {
+public:
+    typedef std::function<void()> Task;
+
+    explicit AsyncWriter(uint32_t maxQueued = 0);
+    ~AsyncWriter();
+    AsyncWriter(const AsyncWriter&) = delete;
+    AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+    void submit(const Task& task);
+    void flush();
+
+    bool isAsynchronous() const { return maxQueued > 0; }
+private:
+    uint32_t maxQueued;
+    std::deque<Task> queue;
+    bool busy;                  // the worker is running a task
+    bool stopping;
+    std::exception_ptr error;   // first error of a task, not yet reported
+
+    std::mutex mutex;
+    std::condition_variable queueChanged;
+    std::thread worker;
+
+    void workerLoop();
+    // call with mutex locked
+    void rethrowError();
+};
+
+
+#endif /* ASYNCWRITER_H_ */
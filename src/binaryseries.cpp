@@ -0,0 +1,152 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  See the enclosed file LICENSE for a copy or if
+ * that was not distributed with this file, You can obtain one at
+ * http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2017 Max H. Gerlach
+ *
+ * */
+
+/*
+ * binaryseries.cpp
+ */
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include "binaryseries.h"
+#include "exceptions.h"
+#include "tools.h"
+
+static const char BinarySeriesMagic[8] = {'D', 'Q', 'M', 'C', 'S', 'E', 'R', '\0'};
+static const uint32_t BinarySeriesVersion = 1;
+
+// numbers are stored in host byte order, which must be little-endian
+static void checkLittleEndian() {
+    const uint16_t probe = 1;
+    if (*reinterpret_cast<const char*>(&probe) != 1) {
+        throw_GeneralError("binary time series are only supported on little-endian hosts");
+    }
+}
+
+template<typename T>
+static void writeRaw(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+static bool readRaw(std::istream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+// bytes between the read position and the end of the stream, to check
+// lengths read from the file before allocating for them [unlimited if
+// the stream cannot seek]
+static uint64_t remainingBytes(std::istream& in) {
+    const std::streampos current = in.tellg();
+    if (current < 0) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    in.seekg(0, std::ios::end);
+    const std::streampos end = in.tellg();
+    in.seekg(current);
+    if (end < current) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    return uint64_t(end - current);
+}
+
+
+bool isBinarySeriesFile(const std::string& filename) {
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    char magic[sizeof(BinarySeriesMagic)];
+    if (not in.read(magic, sizeof(magic))) {
+        return false;
+    }
+    return std::memcmp(magic, BinarySeriesMagic, sizeof(magic)) == 0;
+}
+
+void writeBinarySeriesHeader(std::ostream& out, const std::string& headerText,
+                             const std::vector<std::string>& columnNames) {
+    checkLittleEndian();
+    out.write(BinarySeriesMagic, sizeof(BinarySeriesMagic));
+    writeRaw(out, BinarySeriesVersion);
+    writeRaw(out, uint32_t(columnNames.size()));
+    writeRaw(out, uint64_t(headerText.size()));
+    out.write(headerText.data(), headerText.size());
+    for (const std::string& name : columnNames) {
+        writeRaw(out, uint32_t(name.size()));
+        out.write(name.data(), name.size());
+    }
+}
+
+void writeBinarySeriesChunk(std::ostream& out, const double* columnMajor,
+                            uint64_t rows, uint32_t columns) {
+    if (rows == 0) {
+        return;
+    }
+    checkLittleEndian();
+    writeRaw(out, rows);
+    out.write(reinterpret_cast<const char*>(columnMajor),
+              std::streamsize(rows * columns * sizeof(double)));
+}
+
+BinarySeriesHeader readBinarySeriesHeader(std::istream& in, const std::string& filename) {
+    checkLittleEndian();
+    BinarySeriesHeader header;
+    char magic[sizeof(BinarySeriesMagic)];
+    uint32_t version = 0;
+    uint32_t columns = 0;
+    uint64_t headerLength = 0;
+    if (not in.read(magic, sizeof(magic)) or
+        std::memcmp(magic, BinarySeriesMagic, sizeof(magic)) != 0) {
+        throw_GeneralError(filename + " is not a binary time series");
+    }
+    if (not (readRaw(in, version) and readRaw(in, columns) and readRaw(in, headerLength))) {
+        throw_ReadError(filename);
+    }
+    if (version != BinarySeriesVersion) {
+        throw_GeneralError(filename + ": unsupported binary time series version " + numToString(version));
+    }
+    if (headerLength > remainingBytes(in)) {
+        throw_ReadError(filename + " [header length " + numToString(headerLength) +
+                        " exceeds the file size]");
+    }
+    header.headerText.resize(headerLength);
+    if (headerLength > 0 and not in.read(&header.headerText[0], std::streamsize(headerLength))) {
+        throw_ReadError(filename);
+    }
+    for (uint32_t c = 0; c < columns; ++c) {
+        uint32_t nameLength = 0;
+        if (not readRaw(in, nameLength)) {
+            throw_ReadError(filename);
+        }
+        if (nameLength > remainingBytes(in)) {
+            throw_ReadError(filename + " [column name length " + numToString(nameLength) +
+                            " exceeds the file size]");
+        }
+        std::string name(nameLength, '\0');
+        if (nameLength > 0 and not in.read(&name[0], nameLength)) {
+            throw_ReadError(filename);
+        }
+        header.columnNames.push_back(name);
+    }
+    return header;
+}
+
+bool readBinarySeriesChunk(std::istream& in, const std::string& filename, uint32_t columns,
+                           uint64_t& rows, std::vector<double>& columnMajor) {
+    if (not readRaw(in, rows)) {
+        return false;
+    }
+    // rows * columns * sizeof(double) without overflow
+    if (columns > 0 and rows > remainingBytes(in) / (uint64_t(columns) * sizeof(double))) {
+        throw_ReadError(filename + " [chunk of " + numToString(rows) + " rows exceeds the file size]");
+    }
+    columnMajor.resize(rows * columns);
+    if (not in.read(reinterpret_cast<char*>(columnMajor.data()),
+                    std::streamsize(rows * columns * sizeof(double)))) {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,65 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  See the enclosed file LICENSE for a copy or if
+ * that was not distributed with this file, You can obtain one at
+ * http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2017 Max H. Gerlach
+ *
+ * */
+
+/*
+ * binaryseries.h
+ *
+ * Binary columnar format for time series, alternative to the ASCII
+ * format written by DataSeriesWriterSuccessive and read by
+ * DataSeriesLoader, which detect it by its magic bytes.
+ *
+ * File layout, all numbers little-endian:
+ *   char[8]    magic "DQMCSER\0"
+ *   uint32     format version (1)
+ *   uint32     number of columns C
+ *   uint64     length of the header text, followed by the header text
+ *              [same "# key = value" and "## text" lines as in the
+ *              ASCII format]
+ *   C times:   uint32 length of a column name, followed by the name
+ *   chunks, appended one after the other, each:
+ *     uint64   number of rows R
+ *     C * R    float64 values, column after column
+ */
+
+#ifndef BINARYSERIES_H_
+#define BINARYSERIES_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iostream>
+
+enum SeriesFormat {SeriesFormatText, SeriesFormatBinary};
+
+struct BinarySeriesHeader {
+    std::string headerText;
+    std::vector<std::string> columnNames;
+};
+
+// true if the file starts with the magic bytes of the binary format
+bool isBinarySeriesFile(const std::string& filename);
+
+void writeBinarySeriesHeader(std::ostream& out, const std::string& headerText,
+                             const std::vector<std::string>& columnNames);
+
+// columnMajor holds columns * rows values
+void writeBinarySeriesChunk(std::ostream& out, const double* columnMajor,
+                            uint64_t rows, uint32_t columns);
+
+// read the header, afterwards in is positioned at the first chunk
+BinarySeriesHeader readBinarySeriesHeader(std::istream& in, const std::string& filename);
+
+// read the next chunk into columnMajor, return false if there is none
+// [an incomplete trailing row count is ignored, a row count that does
+// not fit into the rest of the file throws ReadError]
+bool readBinarySeriesChunk(std::istream& in, const std::string& filename, uint32_t columns,
+                           uint64_t& rows, std::vector<double>& columnMajor);
+
+
+#endif /* BINARYSERIES_H_ */
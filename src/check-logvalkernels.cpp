@@ -0,0 +1,101 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  See the enclosed file LICENSE for a copy or if
+ * that was not distributed with this file, You can obtain one at
+ * http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2017 Max H. Gerlach
+ *
+ * */
+
+/*
+ * check-logvalkernels.cpp
+ *
+ * Checks the sums of logvalkernels.h compiled with the project's
+ * compiler flags, in particular that LogVal zeros [ln 0 = -inf] are
+ * still handled with -ffast-math.  Returns 1 on failure.
+ */
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <vector>
+#include "logvalkernels.h"
+
+namespace {
+
+const double minusInf = -std::numeric_limits<double>::infinity();
+
+int failures = 0;
+
+// compare the bit patterns, comparisons with -inf may be folded under -ffast-math
+bool isMinusInf(double x) {
+    return std::memcmp(&x, &minusInf, sizeof(double)) == 0;
+}
+
+void expectMinusInf(double x, const char* what) {
+    if (not isMinusInf(x)) {
+        std::cerr << what << ": got " << x << ", expected -inf\n";
+        ++failures;
+    }
+}
+
+void expectClose(double x, double expected, const char* what) {
+    if (not lv_isFinite(x) or std::fabs(x - expected) > 1e-12 * std::fabs(expected)) {
+        std::cerr << what << ": got " << x << ", expected " << expected << "\n";
+        ++failures;
+    }
+}
+
+// ln sum_i e^{x[i]} one term at a time
+double naiveLogSumExp(const std::vector<double>& x) {
+    double max = x[0];
+    for (double v : x) {
+        max = std::max(max, v);
+    }
+    double sum = 0;
+    for (double v : x) {
+        sum += std::exp(v - max);
+    }
+    return max + std::log(sum);
+}
+
+} // anonymous namespace
+
+
+int main() {
+    // more values than lv_ChunkSize and not a multiple of the vector width
+    const std::size_t n = 2 * lv_ChunkSize + 3;
+
+    std::vector<double> zeros(n, minusInf);
+    std::vector<double> u(n, 1.0);
+    expectMinusInf(lv_logSumExp(zeros.data(), n), "lv_logSumExp, all -inf");
+    expectMinusInf(lv_logSumExp(zeros.data(), u.data(), 2.0, n), "lv_logSumExp with u, all -inf");
+    expectMinusInf(lv_logSumExp(zeros.data(), 0), "lv_logSumExp, n = 0");
+
+    std::vector<double> x(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        x[i] = 0.01 * double(i) - 3.0;
+    }
+    x[5] = minusInf;
+    expectClose(lv_logSumExp(x.data(), n), naiveLogSumExp(x), "lv_logSumExp, one -inf");
+
+    // 2 rows: column 0 is all -inf, column 1 has a single finite value
+    const std::size_t cols = lv_ChunkSize + 1;
+    std::vector<double> m(2 * cols, 1.5);
+    m[0] = minusInf;
+    m[cols] = minusInf;
+    m[1] = minusInf;
+    std::vector<double> rowShift = {0.5, -0.5};
+    std::vector<double> result(cols);
+    lv_logSumExpColumns(result.data(), m.data(), 2, cols, cols, rowShift.data());
+    expectMinusInf(result[0], "lv_logSumExpColumns, all -inf column");
+    expectClose(result[1], 2.0, "lv_logSumExpColumns, one -inf");
+    expectClose(result[cols - 1], naiveLogSumExp({1.0, 2.0}), "lv_logSumExpColumns");
+
+    if (failures > 0) {
+        std::cerr << failures << " check(s) of logvalkernels.h failed\n";
+        return 1;
+    }
+    return 0;
+}
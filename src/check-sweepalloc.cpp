@@ -0,0 +1,224 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  See the enclosed file LICENSE for a copy or if
+ * that was not distributed with this file, You can obtain one at
+ * http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2017 Max H. Gerlach
+ *
+ * */
+
+/*
+ * check-sweepalloc.cpp
+ *
+ * Checks that a steady-state sweep of the determinantal QMC [wrapping,
+ * UdV storage updates, time-displaced passes, measurements] does not
+ * allocate heap memory once the workspace matrices have been set up.
+ * Counts the calls to malloc and friends for sweeps of the Hubbard
+ * model with both stabilization methods and of the O(3) SDW model with
+ * the checkerboard break-up and delayed updates.  Returns 1 on failure.
+ */
+
+#include <cstdlib>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "dethubbard.h"
+#include "dethubbardparams.h"
+#include "detsdwopdim.h"
+#include "detsdwparams.h"
+#include "rngwrapper.h"
+
+// glibc entry points, the replacements below forward to these
+extern "C" {
+    void* __libc_malloc(std::size_t size);
+    void* __libc_calloc(std::size_t n, std::size_t size);
+    void* __libc_realloc(void* ptr, std::size_t size);
+    void* __libc_memalign(std::size_t alignment, std::size_t size);
+    void __libc_free(void* ptr);
+}
+
+namespace {
+
+// only count while a sweep under test is running
+bool counting = false;
+std::size_t allocations = 0;
+
+inline void countAllocation() {
+    if (counting) {
+        ++allocations;
+    }
+}
+
+} // anonymous namespace
+
+// operator new and Armadillo's memory::acquire() end up here
+extern "C" {
+
+void* malloc(std::size_t size) {
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+void* calloc(std::size_t n, std::size_t size) {
+    countAllocation();
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, std::size_t size) {
+    countAllocation();
+    return __libc_realloc(ptr, size);
+}
+
+int posix_memalign(void** memptr, std::size_t alignment, std::size_t size) {
+    countAllocation();
+    void* ptr = __libc_memalign(alignment, size);
+    if (ptr == nullptr) {
+        return 12;              // ENOMEM
+    }
+    *memptr = ptr;
+    return 0;
+}
+
+void* aligned_alloc(std::size_t alignment, std::size_t size) {
+    countAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+void free(void* ptr) {
+    __libc_free(ptr);
+}
+
+} // extern "C"
+
+
+namespace {
+
+int failures = 0;
+
+ModelParams<DetHubbard> hubbardParams(const std::string& udvMethod) {
+    ModelParams<DetHubbard> pars;
+    pars.checkerboard = false;
+    pars.timedisplaced = true;
+    pars.t = 1.0;
+    pars.U = 4.0;
+    pars.mu = 0.0;
+    pars.L = 4;
+    pars.d = 2;
+    pars.m = 40;
+    pars.dtau = 0.1;
+    pars.s = 10;
+    pars.udvMethod_string = udvMethod;
+    pars.specified = {"checkerboard", "timedisplaced", "t", "U", "mu", "L", "d",
+                      "m", "dtau", "s", "udvMethod"};
+    return pars;
+}
+
+// the first sweeps in each direction size the workspace, count the
+// allocations in the following ones [down + up each]
+void checkHubbard(const std::string& udvMethod) {
+    RngWrapper rng(5555);
+    std::unique_ptr<DetHubbard> replica;
+    createReplica(replica, rng, hubbardParams(udvMethod));
+
+    for (uint32_t sw = 0; sw < 2; ++sw) {
+        replica->sweepThermalization();
+        replica->sweep(true);
+    }
+
+    allocations = 0;
+    counting = true;
+    for (uint32_t sw = 0; sw < 2; ++sw) {
+        replica->sweepThermalization();
+    }
+    counting = false;
+    if (allocations > 0) {
+        std::cerr << "hubbard, " << udvMethod << ": " << allocations
+                  << " allocation(s) in thermalization sweeps\n";
+        ++failures;
+    }
+
+    allocations = 0;
+    counting = true;
+    for (uint32_t sw = 0; sw < 2; ++sw) {
+        replica->sweep(true);
+    }
+    counting = false;
+    if (allocations > 0) {
+        std::cerr << "hubbard, " << udvMethod << ": " << allocations
+                  << " allocation(s) in measurement sweeps [time-displaced]\n";
+        ++failures;
+    }
+}
+
+ModelParamsDetSDW sdwParams() {
+    ModelParamsDetSDW pars;
+    pars.checkerboard = true;
+    pars.updateMethod_string = "delayed";
+    pars.delaySteps = 4;
+    pars.spinProposalMethod_string = "box";
+    pars.opdim = 3;
+    pars.r = -0.5;
+    pars.lambda = 1.0;
+    pars.txhor = -1.0;
+    pars.txver = -0.5;
+    pars.tyhor = 0.5;
+    pars.tyver = 1.0;
+    pars.cdwU = 1.0;
+    pars.mu = 0.5;
+    pars.L = 4;
+    pars.beta = 1.0;
+    pars.dtau = 0.1;
+    pars.s = 5;
+    pars.accRatio = 0.5;
+    pars.bc_string = "pbc";
+    pars.repeatUpdateInSlice = 1;
+    pars.globalShift = false;
+    pars.wolffClusterUpdate = false;
+    pars.wolffClusterShiftUpdate = false;
+    pars.globalUpdateInterval = 1;      // all global moves are off
+    pars.specified = {"checkerboard", "updateMethod", "delaySteps", "spinProposalMethod",
+                      "opdim", "r", "lambda", "txhor", "txver", "tyhor", "tyver", "cdwU",
+                      "mu", "L", "beta", "dtau", "s", "accRatio", "bc",
+                      "repeatUpdateInSlice", "globalShift", "wolffClusterUpdate",
+                      "wolffClusterShiftUpdate", "globalUpdateInterval"};
+    return pars;
+}
+
+// only the generic sweep and the measurements: no global updates
+void checkSDW() {
+    RngWrapper rng(5555);
+    std::unique_ptr<DetSDW<CB_ASSAAD_BERG, 3>> replica;
+    createReplica(replica, rng, sdwParams());
+
+    for (uint32_t sw = 0; sw < 2; ++sw) {
+        replica->sweep(true);
+    }
+
+    allocations = 0;
+    counting = true;
+    for (uint32_t sw = 0; sw < 2; ++sw) {
+        replica->sweep(true);
+    }
+    counting = false;
+    if (allocations > 0) {
+        std::cerr << "sdw, checkerboard, delayed: " << allocations
+                  << " allocation(s) in measurement sweeps\n";
+        ++failures;
+    }
+}
+
+} // anonymous namespace
+
+
+int main() {
+    checkHubbard("svd");
+    checkHubbard("qr");
+    checkSDW();
+
+    if (failures > 0) {
+        std::cerr << failures << " check(s) of allocation-free sweeps failed\n";
+        return 1;
+    }
+    return 0;
+}
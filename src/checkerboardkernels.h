@@ -0,0 +1,252 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  See the enclosed file LICENSE for a copy or if
+ * that was not distributed with this file, You can obtain one at
+ * http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2017 Max H. Gerlach
+ *
+ * */
+
+/*
+ * checkerboardkernels.h
+ *
+ * Low level kernels for the checkerboard multiplications of DetSDW
+ * (cb_assaad_applyBondFactors*).
+ *
+ * A plaquette of sites (i, j, k, l) mixes four rows (multiplication
+ * from the left) or four columns (multiplication from the right) of a
+ * real or complex column-major matrix with a 4x4 coefficient matrix M, stored
+ * column-major as m[a + 4*b] = M(a,b) [like arma::Mat::fixed<4,4>].
+ *
+ * Columns are contiguous in memory.  The column kernels are written
+ * with AVX-512 or AVX2+FMA intrinsics if the compiler targets these
+ * instruction sets (e.g. with -march=native), with a plain loop as the
+ * fallback and for the remainder.
+ *
+ * Rows are strided by the leading dimension of the matrix.  The row
+ * kernel processes a range of columns for a single plaquette, so the
+ * caller can loop over all plaquettes for a block of columns that stays
+ * in cache.
+ */
+
+#ifndef CHECKERBOARDKERNELS_H_
+#define CHECKERBOARDKERNELS_H_
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <armadillo>
+#if defined(__AVX512F__) || (defined(__AVX2__) && defined(__FMA__))
+#include <immintrin.h>
+#endif
+
+
+// number of columns to process at once in the row kernels
+const uint32_t cb_ColumnBlockSize = 32;
+
+// distance between subsequent columns in memory
+template<typename eT> inline
+uint32_t cb_leadingDim(const arma::Mat<eT>& A) {
+    return A.n_rows;
+}
+template<typename eT> inline
+uint32_t cb_leadingDim(const arma::subview<eT>& A) {
+    return A.m.n_rows;
+}
+
+// the real coefficient matrix of the bond factors
+// e^{dtau t_hor (ij + kl)} e^{dtau t_ver (ik + jl)} for a plaquette [i j k l],
+// with ch_* = cosh(dtau t_*), sh_* = sinh(dtau t_*).  M is symmetric.
+inline void cb_bondFactorMatrix(double* m, double ch_hor, double sh_hor, double ch_ver, double sh_ver) {
+    const double cc = ch_hor * ch_ver;
+    const double cs = ch_hor * sh_ver;
+    const double sc = ch_ver * sh_hor;
+    const double ss = sh_hor * sh_ver;
+    const double M[16] = { cc, sc, cs, ss,
+                           sc, cc, ss, cs,
+                           cs, ss, cc, sc,
+                           ss, cs, sc, cc };
+    for (uint32_t t = 0; t < 16; ++t) {
+        m[t] = M[t];
+    }
+}
+
+
+// rows i,j,k,l of A -> M * (rows i,j,k,l of A), for columns [colBegin, colEnd)
+template<typename eT, typename Coeff> inline
+void cb_plaquetteRows(eT* A, uint32_t ld, uint32_t colBegin, uint32_t colEnd,
+                      uint32_t i, uint32_t j, uint32_t k, uint32_t l, const Coeff* m) {
+    for (uint32_t c = colBegin; c < colEnd; ++c) {
+        eT* p = A + std::size_t(c) * ld;
+        const eT xi = p[i];
+        const eT xj = p[j];
+        const eT xk = p[k];
+        const eT xl = p[l];
+        p[i] = m[0]*xi + m[4]*xj + m[8]*xk  + m[12]*xl;
+        p[j] = m[1]*xi + m[5]*xj + m[9]*xk  + m[13]*xl;
+        p[k] = m[2]*xi + m[6]*xj + m[10]*xk + m[14]*xl;
+        p[l] = m[3]*xi + m[7]*xj + m[11]*xk + m[15]*xl;
+    }
+}
+
+
+// columns (ci, cj, ck, cl) -> (ci, cj, ck, cl) * M, for rows [rowBegin, n)
+template<typename eT, typename Coeff> inline
+void cb_plaquetteCols_scalar(eT* ci, eT* cj, eT* ck, eT* cl,
+                             uint32_t rowBegin, uint32_t n, const Coeff* m) {
+    for (uint32_t r = rowBegin; r < n; ++r) {
+        const eT xi = ci[r];
+        const eT xj = cj[r];
+        const eT xk = ck[r];
+        const eT xl = cl[r];
+        ci[r] = xi*m[0]  + xj*m[1]  + xk*m[2]  + xl*m[3];
+        cj[r] = xi*m[4]  + xj*m[5]  + xk*m[6]  + xl*m[7];
+        ck[r] = xi*m[8]  + xj*m[9]  + xk*m[10] + xl*m[11];
+        cl[r] = xi*m[12] + xj*m[13] + xk*m[14] + xl*m[15];
+    }
+}
+
+
+#if defined(__AVX512F__)
+
+// SIMD helpers, a vector holds 8 real or 4 complex numbers as interleaved (re, im)
+typedef __m512d cb_simd_t;
+const uint32_t cb_simd_cpx = 4;
+inline cb_simd_t cb_simd_load(const double* p) {
+    return _mm512_loadu_pd(p);
+}
+inline void cb_simd_store(double* p, cb_simd_t x) {
+    _mm512_storeu_pd(p, x);
+}
+inline cb_simd_t cb_simd_load(const std::complex<double>* p) {
+    return _mm512_loadu_pd(reinterpret_cast<const double*>(p));
+}
+inline void cb_simd_store(std::complex<double>* p, cb_simd_t x) {
+    _mm512_storeu_pd(reinterpret_cast<double*>(p), x);
+}
+inline cb_simd_t cb_simd_set1(double a) {
+    return _mm512_set1_pd(a);
+}
+// acc + a * x
+inline cb_simd_t cb_simd_fmadd(cb_simd_t a, cb_simd_t x, cb_simd_t acc) {
+    return _mm512_fmadd_pd(a, x, acc);
+}
+// complex a * x, with a = (a_re, a_im) broadcast to all elements
+inline cb_simd_t cb_simd_cmul(cb_simd_t a_re, cb_simd_t a_im, cb_simd_t x) {
+    const cb_simd_t x_swapped = _mm512_shuffle_pd(x, x, 0x55);     // (im, re)
+    return _mm512_fmaddsub_pd(x, a_re, _mm512_mul_pd(x_swapped, a_im));
+}
+inline cb_simd_t cb_simd_add(cb_simd_t x, cb_simd_t y) {
+    return _mm512_add_pd(x, y);
+}
+inline cb_simd_t cb_simd_mul(cb_simd_t a, cb_simd_t x) {
+    return _mm512_mul_pd(a, x);
+}
+#define CB_HAVE_SIMD
+
+#elif defined(__AVX2__) && defined(__FMA__)
+
+// SIMD helpers, a vector holds 4 real or 2 complex numbers as interleaved (re, im)
+typedef __m256d cb_simd_t;
+const uint32_t cb_simd_cpx = 2;
+inline cb_simd_t cb_simd_load(const double* p) {
+    return _mm256_loadu_pd(p);
+}
+inline void cb_simd_store(double* p, cb_simd_t x) {
+    _mm256_storeu_pd(p, x);
+}
+inline cb_simd_t cb_simd_load(const std::complex<double>* p) {
+    return _mm256_loadu_pd(reinterpret_cast<const double*>(p));
+}
+inline void cb_simd_store(std::complex<double>* p, cb_simd_t x) {
+    _mm256_storeu_pd(reinterpret_cast<double*>(p), x);
+}
+inline cb_simd_t cb_simd_set1(double a) {
+    return _mm256_set1_pd(a);
+}
+// acc + a * x
+inline cb_simd_t cb_simd_fmadd(cb_simd_t a, cb_simd_t x, cb_simd_t acc) {
+    return _mm256_fmadd_pd(a, x, acc);
+}
+// complex a * x, with a = (a_re, a_im) broadcast to all elements
+inline cb_simd_t cb_simd_cmul(cb_simd_t a_re, cb_simd_t a_im, cb_simd_t x) {
+    const cb_simd_t x_swapped = _mm256_permute_pd(x, 0x5);      // (im, re)
+    return _mm256_fmaddsub_pd(x, a_re, _mm256_mul_pd(x_swapped, a_im));
+}
+inline cb_simd_t cb_simd_add(cb_simd_t x, cb_simd_t y) {
+    return _mm256_add_pd(x, y);
+}
+inline cb_simd_t cb_simd_mul(cb_simd_t a, cb_simd_t x) {
+    return _mm256_mul_pd(a, x);
+}
+#define CB_HAVE_SIMD
+
+#endif
+
+
+#ifdef CB_HAVE_SIMD
+
+// columns (ci, cj, ck, cl) -> (ci, cj, ck, cl) * M, M real, columns real or complex
+template<typename eT> inline
+void cb_plaquetteCols(eT* ci, eT* cj, eT* ck, eT* cl, uint32_t n, const double* m) {
+    const uint32_t step = sizeof(cb_simd_t) / sizeof(eT);
+    cb_simd_t mv[16];
+    for (uint32_t t = 0; t < 16; ++t) {
+        mv[t] = cb_simd_set1(m[t]);
+    }
+    uint32_t r = 0;
+    for (; r + step <= n; r += step) {
+        const cb_simd_t xi = cb_simd_load(ci + r);
+        const cb_simd_t xj = cb_simd_load(cj + r);
+        const cb_simd_t xk = cb_simd_load(ck + r);
+        const cb_simd_t xl = cb_simd_load(cl + r);
+        // real coefficients act on real and imaginary parts alike
+        cb_simd_store(ci + r, cb_simd_fmadd(mv[3], xl, cb_simd_fmadd(mv[2], xk,
+                              cb_simd_fmadd(mv[1], xj, cb_simd_mul(mv[0], xi)))));
+        cb_simd_store(cj + r, cb_simd_fmadd(mv[7], xl, cb_simd_fmadd(mv[6], xk,
+                              cb_simd_fmadd(mv[5], xj, cb_simd_mul(mv[4], xi)))));
+        cb_simd_store(ck + r, cb_simd_fmadd(mv[11], xl, cb_simd_fmadd(mv[10], xk,
+                              cb_simd_fmadd(mv[9], xj, cb_simd_mul(mv[8], xi)))));
+        cb_simd_store(cl + r, cb_simd_fmadd(mv[15], xl, cb_simd_fmadd(mv[14], xk,
+                              cb_simd_fmadd(mv[13], xj, cb_simd_mul(mv[12], xi)))));
+    }
+    cb_plaquetteCols_scalar(ci, cj, ck, cl, r, n, m);
+}
+
+// columns (ci, cj, ck, cl) -> (ci, cj, ck, cl) * M, M complex
+inline void cb_plaquetteCols(std::complex<double>* ci, std::complex<double>* cj,
+                             std::complex<double>* ck, std::complex<double>* cl,
+                             uint32_t n, const std::complex<double>* m) {
+    cb_simd_t m_re[16];
+    cb_simd_t m_im[16];
+    for (uint32_t t = 0; t < 16; ++t) {
+        m_re[t] = cb_simd_set1(m[t].real());
+        m_im[t] = cb_simd_set1(m[t].imag());
+    }
+    uint32_t r = 0;
+    for (; r + cb_simd_cpx <= n; r += cb_simd_cpx) {
+        const cb_simd_t x[4] = { cb_simd_load(ci + r), cb_simd_load(cj + r),
+                                 cb_simd_load(ck + r), cb_simd_load(cl + r) };
+        std::complex<double>* out[4] = { ci + r, cj + r, ck + r, cl + r };
+        for (uint32_t a = 0; a < 4; ++a) {
+            const uint32_t t = 4*a;
+            cb_simd_t y = cb_simd_cmul(m_re[t], m_im[t], x[0]);
+            y = cb_simd_add(y, cb_simd_cmul(m_re[t+1], m_im[t+1], x[1]));
+            y = cb_simd_add(y, cb_simd_cmul(m_re[t+2], m_im[t+2], x[2]));
+            y = cb_simd_add(y, cb_simd_cmul(m_re[t+3], m_im[t+3], x[3]));
+            cb_simd_store(out[a], y);
+        }
+    }
+    cb_plaquetteCols_scalar(ci, cj, ck, cl, r, n, m);
+}
+
+#else
+
+template<typename eT, typename Coeff> inline
+void cb_plaquetteCols(eT* ci, eT* cj, eT* ck, eT* cl, uint32_t n, const Coeff* m) {
+    cb_plaquetteCols_scalar(ci, cj, ck, cl, 0, n, m);
+}
+
+#endif
+
+#endif /* CHECKERBOARDKERNELS_H_ */
@@ -0,0 +1,185 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  See the enclosed file LICENSE for a copy or if
+ * that was not distributed with this file, You can obtain one at
+ * http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2017 Max H. Gerlach
+ *
+ * */
+
+/*
+ * configstream.cpp
+ */
+
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <vector>
+#include "configstream.h"
+#include "exceptions.h"
+#include "tools.h"
+
+const uint32_t ConfigStreamHeader::CurrentVersion;
+const uint64_t ConfigStreamHeader::PayloadOffset;
+
+static const char ConfigStreamMagic[8] = {'D', 'Q', 'M', 'C', 'C', 'F', 'G', '\0'};
+
+
+ConfigStreamHeader::ConfigStreamHeader()
+    : magic(), version(0), headerSize(0), dtype(0), layout(0),
+      L(0), m(0), opdim(0), reserved(0),
+      recordSize(0), payloadOffset(0), recordCount(0)
+{
+}
+
+ConfigStreamHeader::ConfigStreamHeader(DType dtype_, uint32_t L_, uint32_t m_, uint32_t opdim_)
+    : magic(), version(CurrentVersion), headerSize(sizeof(ConfigStreamHeader)),
+      dtype(dtype_), layout(LayoutXYTimeComponent),
+      L(L_), m(m_), opdim(opdim_), reserved(0),
+      recordSize(0), payloadOffset(PayloadOffset), recordCount(0)
+{
+    std::memcpy(magic, ConfigStreamMagic, sizeof(magic));
+    recordSize = recordElements() * elementSize();
+}
+
+std::size_t ConfigStreamHeader::elementSize() const {
+    switch (dtype) {
+    case DTypeFloat64:
+        return sizeof(double);
+    case DTypeInt32:
+        return sizeof(int32_t);
+    default:
+        throw_GeneralError("Unknown configstream dtype " + numToString(dtype));
+    }
+}
+
+uint64_t ConfigStreamHeader::recordElements() const {
+    return uint64_t(L) * uint64_t(L) * uint64_t(m) * uint64_t(opdim);
+}
+
+void ConfigStreamHeader::check(const std::string& filename) const {
+    if (std::memcmp(magic, ConfigStreamMagic, sizeof(magic)) != 0) {
+        throw_GeneralError(filename + " is not a configstream file");
+    }
+    if (version != CurrentVersion or headerSize != sizeof(ConfigStreamHeader)) {
+        throw_GeneralError(filename + ": unsupported configstream version " + numToString(version));
+    }
+    if (layout != LayoutXYTimeComponent) {
+        throw_GeneralError(filename + ": unsupported configstream layout " + numToString(layout));
+    }
+    if (recordSize != recordElements() * elementSize() or recordSize == 0) {
+        throw_GeneralError(filename + ": inconsistent configstream record size");
+    }
+    if (payloadOffset < sizeof(ConfigStreamHeader) or payloadOffset % PayloadOffset != 0) {
+        throw_GeneralError(filename + ": configstream payload is not page aligned");
+    }
+}
+
+
+// number of complete records according to the file size
+static uint64_t completeRecords(const ConfigStreamHeader& header, uint64_t fileSize) {
+    if (fileSize <= header.payloadOffset) {
+        return 0;
+    }
+    return std::min(header.recordCount, (fileSize - header.payloadOffset) / header.recordSize);
+}
+
+
+ConfigStreamWriter::ConfigStreamWriter(const std::string& filename_, ConfigStreamHeader::DType dtype,
+                                       uint32_t L, uint32_t m, uint32_t opdim)
+    : filename(filename_), header(dtype, L, m, opdim), out()
+{
+    std::ifstream existing(filename.c_str(), std::ios::binary | std::ios::ate);
+    uint64_t fileSize = existing ? uint64_t(existing.tellg()) : 0;
+    if (fileSize > 0) {
+        ConfigStreamHeader stored;
+        existing.seekg(0);
+        if (not existing.read(reinterpret_cast<char*>(&stored), sizeof(stored))) {
+            throw_ReadError(filename);
+        }
+        stored.check(filename);
+        if (stored.dtype != header.dtype or stored.L != L or stored.m != m or stored.opdim != opdim) {
+            throw_GeneralError(filename + ": existing configstream has incompatible header");
+        }
+        header = stored;
+        header.recordCount = completeRecords(stored, fileSize);
+    } else {
+        // create the file
+        std::ofstream create(filename.c_str(), std::ios::binary | std::ios::trunc);
+    }
+    existing.close();
+
+    out.open(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    if (not out) {
+        std::cerr << "Could not open file " << filename << " for writing.\n";
+        std::cerr << "Error code: " << strerror(errno) << "\n";
+        return;
+    }
+    writeHeader();
+}
+
+void ConfigStreamWriter::writeHeader() {
+    std::vector<char> page(header.payloadOffset, 0);
+    std::memcpy(page.data(), &header, sizeof(header));
+    out.seekp(0);
+    out.write(page.data(), page.size());
+}
+
+void ConfigStreamWriter::writeRecord(const void* data) {
+    out.seekp(header.payloadOffset + header.recordCount * header.recordSize);
+    out.write(reinterpret_cast<const char*>(data), header.recordSize);
+    if (not out) {
+        throw_GeneralError("Could not write record to " + filename);
+    }
+    ++header.recordCount;
+    // only the header needs to be rewritten, the padding stays zero
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void ConfigStreamWriter::flush() {
+    out.flush();
+}
+
+
+ConfigStreamReader::ConfigStreamReader(const std::string& filename_)
+    : filename(filename_), header(),
+      file(filename_),          // records are mostly read in order
+      recordCount(0)
+{
+    if (file.size() < sizeof(ConfigStreamHeader)) {
+        throw_ReadError(filename);
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    header.check(filename);
+    recordCount = completeRecords(header, file.size());
+}
+
+const char* ConfigStreamReader::record(uint64_t r, ConfigStreamHeader::DType dtype) const {
+    if (header.dtype != dtype) {
+        throw_GeneralError(filename + ": requested wrong dtype");
+    }
+    if (r >= recordCount) {
+        throw_GeneralError(filename + ": record " + numToString(r) + " out of range, "
+                           + numToString(recordCount) + " records available");
+    }
+    return file.data() + header.payloadOffset + r * header.recordSize;
+}
+
+const double* ConfigStreamReader::recordFloat64(uint64_t r) const {
+    return reinterpret_cast<const double*>(record(r, ConfigStreamHeader::DTypeFloat64));
+}
+
+const int32_t* ConfigStreamReader::recordInt32(uint64_t r) const {
+    return reinterpret_cast<const int32_t*>(record(r, ConfigStreamHeader::DTypeInt32));
+}
+
+
+bool isConfigStreamFile(const std::string& filename) {
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    char magic[sizeof(ConfigStreamMagic)];
+    if (not in.read(magic, sizeof(magic))) {
+        return false;
+    }
+    return std::memcmp(magic, ConfigStreamMagic, sizeof(magic)) == 0;
+}
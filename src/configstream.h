@@ -0,0 +1,128 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  See the enclosed file LICENSE for a copy or if
+ * that was not distributed with this file, You can obtain one at
+ * http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2017 Max H. Gerlach
+ *
+ * */
+
+/*
+ * configstream.h
+ *
+ * Indexed binary container for streams of system configurations
+ * (*.configstream files).
+ *
+ * File layout:
+ *   [0, payloadOffset)   fixed header (struct ConfigStreamHeader),
+ *                        zero-padded to one page
+ *   [payloadOffset, ...) records of exactly recordSize bytes each
+ *
+ * All records have the same size, so the index is implicit: record r
+ * starts at byte payloadOffset + r * recordSize.  The header field
+ * recordCount is updated after every completely written record, a
+ * partially written trailing record (e.g. after a crash) is ignored
+ * by readers and overwritten by the next writer.
+ *
+ * payloadOffset is a multiple of the page size, so the whole file can
+ * be mmap'ed and every record is suitably aligned to be read in place
+ * as an array of doubles or int32s.
+ */
+
+#ifndef CONFIGSTREAM_H_
+#define CONFIGSTREAM_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <fstream>
+#include "mappedfile.h"
+
+
+struct ConfigStreamHeader {
+    static const uint32_t CurrentVersion = 1;
+    static const uint64_t PayloadOffset = 4096;
+
+    // element type of the records
+    enum DType : uint32_t {DTypeFloat64 = 1, DTypeInt32 = 2};
+    // order of the elements in a record, slowest index first.
+    // LayoutXYTimeComponent: for (x) for (y) for (timeslice) for (component),
+    // which is the order of the legacy *.binarystream files
+    enum Layout : uint32_t {LayoutXYTimeComponent = 1};
+
+    char magic[8];              // "DQMCCFG\0"
+    uint32_t version;
+    uint32_t headerSize;        // sizeof(ConfigStreamHeader)
+    uint32_t dtype;
+    uint32_t layout;
+    uint32_t L;                 // linear lattice size
+    uint32_t m;                 // number of imaginary time slices
+    uint32_t opdim;             // number of components per site and time slice
+    uint32_t reserved;
+    uint64_t recordSize;        // bytes per record
+    uint64_t payloadOffset;     // bytes before the first record
+    uint64_t recordCount;       // number of complete records
+
+    ConfigStreamHeader();
+    ConfigStreamHeader(DType dtype, uint32_t L, uint32_t m, uint32_t opdim);
+
+    // element size in bytes for dtype
+    std::size_t elementSize() const;
+    // number of elements per record
+    uint64_t recordElements() const;
+
+    // throw if the header is not a valid version 1 header
+    void check(const std::string& filename) const;
+};
+
+
+// Append records to a *.configstream file.  If the file exists
+// already, its header must match the given parameters and new records
+// are appended after the last complete one.
+class ConfigStreamWriter {
+public:
+    ConfigStreamWriter(const std::string& filename, ConfigStreamHeader::DType dtype,
+                       uint32_t L, uint32_t m, uint32_t opdim);
+
+    const ConfigStreamHeader& getHeader() const { return header; }
+
+    // data must point to header.recordElements() elements of the right dtype
+    void writeRecord(const void* data);
+    void flush();
+
+    explicit operator bool() const { return static_cast<bool>(out); }
+private:
+    std::string filename;
+    ConfigStreamHeader header;
+    std::fstream out;
+
+    void writeHeader();
+};
+
+
+// Read-only, zero-copy access to a *.configstream file via mmap.
+class ConfigStreamReader {
+public:
+    explicit ConfigStreamReader(const std::string& filename);
+
+    const ConfigStreamHeader& getHeader() const { return header; }
+    uint64_t getRecordCount() const { return recordCount; }
+
+    // pointers into the mapped file, valid for the lifetime of the reader
+    const double* recordFloat64(uint64_t r) const;
+    const int32_t* recordInt32(uint64_t r) const;
+private:
+    std::string filename;
+    ConfigStreamHeader header;
+    MappedFile file;
+    uint64_t recordCount;
+
+    const char* record(uint64_t r, ConfigStreamHeader::DType dtype) const;
+};
+
+
+// true if the file starts with the magic bytes of a *.configstream file
+bool isConfigStreamFile(const std::string& filename);
+
+
+#endif /* CONFIGSTREAM_H_ */
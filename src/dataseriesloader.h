@@ -23,6 +23,7 @@
 #include <sstream>
 #include <cstdlib>
 #include <memory>
+#include <algorithm>
 #include "exceptions.h"
 #include "tools.h"
 #pragma GCC diagnostic push
@@ -31,6 +32,9 @@
 #include "boost/algorithm/string.hpp"   //trimming
 #pragma GCC diagnostic pop
 #include "metadata.h"
+#include "binaryseries.h"
+#include "mappedfile.h"
+#include "textscan.h"
 
 
 //reads in ASCII formated data
@@ -39,10 +43,20 @@
 //finds number of columns from the first line of data.
 //also supports a block of meta data at the beginning in the format
 // # key = val
-//if subsample > 1: take only one from @subsample lines
+//if subsample > 1: take only one from @subsample lines [see seriesRowKept()]
 //if discardData > 0: leave out the first @discardData lines
 //if sizeHint > 0: preallocate space for (sizeHind - discardData) / subsample
 //   samples
+//files in the binary columnar format of binaryseries.h are detected by
+//their magic bytes and read directly, with the same options
+//Subsampling, the same for all readers: the lines after the discarded part
+//are counted from 0.  Line i is kept if i % subsample == 0 when nothing is
+//discarded, else if (i + 1) % subsample == 0 [as the original line based
+//reader has always done it]
+inline bool seriesRowKept(uint64_t i, uint32_t subsample, uint32_t discardData) {
+    return (i + (discardData > 0 ? 1 : 0)) % subsample == 0;
+}
+
 template <typename ValueType>
 class DataSeriesLoader {
 public:
@@ -68,6 +82,9 @@ private:
     int columns;
     std::vector<TimeSeriesPtr> data;
     MetadataMap meta;
+
+    void readFromBinaryFile(const std::string& filename, uint32_t subsample,
+                            uint32_t discardData, uint32_t readMaxData);
 };
 
 template <typename ValueType>
@@ -94,6 +111,10 @@ void DataSeriesLoader<ValueType>::readFromFile(
     uint32_t readMaxData, uint32_t sizeHint)
 {
     using namespace std;
+    if (isBinarySeriesFile(filename)) {
+        readFromBinaryFile(filename, subsample, discardData, readMaxData);
+        return;
+    }
     ifstream input(filename.c_str());
     if (not input) {
         throw_ReadError(filename);
@@ -176,6 +197,68 @@ void DataSeriesLoader<ValueType>::readFromFile(
     }
 }
 
+//binary format: rows are selected by seriesRowKept() like the lines
+//of the ASCII format
+template <typename ValueType>
+void DataSeriesLoader<ValueType>::readFromBinaryFile(
+    const std::string& filename, uint32_t subsample, uint32_t discardData,
+    uint32_t readMaxData)
+{
+    using namespace std;
+    ifstream input(filename.c_str(), ios::binary);
+    if (not input) {
+        throw_ReadError(filename);
+    }
+    data.clear();
+    BinarySeriesHeader header = readBinarySeriesHeader(input, filename);
+
+    //the header text has the same lines as in the ASCII format,
+    //strip the leading '#' like above
+    string configLines;
+    stringstream headerStream(header.headerText);
+    string line;
+    while (getline(headerStream, line)) {
+        boost::algorithm::trim_left(line);
+        if (not line.empty() and line[0] == '#') {
+            line[0] = ' ';
+        }
+        configLines += line + '\n';
+    }
+    meta = parseMetadataBlock(configLines);
+
+    columns = int(header.columnNames.size());
+    for (int c = 0; c < columns; ++c) {
+        data.push_back(TimeSeriesPtr(new vector<ValueType>));
+    }
+    if (subsample == 0) {
+        subsample = 1;
+    }
+
+    uint64_t rowsSeen = 0;          // total, including the discarded ones
+    uint64_t rowsConsidered = 0;    // after the discarded part
+    uint64_t rows = 0;
+    vector<double> chunk;
+    while ((readMaxData == 0 or rowsConsidered < readMaxData) and
+           readBinarySeriesChunk(input, filename, uint32_t(columns), rows, chunk)) {
+        uint64_t first = 0;
+        if (rowsSeen < discardData) {
+            first = std::min<uint64_t>(rows, discardData - rowsSeen);
+        }
+        uint64_t last = rows;
+        if (readMaxData > 0) {
+            last = std::min<uint64_t>(rows, first + (readMaxData - rowsConsidered));
+        }
+        for (uint64_t r = first; r < last; ++r, ++rowsConsidered) {
+            if (seriesRowKept(rowsConsidered, subsample, discardData)) {
+                for (int c = 0; c < columns; ++c) {
+                    data[c]->push_back(ValueType(chunk[uint64_t(c) * rows + r]));
+                }
+            }
+        }
+        rowsSeen += rows;
+    }
+}
+
 template<typename ValueType>
 typename DataSeriesLoader<ValueType>::TimeSeriesPtr DataSeriesLoader<ValueType>::getData(int column) {
     return data[column];
@@ -199,145 +282,100 @@ MetadataMap DataSeriesLoader<ValueType>::getMetadataMap() {
 
 typedef DataSeriesLoader<double> DoubleSeriesLoader;
 
-//for doubles use a faster implementation
+//for doubles use a faster implementation:
+//the file is mapped into memory and scanned in place, without
+//stringstreams and without copying it.  Lines that are discarded or
+//skipped by subsampling [seriesRowKept()] are not parsed at all.
 template<> inline
 void DataSeriesLoader<double>::readFromFile(
        const std::string& filename, uint32_t subsample, uint32_t discardData,
        uint32_t readMaxData, uint32_t sizeHint) {
     using namespace std;
-    ifstream input(filename.c_str());
-    if (not input) {
-        throw_ReadError(filename);
+    if (isBinarySeriesFile(filename)) {
+        readFromBinaryFile(filename, subsample, discardData, readMaxData);
+        return;
     }
+    MappedFile file(filename);
+    const char* p = file.begin();
+    const char* const end = file.end();
     data.clear();
-    //// this was nonsense
-    // if (sizeHint > 0) {
-    //     data->reserve((sizeHint - discardData) / subsample);
-    // }
-    string line;
-    string configLines;
-    while (getline(input, line)) {
-        boost::algorithm::trim_left(line);
-        if (line[0] == '#') {
-            //interpret lines starting with # as meta data
-            //(only at the beginning of the file)
-            line[0] = ' ';
-            line += '\n';
-            configLines += line;
-        } else if (line != "") {
-            //skip empty lines all together
-            //from the remaining parse data
+    columns = 0;
+    if (subsample == 0) {
+        subsample = 1;
+    }
 
-            //scan this first line of data to determine number of columns
-            columns = 0;
-            stringstream ss(line);
-            while (not ss.eof()) {
-                double val;
-                ss >> val;
-                data.push_back(std::shared_ptr<vector<double>>(new vector<double>));
-                if (sizeHint > 0) {
-                    data.at(columns)->
-                        reserve((sizeHint - discardData) / subsample);
-                }
-                data.at(columns)->push_back(val);
-                ++columns;
+    //interpret lines starting with # as meta data
+    //(only at the beginning of the file), skip empty lines
+    string configLines;
+    while (p < end) {
+        const char* q = skipBlanks(p, end);
+        const char* next = nextLine(q, end);
+        if (q < end and *q == '#') {
+            configLines += ' ';
+            configLines.append(q + 1, next);
+            if (configLines[configLines.size() - 1] != '\n') {
+                configLines += '\n';
             }
-            //handle the rest of the lines below
+        } else if (q < end and *q != '\n') {
             break;
         }
+        p = next;
     }
     meta = parseMetadataBlock(configLines);
 
-    if (discardData > 0) {
-        //the line that was already read in earlier has to be discarded:
-        for (int c = 0; c < columns; ++c) data.at(c)->pop_back();
-
-        for (uint32_t linesRead = 1; input and linesRead < discardData; ++linesRead) {
-            getline(input, line);
-        }
+    //scan the first line of data to determine number of columns
+    const char* firstLineEnd = nextLine(p, end);
+    for (const char* q = skipBlanks(p, end); q < end and *q != '\n';
+         q = skipBlanks(skipToken(q, end), end)) {
+        ++columns;
     }
-
-    if (not input) {            // discarded all there is
+    if (columns == 0) {         // no data
         return;
     }
 
-    //read in the remaining data
-    //NEW: faster method using strtod instead of more general, robust, slow stringstream
-    //NEW2: read the whole remaining file into memory first, then parse that
-    streampos startPos = input.tellg();
-    input.seekg(-1, ios::end);                  //points onto the last character
-    //seek last character that is not white space:
-    while (isspace(input.peek())) {
-        input.seekg(-1, ios::cur);
+    //preallocate, estimating the number of lines from the first one
+    //if there is no sizeHint
+    uint64_t expectedLines = sizeHint;
+    if (expectedLines == 0) {
+        expectedLines = uint64_t(end - p) / uint64_t(firstLineEnd - p) + 1;
     }
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wconversion"
-    //max length of data to be read in (in char's !)
-    std::size_t length = input.tellg() - startPos + 1;
-#pragma GCC diagnostic pop
-    input.seekg(startPos);
-    char* buffer = new char[length + 1];
-    input.read(buffer, length);
-    buffer[length] = '\0';              //add null termination
-    char* tokenPointer = buffer;
-    char* newTokenPointer = tokenPointer;
-
-//  if (meta.count("samples")) {
-//      //time series file tells us how many samples are contained -> preallocate vector
-//      uint32_t samples = fromString<uint32_t>(meta["samples"]);
-//      for (int c = 0; c < columns; ++c) {
-//          (*data)[c]->resize(samples);
-//      }
-//      uint32_t index = 1;
-//      while (tokenPointer < buffer + length) {
-//          for (int c = 0; c < columns; ++c) {
-//              double val = strtod(tokenPointer, &tokenPointer);   //scans the double at tokenPointer, then sets tokenPointer to point behind the double
-//              (*((*data)[c]))[index] = val;
-//          }
-//      }
-//  } else {
-
-    // the following is zero if we have discarded initial entries, one otherwise
-    uint32_t valuesRead = (uint32_t)data.at(0)->size(); 
-    //number of samples not known beforehand, resize on the go:
-    if (subsample > 1) {
-        uint32_t samples = 1;
-        while (tokenPointer < buffer + length and (readMaxData == 0 or (valuesRead < readMaxData))) {
-            if (samples == subsample) {
-                samples = 0;
-            }
-            for (int c = 0; c < columns; ++c) {
-                //scans the double at tokenPointer, then sets newTokenPointer to point behind the double
-                double val = strtod(tokenPointer, &newTokenPointer);
-                if (tokenPointer == newTokenPointer) {
-                    // this means no conversion took place
-                    throw_GeneralError( "Could not convert token after value number " + numToString(valuesRead) );
-                }
-                tokenPointer = newTokenPointer; // next token will be after the current one
-                if (samples == 0) {
-                    data[c]->push_back(val);
-                }
-            }
-            ++valuesRead;
-            ++samples;
+    uint64_t expectedRows = (expectedLines > discardData) ? expectedLines - discardData : 0;
+    if (readMaxData > 0) {
+        expectedRows = std::min<uint64_t>(expectedRows, readMaxData);
+    }
+    for (int c = 0; c < columns; ++c) {
+        data.push_back(std::shared_ptr<vector<double>>(new vector<double>));
+        data[c]->reserve(expectedRows / subsample + 1);
+    }
+
+    uint64_t linesSeen = 0;         // data lines, including the discarded ones
+    uint32_t valuesRead = 0;        // data lines after the discarded part
+    while (p < end and (readMaxData == 0 or valuesRead < readMaxData)) {
+        const char* q = skipBlanks(p, end);
+        const char* next = nextLine(q, end);
+        p = next;
+        if (q == end or *q == '\n' or *q == '#') {
+            //skip empty lines and comments
+            continue;
         }
-    } else if (subsample == 1) {
-        while (tokenPointer < buffer + length and (readMaxData == 0 or (valuesRead < readMaxData))) {
+        if (linesSeen++ < discardData) {
+            continue;
+        }
+        if (seriesRowKept(valuesRead, subsample, discardData)) {
             for (int c = 0; c < columns; ++c) {
-                //scans the double at tokenPointer, then sets newTokenPointer to point behind the double
-                double val = strtod(tokenPointer, &newTokenPointer);
-                if (tokenPointer == newTokenPointer) {
+                q = skipBlanks(q, next);
+                double val;
+                const char* behind = scanDouble(q, next, val);
+                if (behind == q) {
                     // this means no conversion took place
                     throw_GeneralError( "Could not convert token after value number " + numToString(valuesRead) );
                 }
-                tokenPointer = newTokenPointer; // next token will be after the current one
+                q = behind;
                 data[c]->push_back(val);
             }
-            ++valuesRead;
         }
+        ++valuesRead;
     }
-//  }
-    delete[] buffer;
 }
 
 
@@ -44,14 +44,20 @@
 #include <sstream>
 #include <fstream>
 #include <cassert>
+#include <vector>
 
 #include "metadata.h"
+#include "binaryseries.h"
+#include "exceptions.h"
 
 template <class Container>
 class DataSeriesWriterSuccessive {
 public:
     //prepare the file, the following operations will append to it
-    DataSeriesWriterSuccessive(const std::string& filename, bool appendToFile = false);
+    //With SeriesFormatBinary data is stored as float64 in the binary
+    //columnar format of binaryseries.h, one chunk per call of writeData()
+    DataSeriesWriterSuccessive(const std::string& filename, bool appendToFile = false,
+                               SeriesFormat format = SeriesFormatText);
 
     //prepare the file at @filename,
     //copy the header from @headerSource
@@ -65,6 +71,8 @@ public:
     void addMeta(const std::string& key, ValueType val);
     void addMetadataMap(const MetadataMap& meta);
     void addHeaderText(const std::string& headerText);
+    //binary format only: name of the column, default: "value"
+    void setColumnName(const std::string& columnName);
     //write meta data and header text to the file
     void writeHeader();
 
@@ -74,17 +82,25 @@ public:
     //write a single data point to the file
     void writeData(typename Container::value_type value);
     void writeData(typename Container::value_type value, uint32_t floatPrecision);
-    // or just a preformatted line:
+    // or just a preformatted line [text format only]:
     void writeData(const std::string& line);    
 private:
+    SeriesFormat format;
     std::ofstream output;
     std::string header;
+    std::string columnName;
+
+    void writeBinaryChunk(const Container& data);
 };
 
 template <class Container>
 DataSeriesWriterSuccessive<Container>::
-DataSeriesWriterSuccessive(const std::string& filename, bool appendToFile)
-    : output(filename.c_str(), appendToFile ? std::ios::app : std::ios::out), header("")
+DataSeriesWriterSuccessive(const std::string& filename, bool appendToFile, SeriesFormat format_)
+    : format(format_),
+      output(filename.c_str(),
+             (appendToFile ? std::ios::app : std::ios::out) |
+             (format_ == SeriesFormatBinary ? std::ios::binary : std::ios::openmode())),
+      header(""), columnName("value")
 {
 	if (not output) {
             std::cerr << "Could not open file " << filename << " for writing.\n";
@@ -98,8 +114,11 @@ DataSeriesWriterSuccessive(
         const DataSeriesWriterSuccessive<Container>& headerSource,
         const std::string& filename,
         bool appendToFile)
-    : output(filename.c_str(), appendToFile ? std::ios::app : std::ios::out),
-      header(headerSource.header)
+    : format(headerSource.format),
+      output(filename.c_str(),
+             (appendToFile ? std::ios::app : std::ios::out) |
+             (headerSource.format == SeriesFormatBinary ? std::ios::binary : std::ios::openmode())),
+      header(headerSource.header), columnName(headerSource.columnName)
 {}
 
 template <class Container>
@@ -128,16 +147,38 @@ addHeaderText(const std::string& headerText) {
     }
 }
 
+template <class Container>
+void DataSeriesWriterSuccessive<Container>::
+setColumnName(const std::string& columnName_) {
+    columnName = columnName_;
+}
+
 template <class Container>
 void DataSeriesWriterSuccessive<Container>::
 writeHeader() {
-    output << header;
+    if (format == SeriesFormatBinary) {
+        writeBinarySeriesHeader(output, header, std::vector<std::string>(1, columnName));
+    } else {
+        output << header;
+    }
+    output.flush();
+}
+
+template <class Container>
+void DataSeriesWriterSuccessive<Container>::
+writeBinaryChunk(const Container& data) {
+    std::vector<double> column(data.cbegin(), data.cend());
+    writeBinarySeriesChunk(output, column.data(), column.size(), 1);
     output.flush();
 }
 
 template <class Container>
 void DataSeriesWriterSuccessive<Container>
 ::writeData(const Container& data) {
+    if (format == SeriesFormatBinary) {
+        writeBinaryChunk(data);
+        return;
+    }
     for (auto iter = data.cbegin(); iter != data.cend(); ++iter) {
         output << *iter << '\n';
     }
@@ -147,6 +188,11 @@ void DataSeriesWriterSuccessive<Container>
 template <class Container>
 void DataSeriesWriterSuccessive<Container>
 ::writeData(const Container& data, uint32_t floatPrecision) {
+    if (format == SeriesFormatBinary) {
+        // full precision anyway
+        writeBinaryChunk(data);
+        return;
+    }
     output.precision(floatPrecision);
     output.setf(std::ios::scientific, std::ios::floatfield);
     for (auto iter = data.cbegin(); iter != data.cend(); ++iter) {
@@ -158,6 +204,10 @@ void DataSeriesWriterSuccessive<Container>
 template <class Container>
 void DataSeriesWriterSuccessive<Container>
 ::writeData(typename Container::value_type value) {
+    if (format == SeriesFormatBinary) {
+        writeBinaryChunk(Container(1, value));
+        return;
+    }
     output << value << '\n';
     output.flush();
 }
@@ -165,6 +215,9 @@ void DataSeriesWriterSuccessive<Container>
 template <class Container>
 void DataSeriesWriterSuccessive<Container>
 ::writeData(const std::string& line) {
+    if (format == SeriesFormatBinary) {
+        throw_GeneralError("Cannot write a preformatted line to a binary time series");
+    }
     output << line << '\n';
     output.flush();
 }
@@ -173,6 +226,10 @@ void DataSeriesWriterSuccessive<Container>
 template <class Container>
 void DataSeriesWriterSuccessive<Container>
 ::writeData(typename Container::value_type value, uint32_t floatPrecision) {
+    if (format == SeriesFormatBinary) {
+        writeBinaryChunk(Container(1, value));
+        return;
+    }
     output.precision(floatPrecision);
     output.setf(std::ios::scientific, std::ios::floatfield);
     output << value << '\n';
@@ -0,0 +1,144 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  See the enclosed file LICENSE for a copy or if
+ * that was not distributed with this file, You can obtain one at
+ * http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2017 Max H. Gerlach
+ *
+ * */
+
+/*
+ * delayedupdates.h
+ *
+ * Engine for delayed updates of the Green's function in a timeslice
+ * (DetSDW::updateInSlice_delayed).
+ *
+ * Each accepted local update at a site changes G by a low-rank term
+ *     G -> G + X_j Y_j,
+ * X_j: (MSF*N x MSF), Y_j: (MSF x MSF*N), where MSF rows and columns
+ * (site + r*N, r = 0..MSF-1) of G are involved.  Up to `capacity`
+ * of these are collected in the blocks X = [X_0 X_1 ...] and
+ * Y = [Y_0; Y_1; ...] and then applied with a single matrix-matrix
+ * product G += X Y.  Until then the rows and columns of the current
+ * Green's function that are needed for the next update are computed on
+ * demand from G, X and Y.
+ *
+ * All buffers are allocated once with their full capacity.  The active
+ * parts of X and Y are addressed through their leading dimensions in
+ * direct BLAS gemm calls, so nothing is resized or copied during a
+ * delay window.
+ */
+
+#ifndef DELAYEDUPDATES_H_
+#define DELAYEDUPDATES_H_
+
+#include <cstdint>
+#include <cassert>
+#include <armadillo>
+
+
+// C = alpha * A * B + beta * C  for column-major blocks given by pointer and leading dimension
+template<typename eT> inline
+void du_gemm(uint32_t m, uint32_t n, uint32_t k,
+             eT alpha, const eT* A, uint32_t ldA, const eT* B, uint32_t ldB,
+             eT beta, eT* C, uint32_t ldC) {
+    const char trans = 'N';
+    const arma::blas_int m_ = m, n_ = n, k_ = k, ldA_ = ldA, ldB_ = ldB, ldC_ = ldC;
+    arma::blas::gemm<eT>(&trans, &trans, &m_, &n_, &k_, &alpha, A, &ldA_, B, &ldB_,
+                         &beta, C, &ldC_);
+}
+
+
+template<typename DataType, uint32_t MSF>
+class DelayedUpdates {
+public:
+    typedef arma::Mat<DataType> MatData;
+    typedef typename arma::Mat<DataType>::template fixed<MSF,MSF> MatSmall;
+
+    DelayedUpdates(uint32_t N_, uint32_t capacity_)
+        : N(N_), capacity(capacity_), count(0),
+          X(MSF*N_, MSF*capacity_), Y(MSF*capacity_, MSF*N_),
+          R(MSF, MSF*N_), C(MSF*N_, MSF),
+          X_rows(MSF, MSF*capacity_), Y_cols(MSF*capacity_, MSF)
+    {
+        X.zeros();
+        Y.zeros();
+    }
+
+    // number of updates currently pending
+    uint32_t size() const { return count; }
+    bool full() const { return count == capacity; }
+
+    // R = rows (site + r*N) of the current Green's function g + X Y
+    const MatData& computeRows(const MatData& g, uint32_t site) {
+        for (uint32_t r = 0; r < MSF; ++r) {
+            R.row(r) = g.row(site + r*N);
+        }
+        if (count > 0) {
+            for (uint32_t r = 0; r < MSF; ++r) {
+                X_rows.row(r).head(MSF*count) = X.row(site + r*N).head(MSF*count);
+            }
+            du_gemm<DataType>(MSF, MSF*N, MSF*count,
+                              DataType(1), X_rows.memptr(), MSF, Y.memptr(), MSF*capacity,
+                              DataType(1), R.memptr(), MSF);
+        }
+        return R;
+    }
+
+    // C = columns (site + c*N) of the current Green's function g + X Y
+    const MatData& computeCols(const MatData& g, uint32_t site) {
+        for (uint32_t c = 0; c < MSF; ++c) {
+            C.col(c) = g.col(site + c*N);
+        }
+        if (count > 0) {
+            for (uint32_t c = 0; c < MSF; ++c) {
+                Y_cols.col(c).head(MSF*count) = Y.col(site + c*N).head(MSF*count);
+            }
+            du_gemm<DataType>(MSF*N, MSF, MSF*count,
+                              DataType(1), X.memptr(), MSF*N, Y_cols.memptr(), MSF*capacity,
+                              DataType(1), C.memptr(), MSF*N);
+        }
+        return C;
+    }
+
+    // Record the update at site, with the rows R and columns C computed
+    // for this site just before:
+    //     X_j = C delta,    Y_j = M^{-1} (R - 1_site)
+    void push(uint32_t site, const MatSmall& delta, const MatSmall& M_inv) {
+        assert(count < capacity);
+        for (uint32_t r = 0; r < MSF; ++r) {
+            R(r, site + r*N) -= DataType(1);
+        }
+        du_gemm<DataType>(MSF*N, MSF, MSF,
+                          DataType(1), C.memptr(), MSF*N, delta.memptr(), MSF,
+                          DataType(0), X.colptr(MSF*count), MSF*N);
+        du_gemm<DataType>(MSF, MSF*N, MSF,
+                          DataType(1), M_inv.memptr(), MSF, R.memptr(), MSF,
+                          DataType(0), Y.memptr() + MSF*count, MSF*capacity);
+        ++count;
+    }
+
+    // g += X Y for all pending updates
+    void flush(MatData& g) {
+        if (count > 0) {
+            du_gemm<DataType>(MSF*N, MSF*N, MSF*count,
+                              DataType(1), X.memptr(), MSF*N, Y.memptr(), MSF*capacity,
+                              DataType(1), g.memptr(), MSF*N);
+            count = 0;
+        }
+    }
+
+private:
+    uint32_t N;
+    uint32_t capacity;
+    uint32_t count;     // pending updates, X.cols(0, MSF*count-1) and Y.rows(0, MSF*count-1) are valid
+    MatData X;          // MSF*N x MSF*capacity
+    MatData Y;          // MSF*capacity x MSF*N
+    MatData R;          // rows of the current Green's function
+    MatData C;          // columns of the current Green's function
+    MatData X_rows;     // gathered rows of X for computeRows
+    MatData Y_cols;     // gathered columns of Y for computeCols
+};
+
+
+#endif /* DELAYEDUPDATES_H_ */
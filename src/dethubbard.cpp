@@ -20,6 +20,7 @@
 #include <cmath>
 #include <complex>
 #include <cassert>
+#include <utility>          // swap
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
 #pragma GCC diagnostic ignored "-Wshadow"
@@ -45,31 +46,32 @@ void createReplica(std::unique_ptr<DetHubbard>& replica_out, RngWrapper& rng, Mo
 
 
 DetHubbard::DetHubbard(RngWrapper& rng_, const ModelParams<DetHubbard>& pars) :
-        DetModelGC<2,num,false>(pars, static_cast<uint32_t>(uint_pow(pars.L,pars.d))),
+        DetModelGC<2,num,true>(pars, static_cast<uint32_t>(uint_pow(pars.L,pars.d))),
         rng(rng_),
         checkerboard(pars.checkerboard),
-        timedisplaced(false),
+        timedisplaced(pars.timedisplaced),
         t(pars.t), U(pars.U), mu(pars.mu), L(pars.L), d(pars.d),
         z(2*d), //coordination number: 2*d
         N(static_cast<uint32_t>(uint_pow(L,d))),
         alpha(acosh(std::exp(dtau * U * 0.5))),
         neigh(d, L),
-        proptmat(N,N),
+        proptmat(N,N), proptmatInv(N,N),
+        flipGreenCol(N), flipOneMinusGreenRow(N),
         auxfield(N, m+1),                //m+1 columns of N rows
         gUp(green[GreenCompSpinUp]), gDn(green[GreenCompSpinDown]),
-        // gFwdUp(greenFwd[GreenCompSpinUp]), gFwdDn(greenFwd[GreenCompSpinDown]),
-        // gBwdUp(greenBwd[GreenCompSpinUp]), gBwdDn(greenBwd[GreenCompSpinDown]),
+        gFwdUp(greenFwd[GreenCompSpinUp]), gFwdDn(greenFwd[GreenCompSpinDown]),
+        gBwdUp(greenBwd[GreenCompSpinUp]), gBwdDn(greenBwd[GreenCompSpinDown]),
+        gTauUp(greenTau[GreenCompSpinUp]), gTauDn(greenTau[GreenCompSpinDown]),
         UdVStorageUp((*UdVStorage)[GreenCompSpinUp]), UdVStorageDn((*UdVStorage)[GreenCompSpinDown]),
         sum_GiiUp(), sum_GiiDn(), sum_GneighUp(), sum_GneighDn(), sum_GiiUpDn(),
+        sum_TrGreenTauUp(), sum_TrGreenTauDn(), sum_TrGreenDisplaced(),
         occUp(), occDn(), occTotal(), eKinetic(), ePotential(), eTotal(),
         occDouble(), localMoment(), suscq0(), zcorr(), gf(m), gf_dt(m)
 {
     gUp = MatNum(N,N);
     gDn = MatNum(N,N);
-    // gFwdUp = MatNum(N,N,m+1);
-    // gFwdDn = MatNum(N,N,m+1);
-    // gBwdUp = MatNum(N,N,m+1);
-    // gBwdDn = MatNum(N,N,m+1);
+
+    greenComponentThreads = pars.greenComponentThreads;
 
     setupRandomAuxfield();
     if (checkerboard) {
@@ -77,6 +79,7 @@ DetHubbard::DetHubbard(RngWrapper& rng_, const ModelParams<DetHubbard>& pars) :
     } else {
         setupPropTmat_direct();
     }
+    proptmatInv = arma::inv(proptmat);
     // setupUdVStorage_and_calculateGreen_skeleton(hubbardComputeBmat(this));
     setupUdVStorage_and_calculateGreen_skeleton(hubbardLeftMultiplyBmat(this));
 
@@ -98,16 +101,16 @@ DetHubbard::DetHubbard(RngWrapper& rng_, const ModelParams<DetHubbard>& pars) :
     obsVector += VectorObservable(cref(zcorr), N, "spinzCorrelationFunction", "zcorr");
 
     if (timedisplaced) {
-        // obsScalar += ScalarObservable(cref(suscq0), "susceptibilityQ0", "chi_q0");
-        // if (d == 2) {
-        //     for (uint32_t timeslice = 1; timeslice <= m; ++timeslice) {
-        //         gf_dt[timeslice - 1] = dtau * timeslice;
-        //     }
-        //     gf_dt.reshape(gf_dt.n_elem, 1);     //column vector
-        //     gf.zeros(gf_dt.n_elem);
-
-        //     obsKeyValue += KeyValueObservable(cref(gf), gf_dt, "dt", "greenFourier", "gf");
-        // }
+        obsScalar += ScalarObservable(cref(suscq0), "susceptibilityQ0", "chi_q0");
+        if (d == 2) {
+            for (uint32_t timeslice = 1; timeslice <= m; ++timeslice) {
+                gf_dt[timeslice - 1] = dtau * timeslice;
+            }
+            gf_dt.reshape(gf_dt.n_elem, 1);     //column vector
+            gf.zeros(gf_dt.n_elem);
+
+            obsKeyValue += KeyValueObservable(cref(gf), gf_dt, "dt", "greenFourier", "gf");
+        }
     }
 }
 
@@ -121,7 +124,7 @@ MetadataMap DetHubbard::prepareModelMetadataMap() const {
     MetadataMap meta;
     meta["model"] = "hubbard";
     meta["checkerboard"] = (checkerboard ? "true" : "false");
-//    meta["timedisplaced"] = (timedisplaced ? "true" : "false");
+    meta["timedisplaced"] = (timedisplaced ? "true" : "false");
 #define META_INSERT(VAR) {meta[#VAR] = numToString(VAR);}
     META_INSERT(t);
     META_INSERT(U);
@@ -506,6 +509,9 @@ void DetHubbard::initMeasurements() {
     sum_GneighUp = 0;
     sum_GneighDn = 0;
     sum_GiiUpDn = 0;
+    sum_TrGreenTauUp = 0;
+    sum_TrGreenTauDn = 0;
+    sum_TrGreenDisplaced = 0;
 }
 
 void DetHubbard::measure(uint32_t timeslice) {
@@ -537,63 +543,34 @@ void DetHubbard::measure(uint32_t timeslice) {
         zcorr[siteJ] += gUp_00 * gUp_jj - gUp_00 * gDn_jj + gDn_00 * gDn_jj - gDn_00 * gUp_jj
             - pow(gUp_0j, 2) - pow(gDn_0j, 2);
     }
+}
 
-    //susceptibility -- for revival at some later point in time
-    if (timedisplaced) {
-//		uint32_t mm = m;        // I don't understand why m can't be captured for the lambda without this line
-//		auto sumTrace = [this, mm](const CubeNum& green) -> num {
-//			num sum = 0;
-//			for (uint32_t timeslice = 1; timeslice <= mm; ++timeslice) {
-//				sum += arma::trace(green.slice(timeslice));
-//			}
-//			return sum;
-//		};
-//		num sumTrGreenUp = sumTrace(gUp);
-//		num sumTrGreenDn = sumTrace(gDn);
-//		auto sumProdTrace = [this, mm](const CubeNum& green1, const CubeNum& green2) -> num {
-//			num sum = 0;
-//			for (uint32_t timeslice = 1; timeslice <= mm; ++timeslice) {
-//				sum += arma::trace(green1.slice(timeslice) * green2.slice(timeslice));
-//			}
-//			return sum;
-//		};
-//		num sumTrGreenDisplacedUp = sumProdTrace(gBwdUp, gFwdUp);
-//		num sumTrGreenDisplacedDn = sumProdTrace(gBwdDn, gFwdDn);
-//		num trGreenUp_0 = arma::trace(gUp.slice(m));            //g(beta) = g(0)
-//		num trGreenDn_0 = arma::trace(gDn.slice(m));
-//		suscq0 = (1.0 / num(N)) * dtau * ( (trGreenUp_0 - trGreenDn_0) * (sumTrGreenUp - sumTrGreenDn)
-//				- (sumTrGreenDisplacedUp + sumTrGreenDisplacedDn)
-//		);
-	}
-
-	//for revival at some later point
-    if (timedisplaced and d == 2) {
-//        //compute the Fourier transform of the imaginary time-displaced forward Green function for
-//        //k = (pi/3, 2*pi/3) at some preset values of tau
-//        const num kx = M_PI / 3.0;
-//        const num ky = 2.0 * M_PI / 3.0;
-//        for (uint32_t timeslice = 1; timeslice < m; ++timeslice) {
-////          std::complex<num> sum(0,0);
-//            num sum = 0.0;
-//            for (uint32_t siteI = 0; siteI < N; ++siteI) {
-//                const num yI = siteI / L;
-//                const num xI = siteI % L;
-//                for (uint32_t siteJ = 0; siteJ < N; ++siteJ) {
-//                    const num yJ = siteJ / L;
-//                    const num xJ = siteJ % L;
-////                  const std::complex<num> expFactor =
-////                          std::exp(std::complex<num>(0, kx * (xJ - xI) + ky * (yJ - yI)));
-//                    const num cosFactor = std::cos(kx * (xJ - xI) + ky * (yJ - yI));
-//
-////                  sum += expFactor * gFwdUp(siteI, siteJ, timeslice);
-////                  sum += expFactor * gFwdDn(siteI, siteJ, timeslice);
-//                    sum += cosFactor * gFwdUp(siteI, siteJ, timeslice);
-//                    sum += cosFactor * gFwdDn(siteI, siteJ, timeslice);
-//                }
-//            }
-//            sum /= num(N);
-//            gf[timeslice - 1] = sum;
-//        }
+void DetHubbard::measureTimedisplaced(uint32_t timeslice) {
+    //susceptibility: integrate the connected correlation function of the
+    //z-magnetization over tau, gBwd = G(0,tau), gFwd = G(tau,0)
+    sum_TrGreenTauUp += arma::trace(gTauUp);
+    sum_TrGreenTauDn += arma::trace(gTauDn);
+    // tr(A B) = sum_ij A_ij B_ji
+    sum_TrGreenDisplaced += arma::accu(gBwdUp % arma::trans(gFwdUp))
+                          + arma::accu(gBwdDn % arma::trans(gFwdDn));
+
+    if (d == 2) {
+        //compute the Fourier transform of the imaginary time-displaced forward Green function for
+        //k = (pi/3, 2*pi/3)
+        const num kx = M_PI / 3.0;
+        const num ky = 2.0 * M_PI / 3.0;
+        num sum = 0.0;
+        for (uint32_t siteI = 0; siteI < N; ++siteI) {
+            const num yI = siteI / L;
+            const num xI = siteI % L;
+            for (uint32_t siteJ = 0; siteJ < N; ++siteJ) {
+                const num yJ = siteJ / L;
+                const num xJ = siteJ % L;
+                const num cosFactor = std::cos(kx * (xJ - xI) + ky * (yJ - yI));
+                sum += cosFactor * (gFwdUp(siteI, siteJ) + gFwdDn(siteI, siteJ));
+            }
+        }
+        gf[timeslice - 1] = sum / num(N);
     }
 }
 
@@ -609,6 +586,14 @@ void DetHubbard::finishMeasurements() {
     eTotal = eKinetic + ePotential;
 
     zcorr /= num(m);
+
+    if (timedisplaced) {
+        //green is G(0) = G(beta) after the sweep
+        const num trGreenUp_0 = arma::trace(gUp);
+        const num trGreenDn_0 = arma::trace(gDn);
+        suscq0 = (1.0 / num(N)) * dtau * ( (trGreenUp_0 - trGreenDn_0) * (sum_TrGreenTauUp - sum_TrGreenTauDn)
+                                           - sum_TrGreenDisplaced );
+    }
 }
 
 
@@ -850,6 +835,103 @@ inline MatNum DetHubbard::computeBmat(uint32_t k2, uint32_t k1, Spin spinz) cons
     return B;
 }
 
+void DetHubbard::scaleRowsByPotential(MatNum& x, uint32_t timeslice, num sign) const {
+    for (uint32_t i = 0; i < N; ++i) {
+        x.row(i) *= std::exp(sign * alpha * num(auxfield(i, timeslice)));
+    }
+}
+
+void DetHubbard::scaleColsByPotential(MatNum& x, uint32_t timeslice, num sign) const {
+    for (uint32_t i = 0; i < N; ++i) {
+        x.col(i) *= std::exp(sign * alpha * num(auxfield(i, timeslice)));
+    }
+}
+
+// B(k2,k1) = e^V(k2) proptmat e^V(k2-1) proptmat ... e^V(k1+1) proptmat
+//
+// In the following the first intermediate result is put into out or into
+// the scratch matrix such that the last one ends up in out.
+
+void DetHubbard::leftMultiplyBmat(uint32_t gc, MatNum& out, const MatNum& in, uint32_t k2, uint32_t k1) {
+    assert(k2 >= k1);
+    assert(k2 <= m);
+    if (k2 == k1) {
+        out = in;
+        return;
+    }
+    const num sign = (gc == GreenCompSpinUp) ? num(int(Spin::Up)) : num(int(Spin::Down));
+    MatNum* dst = ((k2 - k1) % 2 == 1) ? &out : &workspace[gc].bmat_temp_1;
+    MatNum* other = (dst == &out) ? &workspace[gc].bmat_temp_1 : &out;
+    const MatNum* src = &in;
+    for (uint32_t k = k1 + 1; k <= k2; ++k) {
+        *dst = proptmat * (*src);
+        scaleRowsByPotential(*dst, k, sign);
+        src = dst;
+        std::swap(dst, other);
+    }
+}
+
+void DetHubbard::rightMultiplyBmat(uint32_t gc, MatNum& out, const MatNum& in, uint32_t k2, uint32_t k1) {
+    assert(k2 >= k1);
+    assert(k2 <= m);
+    if (k2 == k1) {
+        out = in;
+        return;
+    }
+    const num sign = (gc == GreenCompSpinUp) ? num(int(Spin::Up)) : num(int(Spin::Down));
+    MatNum* dst = ((k2 - k1) % 2 == 0) ? &out : &workspace[gc].bmat_temp_1;
+    MatNum* other = (dst == &out) ? &workspace[gc].bmat_temp_1 : &out;
+    *dst = in;
+    scaleColsByPotential(*dst, k2, sign);
+    for (uint32_t k = k2; k >= k1 + 1; --k) {
+        *other = (*dst) * proptmat;
+        std::swap(dst, other);
+        if (k > k1 + 1) {
+            scaleColsByPotential(*dst, k - 1, sign);
+        }
+    }
+}
+
+void DetHubbard::leftMultiplyBmatInv(uint32_t gc, MatNum& out, const MatNum& in, uint32_t k2, uint32_t k1) {
+    assert(k2 >= k1);
+    assert(k2 <= m);
+    if (k2 == k1) {
+        out = in;
+        return;
+    }
+    const num sign = (gc == GreenCompSpinUp) ? num(int(Spin::Up)) : num(int(Spin::Down));
+    MatNum* dst = ((k2 - k1) % 2 == 0) ? &out : &workspace[gc].bmat_temp_1;
+    MatNum* other = (dst == &out) ? &workspace[gc].bmat_temp_1 : &out;
+    *dst = in;
+    scaleRowsByPotential(*dst, k2, -sign);
+    for (uint32_t k = k2; k >= k1 + 1; --k) {
+        *other = proptmatInv * (*dst);
+        std::swap(dst, other);
+        if (k > k1 + 1) {
+            scaleRowsByPotential(*dst, k - 1, -sign);
+        }
+    }
+}
+
+void DetHubbard::rightMultiplyBmatInv(uint32_t gc, MatNum& out, const MatNum& in, uint32_t k2, uint32_t k1) {
+    assert(k2 >= k1);
+    assert(k2 <= m);
+    if (k2 == k1) {
+        out = in;
+        return;
+    }
+    const num sign = (gc == GreenCompSpinUp) ? num(int(Spin::Up)) : num(int(Spin::Down));
+    MatNum* dst = ((k2 - k1) % 2 == 1) ? &out : &workspace[gc].bmat_temp_1;
+    MatNum* other = (dst == &out) ? &workspace[gc].bmat_temp_1 : &out;
+    const MatNum* src = &in;
+    for (uint32_t k = k1 + 1; k <= k2; ++k) {
+        *dst = (*src) * proptmatInv;
+        scaleColsByPotential(*dst, k, -sign);
+        src = dst;
+        std::swap(dst, other);
+    }
+}
+
 //template <bool TD, bool CB>
 //MatNum DetHubbard<TD,CB>::computeBmat_checkerBoard(uint32_t k2, uint32_t k1,
 //      Spin spinz) const {
@@ -908,23 +990,25 @@ inline num DetHubbard::weightRatioSingleFlip(uint32_t site, uint32_t timeslice)
 
 
 inline void DetHubbard::updateGreenFunctionWithFlip(uint32_t site, uint32_t timeslice) {
+    //rank-1 update in place: only the old column G(:,site) and row
+    //(1-G)(site,:) enter, keep copies of these
     auto update = [this, site](MatNum& green, num deltaSite) {
-        const MatNum& greenOld = green;     //reference
-        MatNum greenNew = green;            //copy
-        const MatNum oneMinusGreenOld = arma::eye(N,N) - greenOld;
-        num divisor = 1.0 + deltaSite * oneMinusGreenOld(site, site);
+        for (uint32_t i = 0; i < N; ++i) {
+            flipGreenCol[i] = green(i, site);
+            flipOneMinusGreenRow[i] = (i == site ? 1.0 : 0.0) - green(site, i);
+        }
+        num divisor = 1.0 + deltaSite * flipOneMinusGreenRow[site];
         num greenFactor = deltaSite / divisor;
         for (uint32_t y = 0; y < N; ++y) {
             for (uint32_t x = 0; x < N; ++x) {
-                greenNew(x, y) -=  greenOld(x, site) * greenFactor *
-                        oneMinusGreenOld(site, y);
+                green(x, y) -=  flipGreenCol[x] * greenFactor *
+                        flipOneMinusGreenRow[y];
 
                 //experimental index swap below -- this seemed to be the choice in Santos 2003
-//              greenNew(x, y) -=  greenOld(site, y) * greenFactor *
+//              green(x, y) -=  greenOld(site, y) * greenFactor *
 //                      oneMinusGreenOld(x, site);
             }
         }
-        green = greenNew;
     };
 
     using std::exp;
@@ -952,13 +1036,25 @@ void DetHubbard::sweepSimpleThermalization() {
 
 
 void DetHubbard::sweep(bool takeMeasurements) {
-    sweep_skeleton(takeMeasurements,
-                   hubbardLeftMultiplyBmat(this), hubbardRightMultiplyBmat(this),
-                   hubbardLeftMultiplyBmatInv(this), hubbardRightMultiplyBmatInv(this),
-                   [this](uint32_t timeslice) {this->updateInSlice(timeslice);},
-                   [this]() {this->initMeasurements();},
-                   [this](uint32_t timeslice) {this->measure(timeslice);},
-                   [this]() {this->finishMeasurements();});
+    if (timedisplaced) {
+        sweep_skeleton(takeMeasurements,
+                       hubbardLeftMultiplyBmat(this), hubbardRightMultiplyBmat(this),
+                       hubbardLeftMultiplyBmatInv(this), hubbardRightMultiplyBmatInv(this),
+                       [this](uint32_t timeslice) {this->updateInSlice(timeslice);},
+                       [this]() {this->initMeasurements();},
+                       [this](uint32_t timeslice) {this->measure(timeslice);},
+                       [this]() {this->finishMeasurements();},
+                       VoidNoOp(), VoidNoOp(),
+                       [this](uint32_t timeslice) {this->measureTimedisplaced(timeslice);});
+    } else {
+        sweep_skeleton(takeMeasurements,
+                       hubbardLeftMultiplyBmat(this), hubbardRightMultiplyBmat(this),
+                       hubbardLeftMultiplyBmatInv(this), hubbardRightMultiplyBmatInv(this),
+                       [this](uint32_t timeslice) {this->updateInSlice(timeslice);},
+                       [this]() {this->initMeasurements();},
+                       [this](uint32_t timeslice) {this->measure(timeslice);},
+                       [this]() {this->finishMeasurements();});
+    }
 }
 
 
@@ -54,7 +54,7 @@ void createReplica(std::unique_ptr<DetHubbard>& replica_out, RngWrapper& rng, Mo
 
 
 
-class DetHubbard : public DetModelGC<2, num, false> {
+class DetHubbard : public DetModelGC<2, num, true> {
 private:
     //only initialize with the "factory" function ::createReplica() declared above.
     //Give a reference to the RNG instance to be used
@@ -89,6 +89,10 @@ public:
         (void)directory;
         throw_GeneralError("DetHubbard::saveConfigurationStreamBinary not implemented");
     }
+    void saveConfigurationStreamIndexed(const std::string& directory = ".") {
+        (void)directory;
+        throw_GeneralError("DetHubbard::saveConfigurationStreamIndexed not implemented");
+    }
     void saveConfigurationStreamTextHeader(const std::string& simInfoHeaderText,
                                            const std::string& directory = ".") {
         (void)simInfoHeaderText; (void)directory;
@@ -100,15 +104,16 @@ public:
         throw_GeneralError("DetHubbard::saveConfigurationStreamBinaryHeaderfile not implemented");
     }
 protected:
-    typedef DetModelGC<2, num, false> Base;
+    typedef DetModelGC<2, num, true> Base;
     // stupid C++ weirdness forces us to explicitly "import" these protected base
     // class member variables:
     // (see: http://stackoverflow.com/questions/11405/gcc-problem-using-a-member-of-a-base-class-that-depends-on-a-template-argument )
     using Base::dtau;
     using Base::m;
     using Base::green;
-    // using Base::greenFwd;
-    // using Base::greenBwd;
+    using Base::greenFwd;
+    using Base::greenBwd;
+    using Base::greenTau;
     using Base::UdVStorage;
     using Base::lastSweepDir;
     using Base::obsScalar;
@@ -116,6 +121,7 @@ protected:
     using Base::obsKeyValue;
     using Base::beta;
     using Base::s;
+    using Base::workspace;
 
     enum class Spin: int {Up = +1, Down = -1};
     enum {GreenCompSpinUp = 0, GreenCompSpinDown = 1};
@@ -145,6 +151,11 @@ protected:
     //for spin up or spin down -- tmat
     // related propagator e ** (-dtau * tmat):
     MatNum proptmat;
+    // and its inverse e ** (+dtau * tmat):
+    MatNum proptmatInv;
+    //scratch for updateGreenFunctionWithFlip(): column G(:,site) and row (1-G)(site,:)
+    VecNum flipGreenCol;
+    VecNum flipOneMinusGreenRow;
 
 
     //the following quantities vary during the course of the simulation
@@ -163,14 +174,16 @@ protected:
     MatNum& gUp;
     MatNum& gDn;
     
-    //Imaginary time displaced Green function
+    //Imaginary time displaced Green function, valid in measureTimedisplaced()
     // "forward" corresponds to G(tau, 0)
     // "backward" corresponds to G(0, tau)
-    //the indexing works the same way as for the equal time case
-    // MatNum& gFwdUp;
-    // MatNum& gFwdDn;
-    // MatNum& gBwdUp;
-    // MatNum& gBwdDn;
+    // "tau" is the equal-time G(tau)
+    MatNum& gFwdUp;
+    MatNum& gFwdDn;
+    MatNum& gBwdUp;
+    MatNum& gBwdDn;
+    MatNum& gTauUp;
+    MatNum& gTauDn;
 
 //  UdVnum eye_UdV; // U = d = V = 1
     std::vector<UdVnum>& UdVStorageUp;
@@ -185,6 +198,10 @@ protected:
     num sum_GneighDn;
     //used to measure double occupancy / potential energy:
     num sum_GiiUpDn;
+    //used to measure the susceptibility, summed over timeslices 1..m:
+    num sum_TrGreenTauUp;           // tr G_up(tau)
+    num sum_TrGreenTauDn;
+    num sum_TrGreenDisplaced;       // tr [G_up(0,tau) G_up(tau,0)] + tr [G_dn(0,tau) G_dn(tau,0)]
 
     //observables, values for the current auxiliary field; averaged over aux. field
     num occUp;          //occupation spin up
@@ -218,6 +235,20 @@ protected:
     //These functions naively multiply the matrices, which can be unstable.
     MatNum computeBmat(uint32_t k2, uint32_t k1, Spin spinz) const;
 
+    //out = B(k2,k1) * in, in * B(k2,k1), B(k2,k1)^{-1} * in or in * B(k2,k1)^{-1}
+    //for the green component gc, computed timeslice by timeslice without forming
+    //B(k2,k1).  The intermediate products alternate between out and
+    //workspace[gc].bmat_temp_1, so these do not allocate memory [see the
+    //contract for the callables in DetModelGC].
+    void leftMultiplyBmat(uint32_t gc, MatNum& out, const MatNum& in, uint32_t k2, uint32_t k1);
+    void rightMultiplyBmat(uint32_t gc, MatNum& out, const MatNum& in, uint32_t k2, uint32_t k1);
+    void leftMultiplyBmatInv(uint32_t gc, MatNum& out, const MatNum& in, uint32_t k2, uint32_t k1);
+    void rightMultiplyBmatInv(uint32_t gc, MatNum& out, const MatNum& in, uint32_t k2, uint32_t k1);
+    //helpers for these: multiply row [column] i of x by
+    //exp(sign * alpha * s_i(timeslice)), i.e. x := e^V x  [x := x e^V]
+    void scaleRowsByPotential(MatNum& x, uint32_t timeslice, num sign) const;
+    void scaleColsByPotential(MatNum& x, uint32_t timeslice, num sign) const;
+
     //compute the latter using a checker board decomposition with systematic
     //error of O[dtau^2]
     // -- for now this is just the same code
@@ -257,18 +288,11 @@ protected:
     void initMeasurements();				//reset stored observable values (beginning of a sweep)
     void measure(uint32_t timeslice);		//measure observables for one timeslice
     void finishMeasurements();				//finalize stored observable values (end of a sweep)
+    void measureTimedisplaced(uint32_t timeslice);  //time-displaced observables for tau = dtau*timeslice
 
     virtual void consistencyCheck();
 
     
-    //Given B(beta, tau) = V_l d_l U_l and B(tau, 0) = U_r d_r V_r
-    //calculate a tuple of four NxN matrices (a,b,c,d) with
-    // a = G(0), b = -(1-G(0))*B^(-1)(tau,0), c = B(tau,0)*G(0), d = G(tau)
-    //b is the backward time-displaced Green function; c the forward time-
-    //displaced Green function; d is the equal-time Green function
-//  typedef std::tuple<MatNum,MatNum,MatNum,MatNum> MatNum4;
-//  MatNum4 greenFromUdV_timedisplaced(const UdVnum& UdV_l, const UdVnum& UdV_r) const;
-
     //use a faster method that does not yield information about the time-displaced
     //Green functions
 //  MatNum greenFromUdV(const UdVnum& UdV_l, const UdVnum& UdV_r) const;
@@ -301,8 +325,8 @@ protected:
         hubbardLeftMultiplyBmat(DetHubbard* parent_) :
             parent(parent_)
         { }
-        MatNum operator()(uint32_t gc, const MatNum& mat, uint32_t k2, uint32_t k1) {
-            return hubbardComputeBmat(parent)(gc, k2, k1) * mat;
+        void operator()(uint32_t gc, MatNum& out, const MatNum& mat, uint32_t k2, uint32_t k1) {
+            parent->leftMultiplyBmat(gc, out, mat, k2, k1);
         }
     };
 
@@ -311,8 +335,8 @@ protected:
         hubbardRightMultiplyBmat(DetHubbard* parent_) :
             parent(parent_)
         { }
-        MatNum operator()(uint32_t gc, const MatNum& mat, uint32_t k2, uint32_t k1) {
-            return mat * hubbardComputeBmat(parent)(gc, k2, k1);
+        void operator()(uint32_t gc, MatNum& out, const MatNum& mat, uint32_t k2, uint32_t k1) {
+            parent->rightMultiplyBmat(gc, out, mat, k2, k1);
         }
     };
 
@@ -321,8 +345,8 @@ protected:
         hubbardLeftMultiplyBmatInv(DetHubbard* parent_) :
             parent(parent_)
         { }
-        MatNum operator()(uint32_t gc, const MatNum& mat, uint32_t k2, uint32_t k1) {
-            return arma::inv(hubbardComputeBmat(parent)(gc, k2, k1)) * mat;
+        void operator()(uint32_t gc, MatNum& out, const MatNum& mat, uint32_t k2, uint32_t k1) {
+            parent->leftMultiplyBmatInv(gc, out, mat, k2, k1);
         }
     };
 
@@ -331,8 +355,8 @@ protected:
         hubbardRightMultiplyBmatInv(DetHubbard* parent_) :
             parent(parent_)
         { }
-        MatNum operator()(uint32_t gc, const MatNum& mat, uint32_t k2, uint32_t k1) {
-            return mat * arma::inv(hubbardComputeBmat(parent)(gc, k2, k1));
+        void operator()(uint32_t gc, MatNum& out, const MatNum& mat, uint32_t k2, uint32_t k1) {
+            parent->rightMultiplyBmatInv(gc, out, mat, k2, k1);
         }
     };
 
@@ -10,6 +10,7 @@
 #include "dethubbardparams.h"
 
 #include <vector>
+#include <iostream>
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
 #pragma GCC diagnostic ignored "-Wshadow"
@@ -17,6 +18,16 @@
 #pragma GCC diagnostic pop
 
 
+void ModelParams<DetHubbard>::takeRuntimeParameters(const ModelParams& current, bool verbose) {
+    if (current.greenComponentThreads != greenComponentThreads) {
+        if (verbose) {
+            std::cout << "greenComponentThreads will be changed from " << greenComponentThreads
+                      << " to " << current.greenComponentThreads << std::endl;
+        }
+        greenComponentThreads = current.greenComponentThreads;
+    }
+}
+
 void ModelParams<DetHubbard>::check() {
     //check parameters: passed all that are necessary
     using namespace boost::assign;
@@ -38,9 +49,19 @@ void ModelParams<DetHubbard>::check() {
     if (checkerboard and d != 2) {
         throw_ParameterWrong_message("Checker board decomposition only supported for 2d lattices");
     }
+    if (greenComponentThreads == 0) {
+        throw_ParameterWrong("greenComponentThreads", greenComponentThreads);
+    }
     if (bc != "pbc") {
         throw_ParameterWrong_message("Boundary conditions " + bc + " not supported for Hubbard model (only pbc)");
     }
+    if (udvMethod_string == "svd") {
+        udvMethod = UDV_SVD;
+    } else if (udvMethod_string == "qr") {
+        udvMethod = UDV_QR;
+    } else {
+        throw_ParameterWrong("udvMethod", udvMethod_string);
+    }
 
     //check that only positive values are passed for certain parameters
 #define IF_NOT_POSITIVE(x) if (specified.count(#x) > 0 and x <= 0)
@@ -60,7 +81,7 @@ MetadataMap ModelParams<DetHubbard>::prepareMetadataMap() const {
     MetadataMap meta;
     meta["model"] = "hubbard";
     meta["checkerboard"] = (checkerboard ? "true" : "false");
-//    meta["timedisplaced"] = (timedisplaced ? "true" : "false");
+    meta["timedisplaced"] = (timedisplaced ? "true" : "false");
 #define META_INSERT(VAR) {meta[#VAR] = numToString(VAR);}
     META_INSERT(t);
     META_INSERT(U);
@@ -71,6 +92,8 @@ MetadataMap ModelParams<DetHubbard>::prepareMetadataMap() const {
     META_INSERT(m);
     META_INSERT(dtau);
     META_INSERT(s);
+    META_INSERT(greenComponentThreads);
+    meta["udvMethod"] = udvMethod_string;
 #undef META_INSERT
     return meta;
 }
@@ -25,6 +25,8 @@ struct ModelParams<DetHubbard> {
     std::string model;          // should be hubbard
 
     bool checkerboard;
+    bool timedisplaced;         // measure time-displaced observables (susceptibility), default: false
+    uint32_t greenComponentThreads; // number of OpenMP threads to wrap / stabilize the spin up and down Green's functions concurrently, default: 1
 
     num t;
     num U;
@@ -38,28 +40,46 @@ struct ModelParams<DetHubbard> {
     uint32_t s;     //separation of timeslices where the Green function is calculated
                     //from scratch
     std::string bc;
+    std::string udvMethod_string;   // "svd" or "qr": decomposition used for numerical stabilization
+    UdVMethod udvMethod;
 
     std::set<std::string> specified;
 
     ModelParams() :
-        model("hubbard"), checkerboard(),
+        model("hubbard"), checkerboard(), timedisplaced(false), greenComponentThreads(1),
         t(), U(), mu(), L(), d(), beta(), m(), dtau(), s(), bc("pbc"),
+        udvMethod_string("svd"), udvMethod(UDV_SVD),
         specified()
     { }
     
     void check();
     MetadataMap prepareMetadataMap() const;
+
+    //on resuming from a state file: take the runtime-only parameters
+    //[greenComponentThreads] from the current invocation
+    void takeRuntimeParameters(const ModelParams& current, bool verbose = true);
 private:
     friend class boost::serialization::access;
 
+    //version 1: udvMethod; version 2: timedisplaced; version 3:
+    //greenComponentThreads.  Older state files keep the defaults for these
     template<class Archive>
     void serialize(Archive& ar, const uint32_t version) {
-        (void)version;
-        ar  & model & checkerboard
-            & t & U & mu & L & d & beta & m
-            & dtau & s & bc
-            & specified;            
+        ar  & model & checkerboard;
+        if (version >= 2) {
+            ar & timedisplaced;
+        }
+        if (version >= 3) {
+            ar & greenComponentThreads;
+        }
+        ar  & t & U & mu & L & d & beta & m
+            & dtau & s & bc;
+        if (version >= 1) {
+            ar & udvMethod_string & udvMethod;
+        }
+        ar  & specified;
     }    
 };
+BOOST_CLASS_VERSION(ModelParams<DetHubbard>, 3)
 
 #endif /* DETHUBBARDPARAMS_H */
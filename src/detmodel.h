@@ -27,6 +27,7 @@
 #include <armadillo>
 #include <cassert>
 #include <type_traits>          // std::is_same
+#include <exception>            // exception_ptr
 
 #include "tools.h"
 #include "toolsdebug.h"
@@ -172,8 +173,14 @@ public:
 //
 //ValueType can be a complex number if the Green function is not purely real
 //
+//The green components are independent during the wrapping and stabilization
+//steps of a sweep.  With greenComponentThreads > 1 these are processed on
+//separate OpenMP threads, synchronizing at each timeslice before the local
+//updates, which need all components.
+//
 //if TimeDisplaced==true: generate code that evaluates time-displaced green
-//functions in the sweep
+//functions in the sweep [after each sweep with measurements, in a separate
+//pass over all timeslices at fixed auxiliary fields, see timedisplacedPassUp/Down]
 //
 //This provides template functions like sweep_skeleton<>() that expect callable template
 //arguments for routines that compute B-matrices etc.  A derived class that provides
@@ -224,12 +231,14 @@ public:
 
     //perform a sweep as suggested in the text by Assaad with stable computation
     //of Green functions, alternate between sweeping up and down in imaginary time.
-    //  /* at some point Will give equal-time and time-displaced Green functions if TimeDisplace == ture */.
+    //Gives equal-time and -- if TimeDisplaced == true and a time-displaced
+    //measurement callable is passed -- time-displaced Green functions.
     //if takeMeasurements == true : perform observable measurements
      //
-    //*_Callable_GC_mat_k2_k1: take arguments green-component, some matrix,
-    //                         time slices k2 > k1
-    //      -> return left/right product of matrix with Bmat or Bmat-inverse
+    //*_Callable_GC_mat_k2_k1: take arguments green-component, output matrix,
+    //                         input matrix, time slices k2 > k1
+    //      -> store left/right product of input matrix with Bmat or Bmat-inverse
+    //         in the output matrix [see the contract below]
     //      useful if a checkerboard-breakup is performed
     //Callable_UpdateInSlice_k: argument timeslice k, update fields for this timeslice
     //Callable_init: no arguments, init observable measurements for this sweep
@@ -247,12 +256,20 @@ public:
     //    Perform some sort of consistency check, comparing the two matrices,
     //    also be informed about whether we are sweeping up or down.
     //    By default: do nothing
+    //optional [only used if TimeDisplaced == true]:
+    //  Callable_measureTimedisplaced_k: argument timeslice k = 1,...,m,
+    //    take time-displaced measurement data for tau = k*dtau from
+    //    greenFwd = G(tau,0), greenBwd = G(0,tau), greenTau = G(tau), and
+    //    green = G(0).  This is called during the time-displaced pass
+    //    following each sweep with measurements, before finishMeasurement.
+    //    By default: do nothing, and skip the time-displaced pass
     template<class a_Callable_GC_mat_k2_k1, class b_Callable_GC_mat_k2_k1,
              class c_Callable_GC_mat_k2_k1, class d_Callable_GC_mat_k2_k1,
              class Callable_UpdateInSlice_k,
              class Callable_init, class Callable_measure_k, class Callable_finish,
              class Callable_GlobalUpdate = VoidNoOp,
-             class Callable_GreenConsistency = VoidNoOp>
+             class Callable_GreenConsistency = VoidNoOp,
+             class Callable_measureTimedisplaced_k = VoidNoOp>
     void sweep_skeleton(bool takeMeasurements,
     					a_Callable_GC_mat_k2_k1 leftMultiplyBmat,
                         b_Callable_GC_mat_k2_k1 rightMultiplyBmat,
@@ -262,7 +279,8 @@ public:
                         Callable_init initMeasurement, Callable_measure_k measure,
                         Callable_finish finishMeasurement,
                         Callable_GlobalUpdate globalUpdate = VoidNoOp(),
-                        Callable_GreenConsistency greenConsistencyCheck = VoidNoOp());
+                        Callable_GreenConsistency greenConsistencyCheck = VoidNoOp(),
+                        Callable_measureTimedisplaced_k measureTimedisplaced = VoidNoOp());
     //the same to be called during thermalization, may do the same or iteratively
     //adjust parameters, but does not take any measurements ever
     template<class a_Callable_GC_mat_k2_k1, class b_Callable_GC_mat_k2_k1,
@@ -283,7 +301,63 @@ protected:
     typedef arma::Col<ValueType> VecV;
     typedef arma::Cube<ValueType> CubeV;
     typedef UdV<ValueType> UdVV;
-    typedef std::tuple<MatV,MatV,MatV,MatV> MatV4;
+
+    //Scratch space for the numerically stabilized Green's function computations
+    //in the sweep (advance*Green, wrap*Green, greenFromUdV*, setupUdVStorage*).
+    //All buffers are sized sz x sz once at construction, later assignments of
+    //equally sized results reuse their memory, so these steps do not go to the
+    //allocator for their temporaries.
+    struct SweepWorkspace {
+        MatV product;       // generic product, e.g. B * U * d or (V_t_l * V_t_new)
+        MatV bmat_product;  // output of the B-matrix multiplication callables
+        MatV bmat_temp_1;   // scratch for the B-matrix multiplication callables
+        MatV bmat_temp_2;   //   of the derived class
+        MatV VU_product;    // V_r^dagger U_l
+        MatV UV_product;    // U_r^dagger V_l^{-1} [ + d_r V_r^dagger U_l d_l ]
+        MatV V;             // V = V_t^dagger of a storage entry, to be multiplied by B
+        MatV V_inv_1;       // V^{-1} buffers, only used with UDV_QR
+        MatV V_inv_2;
+        MatV U_temp;        // UdV-decomposition of the inverse Green's function
+        MatV V_t_temp;
+        MatV g_wrapped;     // copy of green for consistency checks
+        UdVV UdV_temp;      // new entry for the UdV storage
+        UdVWorkspace<ValueType> udv;    // Lapack scratch for sz x sz decompositions
+        // only allocated by allocateTimedisplaced() on the first time-displaced pass
+        MatV td_M;          // 2sz x 2sz block matrix, decomposed as td_U diag(td_d) td_V_t^dagger
+        MatV td_U;
+        VecNum td_d;
+        MatV td_V_t;
+        MatV td_X;          // V_M^{-1} diag(1/d_M)
+        MatV td_Xrows;      // sz x 2sz row blocks of td_X and td_U
+        MatV td_Urows;
+        MatV td_product;    // sz x sz
+        UdVV td_UdV;        // the decompositions built up on the fly during the pass
+        UdVWorkspace<ValueType> td_udv; // Lapack scratch for 2sz x 2sz decompositions
+        SweepWorkspace(uint32_t sz) :
+            product(sz, sz), bmat_product(sz, sz), bmat_temp_1(sz, sz), bmat_temp_2(sz, sz),
+            VU_product(sz, sz), UV_product(sz, sz),
+            V(sz, sz), V_inv_1(sz, sz), V_inv_2(sz, sz), U_temp(sz, sz), V_t_temp(sz, sz),
+            g_wrapped(), UdV_temp(sz), udv(),
+            td_M(), td_U(), td_d(), td_V_t(), td_X(), td_Xrows(), td_Urows(), td_product(),
+            td_UdV(), td_udv()
+        {
+            udv.setSize(sz);
+        }
+        void allocateTimedisplaced(uint32_t sz) {
+            if (td_M.n_rows != 2*sz) {
+                td_M.set_size(2*sz, 2*sz);
+                td_U.set_size(2*sz, 2*sz);
+                td_d.set_size(2*sz);
+                td_V_t.set_size(2*sz, 2*sz);
+                td_X.set_size(2*sz, 2*sz);
+                td_Xrows.set_size(sz, 2*sz);
+                td_Urows.set_size(sz, 2*sz);
+                td_product.set_size(sz, sz);
+                td_UdV = UdVV(sz);
+                td_udv.setSize(2*sz);
+            }
+        }
+    };
 
 //    //update the auxiliary field and the green function in the single timeslice
 //    virtual void updateInSlice(uint32_t timeslice) = 0;
@@ -293,13 +367,20 @@ protected:
 //        updateInSlice(timeslice);
 //    }
 
-    //Given B(beta, tau) = V_l d_l U_l and B(tau, 0) = U_r d_r V_r
-    //calculate a tuple of four NxN matrices (a,b,c,d) with
-    // a = G(0), b = -(1-G(0))*B^(-1)(tau,0), c = B(tau,0)*G(0), d = G(tau)
-    //b is the backward time-displaced Green function; c the forward time-
-    //displaced Green function; d is the equal-time Green function
-    //todo: get rid of this MatNum4 business
-    MatV4 greenFromUdV_timedisplaced(const UdVV& UdV_l, const UdVV& UdV_r) const;
+    //Given B(beta, tau) = U_l d_l V_l and B(tau, 0) = U_r d_r V_r
+    //calculate the time-displaced Green's functions
+    //  green_fwd_out = G(tau,0) = B(tau,0) G(0),
+    //  green_bwd_out = G(0,tau) = -(1 - G(0)) B^{-1}(tau,0),
+    //  green_tau_out = G(tau)
+    //from the inverse of the 2sz x 2sz block matrix
+    //  O = [[1, B(beta,tau)], [-B(tau,0), 1]],
+    //  O^{-1} = [[G(0), G(0,tau)], [G(tau,0), G(tau)]],
+    //which is factored as diag(U_l, U_r) M diag(V_r, V_l) with
+    //  M = [[U_l^dagger V_r^{-1}, d_l], [-d_r, U_r^dagger V_l^{-1}]]
+    //so that only M, which has well-separated scales, needs to be decomposed.
+    void greenFromUdV_timedisplaced(uint32_t gc,
+                                    MatV& green_fwd_out, MatV& green_bwd_out, MatV& green_tau_out,
+                                    const UdVV& UdV_l, const UdVV& UdV_r) const;
     //use a faster method that does not yield information about the time-displaced
     //Green functions.
     // Uses B(beta, tau) = U_l d_l V_l   and     B(tau, 0) = U_r d_r V_r,
@@ -308,17 +389,25 @@ protected:
     //                 = (V_t_L V_t_x) D_x^{-1} (U_R U_x)^{dagger}
         // and stores the singular values of G^{-1} [their product yields
     // the absolute value of the inverse determinant of G]
-    void greenFromUdV(MatV& green_out, VecNum& green_inv_sv, const UdVV& UdV_l, const UdVV& UdV_r) const;
+    //[gc selects the workspace]
+    void greenFromUdV(uint32_t gc, MatV& green_out, VecNum& green_inv_sv, const UdVV& UdV_l, const UdVV& UdV_r) const;
     //The following is useful to compute G(\beta) = [1 + B(\beta, 0)]^{-1}
-    void greenFromEye_and_UdV(MatV& green_out, VecNum& green_inv_sv, const UdVV& UdV_r) const;
+    void greenFromEye_and_UdV(uint32_t gc, MatV& green_out, VecNum& green_inv_sv, const UdVV& UdV_r) const;
 
     //compute Green function from UdV-decomposed matrices L/R
-    //for a single timeslice and update the member variables green --
-    //and if desired -- greenFwd and greenBwd.
+    //for a single timeslice and update the member variable green.
     //Also updates green_inv_sv.
     void updateGreenFunctionUdV(uint32_t gc, const UdVV& UdV_L, const UdVV& UdV_R);
     void updateGreenFunction_Eye_UdV(uint32_t gc, const UdVV& UdV_R);    
 
+    //Given B_times_U = B * U_l and U_l d_l V_l from the storage, set udv_out to
+    //the decomposition of B * U_l d_l V_l.  B_times_U is scaled in place, usually
+    //it is the workspace buffer the B-matrix multiplication callable wrote to.
+    void storeUdVProduct(uint32_t gc, UdVV& udv_out, MatV& B_times_U, const VecNum& d_l, const MatV& V_t_l);
+    //The same for multiplication from the right: given V_times_B = V_l * B and
+    //U_l d_l V_l, set udv_out to the decomposition of U_l d_l V_l * B.
+    void storeUdVProductRight(uint32_t gc, UdVV& udv_out, MatV& V_times_B, const MatV& U_l, const VecNum& d_l);
+
     //for each greenComponent call a function with the greenComponent as a parameter
     template<typename Callable>
     void for_each_gc(Callable func) {
@@ -327,6 +416,37 @@ protected:
         }
     }
 
+    //the same, but distribute the green components over greenComponentThreads
+    //threads.  func may only modify data of its own green component.  An exception
+    //thrown for some component is passed on after all threads are done.
+    template<typename Callable>
+    void for_each_gc_parallel(Callable func) {
+        const int nthreads = int(std::min(greenComponentThreads, GreenComponents));
+        if (nthreads <= 1) {
+            for_each_gc(func);
+            return;
+        }
+        checkarray<std::exception_ptr, GreenComponents> error;
+        //the timers are only locked while several threads may use them
+        timing.setConcurrent(true);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
+        for (int gc = 0; gc < int(GreenComponents); ++gc) {
+            try {
+                func(uint32_t(gc));
+            } catch (...) {
+                error[gc] = std::current_exception();
+            }
+        }
+        timing.setConcurrent(false);
+        for (const std::exception_ptr& e : error) {
+            if (e) {
+                std::rethrow_exception(e);
+            }
+        }
+    }
+
     // //call in a derived class:
     // //  Callable_GC_k2_k1: take arguments green component, timeslices k2 > k1,
     // //  and give the corresponding B-matrix
@@ -338,9 +458,9 @@ protected:
 
 
     //call in a derived class:
-    //Callable_GC_mat_k2_k1: take arguments green-component, some matrix,
-    //                       time slices k2 > k1
-    //      -> return left product of matrix with Bmat: Bmat(k2,k1) * matrix
+    //Callable_GC_mat_k2_k1: take arguments green-component, output matrix,
+    //                       input matrix, time slices k2 > k1
+    //      -> store left product of matrix with Bmat: out = Bmat(k2,k1) * in
     //
     //This will setup the UdV storage used to compute Green's functions from scratch
     //in the following sweep-down and also compute the Green's function G(\beta)
@@ -359,15 +479,23 @@ protected:
 
     //helpers for sweep_skeleton(), sweepThermalization_skeleton():
     //
-    //Callable_GC_mat_k2_k1: take arguments green-component, some matrix,
-    //                       time slices k2 > k1
-    //      -> return left/right product of matrix with Bmat or Bmat-inverse
+    //Callable_GC_mat_k2_k1: take arguments (uint32_t gc, MatV& out, const MatV& in,
+    //                       uint32_t k2, uint32_t k1) with time slices k2 > k1
+    //      -> set out to the left/right product of in with Bmat or Bmat-inverse,
+    //         e.g. out = Bmat(k2,k1) * in.  out is sz x sz already and must not be
+    //         the same object as in.  The callable may use workspace[gc].bmat_temp_1
+    //         and bmat_temp_2 as scratch, so neither out nor in may be one of these.
+    //         Implementations are expected not to allocate memory.
     //optional:
     //  Callable_GreenConsistency:
     //    Arguments: const Mat& g1, const Mat& g2, SweepDirection cursweepdir.
     //    Perform some sort of consistency check, comparing the two matrices,
     //    also be informed about whether we are sweeping up or down.
     //    By default: do nothing
+    //
+    //These handle a single green component and may run concurrently for
+    //different components, so they do not modify currentTimeslice, which
+    //is to be advanced by the caller.
 
     template<class Callable_GC_mat_k2_k1,
              class Callable_GreenConsistency = VoidNoOp>
@@ -420,6 +548,29 @@ protected:
                    Callable_finish finishMeasurement,
                    Callable_GreenConsistency greenConsistencyCheck = VoidNoOp());
 
+    //time-displaced Green's functions [used by sweep_skeleton if TimeDisplaced == true]:
+    //
+    //After a sweep the UdV storage holds the decompositions for one side of each
+    //stabilization point k_l = s*l, and green is G(0) = G(beta):
+    //  after sweepDown: storage[l] = B(beta, k_l*dtau)  -> timedisplacedPassUp
+    //  after sweepUp:   storage[l] = B(k_l*dtau, 0)     -> timedisplacedPassDown
+    //These passes run over all timeslices without changing the auxiliary fields,
+    //build up the decompositions for the other side on the fly, and call
+    //measureTimedisplaced(k) for k = 1, ..., m with greenFwd, greenBwd, greenTau
+    //valid for tau = k*dtau.  Between the stabilization points these are wrapped,
+    //at the stabilization points they are recomputed from scratch.
+    //The UdV storage, green and currentTimeslice are left unchanged.
+    template<class a_Callable_GC_mat_k2_k1, class b_Callable_GC_mat_k2_k1,
+             class Callable_measureTimedisplaced_k>
+    void timedisplacedPassUp(a_Callable_GC_mat_k2_k1 leftMultiplyBmat,
+                             b_Callable_GC_mat_k2_k1 rightMultiplyBmatInv,
+                             Callable_measureTimedisplaced_k measureTimedisplaced);
+    template<class a_Callable_GC_mat_k2_k1, class b_Callable_GC_mat_k2_k1,
+             class Callable_measureTimedisplaced_k>
+    void timedisplacedPassDown(a_Callable_GC_mat_k2_k1 leftMultiplyBmatInv,
+                               b_Callable_GC_mat_k2_k1 rightMultiplyBmat,
+                               Callable_measureTimedisplaced_k measureTimedisplaced);
+
     // This method is called after each sweep.
     // A derived class, which implements the model, may overload it to check
     // its internal state for consistency.  An exception should be thrown if
@@ -441,6 +592,13 @@ protected:
     const uint32_t n;   //number of time slices where the Green-function is calculated from scratch == ceil(m/s)
     const num dtau;     // beta / m
 
+    // decomposition used for the numerical stabilization: SVD or pivoted QR
+    const UdVMethod udvMethod;
+
+    // number of threads for for_each_gc_parallel, default 1: handle
+    // the green components one after another.  May be set by a derived class.
+    uint32_t greenComponentThreads;
+
     // this struct contains parameters related to logging that should
     // be done in this class
     DetModelLoggingParams loggingParams;
@@ -461,6 +619,12 @@ protected:
     // current timeslice
     checkarray<MatV, GreenComponents> green;
     uint32_t currentTimeslice;					//currently green is valid for this timeslice
+    // Only if TimeDisplaced == true, valid during the time-displaced passes for
+    // tau = k*dtau [k passed to measureTimedisplaced].  Empty until the first pass:
+    //   greenFwd = G(tau, 0), greenBwd = G(0, tau), greenTau = G(tau)
+    checkarray<MatV, GreenComponents> greenFwd;
+    checkarray<MatV, GreenComponents> greenBwd;
+    checkarray<MatV, GreenComponents> greenTau;
     // This stores the singular values of G^{-1} (assuming that det(G) > 0).  This is only valid after
     // updateGreenFunction[_Eye_]UdV
     checkarray<VecNum, GreenComponents> green_inv_sv;
@@ -477,6 +641,10 @@ protected:
     const MatV eye_gc;
     std::unique_ptr<checkarray<std::vector<UdVV>, GreenComponents>> UdVStorage;
 
+    //one for each green component
+    //mutable: also used by the const greenFromUdV*()
+    mutable std::vector<SweepWorkspace> workspace;
+
     enum class SweepDirection: int {Up = 1, Down = -1};
     SweepDirection lastSweepDir;
 
@@ -520,13 +688,17 @@ DetModelGC<GC,V,TimeDisplaced>::DetModelGC(const ModelParams& pars, uint32_t gre
     beta(pars.beta), m(pars.m), s(pars.s),
     n(uint32_t(std::ceil(double(m) / s))),
     dtau(pars.dtau),
+    udvMethod(pars.udvMethod),
+    greenComponentThreads(1),
     loggingParams(loggingParams_),
     svLogging(), svMaxLogging(), svMinLogging(),
-    green(), //greenFwd(), greenBwd(),
+    green(),
     currentTimeslice(),
+    greenFwd(), greenBwd(), greenTau(),
     green_inv_sv(),
     eye_UdV(sz), eye_gc(arma::eye<MatV>(sz, sz)),
     UdVStorage(new checkarray<std::vector<UdVV>, GC>),
+    workspace(GC, SweepWorkspace(greenComponentSize)),
     lastSweepDir(SweepDirection::Up),
     obsScalar(), obsVector(), obsKeyValue()
 {
@@ -534,10 +706,6 @@ DetModelGC<GC,V,TimeDisplaced>::DetModelGC(const ModelParams& pars, uint32_t gre
     for(uint32_t gc = 0; gc < GC; ++gc) {
         green[gc].zeros(greenComponentSize, greenComponentSize);
         green_inv_sv[gc].zeros(greenComponentSize);            
-//        if (TimeDisplaced) {
-//            greenFwd[gc].zeros(greenComponentSize, greenComponentSize, m+1);
-//            greenBwd[gc].zeros(greenComponentSize, greenComponentSize, m+1);
-//        }
     }
 
     if (loggingParams.logSV) {
@@ -572,17 +740,17 @@ DetModelGC<GC,V,TimeDisplaced>::DetModelGC(const ModelParams& pars, uint32_t gre
 
 //  // Default functors for multiplication with B-matrices
 //  for_each_gc( [this](uint32_t gc) {
-//      leftMultiplyBmat[gc] = [this, gc](const MatV A, uint32_t k2, uint32_t k1) -> MatV {
-//          return computeBmat[gc](k2, k1) * A;
+//      leftMultiplyBmat[gc] = [this, gc](MatV& out, const MatV& A, uint32_t k2, uint32_t k1) {
+//          out = computeBmat[gc](k2, k1) * A;
 //      };
-//      rightMultiplyBmat[gc] = [this, gc](const MatV A, uint32_t k2, uint32_t k1) -> MatV {
-//          return A * computeBmat[gc](k2, k1);
+//      rightMultiplyBmat[gc] = [this, gc](MatV& out, const MatV& A, uint32_t k2, uint32_t k1) {
+//          out = A * computeBmat[gc](k2, k1);
 //      };
-//      leftMultiplyBmatInv[gc] = [this, gc](const MatV A, uint32_t k2, uint32_t k1) -> MatV {
-//          return arma::inv(computeBmat[gc](k2, k1)) * A;
+//      leftMultiplyBmatInv[gc] = [this, gc](MatV& out, const MatV& A, uint32_t k2, uint32_t k1) {
+//          out = arma::inv(computeBmat[gc](k2, k1)) * A;
 //      };
-//      rightMultiplyBmatInv[gc] = [this, gc](const MatV A, uint32_t k2, uint32_t k1) -> MatV {
-//          return A * arma::inv(computeBmat[gc](k2, k1));
+//      rightMultiplyBmatInv[gc] = [this, gc](MatV& out, const MatV& A, uint32_t k2, uint32_t k1) {
+//          out = A * arma::inv(computeBmat[gc](k2, k1));
 //      };
 //  } );
 }
@@ -618,7 +786,7 @@ void DetModelGC<GC,V,TimeDisplaced>::setupUdVStorage_and_calculateGreen_forTimes
 
     auto setup = [this, timeslice, &leftMultiplyBmat](uint32_t gc) -> uint32_t {
         std::vector<UdVV>& storage = (*UdVStorage)[gc];
-        storage = std::vector<UdVV>(n + 1);
+        storage.resize(n + 1);      // keep previously allocated matrices
 
         uint32_t lk = uint32_t(std::floor(num(timeslice) / s));
         uint32_t k_lkp1 = ((lk < n - 1) ? (s*(lk+1)) : (m));
@@ -626,7 +794,9 @@ void DetModelGC<GC,V,TimeDisplaced>::setupUdVStorage_and_calculateGreen_forTimes
         // std::cout << "timeslice: " << timeslice << " lk: " << lk << " k_lkp1: " << k_lkp1 << "\n";
         
         // std::cout << "(" << k_lkp1 << ", " << timeslice << ")\n";
-        udvDecompose(storage[0], leftMultiplyBmat(gc, eye_gc, k_lkp1, timeslice));
+        SweepWorkspace& ws = workspace[gc];
+        leftMultiplyBmat(gc, ws.bmat_product, eye_gc, k_lkp1, timeslice);
+        udvDecompose(storage[0], ws.bmat_product, udvMethod, ws.udv);
 
         uint32_t storageCounter = 0;
         for (uint32_t l = lk + 1; l <= n - 1; ++l) {
@@ -637,9 +807,8 @@ void DetModelGC<GC,V,TimeDisplaced>::setupUdVStorage_and_calculateGreen_forTimes
             const uint32_t k_l   = s*l;
             const uint32_t k_lp1 = ((l < n - 1) ? (s*(l+1)) : (m));
             // std::cout << "(" << k_lp1 << ", " << k_l << ")\n";
-            MatV B_lp1_times_U_l = leftMultiplyBmat(gc, U_l, k_lp1, k_l);
-            udvDecompose<V>(storage[storageCounter+1], B_lp1_times_U_l * arma::diagmat(d_l));
-            storage[storageCounter+1].V_t =  V_t_l * storage[storageCounter+1].V_t;
+            leftMultiplyBmat(gc, ws.bmat_product, U_l, k_lp1, k_l);
+            storeUdVProduct(gc, storage[storageCounter+1], ws.bmat_product, d_l, V_t_l);
             ++storageCounter;
         }
 
@@ -656,19 +825,18 @@ void DetModelGC<GC,V,TimeDisplaced>::setupUdVStorage_and_calculateGreen_forTimes
             const uint32_t k_l   = s*l;
             const uint32_t k_lp1 = ((l < lk) ? (s*(l+1)) : (timeslice));
             // std::cout << "(" << k_lp1 << ", " << k_l << ")\n";
-            MatV B_lp1_times_U_l = leftMultiplyBmat(gc, U_l, k_lp1, k_l);
-            udvDecompose<V>(storage[storageCounter+1], B_lp1_times_U_l * arma::diagmat(d_l));
-            storage[storageCounter+1].V_t =  V_t_l * storage[storageCounter+1].V_t;            
+            leftMultiplyBmat(gc, ws.bmat_product, U_l, k_lp1, k_l);
+            storeUdVProduct(gc, storage[storageCounter+1], ws.bmat_product, d_l, V_t_l);
             ++storageCounter;
         }
 
         return storageCounter;  // return the highest index in the storage
     };
 
-    for (uint32_t gc = 0; gc < GC; ++gc) {
-        uint32_t index = setup(gc);
-        updateGreenFunction_Eye_UdV(gc, (*UdVStorage)[gc][index]);
-    }
+    for_each_gc_parallel( [this, &setup](uint32_t gc) {
+            uint32_t index = setup(gc);
+            updateGreenFunction_Eye_UdV(gc, (*UdVStorage)[gc][index]);
+        } );
     
     timing.stop("setupUdVStorage");
 }
@@ -682,11 +850,13 @@ void DetModelGC<GC,V,TimeDisplaced>::setupUdVStorage_and_calculateGreen_skeleton
     timing.start("setupUdVStorage");
     auto setup = [this, &leftMultiplyBmat](uint32_t gc) {
         std::vector<UdVV>& storage = (*UdVStorage)[gc];
-        storage = std::vector<UdVV>(n + 1);
+        storage.resize(n + 1);      // keep previously allocated matrices
 
+        SweepWorkspace& ws = workspace[gc];
         storage[0] = eye_UdV; 
         // storage[1] = udvDecompose(computeBmat(gc, s, 0));
-        udvDecompose(storage[1], leftMultiplyBmat(gc, eye_gc, s, 0));
+        leftMultiplyBmat(gc, ws.bmat_product, eye_gc, s, 0);
+        udvDecompose(storage[1], ws.bmat_product, udvMethod, ws.udv);
 
         for (uint32_t l = 1; l <= n - 1; ++l) {
             const MatV&   U_l   = storage[l].U;
@@ -695,17 +865,15 @@ void DetModelGC<GC,V,TimeDisplaced>::setupUdVStorage_and_calculateGreen_skeleton
             const uint32_t k_l   = s*l;
             const uint32_t k_lp1 = ((l < n - 1) ? (s*(l+1)) : (m));
 //            MatV B_lp1_times_U_l = computeBmat(gc, k_lp1, k_l) * U_l;
-            MatV B_lp1_times_U_l = leftMultiplyBmat(gc, U_l, k_lp1, k_l);
-            udvDecompose<V>(storage[l+1], B_lp1_times_U_l * arma::diagmat(d_l));
-            storage[l+1].V_t =  V_t_l * storage[l+1].V_t;
+            leftMultiplyBmat(gc, ws.bmat_product, U_l, k_lp1, k_l);
+            storeUdVProduct(gc, storage[l+1], ws.bmat_product, d_l, V_t_l);
         }
     };
 
-    for_each_gc(setup);
-
-    for (uint32_t gc = 0; gc < GC; ++gc) {
-        updateGreenFunction_Eye_UdV(gc, (*UdVStorage)[gc][n]);
-    }
+    for_each_gc_parallel( [this, &setup](uint32_t gc) {
+            setup(gc);
+            updateGreenFunction_Eye_UdV(gc, (*UdVStorage)[gc][n]);
+        } );
     currentTimeslice = m;
 
     lastSweepDir = SweepDirection::Up;
@@ -765,8 +933,10 @@ void DetModelGC<GC,V,TimeDisplaced>::sweepSimpleThermalization_skeleton(
 // computes G(tau) = [Id + B(tau,0).B(beta,tau)]^{-1}
 //                 = [Id + U_r d_r V_r U_l d_l V_l]^{-1}
 //                 = (V_t_L V_t_x) D_x^{-1} (U_R U_x)^{dagger}
+// [with UDV_QR the V's are not unitary and V_t is replaced by V^{-1}]
 template<uint32_t GC, typename V, bool TimeDisplaced>
 void DetModelGC<GC,V,TimeDisplaced>::greenFromUdV(
+                uint32_t gc,
 		MatV& green_out,
                 VecNum& green_inv_sv,
 		const UdVV& UdV_l,
@@ -781,16 +951,24 @@ void DetModelGC<GC,V,TimeDisplaced>::greenFromUdV(
 
     using arma::diagmat; using arma::trans;
 
-    MatV VU_rl_product = trans(V_t_r) * U_l;
-    MatV UtVt_rl_product = trans(U_r) * V_t_l;
+    SweepWorkspace& ws = workspace[gc];
+
+    // V_l^{-1}: this is V_t_l unless V_l is not unitary (UDV_QR)
+    const MatV& V_inv_l = udvInverseV(ws.V_inv_1, V_t_l, udvMethod, ws.udv);
 
+    ws.VU_product = trans(V_t_r) * U_l;
+    ws.UV_product = trans(U_r) * V_inv_l;
+    // UV_product += diagmat(d_r) * VU_product * diagmat(d_l)
+    for (uint32_t j = 0; j < sz; ++j) {
+        for (uint32_t i = 0; i < sz; ++i) {
+            ws.UV_product(i, j) += d_r[i] * ws.VU_product(i, j) * d_l[j];
+        }
+    }
 
     // here we get just the singular values of G^{-1}
-    MatV U_temp, V_t_temp;
-    udvDecompose<V>(U_temp, green_inv_sv, V_t_temp,
-        UtVt_rl_product +
-        diagmat(d_r) * VU_rl_product * diagmat(d_l)
-        );
+    // [or with UDV_QR: the moduli of the diagonal elements of R, their product
+    //  still yields |det G^{-1}|]
+    udvDecompose<V>(ws.U_temp, green_inv_sv, ws.V_t_temp, ws.UV_product, udvMethod, ws.udv);
 
     
     if (loggingParams.logSV) {
@@ -801,18 +979,24 @@ void DetModelGC<GC,V,TimeDisplaced>::greenFromUdV(
         //     std::cout << i << ' ';
         // std::cout << '\n';
 
-        svLogging->writeData( log_max_sv - log_min_sv );
-        svMinLogging->writeData ( log_min_sv );
-        svMaxLogging->writeData ( log_max_sv );        
+#ifdef _OPENMP
+#pragma omp critical(DetModelGC_svLogging)
+#endif
+        {
+            svLogging->writeData( log_max_sv - log_min_sv );
+            svMinLogging->writeData ( log_min_sv );
+            svMaxLogging->writeData ( log_max_sv );
+        }
     }
     
     
-    MatV Vt_product = V_t_l * V_t_temp;
-    MatV U_product  = U_r * U_temp;
-    
-    green_out = Vt_product *
-        diagmat(1.0 / green_inv_sv) *
-        trans(U_product);
+    // green_out = (V_l^{-1} V_x^{-1}) D_x^{-1} (U_r U_x)^{dagger}
+    ws.product = V_inv_l * udvInverseV(ws.V_inv_2, ws.V_t_temp, udvMethod, ws.udv);
+    for (uint32_t j = 0; j < sz; ++j) {
+        ws.product.col(j) *= 1.0 / green_inv_sv[j];
+    }
+    ws.VU_product = U_r * ws.U_temp;
+    green_out = ws.product * trans(ws.VU_product);
 
     timing.stop("greenFromUdV");
 }
@@ -821,6 +1005,7 @@ void DetModelGC<GC,V,TimeDisplaced>::greenFromUdV(
 
 template<uint32_t GC, typename V, bool TimeDisplaced>
 void DetModelGC<GC,V,TimeDisplaced>::greenFromEye_and_UdV(
+                uint32_t gc,
 		MatV& green_out,
                 VecNum& green_inv_sv,
 		const UdVV& UdV_r) const {
@@ -832,29 +1017,40 @@ void DetModelGC<GC,V,TimeDisplaced>::greenFromEye_and_UdV(
 
     using arma::diagmat; using arma::trans;
 
+    SweepWorkspace& ws = workspace[gc];
+
+    // V_r^{-1}: this is V_t_r unless V_r is not unitary (UDV_QR)
+    const MatV& V_inv_r = udvInverseV(ws.V_inv_1, V_t_r, udvMethod, ws.udv);
+
     // here we get just the singular values of G^{-1}
-    MatV U_temp, V_t_temp;
-    udvDecompose<V>(U_temp, green_inv_sv, V_t_temp,
-        trans(U_r) * V_t_r + diagmat(d_r)
-        );
+    ws.UV_product = trans(U_r) * V_inv_r;
+    for (uint32_t i = 0; i < sz; ++i) {
+        ws.UV_product(i, i) += d_r[i];
+    }
+    udvDecompose<V>(ws.U_temp, green_inv_sv, ws.V_t_temp, ws.UV_product, udvMethod, ws.udv);
 
 
     if (loggingParams.logSV) {
         auto min_max_pair = std::minmax_element(green_inv_sv.begin(), green_inv_sv.end());
         num log_min_sv = std::log(*min_max_pair.first);
         num log_max_sv = std::log(*min_max_pair.second); 
-        svLogging->writeData( log_max_sv - log_min_sv );        
-        svMinLogging->writeData ( log_min_sv );
-        svMaxLogging->writeData ( log_max_sv );        
+#ifdef _OPENMP
+#pragma omp critical(DetModelGC_svLogging)
+#endif
+        {
+            svLogging->writeData( log_max_sv - log_min_sv );
+            svMinLogging->writeData ( log_min_sv );
+            svMaxLogging->writeData ( log_max_sv );
+        }
     }
     
 
-    MatV V_t_product = V_t_r * V_t_temp;
-    MatV U_product = U_r * U_temp;
-    
-    green_out = V_t_product *
-    		diagmat(1.0 / green_inv_sv) *
-                trans(U_product);
+    ws.product = V_inv_r * udvInverseV(ws.V_inv_2, ws.V_t_temp, udvMethod, ws.udv);
+    for (uint32_t j = 0; j < sz; ++j) {
+        ws.product.col(j) *= 1.0 / green_inv_sv[j];
+    }
+    ws.VU_product = U_r * ws.U_temp;
+    green_out = ws.product * trans(ws.VU_product);
 
     timing.stop("greenFromUdV");
 }
@@ -862,84 +1058,113 @@ void DetModelGC<GC,V,TimeDisplaced>::greenFromEye_and_UdV(
 
 
 template<uint32_t GC, typename V, bool TimeDisplaced>
-typename DetModelGC<GC,V,TimeDisplaced>::MatV4 DetModelGC<GC,V,TimeDisplaced>::greenFromUdV_timedisplaced(
+void DetModelGC<GC,V,TimeDisplaced>::greenFromUdV_timedisplaced(
+        uint32_t gc, MatV& green_fwd_out, MatV& green_bwd_out, MatV& green_tau_out,
         const UdVV& UdV_l, const UdVV& UdV_r) const {
     timing.start("greenFromUdV_timedisplaced");
 
-    //Ul vs Vl to be compatible with labeling in the notes
-    const MatV&   Ul = UdV_l.V;   //!
-    const VecNum& dl = UdV_l.d;
-    const MatV&   Vl = UdV_l.U;   //!
-    const MatV&   Ur = UdV_r.U;
-    const VecNum& dr = UdV_r.d;
-    const MatV&   Vr = UdV_r.V;
+    using arma::trans;
 
-    uint32_t sz_ = Ul.n_rows;
-
-    //submatrix view helpers for 2*N x 2*N matrices
-    auto upleft = [sz_](MatV& m) {
-        return m.submat(0,0, sz_-1,sz_-1);
-    };
-    auto upright = [sz_](MatV& m) {
-        return m.submat(0,sz_, sz_-1,2*sz_-1);
-    };
-    auto downleft = [sz_](MatV& m) {
-        return m.submat(sz_,0, 2*sz_-1,sz_-1);
-    };
-    auto downright = [sz_](MatV& m) {
-        return m.submat(sz_,sz_, 2*sz_-1,2*sz_-1);
-    };
-
-    MatV temp(2*sz_,2*sz_);
-    upleft(temp)    = arma::inv(Vr * Vl);
-    upright(temp)   = arma::diagmat(dl);
-    downleft(temp)  = arma::diagmat(-dr);
-    downright(temp) = arma::inv(Ul * Ur);
-    UdVV tempUdV = udvDecompose<V>(temp);
-
-    MatV left(2*sz_,2*sz_);
-    upleft(left) = arma::inv(Vr);
-    upright(left).zeros();
-    downleft(left).zeros();
-    downright(left) = arma::inv(Ul);
+    const MatV&   U_l   = UdV_l.U;
+    const VecNum& d_l   = UdV_l.d;
+    const MatV&   V_t_l = UdV_l.V_t;
+    const MatV&   U_r   = UdV_r.U;
+    const VecNum& d_r   = UdV_r.d;
+    const MatV&   V_t_r = UdV_r.V_t;
 
-    MatV right(2*sz_,2*sz_);
-    upleft(right) = arma::inv(Vl);
-    upright(right).zeros();
-    downleft(right).zeros();
-    downright(right) = arma::inv(Ur);
+    SweepWorkspace& ws = workspace[gc];
+
+    const MatV& V_l_inv = udvInverseV(ws.V_inv_1, V_t_l, udvMethod, ws.udv);
+    const MatV& V_r_inv = udvInverseV(ws.V_inv_2, V_t_r, udvMethod, ws.udv);
+
+    //  M = [[U_l^dagger V_r^{-1}, d_l], [-d_r, U_r^dagger V_l^{-1}]]
+    //  [products go through ws.product: Armadillo would evaluate them into
+    //   a temporary before assigning to the submatrix]
+    MatV& M = ws.td_M;
+    M.zeros();
+    ws.product = trans(U_l) * V_r_inv;
+    M.submat(0,0, sz-1,sz-1)           = ws.product;
+    ws.product = trans(U_r) * V_l_inv;
+    M.submat(sz,sz, 2*sz-1,2*sz-1)     = ws.product;
+    for (uint32_t i = 0; i < sz; ++i) {
+        M(i, sz + i) = d_l[i];
+        M(sz + i, i) = -d_r[i];
+    }
+    udvDecompose<V>(ws.td_U, ws.td_d, ws.td_V_t, M, udvMethod, ws.td_udv);
 
-    MatV result = (left * arma::inv(tempUdV.V)) * arma::diagmat(1.0 / tempUdV.d)
-                    * (arma::inv(tempUdV.U) * right);
+    //  O^{-1} = diag(V_r^{-1}, V_l^{-1}) X U_M^dagger diag(U_l^dagger, U_r^dagger),
+    //  X = V_M^{-1} diag(1/d_M)
+    MatV& X = ws.td_X;
+    if (udvMethod == UDV_QR) {
+        udvInverseV_qr(X, ws.td_V_t, ws.td_udv);
+    } else {
+        X = ws.td_V_t;
+    }
+    for (uint32_t j = 0; j < 2*sz; ++j) {
+        X.col(j) /= ws.td_d[j];
+    }
+    const uint32_t l1 = sz - 1, l2 = 2*sz - 1;
+
+    // the row blocks are copied out before multiplying, products of
+    // submatrices would be evaluated via temporaries
+    // upper right block: G(0,tau)
+    ws.td_Xrows = X.rows(0, l1);
+    ws.td_Urows = ws.td_U.rows(sz, l2);
+    ws.td_product = ws.td_Xrows * trans(ws.td_Urows);
+    ws.product = V_r_inv * ws.td_product;
+    green_bwd_out = ws.product * trans(U_r);
+    // lower left block: G(tau,0)
+    ws.td_Xrows = X.rows(sz, l2);
+    ws.td_Urows = ws.td_U.rows(0, l1);
+    ws.td_product = ws.td_Xrows * trans(ws.td_Urows);
+    ws.product = V_l_inv * ws.td_product;
+    green_fwd_out = ws.product * trans(U_l);
+    // lower right block: G(tau)
+    ws.td_Urows = ws.td_U.rows(sz, l2);
+    ws.td_product = ws.td_Xrows * trans(ws.td_Urows);
+    ws.product = V_l_inv * ws.td_product;
+    green_tau_out = ws.product * trans(U_r);
 
     timing.stop("greenFromUdV_timedisplaced");
+}
 
-    return MatV4(upleft(result), upright(result),
-                   downleft(result), downright(result));
+
+template<uint32_t GC, typename V, bool TimeDisplaced>
+void DetModelGC<GC,V,TimeDisplaced>::storeUdVProduct(
+        uint32_t gc, UdVV& udv_out, MatV& B_times_U, const VecNum& d_l, const MatV& V_t_l) {
+    // B_times_U * diagmat(d_l), in place
+    for (uint32_t j = 0; j < sz; ++j) {
+        B_times_U.col(j) *= d_l[j];
+    }
+    udvDecompose<V>(udv_out, B_times_U, udvMethod, workspace[gc].udv);
+    // udv_out.V_t = V_t_l * udv_out.V_t, without an aliasing temporary
+    workspace[gc].product = V_t_l * udv_out.V_t;
+    udv_out.V_t.swap(workspace[gc].product);
 }
 
+template<uint32_t GC, typename V, bool TimeDisplaced>
+void DetModelGC<GC,V,TimeDisplaced>::storeUdVProductRight(
+        uint32_t gc, UdVV& udv_out, MatV& V_times_B, const MatV& U_l, const VecNum& d_l) {
+    // diagmat(d_l) * V_times_B, in place
+    for (uint32_t i = 0; i < sz; ++i) {
+        V_times_B.row(i) *= d_l[i];
+    }
+    udvDecompose<V>(udv_out, V_times_B, udvMethod, workspace[gc].udv);
+    workspace[gc].product = U_l * udv_out.U;
+    udv_out.U.swap(workspace[gc].product);
+}
 
 template<uint32_t GC, typename V, bool TimeDisplaced>
 void DetModelGC<GC,V,TimeDisplaced>::updateGreenFunctionUdV(
         uint32_t gc, const UdVV& UdV_L, const UdVV& UdV_R)
 {
-    if (TimeDisplaced) {
-//        std::tie(std::ignore, greenBwd[gc].slice(targetSlice),
-//                greenFwd[gc].slice(targetSlice), green[gc].slice(targetSlice))
-//            = greenFromUdV_timedisplaced(UdV_L, UdV_R);
-    } else {
-        greenFromUdV(green[gc], green_inv_sv[gc], UdV_L, UdV_R);
-    }
+    greenFromUdV(gc, green[gc], green_inv_sv[gc], UdV_L, UdV_R);
 }
 
 template<uint32_t GC, typename V, bool TimeDisplaced>
 void DetModelGC<GC,V,TimeDisplaced>::updateGreenFunction_Eye_UdV(
     uint32_t gc, const UdVV& UdV_R) {
-    if (TimeDisplaced) {
-        // no-op
-    } else {
-        greenFromEye_and_UdV(green[gc], green_inv_sv[gc], UdV_R);
-    }
+    greenFromEye_and_UdV(gc, green[gc], green_inv_sv[gc], UdV_R);
 }
 
 //compute the green function in timeslice s*(l-1) from scratch with the help
@@ -972,26 +1197,24 @@ void DetModelGC<GC,V,TimeDisplaced>::advanceDownGreen(
     const uint32_t k_l   = ((l < n) ? (s*l) : (m));
     const uint32_t k_lm1 = s*(l-1);
 
+    SweepWorkspace& ws = workspace[gc];
+
     //UdV_L will correspond to B(beta,k_lm1*dtau)
-    UdVV UdV_L;
+    UdVV& UdV_L = ws.UdV_temp;
     if (l < n) {
         //U_l, d_l, V_l correspond to B(beta,k_l*dtau) [set in the last step]
-        const MatV&   U_l   = storage[l].U;
-        const VecNum& d_l   = storage[l].d;
-        const MatV&   V_t_l = storage[l].V_t;
-
-        udvDecompose<V>(UdV_L,
-            arma::diagmat(d_l) *
-            rightMultiplyBmat(gc, trans(V_t_l), k_l, k_lm1)
-            );
-        UdV_L.U = U_l * UdV_L.U;
+        const UdVV& UdV_l = storage[l];
+        ws.V = trans(UdV_l.V_t);
+        rightMultiplyBmat(gc, ws.bmat_product, ws.V, k_l, k_lm1);
+        storeUdVProductRight(gc, UdV_L, ws.bmat_product, UdV_l.U, UdV_l.d);
     } else {
         // special case l==n, can compute UdV_L from scratch
-        udvDecompose<V>(UdV_L, rightMultiplyBmat(gc, eye_gc, k_l, k_lm1));
+        rightMultiplyBmat(gc, ws.bmat_product, eye_gc, k_l, k_lm1);
+        udvDecompose<V>(UdV_L, ws.bmat_product, udvMethod, ws.udv);
     }
 
     // //Accuracy check:
-    MatV g_wrapped;
+    MatV& g_wrapped = ws.g_wrapped;
     if ( not std::is_same<Callable_GreenConsistency, VoidNoOp>::value ) {
         g_wrapped = green[gc];
     }
@@ -1009,9 +1232,9 @@ void DetModelGC<GC,V,TimeDisplaced>::advanceDownGreen(
     // print_matrix_rel_diff(g_wrapped, green[gc], "Adv-Down" + numToString(currentTimeslice));
     greenConsistencyCheck(g_wrapped, green[gc], SweepDirection::Down);
 
-    storage[l - 1] = UdV_L;
-
-    currentTimeslice = s*(l-1);
+    // UdV_L is not needed anymore, the old contents of storage[l - 1] remain
+    // in the workspace as scratch space
+    storage[l - 1].swap(UdV_L);
 
     timing.stop("advanceDownGreen");
 }
@@ -1060,7 +1283,6 @@ void DetModelGC<GC,V,TimeDisplaced>::advanceDownGreen(
 
 // compute the green function at k-1 by wrapping the one at k (accumulates rounding errors),
 // store the result in green.
-// [if required also compute time-displaced green functions]
 template<uint32_t GC, typename V, bool TimeDisplaced>
 template<class a_Callable_GC_mat_k2_k1, class b_Callable_GC_mat_k2_k1>
 void DetModelGC<GC,V,TimeDisplaced>::wrapDownGreen(
@@ -1081,15 +1303,11 @@ void DetModelGC<GC,V,TimeDisplaced>::wrapDownGreen(
     // //DEBUG
 
     //ORIG
-    green[gc] = leftMultiplyBmatInv(gc, rightMultiplyBmat(gc, green[gc], k, k-1),
-    								k, k-1);
-                                                                
-    if (TimeDisplaced) {
-//        greenFwd[gc].slice(k - 1) = leftMultiplyBmatInv(gc, greenFwd[gc].slice(k), k, k-1);
-//        greenBwd[gc].slice(k - 1) = rightMultiplyBmat(gc, greenBwd[gc].slice(k), k, k-1);
-    }
-
-    currentTimeslice = k-1;
+    // green[gc] = leftMultiplyBmatInv(gc, rightMultiplyBmat(gc, green[gc], k, k-1),
+    // 								k, k-1);
+    MatV& g_times_B = workspace[gc].bmat_product;
+    rightMultiplyBmat(gc, g_times_B, green[gc], k, k-1);
+    leftMultiplyBmatInv(gc, green[gc], g_times_B, k, k-1);
 
     timing.stop("wrapDownGreen");
 }
@@ -1125,8 +1343,10 @@ void DetModelGC<GC,V,TimeDisplaced>::advanceUpGreen(
     //as a refresh of the current time slice.
     assert(currentTimeslice == k_lp1);
 
+    SweepWorkspace& ws = workspace[gc];
+
     // //Accuracy check:
-    MatV g_wrapped;
+    MatV& g_wrapped = ws.g_wrapped;
     if ( not std::is_same<Callable_GreenConsistency, VoidNoOp>::value ) {
         g_wrapped = green[gc];
     }
@@ -1137,10 +1357,9 @@ void DetModelGC<GC,V,TimeDisplaced>::advanceUpGreen(
     const MatV&   V_t_l = storage[l].V_t;
 
     //UdV_temp will be the new B(k_lp1*dtau, 0):
-    UdVV UdV_temp;
-    udvDecompose<V>(UdV_temp,
-                    leftMultiplyBmat(gc, U_l, k_lp1, k_l) * arma::diagmat(d_l));
-    UdV_temp.V_t = V_t_l * UdV_temp.V_t;
+    UdVV& UdV_temp = ws.UdV_temp;
+    leftMultiplyBmat(gc, ws.bmat_product, U_l, k_lp1, k_l);
+    storeUdVProduct(gc, UdV_temp, ws.bmat_product, d_l, V_t_l);
     
     if (k_lp1 != m) {
         //The following is B(beta, k_lp1*dtau), valid from the last sweep
@@ -1151,14 +1370,12 @@ void DetModelGC<GC,V,TimeDisplaced>::advanceUpGreen(
         updateGreenFunction_Eye_UdV(gc, UdV_temp);
     }
 
-    storage[l + 1] = UdV_temp;
+    storage[l + 1].swap(UdV_temp);
     
     //Accuracy check:
     // print_matrix_rel_diff(g_wrapped, green[gc], "Adv-Up" + numToString(currentTimeslice));
     greenConsistencyCheck(g_wrapped, green[gc], SweepDirection::Up);
 
-    currentTimeslice = k_lp1;
-
     timing.stop("advanceUpGreen");
 }
 
@@ -1230,7 +1447,6 @@ void DetModelGC<GC,V,TimeDisplaced>::advanceUpGreen(
 
 //compute the green function at k+1 by wrapping the one at k (accumulates rounding errors),
 //store the result in green.
-//if necessary, also handle the time-displaced Green functions
 template<uint32_t GC, typename V, bool TimeDisplaced>
 template<class a_Callable_GC_mat_k2_k1, class b_Callable_GC_mat_k2_k1>
 void DetModelGC<GC,V,TimeDisplaced>::wrapUpGreen(
@@ -1244,16 +1460,10 @@ void DetModelGC<GC,V,TimeDisplaced>::wrapUpGreen(
 
     assert(currentTimeslice == k);
 
-    green[gc] = leftMultiplyBmat(gc, rightMultiplyBmatInv(gc, green[gc], k+1, k), k+1, k);
-
-    if (TimeDisplaced) {
-//        //  greenFwd[greenComponent].slice(k + 1) = B_kp1 * greenFwd[greenComponent].slice(k);
-//        greenFwd[gc].slice(k + 1) = leftMultiplyBmat(gc, greenFwd[gc].slice(k), k+1, k);
-//        //  greenBwd[greenComponent].slice(k + 1) = greenBwd[greenComponent].slice(k) * arma::inv(B_kp1);
-//        greenBwd[gc].slice(k + 1) = rightMultiplyBmatInv(gc, greenBwd[gc].slice(k), k+1, k);
-    }
-
-    currentTimeslice = k + 1;
+    // green[gc] = leftMultiplyBmat(gc, rightMultiplyBmatInv(gc, green[gc], k+1, k), k+1, k);
+    MatV& g_times_Binv = workspace[gc].bmat_product;
+    rightMultiplyBmatInv(gc, g_times_Binv, green[gc], k+1, k);
+    leftMultiplyBmat(gc, green[gc], g_times_Binv, k+1, k);
 
     timing.stop("wrapUpGreen");
 }
@@ -1294,28 +1504,31 @@ void DetModelGC<GC,V,TimeDisplaced>::sweepUp(
         (*UdVStorage)[gc][0] = eye_UdV;
     }
     //sweep up:
+    auto wrapUp = [&,this](uint32_t k) -> void {
+        for_each_gc_parallel( [&,this](uint32_t gc) {
+                wrapUpGreen(leftMultiplyBmat, rightMultiplyBmatInv, k, gc);
+            } );
+        currentTimeslice = k + 1;
+    };
+    auto advanceUp = [&,this](uint32_t l) -> void {
+        for_each_gc_parallel( [&,this](uint32_t gc) {
+                advanceUpGreen(leftMultiplyBmat, l, gc, greenConsistencyCheck);
+            } );
+    };
     for (uint32_t l = 0; l <= n - 2; ++l) {
         for (uint32_t k = l*s + 1; k <= (l+1)*s; ++k) { // s wrap-up steps
-            for (uint32_t gc = 0; gc < GC; ++gc) {
-                wrapUpGreen(leftMultiplyBmat, rightMultiplyBmatInv, k - 1, gc);
-            }
+            wrapUp(k - 1);
             updateInSliceAndMaybeMeasure(k);
         }
-        for (uint32_t gc = 0; gc < GC; ++gc) {
-            advanceUpGreen(leftMultiplyBmat, l, gc, greenConsistencyCheck);        //new version
-        }
+        advanceUp(l);
     }
     //special handling for the highest time-slices
     for (uint32_t k = (n - 1)*s + 1; k <= m; ++k) {
-        for (uint32_t gc = 0; gc < GC; ++gc) {
-            wrapUpGreen(leftMultiplyBmat, rightMultiplyBmatInv, k - 1, gc);
-        }
+        wrapUp(k - 1);
         updateInSliceAndMaybeMeasure(k);
     }
     //refresh Green's function at highest time-slice
-    for (uint32_t gc = 0; gc < GC; ++gc) {
-        advanceUpGreen(leftMultiplyBmat, n - 1, gc, greenConsistencyCheck);        //new version
-    }
+    advanceUp(n - 1);
 
     if (takeMeasurements) {
         finishMeasurement();
@@ -1361,11 +1574,20 @@ void DetModelGC<GC,V,TimeDisplaced>::sweepDown(
 
     // Handle timeslices between l=n (-> k=m) and k=s*(n-1) + 1,
     // in contrast to the lower values of l, these may be less than s
+    auto wrapDown = [&,this](uint32_t k) -> void {
+        for_each_gc_parallel( [&,this](uint32_t gc) {
+                wrapDownGreen(leftMultiplyBmatInv, rightMultiplyBmat, k, gc);
+            } );
+        currentTimeslice = k - 1;
+    };
+    auto advanceDown = [&,this](uint32_t l) -> void {
+        for_each_gc_parallel( [&,this](uint32_t gc) {
+                advanceDownGreen(rightMultiplyBmat, l, gc, greenConsistencyCheck);
+            } );
+    };
     for (uint32_t k = m; k >= (n-1)*s + 1; --k) {
         updateInSliceAndMaybeMeasure(k);
-        for (uint32_t gc = 0; gc < GC; ++gc) {
-            wrapDownGreen(leftMultiplyBmatInv, rightMultiplyBmat, k, gc);
-        }
+        wrapDown(k);
     }
 
     // Handle the remaining timeslices, including advanceDown steps to refresh
@@ -1376,20 +1598,14 @@ void DetModelGC<GC,V,TimeDisplaced>::sweepDown(
     // }
 
     for (uint32_t l = n - 1; l >= 1; --l) {
-        for (uint32_t gc = 0; gc < GC; ++gc) {
-            advanceDownGreen(rightMultiplyBmat, l + 1, gc, greenConsistencyCheck);
-        }
+        advanceDown(l + 1);
         for (uint32_t k = l*s; k >= (l-1)*s + 1; --k) {
             updateInSliceAndMaybeMeasure(k);
-            for (uint32_t gc = 0; gc < GC; ++gc) {
-                wrapDownGreen(leftMultiplyBmatInv, rightMultiplyBmat, k, gc);
-            }
+            wrapDown(k);
         }
     }
     // refresh the Green's function at k=0 so we are ready to sweep-up
-    for (uint32_t gc = 0; gc < GC; ++gc) {
-        advanceDownGreen(rightMultiplyBmat, 1, gc, greenConsistencyCheck);
-    }
+    advanceDown(1);
 
     if (takeMeasurements) {
         finishMeasurement();
@@ -1398,13 +1614,123 @@ void DetModelGC<GC,V,TimeDisplaced>::sweepDown(
     consistencyCheck();
 }
 
+//time-displaced pass following sweepDown: go up in imaginary time
+//
+//preconditions: storage[l] contains B(beta, l*s*dtau) for l = 0, ..., n-1
+//               green is G(0)
+template<uint32_t GC, typename V, bool TimeDisplaced>
+template<class a_Callable_GC_mat_k2_k1, class b_Callable_GC_mat_k2_k1,
+         class Callable_measureTimedisplaced_k>
+void DetModelGC<GC,V,TimeDisplaced>::timedisplacedPassUp(
+        a_Callable_GC_mat_k2_k1 leftMultiplyBmat,
+        b_Callable_GC_mat_k2_k1 rightMultiplyBmatInv,
+        Callable_measureTimedisplaced_k measureTimedisplaced)
+{
+    timing.start("timedisplacedPassUp");
+
+    //workspace[gc].td_UdV will correspond to B(k_l*dtau, 0)
+    for (uint32_t gc = 0; gc < GC; ++gc) {
+        workspace[gc].allocateTimedisplaced(sz);
+        workspace[gc].td_UdV = eye_UdV;
+        greenFwd[gc] = green[gc];               // G(0,0)   =  G(0)
+        greenBwd[gc] = green[gc] - eye_gc;      // G(0,0^+) = -(1 - G(0))
+        greenTau[gc] = green[gc];
+    }
+
+    for (uint32_t l = 0; l <= n - 1; ++l) {
+        const uint32_t k_l   = s*l;
+        const uint32_t k_lp1 = ((l < n - 1) ? (s*(l+1)) : (m));
+        for (uint32_t k = k_l + 1; k <= k_lp1; ++k) {
+            for_each_gc_parallel( [&,this](uint32_t gc) {
+                SweepWorkspace& ws = workspace[gc];
+                if (k < k_lp1) {
+                    leftMultiplyBmat(gc, ws.bmat_product, greenFwd[gc], k, k-1);
+                    greenFwd[gc].swap(ws.bmat_product);
+                    rightMultiplyBmatInv(gc, ws.bmat_product, greenBwd[gc], k, k-1);
+                    greenBwd[gc].swap(ws.bmat_product);
+                    rightMultiplyBmatInv(gc, ws.bmat_product, greenTau[gc], k, k-1);
+                    leftMultiplyBmat(gc, greenTau[gc], ws.bmat_product, k, k-1);
+                } else {
+                    //from scratch with B(k_lp1*dtau, 0) and B(beta, k_lp1*dtau)
+                    UdVV& R = ws.td_UdV;
+                    leftMultiplyBmat(gc, ws.bmat_product, R.U, k_lp1, k_l);
+                    storeUdVProduct(gc, ws.UdV_temp, ws.bmat_product, R.d, R.V_t);
+                    R.swap(ws.UdV_temp);
+                    const UdVV& L = ((l < n - 1) ? (*UdVStorage)[gc][l + 1] : eye_UdV);
+                    greenFromUdV_timedisplaced(gc, greenFwd[gc], greenBwd[gc], greenTau[gc], L, R);
+                }
+            } );
+            measureTimedisplaced(k);
+        }
+    }
+
+    timing.stop("timedisplacedPassUp");
+}
+
+//time-displaced pass following sweepUp: go down in imaginary time
+//
+//preconditions: storage[l] contains B(l*s*dtau, 0) for l = 1, ..., n-1
+//               green is G(beta) = G(0)
+template<uint32_t GC, typename V, bool TimeDisplaced>
+template<class a_Callable_GC_mat_k2_k1, class b_Callable_GC_mat_k2_k1,
+         class Callable_measureTimedisplaced_k>
+void DetModelGC<GC,V,TimeDisplaced>::timedisplacedPassDown(
+        a_Callable_GC_mat_k2_k1 leftMultiplyBmatInv,
+        b_Callable_GC_mat_k2_k1 rightMultiplyBmat,
+        Callable_measureTimedisplaced_k measureTimedisplaced)
+{
+    timing.start("timedisplacedPassDown");
+
+    //workspace[gc].td_UdV will correspond to B(beta, k_l*dtau)
+    for (uint32_t gc = 0; gc < GC; ++gc) {
+        workspace[gc].allocateTimedisplaced(sz);
+        workspace[gc].td_UdV = eye_UdV;
+        greenFwd[gc] = eye_gc - green[gc];      // G(beta,0) =  1 - G(0)
+        greenBwd[gc] = -green[gc];              // G(0,beta) = -G(0)
+        greenTau[gc] = green[gc];
+    }
+    measureTimedisplaced(m);
+
+    for (uint32_t l = n; l >= 1; --l) {
+        const uint32_t k_l   = ((l < n) ? (s*l) : (m));
+        const uint32_t k_lm1 = s*(l-1);
+        //go from timeslice k to k-1, no measurement needed at k-1 == 0
+        for (uint32_t k = k_l; k >= k_lm1 + 1 and k >= 2; --k) {
+            for_each_gc_parallel( [&,this](uint32_t gc) {
+                SweepWorkspace& ws = workspace[gc];
+                if (k - 1 > k_lm1) {
+                    leftMultiplyBmatInv(gc, ws.bmat_product, greenFwd[gc], k, k-1);
+                    greenFwd[gc].swap(ws.bmat_product);
+                    rightMultiplyBmat(gc, ws.bmat_product, greenBwd[gc], k, k-1);
+                    greenBwd[gc].swap(ws.bmat_product);
+                    rightMultiplyBmat(gc, ws.bmat_product, greenTau[gc], k, k-1);
+                    leftMultiplyBmatInv(gc, greenTau[gc], ws.bmat_product, k, k-1);
+                } else {
+                    //from scratch with B(beta, k_lm1*dtau) and B(k_lm1*dtau, 0)
+                    UdVV& L = ws.td_UdV;
+                    ws.V = arma::trans(L.V_t);
+                    rightMultiplyBmat(gc, ws.bmat_product, ws.V, k_l, k_lm1);
+                    storeUdVProductRight(gc, ws.UdV_temp, ws.bmat_product, L.U, L.d);
+                    L.swap(ws.UdV_temp);
+                    greenFromUdV_timedisplaced(gc, greenFwd[gc], greenBwd[gc], greenTau[gc],
+                                               L, (*UdVStorage)[gc][l - 1]);
+                }
+            } );
+            measureTimedisplaced(k - 1);
+        }
+    }
+
+    timing.stop("timedisplacedPassDown");
+}
+
 template<uint32_t GC, typename V, bool TimeDisplaced>
 template<class a_Callable_GC_mat_k2_k1, class b_Callable_GC_mat_k2_k1,
          class c_Callable_GC_mat_k2_k1, class d_Callable_GC_mat_k2_k1,
          class Callable_UpdateInSlice_k,
          class Callable_init, class Callable_measure_k, class Callable_finish,
          class Callable_GlobalUpdate,
-         class Callable_GreenConsistency>
+         class Callable_GreenConsistency,
+         class Callable_measureTimedisplaced_k>
 void DetModelGC<GC,V,TimeDisplaced>::sweep_skeleton(
         bool takeMeasurements,
         a_Callable_GC_mat_k2_k1 leftMultiplyBmat,
@@ -1415,24 +1741,49 @@ void DetModelGC<GC,V,TimeDisplaced>::sweep_skeleton(
         Callable_init initMeasurement, Callable_measure_k measure,
         Callable_finish finishMeasurement,
         Callable_GlobalUpdate globalUpdate,
-        Callable_GreenConsistency greenConsistencyCheck)
+        Callable_GreenConsistency greenConsistencyCheck,
+        Callable_measureTimedisplaced_k measureTimedisplaced)
 {
     timing.start("sweep");
 
+    const bool measureTD = TimeDisplaced and takeMeasurements and
+        not std::is_same<Callable_measureTimedisplaced_k, VoidNoOp>::value;
+
     if (lastSweepDir == SweepDirection::Up) {
         globalUpdate();
-        sweepDown(takeMeasurements,
-                  leftMultiplyBmatInv, rightMultiplyBmat,
-                  updateInSlice,
-                  initMeasurement, measure, finishMeasurement,
-                  greenConsistencyCheck);
+        if (measureTD) {
+            //finish the measurements only after the time-displaced pass
+            sweepDown(takeMeasurements,
+                      leftMultiplyBmatInv, rightMultiplyBmat,
+                      updateInSlice,
+                      initMeasurement, measure, VoidNoOp(),
+                      greenConsistencyCheck);
+            timedisplacedPassUp(leftMultiplyBmat, rightMultiplyBmatInv, measureTimedisplaced);
+            finishMeasurement();
+        } else {
+            sweepDown(takeMeasurements,
+                      leftMultiplyBmatInv, rightMultiplyBmat,
+                      updateInSlice,
+                      initMeasurement, measure, finishMeasurement,
+                      greenConsistencyCheck);
+        }
         lastSweepDir = SweepDirection::Down;
     } else if (lastSweepDir == SweepDirection::Down) {
-        sweepUp(takeMeasurements,
-                leftMultiplyBmat, rightMultiplyBmatInv,
-                updateInSlice,
-                initMeasurement, measure, finishMeasurement,
-                greenConsistencyCheck);
+        if (measureTD) {
+            sweepUp(takeMeasurements,
+                    leftMultiplyBmat, rightMultiplyBmatInv,
+                    updateInSlice,
+                    initMeasurement, measure, VoidNoOp(),
+                    greenConsistencyCheck);
+            timedisplacedPassDown(leftMultiplyBmatInv, rightMultiplyBmat, measureTimedisplaced);
+            finishMeasurement();
+        } else {
+            sweepUp(takeMeasurements,
+                    leftMultiplyBmat, rightMultiplyBmatInv,
+                    updateInSlice,
+                    initMeasurement, measure, finishMeasurement,
+                    greenConsistencyCheck);
+        }
         lastSweepDir = SweepDirection::Up;
     }
 
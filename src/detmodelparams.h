@@ -19,6 +19,7 @@
 #pragma GCC diagnostic ignored "-Wshadow"
 #include "boost/serialization/string.hpp"
 #include "boost/serialization/set.hpp"
+#include "boost/serialization/version.hpp"
 #include "boost/assign/std/vector.hpp"    // 'operator+=()' for vectors
 #pragma GCC diagnostic pop            
 
@@ -34,6 +35,14 @@ typedef double num;     //possibility to switch to single precision if ever desi
 
 
 
+// Method used to compute the UdV decompositions for the numerical
+// stabilization of the Green's function computation (see udv.h),
+// model parameter "udvMethod"
+enum UdVMethod {
+    UDV_SVD,            // singular value decomposition (Lapack ?gesvd), default
+    UDV_QR,             // QR decomposition with column pivoting (Lapack ?geqp3), faster
+};
+
 
 // Template for struct representing model specific parameters
 // -- needs to have a proper specialization for each model considered, which actually
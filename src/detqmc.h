@@ -27,6 +27,7 @@
 #include <ctime>
 #include <functional>
 #include <fstream>
+#include <sstream>
 #include <armadillo>
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
@@ -50,6 +51,7 @@
 #include "tools.h"
 #include "git-revision.h"
 #include "timing.h"
+#include "asyncwriter.h"
 
 
 
@@ -65,8 +67,10 @@ public:
     //constructor to resume a simulation from a dumped state file:
     //we allow to change some MC parameters at this point:
     //  sweeps & saveInterval
-    //if values > than the old values are specified, change them
-    DetQMC(const std::string& stateFileName, const DetQMCParams& newParsmc);
+    //if values > than the old values are specified, change them.
+    //Runtime-only model parameters [thread counts] are taken from newParsmodel.
+    DetQMC(const std::string& stateFileName, const DetQMCParams& newParsmc,
+           const ModelParams& newParsmodel);
 
 
     //carry out simulation determined by parsmc given in construction,
@@ -116,6 +120,10 @@ protected:
     uint32_t grantedWalltimeSecs;               //walltime the simulation is allowed to run
     std::string jobid;							//id string from the job scheduling system, or "nojobid"
 
+    //writes time series, results and state files [possibly on a background thread];
+    //declared last, so it is flushed and destroyed before the data it refers to
+    std::unique_ptr<AsyncWriter> asyncWriter;
+
 private:
     //Serialize only the content data that has changed after construction.
     //Only call for deserialization after DetQMC has already been constructed and initialized!
@@ -180,6 +188,8 @@ void DetQMC<Model,ModelParams>::initFromParameters(const ModelParams& parsmodel_
     }
     rng = RngWrapper(parsmc.rngSeed, (parsmc.simindex + 1));
 
+    asyncWriter.reset(new AsyncWriter(parsmc.asyncOutputQueue));
+
     createReplica(replica, rng, parsmodel, parslogging);    
 
     //prepare metadata
@@ -208,6 +218,7 @@ void DetQMC<Model,ModelParams>::initFromParameters(const ModelParams& parsmodel_
 
     // setup files for system configuration streams [if files do not exist already]
     // [each process for its local replica]
+    // [the indexed stream is self-describing and needs no header file]
     if (parsmc.saveConfigurationStreamText or parsmc.saveConfigurationStreamBinary) {
         std::string headerInfoText = metadataToString(modelMeta, "#")
             + metadataToString(mcMeta, "#");
@@ -255,13 +266,14 @@ DetQMC<Model, ModelParams>::DetQMC(const ModelParams& parsmodel_, const DetQMCPa
     swCounter(0),
     elapsedTimer(),     // start timing
     totalWalltimeSecs(0), walltimeSecsLastSaveResults(0),
-    grantedWalltimeSecs(0)
+    grantedWalltimeSecs(0), jobid(), asyncWriter()
 {
     initFromParameters(parsmodel_, parsmc_, parslogging_);
 }
 
 template<class Model, class ModelParams>
-DetQMC<Model, ModelParams>::DetQMC(const std::string& stateFileName, const DetQMCParams& newParsmc) :
+DetQMC<Model, ModelParams>::DetQMC(const std::string& stateFileName, const DetQMCParams& newParsmc,
+                                   const ModelParams& newParsmodel) :
     parsmodel(), parsmc(), parslogging(),
     //proper initialization of default initialized members done by loading from archive
     modelMeta(), mcMeta(), rng(), replica(),
@@ -270,7 +282,7 @@ DetQMC<Model, ModelParams>::DetQMC(const std::string& stateFileName, const DetQM
     swCounter(0),
     elapsedTimer(),     // start timing
     totalWalltimeSecs(0), walltimeSecsLastSaveResults(0),
-    grantedWalltimeSecs(0), jobid("")
+    grantedWalltimeSecs(0), jobid(""), asyncWriter()
 {
     std::ifstream ifs;
     ifs.exceptions(std::ifstream::badbit | std::ifstream::failbit);
@@ -281,6 +293,8 @@ DetQMC<Model, ModelParams>::DetQMC(const std::string& stateFileName, const DetQM
     DetQMCParams parsmc_;
     ia >> parslogging_ >> parsmodel_ >> parsmc_;
 
+    parsmodel_.takeRuntimeParameters(newParsmodel);
+
     if (newParsmc.sweeps > parsmc_.sweeps) {
         std::cout << "Target sweeps will be changed from " << parsmc_.sweeps
                   << " to " << newParsmc.sweeps << std::endl;
@@ -292,6 +306,12 @@ DetQMC<Model, ModelParams>::DetQMC(const std::string& stateFileName, const DetQM
                   << " to " << newParsmc.saveInterval << std::endl;
         parsmc_.saveInterval = newParsmc.saveInterval;
     }
+    if (newParsmc.specified.count("asyncOutputQueue") and
+        newParsmc.asyncOutputQueue != parsmc_.asyncOutputQueue) {
+        std::cout << "asyncOutputQueue will be changed from " << parsmc_.asyncOutputQueue
+                  << " to " << newParsmc.asyncOutputQueue << std::endl;
+        parsmc_.asyncOutputQueue = newParsmc.asyncOutputQueue;
+    }
     parsmc_.stateFileName = stateFileName;
 
     //make sure mcparams are set correctly as "specified"
@@ -322,26 +342,25 @@ template<class Model, class ModelParams>
 void DetQMC<Model, ModelParams>::saveState() {
     timing.start("saveState");
 
-    //serialize state to file
-    std::ofstream ofs;
-    ofs.exceptions(std::ofstream::badbit | std::ofstream::failbit);
-    ofs.open(parsmc.stateFileName.c_str(), std::ios::binary);
-    boost::archive::binary_oarchive oa(ofs);
-    oa << parslogging << parsmodel << parsmc;
-    saveContents(oa);
+    //serialize state to memory, it is written to file by asyncWriter
+    std::ostringstream stateStream(std::ios::binary);
+    {
+        boost::archive::binary_oarchive oa(stateStream);
+        oa << parslogging << parsmodel << parsmc;
+        saveContents(oa);
+    }
+    std::shared_ptr<std::string> stateData(new std::string(stateStream.str()));
+    std::string stateFileName = parsmc.stateFileName;
+    asyncWriter->submit([stateData, stateFileName]() {
+        std::ofstream ofs;
+        ofs.exceptions(std::ofstream::badbit | std::ofstream::failbit);
+        ofs.open(stateFileName.c_str(), std::ios::binary);
+        ofs.write(stateData->data(), stateData->size());
+    });
 
     //write out info about state of simulation to "info.dat"
-    std::string commonInfoFilename = "info.dat";
-    writeOnlyMetaData(commonInfoFilename, collectVersionInfo(),
-                      "Collected information about this determinantal quantum Monte Carlo simulation",
-                      false);
+    MetadataMap versionInfo = collectVersionInfo();
     MetadataMap modelMeta_current = replica->prepareModelMetadataMap();
-    writeOnlyMetaData(commonInfoFilename, modelMeta_current,
-                      "Model parameters and some data:",
-                      true);
-    writeOnlyMetaData(commonInfoFilename, mcMeta,
-                      "Monte Carlo parameters:",
-                      true);
 
     MetadataMap currentState;
     currentState["sweepsDoneThermalization"] = numToString(sweepsDoneThermalization);
@@ -352,9 +371,23 @@ void DetQMC<Model, ModelParams>::saveState() {
     walltimeSecsLastSaveResults = cwts;
 
     currentState["totalWallTimeSecs"] = numToString(totalWalltimeSecs);
-    writeOnlyMetaData(commonInfoFilename, currentState,
-                      "Current state of simulation:",
-                      true);
+
+    MetadataMap mcMeta_ = mcMeta;
+    asyncWriter->submit([versionInfo, modelMeta_current, mcMeta_, currentState]() {
+        std::string commonInfoFilename = "info.dat";
+        writeOnlyMetaData(commonInfoFilename, versionInfo,
+                          "Collected information about this determinantal quantum Monte Carlo simulation",
+                          false);
+        writeOnlyMetaData(commonInfoFilename, modelMeta_current,
+                          "Model parameters and some data:",
+                          true);
+        writeOnlyMetaData(commonInfoFilename, mcMeta_,
+                          "Monte Carlo parameters:",
+                          true);
+        writeOnlyMetaData(commonInfoFilename, currentState,
+                          "Current state of simulation:",
+                          true);
+    });
 
     std::cout << "State has been saved." << std::endl;
 
@@ -489,6 +522,9 @@ void DetQMC<Model, ModelParams>::run() {
                     if (parsmc.saveConfigurationStreamBinary) {
                         replica->saveConfigurationStreamBinary();
                     }
+                    if (parsmc.saveConfigurationStreamIndexed) {
+                        replica->saveConfigurationStreamIndexed();
+                    }
                 }
             }
             ++sweepsDone;
@@ -511,6 +547,9 @@ void DetQMC<Model, ModelParams>::run() {
 
         }  //switch
     }
+
+    //make sure everything has been written to disk before we return
+    asyncWriter->flush();
 }
 
 
@@ -522,11 +561,11 @@ template<class Model, class ModelParams>
 void DetQMC<Model, ModelParams>::saveResults() {
     timing.start("saveResults");
 
-    outputResults(obsHandlers);
+    outputResults(obsHandlers, *asyncWriter);
     for (auto p = obsHandlers.begin(); p != obsHandlers.end(); ++p) {
-        (*p)->outputTimeseries();
+        (*p)->outputTimeseries(*asyncWriter);
     }
-    outputResults(vecObsHandlers);
+    outputResults(vecObsHandlers, *asyncWriter);
 
     timing.stop("saveResults");
 }
@@ -51,6 +51,14 @@ void DetQMCParams::check() {
         throw_ParameterWrong("greenUpdateType", greenUpdateType_string);
     }
 
+    if (timeseriesFormat_string == "text") {
+        timeseriesFormat = TimeseriesFormatText;
+    } else if (timeseriesFormat_string == "binary") {
+        timeseriesFormat = TimeseriesFormatBinary;
+    } else {
+        throw_ParameterWrong("timeseriesFormat", timeseriesFormat_string);
+    }
+
     //some parameter consistency checking:
     if (sweeps % jkBlocks != 0) {
         throw_ParameterWrong_message("Number of jackknife blocks " + numToString(jkBlocks)
@@ -81,6 +89,7 @@ MetadataMap DetQMCParams::prepareMetadataMap() const {
     MetadataMap meta;
 #define META_INSERT(VAR) meta[#VAR] = numToString(VAR)
     META_INSERT(greenUpdateType_string);
+    META_INSERT(timeseriesFormat_string);
     META_INSERT(simindex);
     META_INSERT(sweeps);
     META_INSERT(thermalization);
@@ -89,10 +98,12 @@ MetadataMap DetQMCParams::prepareMetadataMap() const {
     META_INSERT(saveInterval);
     META_INSERT(saveConfigurationStreamInterval);
     META_INSERT(rngSeed);
+    META_INSERT(asyncOutputQueue);
 #undef META_INSERT
     meta["timeseries"] = (timeseries ? "true" : "false");
     meta["saveConfigurationStreamText"]   = (saveConfigurationStreamText   ? "true" : "false");
     meta["saveConfigurationStreamBinary"] = (saveConfigurationStreamBinary ? "true" : "false");    
+    meta["saveConfigurationStreamIndexed"] = (saveConfigurationStreamIndexed ? "true" : "false");
     meta["stateFileName"] = stateFileName;
     return meta;
 }
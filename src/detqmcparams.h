@@ -18,6 +18,7 @@
 #pragma GCC diagnostic ignored "-Wshadow"
 #include "boost/serialization/string.hpp"
 #include "boost/serialization/set.hpp"
+#include "boost/serialization/version.hpp"
 #pragma GCC diagnostic pop
 
 #include "metadata.h"
@@ -43,6 +44,9 @@ struct DetQMCParams {
     uint32_t thermalization;    // number of warm-up sweeps allowed before equilibrium is assumed
     uint32_t jkBlocks;          // number of jackknife blocks for error estimation
     bool timeseries;            // if true, write time series of individual measurements to disk
+    std::string timeseriesFormat_string;   //"text" or "binary" [see binaryseries.h]
+    enum TimeseriesFormat {TimeseriesFormatText, TimeseriesFormatBinary};
+    TimeseriesFormat timeseriesFormat;
     uint32_t measureInterval;   // take measurements every measureInterval sweeps
     uint32_t saveInterval;      // write measurements to disk every saveInterval sweeps
     uint32_t saveConfigurationStreamInterval; // interval in sweeps where full system configurations are buffered and saved to disk.  Must be an integer multiple of measureInterval.  This is only effective if one of the boolean flags for saving configurations is set to true.
@@ -54,17 +58,33 @@ struct DetQMCParams {
 
     bool saveConfigurationStreamText;
     bool saveConfigurationStreamBinary;
+    bool saveConfigurationStreamIndexed;   // indexed binary container, see configstream.h
+
+    uint32_t asyncOutputQueue;  // if > 0: write configuration streams, time series and state files on a
+                                // background thread, with at most this many pending write operations.
+                                // 0: write synchronously
     
     std::string stateFileName;      //for serialization dumps
     bool sweepsHasChanged;          //true, if the number of target sweeps has changed after resuming
 
     std::set<std::string> specified; // used to record names of specified parameters
 
+    // not a parameter: the class version [BOOST_CLASS_VERSION below] of the
+    // state file these parameters have been loaded from, else the current one.
+    // Contents serialized after the parameters depend on it:
+    //   < 4: observable handlers store leave-one-out sums for the jackknife blocks
+    //   4: they store the sums of the individual blocks
+    uint32_t stateVersion;
+
     DetQMCParams() :
-        simindex(0), sweeps(), thermalization(), jkBlocks(), timeseries(false), measureInterval(), saveInterval(),
+        simindex(0), sweeps(), thermalization(), jkBlocks(), timeseries(false),
+        timeseriesFormat_string("text"), timeseriesFormat(TimeseriesFormatText),
+        measureInterval(), saveInterval(),
         saveConfigurationStreamInterval(0),
         rngSeed(), greenUpdateType_string(), saveConfigurationStreamText(false), saveConfigurationStreamBinary(false),
-        stateFileName(), sweepsHasChanged(false), specified()
+        saveConfigurationStreamIndexed(false), asyncOutputQueue(0),
+        stateFileName(), sweepsHasChanged(false), specified(),
+        stateVersion(4)
     { }
 
     // check consistency, convert strings to enums
@@ -75,20 +95,35 @@ struct DetQMCParams {
 private:
     friend class boost::serialization::access;
 
+    //version 1: saveConfigurationStreamIndexed; version 2: asyncOutputQueue;
+    //version 3: timeseriesFormat.  Older state files keep the defaults for these.
+    //version 4: jackknife block sums in the observable handlers [stateVersion]
     template<class Archive>
     void serialize(Archive& ar, const uint32_t version) {
-        (void)version;
         ar  & simindex
-            & sweeps & thermalization & jkBlocks & timeseries
-            & measureInterval & saveInterval & saveConfigurationStreamInterval
+            & sweeps & thermalization & jkBlocks & timeseries;
+        if (version >= 3) {
+            ar & timeseriesFormat_string & timeseriesFormat;
+        }
+        ar  & measureInterval & saveInterval & saveConfigurationStreamInterval
             & rngSeed
             & greenUpdateType_string & greenUpdateType
-            & saveConfigurationStreamText & saveConfigurationStreamBinary
-            & stateFileName
+            & saveConfigurationStreamText & saveConfigurationStreamBinary;
+        if (version >= 1) {
+            ar & saveConfigurationStreamIndexed;
+        }
+        if (version >= 2) {
+            ar & asyncOutputQueue;
+        }
+        ar  & stateFileName
             & sweepsHasChanged
             & specified;
+        if (Archive::is_loading::value) {
+            stateVersion = version;
+        }
     }
 };
+BOOST_CLASS_VERSION(DetQMCParams, 4)
 
 
 
@@ -8,6 +8,10 @@
  * */
 
 // Parallel Tempering Determinantal QMC simulation handling
+//
+// Each MPI process simulates parspt.replicasPerProcess replicas in
+// turn.  The replica with local index lri at process p has the global
+// replica index p * replicasPerProcess + lri.
 
 #ifndef MPIDETQMCPT_H_               
 #define MPIDETQMCPT_H_
@@ -23,6 +27,7 @@
 #include <ctime>
 #include <functional>
 #include <fstream>
+#include <sstream>
 #include <armadillo>
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wpragmas"
@@ -52,7 +57,48 @@
 #include "tools.h"
 #include "git-revision.h"
 #include "timing.h"
-
+#include "asyncwriter.h"
+
+
+// Constant-acceptance placement of replica exchange control parameters:
+// from the exchange acceptance ratios of the pairs of neighboring values,
+// return new values with the same end points, such that all pairs
+// should have about the same acceptance ratio.  This assumes that
+// locally -ln(acceptance ratio) grows quadratically with the distance
+// of the parameters.  If a pair has not been proposed, return the old
+// values.
+inline std::vector<num> placeControlParametersConstantAcceptance(
+    const std::vector<num>& values,
+    const std::vector<int>& swapProposed, const std::vector<int>& swapAccepted) {
+    const double MinAcceptance = 1E-3;
+    const double MaxAcceptance = 0.99;
+    const std::size_t n = values.size();
+    if (n < 3) {
+        return values;
+    }
+    // cumulative[i]: sum of the distances sqrt(-ln(acceptance)) of the pairs below i
+    std::vector<double> cumulative(n, 0.0);
+    for (std::size_t i = 0; i + 1 < n; ++i) {
+        if (swapProposed[i] == 0) {
+            return values;
+        }
+        double acc = double(swapAccepted[i]) / double(swapProposed[i]);
+        acc = std::min(std::max(acc, MinAcceptance), MaxAcceptance);
+        cumulative[i + 1] = cumulative[i] + std::sqrt(-std::log(acc));
+    }
+    // place the new values at equal distances, interpolate linearly within the pairs
+    std::vector<num> newValues(values);
+    std::size_t i = 0;
+    for (std::size_t k = 1; k + 1 < n; ++k) {
+        double target = cumulative[n - 1] * double(k) / double(n - 1);
+        while (cumulative[i + 1] < target) {
+            ++i;
+        }
+        double fraction = (target - cumulative[i]) / (cumulative[i + 1] - cumulative[i]);
+        newValues[k] = values[i] + fraction * (values[i + 1] - values[i]);
+    }
+    return newValues;
+}
 
 
 // Class handling the simulation
@@ -67,8 +113,10 @@ public:
     //constructor to resume a simulation from a dumped state file:
     //we allow to change some MC parameters at this point:
     //  sweeps & saveInterval
-    //if values > than the old values are specified, change them
-    DetQMCPT(const std::string& stateFileName, const DetQMCParams& newParsmc);
+    //if values > than the old values are specified, change them.
+    //Runtime-only model parameters [thread counts] are taken from newParsmodel.
+    DetQMCPT(const std::string& stateFileName, const DetQMCParams& newParsmc,
+             const ModelParams& newParsmodel);
 
 
     //carry out simulation determined by parsmc and parspt given in construction,
@@ -92,9 +140,33 @@ protected:
                             const DetModelLoggingParams& loggingParams = DetModelLoggingParams());
 
     void replicaExchangeStep();
+    // alternative to replicaExchangeStep() for the pairwise exchange protocol:
+    // no collective operations, every process only communicates with the processes
+    // holding the neighboring control parameters of its replicas; pairs of
+    // replicas at the same process are handled without MPI
+    void replicaExchangeStepPairwise();
     void replicaExchangeConsistencyCheck(); // verify that processes have the right control parameters
 
-    void saveReplicaExchangeStatistics();
+    // adaptive control parameters: sweeps of thermalization during which they are adapted
+    uint32_t adaptationSweeps() const {
+        return parsmc.thermalization / 2;
+    }
+    // true unless the control parameter values may still change
+    bool controlParametersFinal() const {
+        return (not parspt.adaptControlParameters) or sweepsDoneThermalization >= adaptationSweeps();
+    }
+    // move the control parameter values according to the exchange statistics since the
+    // last call, at all processes
+    void adaptControlParameterValues();
+    // the control parameter values have become final during thermalization
+    void freezeControlParameters();
+
+    // pairwise exchange protocol: current_replica_par and current_par_replica at rank 0
+    // are not kept up to date by replicaExchangeStepPairwise(), gather the control
+    // parameter indexes whenever they are needed there
+    void gatherCurrentReplicaPar();
+    // pairwise exchange protocol: set up local_neighbor_*_replica from current_par_replica at rank 0
+    void distributeExchangeNeighbors();
 
     // subdirectory currently associated with replica set to the control parameter with index cpi
     std::string control_parameter_subdir(int cpi);
@@ -108,12 +180,13 @@ protected:
     MetadataMap modelMeta;
     MetadataMap mcMeta;
     MetadataMap ptMeta;    
-    RngWrapper rng;
-    std::unique_ptr<Model> replica;
+    RngWrapper rng;                             //shared by the local replicas
+    std::vector<std::unique_ptr<Model>> replicas; //indexed by local replica index
     typedef std::unique_ptr<ScalarObservableHandlerPT> ObsPtr;
     typedef std::unique_ptr<VectorObservableHandlerPT> VecObsPtr;
     std::vector<ObsPtr> obsHandlers;
     std::vector<VecObsPtr> vecObsHandlers;      //need to be pointers: holds both KeyValueObservableHandlerPTs and VectorObservableHandlerPTs
+    PackedObservableGathererPT obsGatherer;     //gathers the measurements for all handlers with one collective
     uint32_t sweepsDone;                        //Measurement sweeps done
     uint32_t sweepsDoneThermalization;          //thermalization sweeps done
 
@@ -132,19 +205,39 @@ protected:
     //MPI specifics:
     int numProcesses;      //total number of parallel processes
     int processIndex;      //MPI-rank of the current process
+    int localReplicas;     //number of replicas at each process [parspt.replicasPerProcess]
+    int numReplicas;       //total number of replicas [= number of control parameter values]
+
+    int globalReplicaIndex(int lri) const {
+        return processIndex * localReplicas + lri;
+    }
+    int replicaProcess(int ri) const {
+        return ri / localReplicas;
+    }
+    int replicaLocalIndex(int ri) const {
+        return ri % localReplicas;
+    }
 
-    int local_current_parameter_index; // current control parameter index of this process's replica
+    std::vector<int> local_current_parameter_index; // current control parameter index of each local replica
 
     // specific to the root process
-    std::vector<int> current_process_par; // indexed by process rank number, giving control parameter index
-                                          // currently associated to the replica at that process
-    std::vector<int> current_par_process; // the reverse association
+    std::vector<int> current_replica_par; // indexed by global replica index, giving control parameter index
+                                          // currently associated to that replica
+    std::vector<int> current_par_replica; // the reverse association
     std::vector<double> exchange_action;       // for each replica: its locally measured exchange action
     // for control-parameter specific data, e.g. MC stepsize adjustment
     //std::vector<uint8_tString> control_data_buffer_1, control_data_buffer_2;
-    std::vector<std::string> process_control_data_buffer; // map process index -> control data
-    // for each process:
-    std::string local_control_data_buffer;
+    std::vector<std::string> replica_control_data_buffer; // map global replica index -> control data
+    // for each process, indexed by local replica index:
+    std::vector<std::string> local_control_data_buffer;
+    std::vector<double> local_exchange_action;
+
+    // specific to the pairwise exchange protocol, for each local replica
+    std::vector<int> local_neighbor_down_replica; // replica at control parameter index local_current_parameter_index - 1, or -1
+    std::vector<int> local_neighbor_up_replica;   // replica at control parameter index local_current_parameter_index + 1, or -1
+    uint32_t exchangeStepCounter;    // even/odd pairs of control parameters alternate between exchange steps
+    RngWrapper sharedRng;            // same seed at all processes, used in lockstep to decide on swaps
+    std::vector<double> sharedRandomNumbers; // one number for each pair of control parameters in an exchange step
 
     //Statistics about replica exchange
     // -- evaluate at rank 0 --
@@ -153,51 +246,70 @@ protected:
         std::vector<int> par_swapUpAccepted; // count for each control parameter index how often replica exchanges
                                                   // with one index higher are accepted
         std::vector<int> par_swapUpProposed; // .. are proposed
-        // replica diffusion -- histograms if replicas (processes) are
+        // replica diffusion -- histograms if replicas are
         // moving up or down in control parameter space
         enum ParameterDirection {NONE_P, UP_P, DOWN_P};
-        std::vector<ParameterDirection> process_goingWhere; // track for each replica current direction
+        std::vector<ParameterDirection> replica_goingWhere; // track for each replica current direction
         std::vector<int> par_countGoingUp;//at each attempted parameter swap: if replica at current parameter has visited parMax last (and not parMin) increase
         std::vector<int> par_countGoingDown; //vice versa for replicas having visited parMin last (and not parMax)
 
         ExchangeStatistics() :
-            par_swapUpAccepted(), par_swapUpProposed(), process_goingWhere(),
+            par_swapUpAccepted(), par_swapUpProposed(), replica_goingWhere(),
             par_countGoingUp(), par_countGoingDown()
             { }
         
         ExchangeStatistics(const DetQMCPTParams& ptPars) :
             par_swapUpAccepted(ptPars.controlParameterValues.size(), 0),
             par_swapUpProposed(ptPars.controlParameterValues.size(), 0),
-            process_goingWhere(ptPars.controlParameterValues.size(), NONE_P),
+            replica_goingWhere(ptPars.controlParameterValues.size(), NONE_P),
             par_countGoingUp(ptPars.controlParameterValues.size(), 0),
             par_countGoingDown(ptPars.controlParameterValues.size(), 0)
             { }
 
+        // start counting anew, but keep the directions of the replicas
+        void resetCounts() {
+            std::fill(par_swapUpAccepted.begin(), par_swapUpAccepted.end(), 0);
+            std::fill(par_swapUpProposed.begin(), par_swapUpProposed.end(), 0);
+            std::fill(par_countGoingUp.begin(), par_countGoingUp.end(), 0);
+            std::fill(par_countGoingDown.begin(), par_countGoingDown.end(), 0);
+        }
+
         template<class Archive>
         void serialize(Archive& ar, const uint32_t /*version*/) {
-            ar & par_swapUpAccepted & par_swapUpProposed & process_goingWhere
+            ar & par_swapUpAccepted & par_swapUpProposed & replica_goingWhere
                & par_countGoingUp & par_countGoingDown;
         }        
     } es;
+    // with the pairwise exchange protocol each process has counted the exchanges of
+    // its replica, sum these up at rank 0. To be called by all processes.
+    ExchangeStatistics collectExchangeStatistics();
+    void saveReplicaExchangeStatistics(const ExchangeStatistics& stats);
 
 
     // Saving system configurations in parallelized simulations:
     // -- root process collects configs from all replicas, saves all of them after buffering
     struct SaveConfigurations {
         typedef typename Model::SystemConfig SystemConfig;
-        std::queue<SystemConfig> local_bufferedConfigurations; // each process buffers the configs of its own replica here (FIFO)
-        std::queue<int> local_bufferedControlParameterIndex;   // each process buffers the current controlParameterIndex for its replica
-        std::string local_mpi_buffer;
+        std::queue<SystemConfig> local_bufferedConfigurations; // each process buffers the configs of its own replicas here (FIFO,
+                                                               // local replicas in order)
+        std::queue<int> local_bufferedControlParameterIndex;   // each process buffers the current controlParameterIndex for its replicas
+        std::vector<std::string> local_mpi_buffer;             // for each local replica
+        std::vector<int> local_controlParameterIndex;          // for each local replica
 
         // at rank 0:
         typedef typename Model::SystemConfig_FileHandle FileHandle;
         std::vector<FileHandle> par_fileHandle; // file handle to save configurations for each control parameter index
-        std::vector<std::string> process_mpi_buffer; // buffer for MPI gathered data for each process index
-        std::vector<int> process_controlParameterIndex; // cpi mathching the system configuration in process_mpi_buffer
+        std::vector<std::string> replica_mpi_buffer; // buffer for MPI gathered data for each global replica index
+        std::vector<int> replica_controlParameterIndex; // cpi mathching the system configuration in replica_mpi_buffer
     } sc;
     void setup_SaveConfigurations();
+    void write_SaveConfigurations_headers();
     void buffer_local_system_configuration();
     void gather_and_output_buffered_system_configurations();
+
+    //writes configuration streams, time series, results and state files [possibly on a
+    //background thread]; declared last, so it is flushed and destroyed before the data it refers to
+    std::unique_ptr<AsyncWriter> asyncWriter;
 private:
     //Serialize only the content data that has changed after construction.
     //Only call for deserialization after DetQMCPT has already been constructed and initialized!
@@ -207,29 +319,37 @@ private:
     void loadContents(Archive& ar) {
         serializeContentsCommon(ar);
 
-        replica->loadContents(ar);
+        for (auto& replica : replicas) {
+            replica->loadContents(ar);
+        }
 
-        // distribute and update control parameter for replica
+        // distribute and update control parameters for the replicas
         // after deserialization
         namespace mpi = boost::mpi;
         mpi::communicator world;        
-        int new_param_index = 0;
         mpi::scatter(world,
-                     current_process_par, // send
-                     new_param_index,     // recv
-                     0                    // root
+                     current_replica_par,                  // send
+                     local_current_parameter_index.data(), // recv
+                     localReplicas,
+                     0                                     // root
             );
-        local_current_parameter_index = new_param_index;
-        replica->set_exchange_parameter_value(
-            parspt.controlParameterValues[new_param_index]
-            );        
+        for (int lri = 0; lri < localReplicas; ++lri) {
+            replicas[lri]->set_exchange_parameter_value(
+                parspt.controlParameterValues[local_current_parameter_index[lri]]
+                );        
+        }
+        if (parspt.exchangeProtocol == DetQMCPTParams::EXCHANGE_PAIRWISE) {
+            distributeExchangeNeighbors();
+        }
     }
 
     template<class Archive>
     void saveContents(Archive& ar) {
         serializeContentsCommon(ar);
 
-        replica->saveContents(ar);
+        for (auto& replica : replicas) {
+            replica->saveContents(ar);
+        }
     }
 
 
@@ -250,13 +370,28 @@ private:
 
         ar & totalWalltimeSecs;
 
-        ar & local_current_parameter_index;
+        if (Archive::is_loading::value and parspt.stateVersion < 1) {
+            //older state file: one replica per process
+            int current_parameter_index;
+            ar & current_parameter_index;
+            local_current_parameter_index.assign(1, current_parameter_index);
+        } else {
+            ar & local_current_parameter_index;
+        }
 
-        ar & current_process_par;
+        ar & current_replica_par;
 
-        ar & current_par_process;
+        ar & current_par_replica;
 
         ar & es;                // exchange statistics
+
+        //older state files only know the central exchange protocol, keep the
+        //freshly initialized counter and shared rng then
+        if (not (Archive::is_loading::value and parspt.stateVersion < 1)) {
+            ar & exchangeStepCounter;
+
+            ar & sharedRng;
+        }
     }
 };
 
@@ -282,8 +417,11 @@ void DetQMCPT<Model,ModelParams>::initFromParameters(const ModelParams& parsmode
     mpi::communicator world;
     processIndex = world.rank();
     numProcesses = world.size();
-    if (numProcesses != int(parspt.controlParameterValues.size())) {
+    localReplicas = int(parspt.replicasPerProcess);
+    numReplicas = numProcesses * localReplicas;
+    if (numReplicas != int(parspt.controlParameterValues.size())) {
         throw_ConfigurationError("Number of processes " + numToString(numProcesses) +
+                                 " times replicasPerProcess " + numToString(localReplicas) +
                                  " does not match number of control parameter values " +
                                  numToString(parspt.controlParameterValues.size()));
     }
@@ -299,42 +437,69 @@ void DetQMCPT<Model,ModelParams>::initFromParameters(const ModelParams& parsmode
         mpi::broadcast(world, parsmc.rngSeed, 0);
     }
     rng = RngWrapper(parsmc.rngSeed, (parsmc.simindex + 1) * (processIndex + 1));
+    // common random numbers for the pairwise exchange protocol
+    sharedRng = RngWrapper(parsmc.rngSeed, (parsmc.simindex + 1) * (numProcesses + 1));
+
+    // every process writes its own state file, rank 0 writes everything else
+    asyncWriter.reset(new AsyncWriter(parsmc.asyncOutputQueue));
 
-    // set up control parameters for current process replica parameters
-    local_current_parameter_index = processIndex;
+    // set up control parameters for the local replicas, initially
+    // the replica with global index ri has control parameter index ri
+    local_current_parameter_index.resize(localReplicas);
+    for (int lri = 0; lri < localReplicas; ++lri) {
+        local_current_parameter_index[lri] = globalReplicaIndex(lri);
+    }
+    // parsmodel carries the control parameter of the first local replica
     parsmodel.set_exchange_parameter_value(
-        parspt.controlParameterValues[local_current_parameter_index]);
+        parspt.controlParameterValues[local_current_parameter_index[0]]);
 
     parsmodel.check();
 
-    // the replicaLogfiledir is for some consistency checks, and is most likely
-    // to be unused in later production runs.  Replicas to be used with this
-    // replica-exchange code therefore are required to support this parameter
-    // in the createReplica function associated to them.
-    std::string replicaLogfiledir = "log_proc_" + numToString(processIndex);
+    replicas.clear();
+    replicas.resize(localReplicas);
+    for (int lri = 0; lri < localReplicas; ++lri) {
+        ModelParams parsreplica = parsmodel;
+        parsreplica.set_exchange_parameter_value(
+            parspt.controlParameterValues[local_current_parameter_index[lri]]);
+
+        // the replicaLogfiledir is for some consistency checks, and is most likely
+        // to be unused in later production runs.  Replicas to be used with this
+        // replica-exchange code therefore are required to support this parameter
+        // in the createReplica function associated to them.
+        std::string replicaLogfiledir = "log_proc_" + numToString(globalReplicaIndex(lri));
     
-    createReplica(replica, rng, parsmodel, parslogging, replicaLogfiledir);
+        createReplica(replicas[lri], rng, parsreplica, parslogging, replicaLogfiledir);
+    }
     
-    // at rank 0 keep track of which process has which control parameter currently
+    // at rank 0 keep track of which replica has which control parameter currently
     // and track exchange action contributions
     // also initialize control parameter data buffers,
     // at rank 0: exchangeStatistics
     if (processIndex == 0) {
-        // fill with 0, 1, 2, ... numProcesses-1
-        current_process_par.resize(numProcesses);
-        std::iota(current_process_par.begin(), current_process_par.end(), 0);
-        current_par_process.resize(numProcesses);
-        std::iota(current_par_process.begin(), current_par_process.end(), 0);
-        exchange_action.resize(numProcesses, 0);
+        // fill with 0, 1, 2, ... numReplicas-1
+        current_replica_par.resize(numReplicas);
+        std::iota(current_replica_par.begin(), current_replica_par.end(), 0);
+        current_par_replica.resize(numReplicas);
+        std::iota(current_par_replica.begin(), current_par_replica.end(), 0);
+        exchange_action.resize(numReplicas, 0);
         
         // control_data_buffer_1.resize(numProcesses * replica->get_control_data_buffer_size());        
         // control_data_buffer_2.resize(numProcesses * replica->get_control_data_buffer_size());
-        process_control_data_buffer.resize(numProcesses);        
+        replica_control_data_buffer.resize(numReplicas);        
         // control_data_buffer_2.resize(numProcesses);
         es = ExchangeStatistics(parspt);
     }
     //local_control_data_buffer.resize(replica->get_control_data_buffer_size());
-    local_control_data_buffer.clear();
+    local_control_data_buffer.assign(localReplicas, std::string());
+    local_exchange_action.assign(localReplicas, 0.0);
+
+    // with the pairwise exchange protocol every process keeps its own statistics
+    // and tracks its neighbors in control parameter space
+    if (parspt.exchangeProtocol == DetQMCPTParams::EXCHANGE_PAIRWISE) {
+        es = ExchangeStatistics(parspt);
+        exchangeStepCounter = 0;
+        distributeExchangeNeighbors();
+    }
 
 
     //prepare metadata
@@ -344,47 +509,50 @@ void DetQMCPT<Model,ModelParams>::initFromParameters(const ModelParams& parsmode
     mcMeta.erase("stateFileName");
     ptMeta = parspt.prepareMetadataMap();
 
-    //prepare observable handlers
-    auto scalarObs = replica->getScalarObservables();
+    //prepare observable handlers [from the observables of the first local replica]
+    auto scalarObs = replicas[0]->getScalarObservables();
     for (auto obsP = scalarObs.cbegin(); obsP != scalarObs.cend(); ++obsP) {
         obsHandlers.push_back(
-            ObsPtr(new ScalarObservableHandlerPT(*obsP, current_process_par, parsmc, parspt, modelMeta, mcMeta, ptMeta))
+            ObsPtr(new ScalarObservableHandlerPT(*obsP, current_replica_par, parsmc, parspt, modelMeta, mcMeta, ptMeta))
         );
     }
 
-    auto vectorObs = replica->getVectorObservables();
+    auto vectorObs = replicas[0]->getVectorObservables();
     for (auto obsP = vectorObs.cbegin(); obsP != vectorObs.cend(); ++obsP) {
         vecObsHandlers.push_back(
-            VecObsPtr(new VectorObservableHandlerPT(*obsP, current_process_par, parsmc, parspt, modelMeta, mcMeta, ptMeta))
+            VecObsPtr(new VectorObservableHandlerPT(*obsP, current_replica_par, parsmc, parspt, modelMeta, mcMeta, ptMeta))
         );
     }
-    auto keyValueObs = replica->getKeyValueObservables();
+    auto keyValueObs = replicas[0]->getKeyValueObservables();
     for (auto obsP = keyValueObs.cbegin(); obsP != keyValueObs.cend(); ++obsP) {
         vecObsHandlers.push_back(
-            VecObsPtr(new KeyValueObservableHandlerPT(*obsP, current_process_par, parsmc, parspt, modelMeta, mcMeta, ptMeta))
+            VecObsPtr(new KeyValueObservableHandlerPT(*obsP, current_replica_par, parsmc, parspt, modelMeta, mcMeta, ptMeta))
         );
     }
+    // the same observables at the other local replicas
+    for (int lri = 1; lri < localReplicas; ++lri) {
+        auto scalarObs_lri = replicas[lri]->getScalarObservables();
+        for (std::size_t i = 0; i < scalarObs_lri.size(); ++i) {
+            obsHandlers[i]->addLocalReplicaObservable(scalarObs_lri[i]);
+        }
+        auto vectorObs_lri = replicas[lri]->getVectorObservables();
+        for (std::size_t i = 0; i < vectorObs_lri.size(); ++i) {
+            vecObsHandlers[i]->addLocalReplicaObservable(vectorObs_lri[i]);
+        }
+        auto keyValueObs_lri = replicas[lri]->getKeyValueObservables();
+        for (std::size_t i = 0; i < keyValueObs_lri.size(); ++i) {
+            vecObsHandlers[vectorObs_lri.size() + i]->addLocalReplicaObservable(keyValueObs_lri[i]);
+        }
+    }
 
     // setup files for system configuration streams [if files do not exist already]
-    // [each process for its local replica]
+    // [each process for its local replicas]
     // Afterwards only the master process will continue to write to these files
-    if (parsmc.saveConfigurationStreamText or parsmc.saveConfigurationStreamBinary) {
-        namespace fs = boost::filesystem;
-        std::string subdir_string = control_parameter_subdir(local_current_parameter_index);
-        fs::create_directories(subdir_string);
-        std::string parname = parspt.controlParameterName;
-        std::string parvalue = numToString(parspt.controlParameterValues[local_current_parameter_index]);            
-        MetadataMap modelMeta_cpi = modelMeta;
-        modelMeta_cpi[parname] = parvalue;
-        std::string headerInfoText = metadataToString(modelMeta_cpi, "#")
-            + metadataToString(mcMeta, "#")
-            + metadataToString(ptMeta, "#");
-        if (parsmc.saveConfigurationStreamText) {
-            replica->saveConfigurationStreamTextHeader(headerInfoText, subdir_string);
-        }
-        if (parsmc.saveConfigurationStreamBinary) {
-            replica->saveConfigurationStreamBinaryHeaderfile(headerInfoText, subdir_string);
-        }
+    // With adaptive control parameters this is done once they are final.
+    if ((parsmc.saveConfigurationStreamText or parsmc.saveConfigurationStreamBinary
+         or parsmc.saveConfigurationStreamIndexed)
+        and controlParametersFinal()) {
+        write_SaveConfigurations_headers();
     }
 
 
@@ -414,6 +582,30 @@ void DetQMCPT<Model,ModelParams>::initFromParameters(const ModelParams& parsmode
     }
 }
 
+template<class Model, class ModelParams>
+void DetQMCPT<Model, ModelParams>::write_SaveConfigurations_headers() {
+    // [each process for its local replicas, at their current control parameter values]
+    namespace fs = boost::filesystem;
+    for (int lri = 0; lri < localReplicas; ++lri) {
+        int cpi = local_current_parameter_index[lri];
+        std::string subdir_string = control_parameter_subdir(cpi);
+        fs::create_directories(subdir_string);
+        std::string parname = parspt.controlParameterName;
+        std::string parvalue = numToString(parspt.controlParameterValues[cpi]);            
+        MetadataMap modelMeta_cpi = modelMeta;
+        modelMeta_cpi[parname] = parvalue;
+        std::string headerInfoText = metadataToString(modelMeta_cpi, "#")
+            + metadataToString(mcMeta, "#")
+            + metadataToString(ptMeta, "#");
+        if (parsmc.saveConfigurationStreamText) {
+            replicas[lri]->saveConfigurationStreamTextHeader(headerInfoText, subdir_string);
+        }
+        if (parsmc.saveConfigurationStreamBinary) {
+            replicas[lri]->saveConfigurationStreamBinaryHeaderfile(headerInfoText, subdir_string);
+        }
+    }
+}
+
 
 
 template<class Model, class ModelParams>
@@ -423,46 +615,55 @@ DetQMCPT<Model, ModelParams>::DetQMCPT(const ModelParams& parsmodel_, const DetQ
     :
     parsmodel(), parsmc(), parspt(), parslogging(),
     //proper initialization of default initialized members done in initFromParameters
-    modelMeta(), mcMeta(), ptMeta(), rng(), replica(),
-    obsHandlers(), vecObsHandlers(),
+    modelMeta(), mcMeta(), ptMeta(), rng(), replicas(),
+    obsHandlers(), vecObsHandlers(), obsGatherer(),
     sweepsDone(0), sweepsDoneThermalization(),
     swCounter(0),
     elapsedTimer(),     // start timing
     totalWalltimeSecs(0), walltimeSecsLastSaveResults(0),
     grantedWalltimeSecs(0), jobid(""),
     numProcesses(1), processIndex(0),
-    local_current_parameter_index(0),
-    current_process_par(1, 0),
-    current_par_process(1, 0),
+    localReplicas(1), numReplicas(1),
+    local_current_parameter_index(1, 0),
+    current_replica_par(1, 0),
+    current_par_replica(1, 0),
     exchange_action(1, 0),
-    process_control_data_buffer(),
+    replica_control_data_buffer(),
     //control_data_buffer_2(),
     local_control_data_buffer(),
-    es(), sc()
+    local_exchange_action(),
+    local_neighbor_down_replica(), local_neighbor_up_replica(),
+    exchangeStepCounter(0), sharedRng(), sharedRandomNumbers(),
+    es(), sc(), asyncWriter()
 {
     initFromParameters(parsmodel_, parsmc_, parspt_, parslogging_);
 }
 
 template<class Model, class ModelParams>
-DetQMCPT<Model, ModelParams>::DetQMCPT(const std::string& stateFileName, const DetQMCParams& newParsmc) :
+DetQMCPT<Model, ModelParams>::DetQMCPT(const std::string& stateFileName, const DetQMCParams& newParsmc,
+                                       const ModelParams& newParsmodel) :
     parsmodel(), parsmc(), parspt(), parslogging(),
     //proper initialization of default initialized members done by loading from archive
-    modelMeta(), mcMeta(), rng(), replica(),
-    obsHandlers(), vecObsHandlers(),
+    modelMeta(), mcMeta(), rng(), replicas(),
+    obsHandlers(), vecObsHandlers(), obsGatherer(),
     sweepsDone(), sweepsDoneThermalization(),
     swCounter(0),
     elapsedTimer(),     // start timing
     totalWalltimeSecs(0), walltimeSecsLastSaveResults(0),
     grantedWalltimeSecs(0), jobid(""),
     numProcesses(1), processIndex(0),
-    local_current_parameter_index(0),
-    current_process_par(1, 0),
-    current_par_process(1, 0),
+    localReplicas(1), numReplicas(1),
+    local_current_parameter_index(1, 0),
+    current_replica_par(1, 0),
+    current_par_replica(1, 0),
     exchange_action(1, 0),
-    process_control_data_buffer(),
+    replica_control_data_buffer(),
     //control_data_buffer_2(),
     local_control_data_buffer(),
-    es()
+    local_exchange_action(),
+    local_neighbor_down_replica(), local_neighbor_up_replica(),
+    exchangeStepCounter(0), sharedRng(), sharedRandomNumbers(),
+    es(), sc(), asyncWriter()
 {
     std::ifstream ifs;
     ifs.exceptions(std::ifstream::badbit | std::ifstream::failbit);
@@ -474,6 +675,8 @@ DetQMCPT<Model, ModelParams>::DetQMCPT(const std::string& stateFileName, const D
     DetQMCPTParams parspt_;
     ia >> parslogging_ >> parsmodel_ >> parsmc_ >> parspt_;
 
+    parsmodel_.takeRuntimeParameters(newParsmodel, processIndex == 0);
+
     if (newParsmc.sweeps > parsmc_.sweeps) {
         if (processIndex == 0) {
             std::cout << "Target sweeps will be changed from " << parsmc_.sweeps
@@ -489,6 +692,14 @@ DetQMCPT<Model, ModelParams>::DetQMCPT(const std::string& stateFileName, const D
         }
         parsmc_.saveInterval = newParsmc.saveInterval;
     }
+    if (newParsmc.specified.count("asyncOutputQueue") and
+        newParsmc.asyncOutputQueue != parsmc_.asyncOutputQueue) {
+        if (processIndex == 0) {
+            std::cout << "asyncOutputQueue will be changed from " << parsmc_.asyncOutputQueue
+                      << " to " << newParsmc.asyncOutputQueue << std::endl;
+        }
+        parsmc_.asyncOutputQueue = newParsmc.asyncOutputQueue;
+    }
     parsmc_.stateFileName = stateFileName;
 
     //make sure mcparams are set correctly as "specified"
@@ -525,12 +736,24 @@ void DetQMCPT<Model, ModelParams>::saveState() {
 
     //serialize state to file
     // -- every process needs to do this
-    std::ofstream ofs;
-    ofs.exceptions(std::ofstream::badbit | std::ofstream::failbit);
-    ofs.open(parsmc.stateFileName.c_str(), std::ios::binary);
-    boost::archive::binary_oarchive oa(ofs);
-    oa << parslogging << parsmodel << parsmc << parspt;
-    saveContents(oa);
+    if (parspt.exchangeProtocol == DetQMCPTParams::EXCHANGE_PAIRWISE) {
+        gatherCurrentReplicaPar();
+    }
+    // -- into memory, the file is written by asyncWriter
+    std::ostringstream stateStream(std::ios::binary);
+    {
+        boost::archive::binary_oarchive oa(stateStream);
+        oa << parslogging << parsmodel << parsmc << parspt;
+        saveContents(oa);
+    }
+    std::shared_ptr<std::string> stateData(new std::string(stateStream.str()));
+    std::string stateFileName = parsmc.stateFileName;
+    asyncWriter->submit([stateData, stateFileName]() {
+        std::ofstream ofs;
+        ofs.exceptions(std::ofstream::badbit | std::ofstream::failbit);
+        ofs.open(stateFileName.c_str(), std::ios::binary);
+        ofs.write(stateData->data(), stateData->size());
+    });
 
     //write out info about state of simulation to "info.dat"
     // -- one for the main directory and one for each subdirectory (control parameter specific)
@@ -546,32 +769,38 @@ void DetQMCPT<Model, ModelParams>::saveState() {
         
         currentState["totalWallTimeSecs"] = numToString(totalWalltimeSecs);
 
-        auto write_info = [this](const MetadataMap& modelMeta_, const MetadataMap& currentState,
-                                 const fs::path& subdirectory) {
-            fs::create_directories(subdirectory);
-            std::string commonInfoFilename = (subdirectory / fs::path("info.dat")).string();
-            writeOnlyMetaData(commonInfoFilename, collectVersionInfo(),
-                              "Collected information about this determinantal quantum Monte Carlo simulation",
-                              false);
-            writeOnlyMetaData(commonInfoFilename, modelMeta_,
-                              "Model parameters:",
-                              true);
-            writeOnlyMetaData(commonInfoFilename, mcMeta,
-                              "Monte Carlo parameters:",
-                              true);
-            writeOnlyMetaData(commonInfoFilename, ptMeta,
-                              "Replica exchange parameters:",
-                              true);
-            writeOnlyMetaData(commonInfoFilename, currentState,
-                              "Current state of simulation:",
-                              true);
+        MetadataMap versionInfo = collectVersionInfo();
+        auto write_info = [this, &versionInfo](const MetadataMap& modelMeta_, const MetadataMap& currentState,
+                                               const fs::path& subdirectory) {
+            MetadataMap mcMeta_ = mcMeta;
+            MetadataMap ptMeta_ = ptMeta;
+            asyncWriter->submit([versionInfo, modelMeta_, mcMeta_, ptMeta_, currentState, subdirectory]() {
+                fs::create_directories(subdirectory);
+                std::string commonInfoFilename = (subdirectory / fs::path("info.dat")).string();
+                writeOnlyMetaData(commonInfoFilename, versionInfo,
+                                  "Collected information about this determinantal quantum Monte Carlo simulation",
+                                  false);
+                writeOnlyMetaData(commonInfoFilename, modelMeta_,
+                                  "Model parameters:",
+                                  true);
+                writeOnlyMetaData(commonInfoFilename, mcMeta_,
+                                  "Monte Carlo parameters:",
+                                  true);
+                writeOnlyMetaData(commonInfoFilename, ptMeta_,
+                                  "Replica exchange parameters:",
+                                  true);
+                writeOnlyMetaData(commonInfoFilename, currentState,
+                                  "Current state of simulation:",
+                                  true);
+            });
         };
 
         // top level directory: info not restricted to any value of the control parameter
         write_info(modelMeta, currentState, fs::path("."));
 
         // write a separate info.dat for each value of the control parameter
-        for (int cpi = 0; cpi < numProcesses; ++cpi) {
+        // [not for intermediate values of adaptive control parameters]
+        for (int cpi = 0; controlParametersFinal() and cpi < numReplicas; ++cpi) {
             std::string subdir_string = control_parameter_subdir(cpi);
             std::string parname = parspt.controlParameterName;
             std::string parvalue = numToString(parspt.controlParameterValues[cpi]);            
@@ -581,8 +810,9 @@ void DetQMCPT<Model, ModelParams>::saveState() {
         }        
     }
 
+    ExchangeStatistics stats = collectExchangeStatistics();
     if (processIndex == 0) {
-        saveReplicaExchangeStatistics();
+        saveReplicaExchangeStatistics(stats);
     }
 
     if (processIndex == 0) {
@@ -593,7 +823,27 @@ void DetQMCPT<Model, ModelParams>::saveState() {
 }
 
 template<class Model, class ModelParams>
-void DetQMCPT<Model, ModelParams>::saveReplicaExchangeStatistics() {
+typename DetQMCPT<Model, ModelParams>::ExchangeStatistics
+DetQMCPT<Model, ModelParams>::collectExchangeStatistics() {
+    if (parspt.exchangeProtocol != DetQMCPTParams::EXCHANGE_PAIRWISE) {
+        return es;
+    }
+    namespace mpi = boost::mpi;
+    mpi::communicator world;
+    ExchangeStatistics total(parspt);
+    auto sum = [&world, this](const std::vector<int>& local, std::vector<int>& total_out) {
+        mpi::reduce(world, local.data(), numReplicas, total_out.data(),
+                    std::plus<int>(), 0);
+    };
+    sum(es.par_swapUpAccepted, total.par_swapUpAccepted);
+    sum(es.par_swapUpProposed, total.par_swapUpProposed);
+    sum(es.par_countGoingUp, total.par_countGoingUp);
+    sum(es.par_countGoingDown, total.par_countGoingDown);
+    return total;
+}
+
+template<class Model, class ModelParams>
+void DetQMCPT<Model, ModelParams>::saveReplicaExchangeStatistics(const ExchangeStatistics& stats) {
     IntDoubleMapWriter mapWriter;
     mapWriter.addMetadataMap(modelMeta);
     mapWriter.addMetadataMap(mcMeta);
@@ -601,7 +851,7 @@ void DetQMCPT<Model, ModelParams>::saveReplicaExchangeStatistics() {
 
     // index -> control parameter
     std::shared_ptr<std::map<int, double>> controlParameters(new std::map<int,double>);
-    for (int cpi = 0; cpi < numProcesses; ++cpi) {
+    for (int cpi = 0; cpi < numReplicas; ++cpi) {
         (*controlParameters)[cpi] = parspt.controlParameterValues[cpi];
     }
     IntDoubleMapWriter controlParametersWriter = mapWriter;
@@ -609,13 +859,12 @@ void DetQMCPT<Model, ModelParams>::saveReplicaExchangeStatistics() {
     controlParametersWriter.addHeaderText("Control parameter values");
     controlParametersWriter.addHeaderText("control parameter index \t control parameter value");
     controlParametersWriter.setData(controlParameters);
-    controlParametersWriter.writeToFile("exchange-parameters.values");
 
     //control parameter swap acceptance
     std::shared_ptr<std::map<int, double>> cpiAccRates(new std::map<int,double>);
-    for (int cpi = 0; cpi < numProcesses; ++cpi) {
-        int countAccepted = es.par_swapUpAccepted[cpi];
-        int countProposed = es.par_swapUpProposed[cpi];
+    for (int cpi = 0; cpi < numReplicas; ++cpi) {
+        int countAccepted = stats.par_swapUpAccepted[cpi];
+        int countProposed = stats.par_swapUpProposed[cpi];
         double ar = 0.0;
         if (countProposed != 0) {
             ar = static_cast<double>(countAccepted)
@@ -628,13 +877,12 @@ void DetQMCPT<Model, ModelParams>::saveReplicaExchangeStatistics() {
     cpiAccRatesWriter.addHeaderText("Acceptance ratio of exchanging replicas at control parameters (upwards)");
     cpiAccRatesWriter.addHeaderText("control parameter index \t acceptance ratio");
     cpiAccRatesWriter.setData(cpiAccRates);
-    cpiAccRatesWriter.writeToFile("exchange-acceptance.values");
 
     //diffusion fraction
     std::shared_ptr<std::map<int, double>> dfractions(new std::map<int,double>);
-    for (int cpi = 0; cpi < numProcesses; ++cpi) {
-        int countUp = es.par_countGoingUp[cpi];
-        int countDown = es.par_countGoingDown[cpi];
+    for (int cpi = 0; cpi < numReplicas; ++cpi) {
+        int countUp = stats.par_countGoingUp[cpi];
+        int countDown = stats.par_countGoingDown[cpi];
         double df = 0.0;
         if (countUp + countDown != 0) {
             df = static_cast<double>(countUp)
@@ -647,7 +895,12 @@ void DetQMCPT<Model, ModelParams>::saveReplicaExchangeStatistics() {
     dfractionsWriter.addHeaderText("Diffusion fraction of replicas at control parameters: df = nUp / (nUp + nDown)");
     dfractionsWriter.addHeaderText("control parameter index \t diffusion fraction");
     dfractionsWriter.setData(dfractions);
-    dfractionsWriter.writeToFile("exchange-diffusion.values");
+
+    asyncWriter->submit([controlParametersWriter, cpiAccRatesWriter, dfractionsWriter]() mutable {
+        controlParametersWriter.writeToFile("exchange-parameters.values");
+        cpiAccRatesWriter.writeToFile("exchange-acceptance.values");
+        dfractionsWriter.writeToFile("exchange-diffusion.values");
+    });
 }
 
 
@@ -668,34 +921,41 @@ DetQMCPT<Model, ModelParams>::~DetQMCPT() {
 template<class Model, class ModelParams>
 void DetQMCPT<Model, ModelParams>::setup_SaveConfigurations() {
     namespace fs = boost::filesystem;
-    if (parsmc.saveConfigurationStreamText or parsmc.saveConfigurationStreamBinary) {
+    if (parsmc.saveConfigurationStreamText or parsmc.saveConfigurationStreamBinary
+        or parsmc.saveConfigurationStreamIndexed) {
         sc = SaveConfigurations();
     
+        sc.local_mpi_buffer.resize(localReplicas);
+        sc.local_controlParameterIndex.resize(localReplicas);
         if (processIndex == 0) {
-            sc.par_fileHandle.resize(numProcesses);
-            for (int cpi = 0; cpi < numProcesses; ++cpi) {
+            sc.par_fileHandle.resize(numReplicas);
+            for (int cpi = 0; cpi < numReplicas; ++cpi) {
                 std::string subdirectory = control_parameter_subdir(cpi);
                 fs::create_directories(subdirectory);
-                sc.par_fileHandle[cpi] = replica->prepareSystemConfigurationStreamFileHandle(
+                sc.par_fileHandle[cpi] = replicas[0]->prepareSystemConfigurationStreamFileHandle(
                     parsmc.saveConfigurationStreamBinary, parsmc.saveConfigurationStreamText,
+                    parsmc.saveConfigurationStreamIndexed,
                     subdirectory
                     );
             }
-            sc.process_mpi_buffer.resize(numProcesses);
-            for (int pi = 0; pi < numProcesses; ++pi) {
-                sc.process_mpi_buffer[pi].clear();
+            sc.replica_mpi_buffer.resize(numReplicas);
+            for (int ri = 0; ri < numReplicas; ++ri) {
+                sc.replica_mpi_buffer[ri].clear();
             }
-            sc.process_controlParameterIndex.resize(numProcesses);
+            sc.replica_controlParameterIndex.resize(numReplicas);
         }
     }
 }
 
 template<class Model, class ModelParams>
 void DetQMCPT<Model, ModelParams>::buffer_local_system_configuration() {
-    // each process buffers the system configuration of its replica in local memory
-    if (parsmc.saveConfigurationStreamText or parsmc.saveConfigurationStreamBinary) {
-        sc.local_bufferedConfigurations.push(replica->getCurrentSystemConfiguration());
-        sc.local_bufferedControlParameterIndex.push(local_current_parameter_index);
+    // each process buffers the system configurations of its replicas in local memory
+    if (parsmc.saveConfigurationStreamText or parsmc.saveConfigurationStreamBinary
+        or parsmc.saveConfigurationStreamIndexed) {
+        for (int lri = 0; lri < localReplicas; ++lri) {
+            sc.local_bufferedConfigurations.push(replicas[lri]->getCurrentSystemConfiguration());
+            sc.local_bufferedControlParameterIndex.push(local_current_parameter_index[lri]);
+        }
     }
 }
 
@@ -704,55 +964,76 @@ void DetQMCPT<Model, ModelParams>::gather_and_output_buffered_system_configurati
     namespace mpi = boost::mpi;
     mpi::communicator world;
 
-    if (not (parsmc.saveConfigurationStreamText or parsmc.saveConfigurationStreamBinary)) {
+    if (not (parsmc.saveConfigurationStreamText or parsmc.saveConfigurationStreamBinary
+             or parsmc.saveConfigurationStreamIndexed)) {
         return;
     }
 
     while (not sc.local_bufferedConfigurations.empty()) {
-        // collect at rank0
+        // collect at rank0, the buffered configurations of all local
+        // replicas at once
         
-        sc.local_mpi_buffer.clear();
-        serialize_systemConfig_to_buffer(sc.local_mpi_buffer,
-                                         sc.local_bufferedConfigurations.front());
-        int local_cpi = sc.local_bufferedControlParameterIndex.front();
-
-        sc.local_bufferedConfigurations.pop();
-        sc.local_bufferedControlParameterIndex.pop();
+        for (int lri = 0; lri < localReplicas; ++lri) {
+            sc.local_mpi_buffer[lri].clear();
+            serialize_systemConfig_to_buffer(sc.local_mpi_buffer[lri],
+                                             sc.local_bufferedConfigurations.front());
+            sc.local_controlParameterIndex[lri] = sc.local_bufferedControlParameterIndex.front();
+
+            sc.local_bufferedConfigurations.pop();
+            sc.local_bufferedControlParameterIndex.pop();
+        }
         
         if (processIndex == 0) {
-            for (auto& datastring : sc.process_mpi_buffer) {
+            for (auto& datastring : sc.replica_mpi_buffer) {
                 datastring.clear();
             }
+            mpi::gather(world,
+                        sc.local_mpi_buffer.data(),   // send
+                        localReplicas,
+                        sc.replica_mpi_buffer.data(), // recv at rank 0
+                        0);
+            mpi::gather(world,
+                        sc.local_controlParameterIndex.data(),   // send
+                        localReplicas,
+                        sc.replica_controlParameterIndex.data(), // recv at rank 0
+                        0);
+        } else {
+            mpi::gather(world, sc.local_mpi_buffer.data(), localReplicas, 0);
+            mpi::gather(world, sc.local_controlParameterIndex.data(), localReplicas, 0);
         }
-        
-        mpi::gather(world,
-                    sc.local_mpi_buffer,   // send
-                    sc.process_mpi_buffer, // recv at rank 0
-                    0);
 
-        mpi::gather(world,
-                    local_cpi,                        // send
-                    sc.process_controlParameterIndex, // recv at rank 0
-                    0);
-
-        // write to the right files
+        // write to the right files [deserialize here, then hand over the
+        // configurations to asyncWriter, which is the only one to use the
+        // file handles]
 
         if (processIndex == 0) {
-            for (int pi = 0; pi < numProcesses; ++pi) {
-                typename SaveConfigurations::SystemConfig pi_systemConfig;
-                deserialize_systemConfig_from_buffer(pi_systemConfig, sc.process_mpi_buffer[pi]);
-                int cpi = sc.process_controlParameterIndex[pi];
-
-                pi_systemConfig.write_to_disk(sc.par_fileHandle[cpi]);
+            typedef typename SaveConfigurations::SystemConfig SystemConfig;
+            typedef typename SaveConfigurations::FileHandle FileHandle;
+            std::shared_ptr<std::vector<SystemConfig>> replica_systemConfig(
+                new std::vector<SystemConfig>(numReplicas));
+            for (int ri = 0; ri < numReplicas; ++ri) {
+                deserialize_systemConfig_from_buffer((*replica_systemConfig)[ri], sc.replica_mpi_buffer[ri]);
             }
+            std::vector<int> replica_cpi = sc.replica_controlParameterIndex;
+            std::vector<FileHandle> par_fileHandle = sc.par_fileHandle;
+            asyncWriter->submit([replica_systemConfig, replica_cpi, par_fileHandle]() mutable {
+                for (std::size_t ri = 0; ri < replica_systemConfig->size(); ++ri) {
+                    int cpi = replica_cpi[ri];
+                    (*replica_systemConfig)[ri].write_to_disk(par_fileHandle[cpi]);
+                }
+            });
         }
     }
 
     // flush all ofstreams
     if (processIndex == 0) {
-        for (int cpi = 0; cpi < numProcesses; ++cpi) {
-            sc.par_fileHandle[cpi].flush();
-        }
+        typedef typename SaveConfigurations::FileHandle FileHandle;
+        std::vector<FileHandle> par_fileHandle = sc.par_fileHandle;
+        asyncWriter->submit([par_fileHandle]() mutable {
+            for (auto& fileHandle : par_fileHandle) {
+                fileHandle.flush();
+            }
+        });
     }
 }
 
@@ -790,7 +1071,9 @@ void DetQMCPT<Model, ModelParams>::run() {
         this->saveState();
     };
 
-    if (parsmc.saveConfigurationStreamText or parsmc.saveConfigurationStreamBinary) {
+    if ((parsmc.saveConfigurationStreamText or parsmc.saveConfigurationStreamBinary
+         or parsmc.saveConfigurationStreamIndexed)
+        and controlParametersFinal()) {
         setup_SaveConfigurations();
     }
     
@@ -854,16 +1137,26 @@ void DetQMCPT<Model, ModelParams>::run() {
         switch (stage) {
 
         case T: {
-            switch(parsmc.greenUpdateType) {
-            case GreenUpdateType::GreenUpdateTypeSimple:
-                replica->sweepSimpleThermalization();
-                break;
-            case GreenUpdateType::GreenUpdateTypeStabilized:
-                replica->sweepThermalization();
-                break;
+            for (auto& replica : replicas) {
+                switch(parsmc.greenUpdateType) {
+                case GreenUpdateType::GreenUpdateTypeSimple:
+                    replica->sweepSimpleThermalization();
+                    break;
+                case GreenUpdateType::GreenUpdateTypeStabilized:
+                    replica->sweepThermalization();
+                    break;
+                }
             }
             ++sweepsDoneThermalization;
             ++swCounter;
+            if (parspt.adaptControlParameters and sweepsDoneThermalization <= adaptationSweeps()) {
+                if (sweepsDoneThermalization % parspt.adaptInterval == 0) {
+                    adaptControlParameterValues();
+                }
+                if (sweepsDoneThermalization == adaptationSweeps()) {
+                    freezeControlParameters();
+                }
+            }
             if (swCounter == parsmc.saveInterval) {
                 if (processIndex == 0) {
                     std::cout << "  " << sweepsDoneThermalization << " ... saving state...";
@@ -880,7 +1173,9 @@ void DetQMCPT<Model, ModelParams>::run() {
                 if (processIndex == 0) {
                     std::cout << "Thermalization finished\n" << std::endl;
                 }
-                replica->thermalizationOver(processIndex);
+                for (int lri = 0; lri < localReplicas; ++lri) {
+                    replicas[lri]->thermalizationOver(globalReplicaIndex(lri));
+                }
                 swCounter = 0;
                 measurementsStage();
             }
@@ -890,22 +1185,22 @@ void DetQMCPT<Model, ModelParams>::run() {
             ++swCounter;
             bool takeMeasurementNow = (swCounter % parsmc.measureInterval == 0);
             
-            switch(parsmc.greenUpdateType) {
-            case GreenUpdateType::GreenUpdateTypeSimple:
-                replica->sweepSimple(takeMeasurementNow);
-                break;
-            case GreenUpdateType::GreenUpdateTypeStabilized:
-                replica->sweep(takeMeasurementNow);
-                break;
+            for (auto& replica : replicas) {
+                switch(parsmc.greenUpdateType) {
+                case GreenUpdateType::GreenUpdateTypeSimple:
+                    replica->sweepSimple(takeMeasurementNow);
+                    break;
+                case GreenUpdateType::GreenUpdateTypeStabilized:
+                    replica->sweep(takeMeasurementNow);
+                    break;
+                }
             }
 
             if (takeMeasurementNow) {
-                for (auto ph = obsHandlers.begin(); ph != obsHandlers.end(); ++ph) {
-                    (*ph)->insertValue(sweepsDone);
-                }
-                for (auto ph = vecObsHandlers.begin(); ph != vecObsHandlers.end(); ++ph) {
-                    (*ph)->insertValue(sweepsDone);
+                if (parspt.exchangeProtocol == DetQMCPTParams::EXCHANGE_PAIRWISE) {
+                    gatherCurrentReplicaPar();
                 }
+                obsGatherer.insertValues(sweepsDone, localReplicas, obsHandlers, vecObsHandlers);
 
                 if (swCounter % parsmc.saveConfigurationStreamInterval == 0) {
                     buffer_local_system_configuration();
@@ -949,12 +1244,19 @@ void DetQMCPT<Model, ModelParams>::run() {
         //replica exchange
         if (stage == T or stage == M) {
             if (parspt.exchangeInterval != 0 and ((sweepsDone + sweepsDoneThermalization) % parspt.exchangeInterval == 0)) {
-                replicaExchangeStep();
+                if (parspt.exchangeProtocol == DetQMCPTParams::EXCHANGE_PAIRWISE) {
+                    replicaExchangeStepPairwise();
+                } else {
+                    replicaExchangeStep();
+                }
             }
             replicaExchangeConsistencyCheck();
         } //replica exchange
         
     } // while (stage != F)
+
+    //make sure everything has been written to disk before we return
+    asyncWriter->flush();
 }
 
 
@@ -966,19 +1268,24 @@ void DetQMCPT<Model, ModelParams>::replicaExchangeStep() {
     namespace mpi = boost::mpi;
     mpi::communicator world;
     
-    // Gather control_data_buffer contents from all processes:
-    local_control_data_buffer.clear();
-    replica->get_control_data(local_control_data_buffer);
+    // Gather control_data_buffer contents from all replicas:
+    for (int lri = 0; lri < localReplicas; ++lri) {
+        local_control_data_buffer[lri].clear();
+        replicas[lri]->get_control_data(local_control_data_buffer[lri]);
+    }
     if (processIndex == 0) {
-        assert(process_control_data_buffer.size() == (std::size_t)numProcesses);
-        for (auto& datastring : process_control_data_buffer) {
+        assert(replica_control_data_buffer.size() == (std::size_t)numReplicas);
+        for (auto& datastring : replica_control_data_buffer) {
             datastring.clear();
         }
+        mpi::gather(world,
+                    local_control_data_buffer.data(),   // send
+                    localReplicas,
+                    replica_control_data_buffer.data(), // recv at rank 0
+                    0);
+    } else {
+        mpi::gather(world, local_control_data_buffer.data(), localReplicas, 0);
     }
-    mpi::gather(world,
-                local_control_data_buffer,   // send
-                process_control_data_buffer, // recv at rank 0
-                0);
                 
     // double* local_buf = local_control_data_buffer.data();
     // uint32_t local_buf_size = local_control_data_buffer.size();
@@ -995,7 +1302,9 @@ void DetQMCPT<Model, ModelParams>::replicaExchangeStep() {
     
                 
     // Gather exchange action contribution from replicas
-    double localAction = replica->get_exchange_action_contribution();
+    for (int lri = 0; lri < localReplicas; ++lri) {
+        local_exchange_action[lri] = replicas[lri]->get_exchange_action_contribution();
+    }
     // MPI_Gather( &localAction,           // send buf
     //             1,
     //             MPI_DOUBLE,
@@ -1005,38 +1314,43 @@ void DetQMCPT<Model, ModelParams>::replicaExchangeStep() {
     //             0,                      // root process
     //             MPI_COMM_WORLD
     //     );
-    mpi::gather(world,
-                localAction,     // send
-                exchange_action, // recv at rank 0
-                0);
+    if (processIndex == 0) {
+        mpi::gather(world,
+                    local_exchange_action.data(), // send
+                    localReplicas,
+                    exchange_action.data(),       // recv at rank 0
+                    0);
+    } else {
+        mpi::gather(world, local_exchange_action.data(), localReplicas, 0);
+    }
 
 
     if (processIndex == 0) {
 
         //update histograms of replicas moving up or down
-        for (int pi = 0; pi < numProcesses; ++pi) {
-            int nPar = current_process_par[pi];            
-            if (nPar == numProcesses - 1) {
-                es.process_goingWhere[pi] = ExchangeStatistics::DOWN_P;
+        for (int ri = 0; ri < numReplicas; ++ri) {
+            int nPar = current_replica_par[ri];            
+            if (nPar == numReplicas - 1) {
+                es.replica_goingWhere[ri] = ExchangeStatistics::DOWN_P;
             } else if (nPar == 0) {
-                es.process_goingWhere[pi] = ExchangeStatistics::UP_P;
+                es.replica_goingWhere[ri] = ExchangeStatistics::UP_P;
             }
-            if (es.process_goingWhere[pi] == ExchangeStatistics::DOWN_P) {
+            if (es.replica_goingWhere[ri] == ExchangeStatistics::DOWN_P) {
                 ++es.par_countGoingDown[nPar];
-            } else if (es.process_goingWhere[pi] == ExchangeStatistics::UP_P) {
+            } else if (es.replica_goingWhere[ri] == ExchangeStatistics::UP_P) {
                 ++es.par_countGoingUp[nPar];
             }
         }
         
         // serially walk through control parameters and propose exchange
-        for (int cpi1 = 0; cpi1 < numProcesses - 1; ++cpi1) {
+        for (int cpi1 = 0; cpi1 < numReplicas - 1; ++cpi1) {
             int cpi2 = cpi1 + 1;
             double par1 = parspt.controlParameterValues[cpi1];
             double par2 = parspt.controlParameterValues[cpi2];
-            int indexProc1 = current_par_process[cpi1];
-            int indexProc2 = current_par_process[cpi2];
-            double action1 = exchange_action[indexProc1];                    
-            double action2 = exchange_action[indexProc2];
+            int indexReplica1 = current_par_replica[cpi1];
+            int indexReplica2 = current_par_replica[cpi2];
+            double action1 = exchange_action[indexReplica1];                    
+            double action2 = exchange_action[indexReplica2];
 
             num exchange_prob = get_replica_exchange_probability<Model>(par1, action1,
                                                                         par2, action2);
@@ -1044,13 +1358,13 @@ void DetQMCPT<Model, ModelParams>::replicaExchangeStep() {
             if (exchange_prob >= 1 or rng.rand01() <= exchange_prob) {
                 ++es.par_swapUpAccepted[cpi1];
                 // swap control parameters
-                current_process_par[indexProc1] = cpi2;
-                current_process_par[indexProc2] = cpi1;
-                current_par_process[cpi1] = indexProc2;
-                current_par_process[cpi2] = indexProc1;
+                current_replica_par[indexReplica1] = cpi2;
+                current_replica_par[indexReplica2] = cpi1;
+                current_par_replica[cpi1] = indexReplica2;
+                current_par_replica[cpi2] = indexReplica1;
                 // swap control parameter data
-                std::swap(process_control_data_buffer[indexProc1],
-                          process_control_data_buffer[indexProc2]);
+                std::swap(replica_control_data_buffer[indexReplica1],
+                          replica_control_data_buffer[indexReplica2]);
                 
                 // // take control parameter data in swapped process order
                 // //  control_data_buffer_2 { indexProc1 } = control_data_buffer_1 { indexProc2 }
@@ -1078,8 +1392,7 @@ void DetQMCPT<Model, ModelParams>::replicaExchangeStep() {
             // }
         }
     } // if (processIndex == 0)
-    // distribute and update control parameter
-    int new_param_index = 0;
+    // distribute and update control parameters
     // MPI_Scatter( current_process_par.data(), // send buf
     //              1,
     //              MPI_INT,
@@ -1090,18 +1403,23 @@ void DetQMCPT<Model, ModelParams>::replicaExchangeStep() {
     //              MPI_COMM_WORLD
     //     );
     mpi::scatter(world,
-                 current_process_par, // send
-                 new_param_index,     // recv
+                 current_replica_par,                  // send
+                 local_current_parameter_index.data(), // recv
+                 localReplicas,
                  0);
-    replica->set_exchange_parameter_value(
-        parspt.controlParameterValues[new_param_index]
-        );
-    local_current_parameter_index = new_param_index;
-    // distribute new control parameter data and update replica
-    local_control_data_buffer.clear();
+    for (int lri = 0; lri < localReplicas; ++lri) {
+        replicas[lri]->set_exchange_parameter_value(
+            parspt.controlParameterValues[local_current_parameter_index[lri]]
+            );
+    }
+    // distribute new control parameter data and update replicas
+    for (auto& datastring : local_control_data_buffer) {
+        datastring.clear();
+    }
     mpi::scatter(world,
-                 process_control_data_buffer, // send at rank 0
-                 local_control_data_buffer,   // recv 
+                 replica_control_data_buffer,      // send at rank 0
+                 local_control_data_buffer.data(), // recv 
+                 localReplicas,
                  0);
     // MPI_Scatter( control_data_buffer_2.data(), // send buf
     //              local_buf_size,
@@ -1112,21 +1430,321 @@ void DetQMCPT<Model, ModelParams>::replicaExchangeStep() {
     //              0,                            // root process
     //              MPI_COMM_WORLD
     //     );
-    replica->set_control_data(local_control_data_buffer);
+    for (int lri = 0; lri < localReplicas; ++lri) {
+        replicas[lri]->set_control_data(local_control_data_buffer[lri]);
+    }
 
     timing.stop("detqmcpt-replicaExchangeStep");
 }
 
 
+template<class Model, class ModelParams>
+void DetQMCPT<Model, ModelParams>::replicaExchangeStepPairwise() {
+    timing.start("detqmcpt-replicaExchangeStepPairwise");
+
+    namespace mpi = boost::mpi;
+    mpi::communicator world;
+    // Two processes may share several pairs of neighboring control
+    // parameters, so the tag also encodes the lower control parameter
+    // index of the pair a message belongs to.
+    enum MessageTag { TAG_ACTION, TAG_CONTROL_DATA, TAG_NEW_HOLDER, TAG_NEW_OUTER_HOLDER, NUM_TAGS };
+    auto tag = [](MessageTag kind, int lowerCpi) {
+        return int(kind) + int(NUM_TAGS) * lowerCpi;
+    };
+
+    // Draw the same amount of shared random numbers at every process, so
+    // that sharedRng stays in lockstep.  The pair (lowerCpi, lowerCpi + 1)
+    // uses sharedRandomNumbers[lowerCpi / 2].
+    sharedRandomNumbers.resize(numReplicas / 2);
+    sharedRng.fillRand01(sharedRandomNumbers.data(), sharedRandomNumbers.size());
+
+    // even steps: pairs (0,1), (2,3), ...; odd steps: pairs (1,2), (3,4), ...
+    const int parity = int(exchangeStepCounter % 2);
+    ++exchangeStepCounter;
+
+    // the state of the exchange step for each local replica
+    struct PairExchange {
+        int cpi;                    // control parameter index before the step
+        bool isLower;               // replica is at the lower control parameter of its pair
+        int partnerCpi;
+        bool hasPartner;
+        int partner;                // replica at partnerCpi
+        int outer;                  // neighbor on the other side, which belongs to a different pair [or -1]
+        double action;
+        double partnerAction;
+        std::string partnerControlData;
+        bool swapped;
+        int newHolder;              // replica at cpi after the step
+        int outerNewHolder;         // replica at the control parameter of outer after the step
+        int partnerOuterNewHolder;  // outerNewHolder of the partner
+    };
+    std::vector<PairExchange> ex(localReplicas);
+    std::vector<mpi::request> requests;
+
+    for (int lri = 0; lri < localReplicas; ++lri) {
+        PairExchange& e = ex[lri];
+        e.cpi = local_current_parameter_index[lri];
+        e.isLower = (e.cpi % 2 == parity);
+        e.partnerCpi = e.isLower ? e.cpi + 1 : e.cpi - 1;
+        e.hasPartner = (e.partnerCpi >= 0 and e.partnerCpi < numReplicas);
+        e.partner = e.isLower ? local_neighbor_up_replica[lri] : local_neighbor_down_replica[lri];
+        e.outer = e.isLower ? local_neighbor_down_replica[lri] : local_neighbor_up_replica[lri];
+        e.action = 0;
+        e.partnerAction = 0;
+        e.swapped = false;
+        e.outerNewHolder = -1;
+        e.partnerOuterNewHolder = -1;
+
+        //update histogram of replicas moving up or down, for the local replica
+        typename ExchangeStatistics::ParameterDirection& goingWhere =
+            es.replica_goingWhere[globalReplicaIndex(lri)];
+        if (e.cpi == numReplicas - 1) {
+            goingWhere = ExchangeStatistics::DOWN_P;
+        } else if (e.cpi == 0) {
+            goingWhere = ExchangeStatistics::UP_P;
+        }
+        if (goingWhere == ExchangeStatistics::DOWN_P) {
+            ++es.par_countGoingDown[e.cpi];
+        } else if (goingWhere == ExchangeStatistics::UP_P) {
+            ++es.par_countGoingUp[e.cpi];
+        }
+
+        if (e.hasPartner) {
+            e.action = replicas[lri]->get_exchange_action_contribution();
+            local_control_data_buffer[lri].clear();
+            replicas[lri]->get_control_data(local_control_data_buffer[lri]);
+        }
+    }
+
+    // 1) exchange actions and control data with the partner, both decide on
+    //    the swap with the same shared random number
+    for (int lri = 0; lri < localReplicas; ++lri) {
+        PairExchange& e = ex[lri];
+        if (not e.hasPartner) {
+            continue;
+        }
+        if (replicaProcess(e.partner) == processIndex) {
+            const int partnerLri = replicaLocalIndex(e.partner);
+            e.partnerAction = ex[partnerLri].action;
+            e.partnerControlData = local_control_data_buffer[partnerLri];
+        } else {
+            const int partnerProcess = replicaProcess(e.partner);
+            const int lowerCpi = std::min(e.cpi, e.partnerCpi);
+            requests.push_back(world.isend(partnerProcess, tag(TAG_ACTION, lowerCpi), e.action));
+            requests.push_back(world.irecv(partnerProcess, tag(TAG_ACTION, lowerCpi), e.partnerAction));
+            requests.push_back(world.isend(partnerProcess, tag(TAG_CONTROL_DATA, lowerCpi),
+                                           local_control_data_buffer[lri]));
+            requests.push_back(world.irecv(partnerProcess, tag(TAG_CONTROL_DATA, lowerCpi),
+                                           e.partnerControlData));
+        }
+    }
+    mpi::wait_all(requests.begin(), requests.end());
+    requests.clear();
+
+    for (int lri = 0; lri < localReplicas; ++lri) {
+        PairExchange& e = ex[lri];
+        if (not e.hasPartner) {
+            continue;
+        }
+        const int lowerCpi = e.isLower ? e.cpi : e.partnerCpi;
+        const int upperCpi = lowerCpi + 1;
+        double actionLower = e.isLower ? e.action : e.partnerAction;
+        double actionUpper = e.isLower ? e.partnerAction : e.action;
+        num exchange_prob = get_replica_exchange_probability<Model>(
+            parspt.controlParameterValues[lowerCpi], actionLower,
+            parspt.controlParameterValues[upperCpi], actionUpper);
+        e.swapped = (exchange_prob >= 1 or sharedRandomNumbers[lowerCpi / 2] <= exchange_prob);
+        if (e.isLower) {
+            ++es.par_swapUpProposed[lowerCpi];
+            if (e.swapped) {
+                ++es.par_swapUpAccepted[lowerCpi];
+            }
+        }
+        if (e.swapped) {
+            // swap control parameter and control parameter data
+            local_current_parameter_index[lri] = e.partnerCpi;
+            replicas[lri]->set_exchange_parameter_value(
+                parspt.controlParameterValues[e.partnerCpi]
+                );
+            replicas[lri]->set_control_data(e.partnerControlData);
+        }
+    }
+
+    // 2) across the boundary to the neighboring pair: tell the outer neighbor which
+    //    replica now has control parameter cpi, and learn which replica now has
+    //    the outer control parameter
+    for (int lri = 0; lri < localReplicas; ++lri) {
+        ex[lri].newHolder = ex[lri].swapped ? ex[lri].partner : globalReplicaIndex(lri);
+    }
+    for (int lri = 0; lri < localReplicas; ++lri) {
+        PairExchange& e = ex[lri];
+        if (e.outer < 0) {
+            continue;
+        }
+        if (replicaProcess(e.outer) == processIndex) {
+            e.outerNewHolder = ex[replicaLocalIndex(e.outer)].newHolder;
+        } else {
+            const int outerProcess = replicaProcess(e.outer);
+            const int lowerCpi = e.isLower ? e.cpi - 1 : e.cpi;
+            requests.push_back(world.isend(outerProcess, tag(TAG_NEW_HOLDER, lowerCpi), e.newHolder));
+            requests.push_back(world.irecv(outerProcess, tag(TAG_NEW_HOLDER, lowerCpi), e.outerNewHolder));
+        }
+    }
+    mpi::wait_all(requests.begin(), requests.end());
+    requests.clear();
+
+    // 3) after a swap the partners hand this information over to each other
+    for (int lri = 0; lri < localReplicas; ++lri) {
+        PairExchange& e = ex[lri];
+        if (not e.swapped) {
+            continue;
+        }
+        if (replicaProcess(e.partner) == processIndex) {
+            e.partnerOuterNewHolder = ex[replicaLocalIndex(e.partner)].outerNewHolder;
+        } else {
+            const int partnerProcess = replicaProcess(e.partner);
+            const int lowerCpi = std::min(e.cpi, e.partnerCpi);
+            requests.push_back(world.isend(partnerProcess, tag(TAG_NEW_OUTER_HOLDER, lowerCpi),
+                                           e.outerNewHolder));
+            requests.push_back(world.irecv(partnerProcess, tag(TAG_NEW_OUTER_HOLDER, lowerCpi),
+                                           e.partnerOuterNewHolder));
+        }
+    }
+    mpi::wait_all(requests.begin(), requests.end());
+
+    for (int lri = 0; lri < localReplicas; ++lri) {
+        const PairExchange& e = ex[lri];
+        if (e.swapped) {
+            if (e.isLower) {
+                local_neighbor_down_replica[lri] = e.partner;
+                local_neighbor_up_replica[lri] = e.partnerOuterNewHolder;
+            } else {
+                local_neighbor_up_replica[lri] = e.partner;
+                local_neighbor_down_replica[lri] = e.partnerOuterNewHolder;
+            }
+        } else if (e.isLower) {
+            local_neighbor_down_replica[lri] = e.outerNewHolder;
+        } else {
+            local_neighbor_up_replica[lri] = e.outerNewHolder;
+        }
+    }
+
+    timing.stop("detqmcpt-replicaExchangeStepPairwise");
+}
+
+
+template<class Model, class ModelParams>
+void DetQMCPT<Model, ModelParams>::gatherCurrentReplicaPar() {
+    namespace mpi = boost::mpi;
+    mpi::communicator world;
+    if (processIndex == 0) {
+        mpi::gather(world,
+                    local_current_parameter_index.data(), // send
+                    localReplicas,
+                    current_replica_par.data(),           // recv at rank 0
+                    0);
+        std::fill(current_par_replica.begin(), current_par_replica.end(), -1);
+        for (int ri = 0; ri < numReplicas; ++ri) {
+            int cpi = current_replica_par[ri];
+            if (cpi < 0 or cpi >= numReplicas or current_par_replica[cpi] != -1) {
+                throw_GeneralError("Control parameter indexes of the replicas are inconsistent!");
+            }
+            current_par_replica[cpi] = ri;
+        }
+    } else {
+        mpi::gather(world, local_current_parameter_index.data(), localReplicas, 0);
+    }
+}
+
+
+template<class Model, class ModelParams>
+void DetQMCPT<Model, ModelParams>::distributeExchangeNeighbors() {
+    namespace mpi = boost::mpi;
+    mpi::communicator world;
+    std::vector<int> par_replica = current_par_replica;
+    mpi::broadcast(world, par_replica, 0);
+    local_neighbor_down_replica.resize(localReplicas);
+    local_neighbor_up_replica.resize(localReplicas);
+    for (int lri = 0; lri < localReplicas; ++lri) {
+        int cpi = local_current_parameter_index[lri];
+        local_neighbor_down_replica[lri] = (cpi > 0) ? par_replica[cpi - 1] : -1;
+        local_neighbor_up_replica[lri] = (cpi < numReplicas - 1) ? par_replica[cpi + 1] : -1;
+    }
+}
+
+
+template<class Model, class ModelParams>
+void DetQMCPT<Model, ModelParams>::adaptControlParameterValues() {
+    namespace mpi = boost::mpi;
+    mpi::communicator world;
+
+    ExchangeStatistics stats = collectExchangeStatistics();
+    std::vector<num> newValues;
+    if (processIndex == 0) {
+        std::vector<num> placed = placeControlParametersConstantAcceptance(
+            parspt.controlParameterValues, stats.par_swapUpProposed, stats.par_swapUpAccepted);
+        // only go half the way: the acceptance ratios of a single interval
+        // are noisy
+        newValues = parspt.controlParameterValues;
+        for (std::size_t cpi = 0; cpi < newValues.size(); ++cpi) {
+            newValues[cpi] = 0.5 * (newValues[cpi] + placed[cpi]);
+        }
+    }
+    mpi::broadcast(world, newValues, 0);
+
+    parspt.controlParameterValues = newValues;
+    parsmodel.set_exchange_parameter_value(
+        parspt.controlParameterValues[local_current_parameter_index[0]]);
+    for (int lri = 0; lri < localReplicas; ++lri) {
+        replicas[lri]->set_exchange_parameter_value(
+            parspt.controlParameterValues[local_current_parameter_index[lri]]
+            );
+    }
+    // count exchanges for the new values from here on
+    es.resetCounts();
+
+    ptMeta = parspt.prepareMetadataMap();
+    for (auto p = obsHandlers.begin(); p != obsHandlers.end(); ++p) {
+        (*p)->updateControlParameters(parspt, ptMeta);
+    }
+    for (auto p = vecObsHandlers.begin(); p != vecObsHandlers.end(); ++p) {
+        (*p)->updateControlParameters(parspt, ptMeta);
+    }
+}
+
+template<class Model, class ModelParams>
+void DetQMCPT<Model, ModelParams>::freezeControlParameters() {
+    if (processIndex == 0) {
+        std::cout << "Adapted control parameter values " << parspt.controlParameterName << ":";
+        for (num v : parspt.controlParameterValues) {
+            std::cout << " " << v;
+        }
+        std::cout << std::endl;
+    }
+    if (parsmc.saveConfigurationStreamText or parsmc.saveConfigurationStreamBinary
+        or parsmc.saveConfigurationStreamIndexed) {
+        write_SaveConfigurations_headers();
+        setup_SaveConfigurations();
+    }
+}
+
 template<class Model, class ModelParams>
 void DetQMCPT<Model, ModelParams>::replicaExchangeConsistencyCheck() {
-    double local_exchange_parameter_value = replica->get_exchange_parameter_value();
-    double diff = local_exchange_parameter_value -
-        parspt.controlParameterValues[local_current_parameter_index];
-    if ( std::abs(diff) > 1E-10 ) {
-        throw_GeneralError("local_current_parameter_index mismatch!");
+    std::vector<double> local_exchange_parameter_values(localReplicas, 0.0);
+    for (int lri = 0; lri < localReplicas; ++lri) {
+        local_exchange_parameter_values[lri] = replicas[lri]->get_exchange_parameter_value();
+        double diff = local_exchange_parameter_values[lri] -
+            parspt.controlParameterValues[local_current_parameter_index[lri]];
+        if ( std::abs(diff) > 1E-10 ) {
+            throw_GeneralError("local_current_parameter_index mismatch!");
+        }
+    }
+    if (parspt.exchangeProtocol == DetQMCPTParams::EXCHANGE_PAIRWISE) {
+        // no global synchronization here, the association of all replicas
+        // is verified in gatherCurrentReplicaPar()
+        return;
     }
-    std::vector<double> process_par_values(numProcesses, 0.0);
+    std::vector<double> replica_par_values(numReplicas, 0.0);
     // MPI_Gather( &local_exchange_parameter_value, // send buf
     //             1,
     //             MPI_DOUBLE,
@@ -1139,13 +1757,14 @@ void DetQMCPT<Model, ModelParams>::replicaExchangeConsistencyCheck() {
     namespace mpi = boost::mpi;
     mpi::communicator world;
     mpi::gather(world,
-                local_exchange_parameter_value, // send
-                process_par_values,             // recv
+                local_exchange_parameter_values.data(), // send
+                localReplicas,
+                replica_par_values.data(),              // recv
                 0);    
     if (processIndex == 0) {
-        for (int pi = 0; pi < numProcesses; ++pi) {
-            num v1 = process_par_values[pi];
-            num v2 = parspt.controlParameterValues[current_process_par[pi]];
+        for (int ri = 0; ri < numReplicas; ++ri) {
+            num v1 = replica_par_values[ri];
+            num v2 = parspt.controlParameterValues[current_replica_par[ri]];
             if ( std::abs(v1 - v2) > 1E-10 ) {
                 throw_GeneralError("Exchange parameter value mismatch!");
             }
@@ -1160,11 +1779,11 @@ template<class Model, class ModelParams>
 void DetQMCPT<Model, ModelParams>::saveResults() {
     timing.start("saveResults");
 
-    outputResults(obsHandlers);
+    outputResults(obsHandlers, *asyncWriter);
     for (auto p = obsHandlers.begin(); p != obsHandlers.end(); ++p) {
-        (*p)->outputTimeseries();
+        (*p)->outputTimeseries(*asyncWriter);
     }
-    outputResults(vecObsHandlers);
+    outputResults(vecObsHandlers, *asyncWriter);
 
     timing.stop("saveResults");
 }
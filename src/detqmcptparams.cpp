@@ -34,6 +34,33 @@ void DetQMCPTParams::check() {
     if (controlParameterValues.size() == 0) {
         throw_ParameterWrong_message("No PT control parameters specified");
     }
+
+    if (replicasPerProcess == 0) {
+        throw_ParameterWrong("replicasPerProcess", replicasPerProcess);
+    }
+    if (controlParameterValues.size() % replicasPerProcess != 0) {
+        throw_ParameterWrong_message("Number of PT control parameters " +
+                                     numToString(controlParameterValues.size()) +
+                                     " is not a multiple of replicasPerProcess " +
+                                     numToString(replicasPerProcess));
+    }
+
+    if (exchangeProtocol_string == "central") {
+        exchangeProtocol = EXCHANGE_CENTRAL;
+    } else if (exchangeProtocol_string == "pairwise") {
+        exchangeProtocol = EXCHANGE_PAIRWISE;
+    } else {
+        throw_ParameterWrong("exchangeProtocol", exchangeProtocol_string);
+    }
+
+    if (adaptControlParameters) {
+        if (exchangeInterval == 0) {
+            throw_ParameterWrong_message("adaptControlParameters needs replica exchanges, exchangeInterval must not be 0");
+        }
+        if (adaptInterval == 0) {
+            throw_ParameterWrong_message("adaptControlParameters needs adaptInterval > 0");
+        }
+    }
 }
 
 MetadataMap DetQMCPTParams::prepareMetadataMap() const {
@@ -41,6 +68,12 @@ MetadataMap DetQMCPTParams::prepareMetadataMap() const {
 #define META_INSERT(VAR) meta[#VAR] = numToString(VAR)
     META_INSERT(exchangeInterval);
     META_INSERT(controlParameterName);
+    META_INSERT(replicasPerProcess);
+    meta["exchangeProtocol"] = exchangeProtocol_string;
+    META_INSERT(adaptControlParameters);
+    if (adaptControlParameters) {
+        META_INSERT(adaptInterval);
+    }
 #undef META_INSERT
     using boost::algorithm::join;
     using boost::adaptors::transformed;
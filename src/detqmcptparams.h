@@ -20,6 +20,7 @@
 #include "boost/serialization/string.hpp"
 #include "boost/serialization/set.hpp"
 #include "boost/serialization/vector.hpp"
+#include "boost/serialization/version.hpp"
 #pragma GCC diagnostic pop
 
 #include "metadata.h"
@@ -38,14 +39,41 @@ struct DetQMCPTParams {
     uint32_t exchangeInterval;
     std::vector<num> controlParameterValues;
     std::string controlParameterName;
+
+    // number of replicas simulated by each MPI process, the number of
+    // control parameter values must equal this times the number of processes
+    uint32_t replicasPerProcess;
+
+    // "central": rank 0 gathers all exchange actions and decides on all swaps,
+    // "pairwise": replicas at neighboring control parameters exchange their actions
+    //             point-to-point and decide on swaps locally, alternating between
+    //             even and odd pairs
+    std::string exchangeProtocol_string;
+    enum ExchangeProtocol {EXCHANGE_CENTRAL, EXCHANGE_PAIRWISE};
+    ExchangeProtocol exchangeProtocol;
+
+    // if true: during the first half of thermalization, every adaptInterval sweeps
+    // move the control parameter values [except the end points] such that the
+    // exchange acceptance ratios become equal for all pairs, then keep them fixed
+    bool adaptControlParameters;
+    uint32_t adaptInterval;
     
     std::set<std::string> specified; // used to record names of specified parameters
 
+    // not a parameter: the class version of the state file these parameters
+    // have been loaded from, else the current one.  Version 0 states hold a
+    // single replica per process and no pairwise exchange state.
+    uint32_t stateVersion;
+
     DetQMCPTParams() :
-        exchangeInterval(0), controlParameterValues(), controlParameterName(""), specified()
+        exchangeInterval(0), controlParameterValues(), controlParameterName(""),
+        replicasPerProcess(1),
+        exchangeProtocol_string("central"), exchangeProtocol(EXCHANGE_CENTRAL),
+        adaptControlParameters(false), adaptInterval(0),
+        specified(), stateVersion(1)
     { }
 
-    // check consistency
+    // check consistency, convert strings to enums
     void check();
 
     // to export human readable form of parameters
@@ -55,10 +83,18 @@ private:
 
     template<class Archive>
     void serialize(Archive& ar, const uint32_t version) {
-        (void)version;
-        ar & exchangeInterval & controlParameterValues & controlParameterName
-           & specified;
+        ar & exchangeInterval & controlParameterValues & controlParameterName;
+        if (version >= 1) {
+            ar & replicasPerProcess
+               & exchangeProtocol_string & exchangeProtocol
+               & adaptControlParameters & adaptInterval;
+        }
+        ar & specified;
+        if (Archive::is_loading::value) {
+            stateVersion = version;
+        }
     }
 };
+BOOST_CLASS_VERSION(DetQMCPTParams, 1)
 
 #endif /* DETQMCPTPARAMS_H */
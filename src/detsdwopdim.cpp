@@ -20,6 +20,7 @@
 #include <array>
 #include <tuple>
 #include <cassert>
+#include <algorithm>
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wpragmas"
 #pragma GCC diagnostic ignored "-Wconversion"
@@ -39,6 +40,7 @@
 #include "exceptions.h"
 #include "timing.h"
 #include "checkarray.h"
+#include "checkerboardkernels.h"
 #include "tools.h"
 #include "toolsdebug.h"
 #include "pytools.h"
@@ -162,7 +164,9 @@ DetSDW<CB, OPDIM>::DetSDW(RngWrapper& rng_, const ModelParams& pars_,
                  : (MatrixSizeFactor * pars_.L*pars_.L)),
          loggingPars),
     smalleye(arma::eye<MatData>(MatrixSizeFactor, MatrixSizeFactor)),
-    rng(rng_), normal_distribution(rng),
+    rng(rng_),
+    // scaled spin proposals draw one normal variate per site
+    normal_distribution(rng, pars_.L*pars_.L),
     pars(pars_),
     us(),                       // UpdateStatistics
     hopHor(), hopVer(), sinhHopHor(), sinhHopVer(), coshHopHor(), coshHopVer(),
@@ -178,6 +182,7 @@ DetSDW<CB, OPDIM>::DetSDW(RngWrapper& rng_, const ModelParams& pars_,
     coshTermCDWl(pars.N, pars.m+1), sinhTermCDWl(pars.N, pars.m+1),
     ad(pars),                   // AdjustmentData
     performedSweeps(0),
+    gshifted(), gshiftedTemp(),
     meanPhi(), normMeanPhi(0), phiRhoS_Gs(0), phiRhoS_Gc(0),
     associatedEnergy(0),
     // kgreenXUP(), kgreenYDOWN(), kgreenXDOWN(), kgreenYUP(),
@@ -185,12 +190,13 @@ DetSDW<CB, OPDIM>::DetSDW(RngWrapper& rng_, const ModelParams& pars_,
     greenXUPYDOWN_summed(), greenYDOWNXUP_summed(),
     greenK0(), greenLocal(),
     kOcc(), kOccX(kOcc[XBAND]), kOccY(kOcc[YBAND]),
+    latticeFourier(), kOccGreen(), kOccTransformed(),
     // occ(), occX(occ[XBAND]), occY(occ[YBAND]),
     pairPlusMax(0.0), pairMinusMax(0.0),
     pairPlus(), pairMinus(),
     fermionEkinetic(0), fermionEcouple(0),
     // occCorr(), chargeCorr(), occCorrFT(), chargeCorrFT(), occDiffSq(),
-    timeslices_included_in_measurement(),
+    timeslices_included_in_measurement(pars.m + 1, false),
     dud(pars.N, pars.delaySteps), gmd(pars.N, m, pars_.turnoffFermions),
     greenConsistencyLogger(logfiledir_, loggingPars.logGreenConsistency), detRatioLogging(), greenLogging()
 {
@@ -263,8 +269,19 @@ DetSDW<CB, OPDIM>::DetSDW(RngWrapper& rng_, const ModelParams& pars_,
         setupPropK();
     }
 
+    //per-site potential factors used by the checkerboard B-matrix multiplications
+    for (auto& factorRow : cbPotentialFactor) {
+        for (auto& factor : factorRow) {
+            factor.zeros(pars.N);
+        }
+    }
+
     setupUdVStorage_and_calculateGreen();
 
+    //FFT plan for the momentum distributions and computeStructureFactor(),
+    //the latter does not depend on the fermion measurements
+    latticeFourier = std::unique_ptr<LatticeFourier>(new LatticeFourier(pars.L));
+
     using std::cref;
     using namespace boost::assign;
     obsScalar += ScalarObservable(cref(normMeanPhi), "normMeanPhi", "nmp"),
@@ -286,6 +303,8 @@ DetSDW<CB, OPDIM>::DetSDW(RngWrapper& rng_, const ModelParams& pars_,
 
         kOccX.zeros(pars.N);
         kOccY.zeros(pars.N);
+        gshifted.set_size(MatrixSizeFactor*pars.N, MatrixSizeFactor*pars.N);
+        gshiftedTemp.set_size(MatrixSizeFactor*pars.N, MatrixSizeFactor*pars.N);
         obsVector += VectorObservable(cref(kOccX), pars.N, "kOccX", "nkx"),
             VectorObservable(cref(kOccY), pars.N, "kOccY", "nky");
         // output some different sectors of the Green's function in the
@@ -441,7 +460,8 @@ template<CheckerboardMethod CB, int OPDIM>
 void DetSDW<CB, OPDIM>::initMeasurements() {
     timing.start("sdw-measure");
 
-    timeslices_included_in_measurement.clear();
+    std::fill(timeslices_included_in_measurement.begin(),
+              timeslices_included_in_measurement.end(), false);
 
     //meanPhi
     meanPhi.zeros();
@@ -516,10 +536,9 @@ void DetSDW<CB, OPDIM>::measure(uint32_t timeslice) {
     timing.start("sdw-measure");
 
     // to ease notation in here
-    const auto L = pars.L;
     const auto N = pars.N;
 
-    timeslices_included_in_measurement.insert(timeslice);
+    timeslices_included_in_measurement[timeslice] = true;
 
     // bosonic spin stiffness
     if (OPDIM == 2) {
@@ -547,7 +566,7 @@ void DetSDW<CB, OPDIM>::measure(uint32_t timeslice) {
 
     if (not (pars.turnoffFermions or pars.turnoffFermionMeasurements)) {
 
-        MatData gshifted = shiftGreenSymmetric();
+        const MatData& gshifted = shiftGreenSymmetricInPlace();
 
         // some sectors of the momentum space Green's function
         // helpers:
@@ -608,7 +627,7 @@ void DetSDW<CB, OPDIM>::measure(uint32_t timeslice) {
                     return gshifted(site1 + N*bs1, site2 + N*bs2);
                 }
                 else if ((bs1 == XDOWN or bs1 == YUP) and (bs2 == XDOWN or bs2 == YUP)) {
-                    return std::conj(gshifted(site1 + N*(bs1-2), site2 + N*(bs2-2)));
+                    return dataConj(gshifted(site1 + N*(bs1-2), site2 + N*(bs2-2)));
                 }
                 else {
                     return DataType(0);
@@ -630,7 +649,6 @@ void DetSDW<CB, OPDIM>::measure(uint32_t timeslice) {
         // }
 
         //fermion occupation number -- k-space
-        static const num pi = M_PI;
         //offset k-components for antiperiodic bc
         num offset_x = 0.0;
         num offset_y = 0.0;
@@ -640,35 +658,24 @@ void DetSDW<CB, OPDIM>::measure(uint32_t timeslice) {
         if (pars.bc == BC_Type::APBC_Y or pars.bc == BC_Type::APBC_XY) {
             offset_y = 0.5;
         }
-        for (uint32_t ksite = 0; ksite < N; ++ksite) {
-            uint32_t ksitey = ksite / L;
-            uint32_t ksitex = ksite % L;
-            num ky = -pi + (num(ksitey) + offset_y) * 2*pi / num(L);
-            num kx = -pi + (num(ksitex) + offset_x) * 2*pi / num(L);
-
-            for (uint32_t i = 0; i < N; ++i) {
-                num iy = num(i / L);
-                num ix = num(i % L);
-                for (uint32_t j = 0; j  < N; ++j) {
-                    num jy = num(j / L);
-                    num jx = num(j % L);
-
-                    num argument = kx * (ix - jx) + ky * (iy - jy);
-                    cpx phase = std::exp(cpx(0, argument));
-
-                    DataType green_x_up   = gl1(i, XUP, j, XUP);
-                    DataType green_x_down = gl1(i, XDOWN, j, XDOWN);
-                    DataType green_y_up   = gl1(i, YUP, j, YUP);
-                    DataType green_y_down = gl1(i, YDOWN, j, YDOWN);
-
-                    cpx x_cpx = phase * (green_x_up + green_x_down);
-                    cpx y_cpx = phase * (green_y_up + green_y_down);
-
-                    kOccX[ksite] += std::real(x_cpx);
-                    kOccY[ksite] += std::real(y_cpx);
-                }
-            }
+        //  sum_{i,j} exp(i k.(r_i - r_j)) [G_{up,up}(i,j) + G_{down,down}(i,j)]
+        if (OPDIM == 3) {
+            kOccGreen = gblock(XUP, XUP) + gblock(XDOWN, XDOWN);
+        } else {
+            // down blocks are the complex conjugates of the up blocks
+            kOccGreen = gblock(XUP, XUP);
+            kOccGreen += arma::conj(kOccGreen);
         }
+        latticeFourier->transform(kOccTransformed, kOccGreen, offset_x, offset_y);
+        kOccX += arma::real(kOccTransformed);
+        if (OPDIM == 3) {
+            kOccGreen = gblock(YUP, YUP) + gblock(YDOWN, YDOWN);
+        } else {
+            kOccGreen = gblock(YDOWN, YDOWN);
+            kOccGreen += arma::conj(kOccGreen);
+        }
+        latticeFourier->transform(kOccTransformed, kOccGreen, offset_x, offset_y);
+        kOccY += arma::real(kOccTransformed);
 
         //equal-time pairing-correlations
         //-------------------------------
@@ -907,7 +914,8 @@ void DetSDW<CB, OPDIM>::finishMeasurements() {
     const auto m = pars.m;
     const auto dtau = pars.dtau;
 
-    assert(timeslices_included_in_measurement.size() == m);
+    assert(uint32_t(std::count(timeslices_included_in_measurement.begin(),
+                               timeslices_included_in_measurement.end(), true)) == m);
 
     //normphi, meanPhi, sdw-susceptibility
     meanPhi /= num(N * m);
@@ -1025,84 +1033,30 @@ void DetSDW<CB, OPDIM>::finishMeasurements() {
 // --> no offsetting of k-space vectors!
 template<CheckerboardMethod CB, int OPDIM>
 void DetSDW<CB, OPDIM>::computeStructureFactor(VecNum& out_k, const MatNum& in_r) {
-    static const num pi = M_PI;
-    const auto L = pars.L;
-    const auto N = pars.N;
-    // //offset k-components for antiperiodic bc
-    // num offset_x = 0.0;
-    // num offset_y = 0.0;
-    // if (pars.bc == BC_Type::APBC_X or pars.bc == BC_Type::APBC_XY) {
-    //     offset_x = 0.5;
-    // }
-    // if (pars.bc == BC_Type::APBC_Y or pars.bc == BC_Type::APBC_XY) {
-    //     offset_y = 0.5;
-    // }
-    out_k.zeros(N);
-    for (uint32_t ksite = 0; ksite < N; ++ksite) {
-        uint32_t ksitey = ksite / L;
-        uint32_t ksitex = ksite % L;
-        // num ky = -pi + (num(ksitey) + offset_y) * 2*pi / num(L);
-        // num kx = -pi + (num(ksitex) + offset_x) * 2*pi / num(L);
-        num ky = -pi + num(ksitey) * 2*pi / num(L);
-        num kx = -pi + num(ksitex) * 2*pi / num(L);
-        for (uint32_t i = 0; i < N; ++i) {
-            num iy = num(i / L);
-            num ix = num(i % L);
-            for (uint32_t j = 0; j  < N; ++j) {
-                num jy = num(j / L);
-                num jx = num(j % L);
-
-                num argument = kx * (ix - jx) + ky * (iy - jy);
-                cpx phase = std::exp(cpx(0, argument));
-
-                cpx contrib = in_r(i,j) * phase;
-                out_k(ksite) += contrib.real();
-            }
-        }
-    }
-    out_k /= num(N);
+    assert(latticeFourier);
+    latticeFourier->transform(kOccTransformed, in_r);
+    out_k = arma::real(kOccTransformed) / num(pars.N);
 }
 
 template<CheckerboardMethod CB, int OPDIM>
 void DetSDW<CB, OPDIM>::computeStructureFactor(VecNum& out_k, const MatCpx& in_r) {
-    static const num pi = M_PI;
-    const auto L = pars.L;
-    const auto N = pars.N;
-    out_k.zeros(N);
-    for (uint32_t ksite = 0; ksite < N; ++ksite) {
-        uint32_t ksitey = ksite / L;
-        uint32_t ksitex = ksite % L;
-        // num ky = -pi + (num(ksitey) + offset_y) * 2*pi / num(L);
-        // num kx = -pi + (num(ksitex) + offset_x) * 2*pi / num(L);
-        num ky = -pi + num(ksitey) * 2*pi / num(L);
-        num kx = -pi + num(ksitex) * 2*pi / num(L);
-        cpx k_contrib = cpx(0);
-        for (uint32_t i = 0; i < N; ++i) {
-            num iy = num(i / L);
-            num ix = num(i % L);
-            for (uint32_t j = 0; j  < N; ++j) {
-                num jy = num(j / L);
-                num jx = num(j % L);
-
-                num argument = kx * (ix - jx) + ky * (iy - jy);
-                cpx phase = std::exp(cpx(0, argument));
-
-                k_contrib += in_r(i,j) * phase;
-            }
-        }
-        out_k(ksite) = k_contrib.real();
-    }
-    out_k /= num(N);
+    assert(latticeFourier);
+    latticeFourier->transform(kOccTransformed, in_r);
+    out_k = arma::real(kOccTransformed) / num(pars.N);
 }
 
 template<CheckerboardMethod CB, int OPDIM>
 void DetSDW<CB, OPDIM>::setupRandomField() {
+    // per site: OPDIM uniform variates for phi, one for cdwl
+    VecNum rand01(pars.N * (OPDIM + 1));
     for (uint32_t k = 1; k <= pars.m; ++k) {
+        rng.fillRand01(rand01.memptr(), rand01.n_elem);
+        const num* r_iter = rand01.memptr();
         for (uint32_t site = 0; site < pars.N; ++site) {
             for (uint32_t dim = 0; dim < OPDIM; ++dim) {
-                phi(site, dim, k) = rng.randRange(PhiLow, PhiHigh);
+                phi(site, dim, k) = PhiLow + (PhiHigh - PhiLow) * (*r_iter++);
             }
-            num r = rng.rand01();
+            num r = *r_iter++;
             if      (r <= 0.25) cdwl(site, k) = +2;
             else if (r <= 0.5)	cdwl(site, k) = -2;
             else if (r <= 0.75)	cdwl(site, k) = +1;
@@ -1277,10 +1231,10 @@ void DetSDW<CB, OPDIM>::setupPropK() {
         }
         //debugSaveMatrix(k, "k" + bandstr(band));
 
-        propK[band] = computePropagator(pars.dtau, k);
+        setFromCpx(propK[band], computePropagator(pars.dtau, k));
 
-        propK_half[band] = computePropagator(pars.dtau / 2.0, k);
-        propK_half_inv[band] = computePropagator(-pars.dtau / 2.0, k);
+        setFromCpx(propK_half[band], computePropagator(pars.dtau / 2.0, k));
+        setFromCpx(propK_half_inv[band], computePropagator(-pars.dtau / 2.0, k));
     }
 }
 
@@ -1423,15 +1377,15 @@ DetSDW<CB, OPDIM>::computeBmatSDW(uint32_t k2, uint32_t k1) {
                 block(1, 1) = diagmat(kcoshTermPhi % kcoshTermCDWl - ksinhTermCDWl) * propKy;
                 
                 if (OPDIM == 1) {
-                    block(0,1) = diagmat(VecCpx(-kphi0 % ksinhTermPhi % kcoshTermCDWl,
-                                                zeros(N))) * propKy;
-                    block(1,0) = diagmat(VecCpx(-kphi0 % ksinhTermPhi % kcoshTermCDWl,
-                                                zeros(N))) * propKx;
+                    D::setFromCpx(block(0,1), diagmat(VecCpx(-kphi0 % ksinhTermPhi % kcoshTermCDWl,
+                                                             zeros(N))) * propKy);
+                    D::setFromCpx(block(1,0), diagmat(VecCpx(-kphi0 % ksinhTermPhi % kcoshTermCDWl,
+                                                             zeros(N))) * propKx);
                 } else {
-                    block(0,1) = diagmat(VecCpx(-kphi0 % ksinhTermPhi % kcoshTermCDWl,
-                                                +kphi1 % ksinhTermPhi % kcoshTermCDWl)) * propKy;
-                    block(1,0) = diagmat(VecCpx(-kphi0 % ksinhTermPhi % kcoshTermCDWl,
-                                                -kphi1 % ksinhTermPhi % kcoshTermCDWl)) * propKx;
+                    D::setFromCpx(block(0,1), diagmat(VecCpx(-kphi0 % ksinhTermPhi % kcoshTermCDWl,
+                                                             +kphi1 % ksinhTermPhi % kcoshTermCDWl)) * propKy);
+                    D::setFromCpx(block(1,0), diagmat(VecCpx(-kphi0 % ksinhTermPhi % kcoshTermCDWl,
+                                                             -kphi1 % ksinhTermPhi % kcoshTermCDWl)) * propKx);
                 }
                 if (OPDIM == 3) {
                     //lower right 2*2 blocks
@@ -1441,21 +1395,21 @@ DetSDW<CB, OPDIM>::computeBmatSDW(uint32_t k2, uint32_t k1) {
                     
                     block(2, 2) = block(0, 0);
 
-                    block(2, 3) = diagmat(VecCpx(diagmat(-kphi0 % ksinhTermPhi % kcoshTermCDWl),
-                                                 diagmat(-kphi1 % ksinhTermPhi % kcoshTermCDWl))) * propKy;
-                    block(3, 2) = diagmat(VecCpx(diagmat(-kphi0 % ksinhTermPhi % kcoshTermCDWl),
-                                                 diagmat(+kphi1 % ksinhTermPhi % kcoshTermCDWl))) * propKx;
+                    D::setFromCpx(block(2, 3), diagmat(VecCpx(-kphi0 % ksinhTermPhi % kcoshTermCDWl,
+                                                              -kphi1 % ksinhTermPhi % kcoshTermCDWl)) * propKy);
+                    D::setFromCpx(block(3, 2), diagmat(VecCpx(-kphi0 % ksinhTermPhi % kcoshTermCDWl,
+                                                              +kphi1 % ksinhTermPhi % kcoshTermCDWl)) * propKx);
                     block(3, 3) = block(1, 1);
 
                     //anti-diagonal blocks
-                    block(0, 3) = diagmat(VecCpx(-kphi2 % ksinhTermPhi % kcoshTermCDWl,
-                                                 zeros(N))) * propKy;
-                    block(1, 2) = diagmat(VecCpx(+kphi2 % ksinhTermPhi % kcoshTermCDWl,
-                                                 zeros(N))) * propKx;
-                    block(2, 1) = diagmat(VecCpx(+kphi2 % ksinhTermPhi % kcoshTermCDWl,
-                                                 zeros(N))) * propKy;
-                    block(3, 0) = diagmat(VecCpx(-kphi2 % ksinhTermPhi % kcoshTermCDWl,
-                                                 zeros(N))) * propKx;
+                    D::setFromCpx(block(0, 3), diagmat(VecCpx(-kphi2 % ksinhTermPhi % kcoshTermCDWl,
+                                                              zeros(N))) * propKy);
+                    D::setFromCpx(block(1, 2), diagmat(VecCpx(+kphi2 % ksinhTermPhi % kcoshTermCDWl,
+                                                              zeros(N))) * propKx);
+                    D::setFromCpx(block(2, 1), diagmat(VecCpx(+kphi2 % ksinhTermPhi % kcoshTermCDWl,
+                                                              zeros(N))) * propKy);
+                    D::setFromCpx(block(3, 0), diagmat(VecCpx(-kphi2 % ksinhTermPhi % kcoshTermCDWl,
+                                                              zeros(N))) * propKx);
 
                     //zero blocks
                     block(0, 2).zeros();
@@ -1621,13 +1575,15 @@ void DetSDW<CB, OPDIM>::precalc_4site_hopping_exponentials() {
 
             uint32_t subgroups[2] = {0, 1};
             for (uint32_t subgroup : subgroups) {
-                storage[band][subgroup] = std::map<uint32_t, Mat4Site>();
+                std::vector<ExpHop4SitePlaquette>& table = storage[band][subgroup];
+                table.clear();
+                table.reserve((L / 2) * (L / 2));
                 for (uint32_t i1 = subgroup; i1 < L; i1 += 2) {
                     for (uint32_t i2 = subgroup; i2 < L; i2 += 2) {
                         uint32_t i = this->coordsToSite(i1, i2);
                         uint32_t j = spaceNeigh(XPLUS, i);
                         uint32_t k = spaceNeigh(YPLUS, i);
-                        // uint32_t l = spaceNeigh(XPLUS, k);
+                        uint32_t l = spaceNeigh(XPLUS, k);
 
                         uint32_t j1 = j % L;
                         uint32_t k2 = k / L;
@@ -1655,11 +1611,13 @@ void DetSDW<CB, OPDIM>::precalc_4site_hopping_exponentials() {
                             ph_jl = std::exp(cpx(0.0, +2.0 * pi * zmag_here * L * j1)); // vertical 2
                         }             
 
+                        MatCpx::fixed<4,4> hop_mat_cpx;
+                        hop_mat_cpx << 0 << ph_ij * hh << ph_ik * hv << 0         << arma::endr
+                                    << 0 << 0          << 0          << ph_jl * hv << arma::endr
+                                    << 0 << 0          << 0          << ph_kl * hh << arma::endr
+                                    << 0 << 0          << 0          << 0          << arma::endr;
                         Mat4Site hop_mat; // 4x4, corresponding to sites i,j,k,l
-                        hop_mat << 0 << ph_ij * hh << ph_ik * hv << 0         << arma::endr
-                                << 0 << 0          << 0          << ph_jl * hv << arma::endr
-                                << 0 << 0          << 0          << ph_kl * hh << arma::endr
-                                << 0 << 0          << 0          << 0          << arma::endr;
+                        setFromCpx(hop_mat, hop_mat_cpx);
                         hop_mat += arma::trans(hop_mat); // add hermitian conjugate for the other directions
 
                         // overall factor of -1
@@ -1674,8 +1632,8 @@ void DetSDW<CB, OPDIM>::precalc_4site_hopping_exponentials() {
                             arma::diagmat(arma::exp( prefactor * eigval )) *
                             arma::trans(eigvec);
 
-                        // insert into precal storage
-                        storage[band][subgroup][i] = exp_hop_mat;                    
+                        // append to precalc storage
+                        table.push_back(ExpHop4SitePlaquette{i, j, k, l, exp_hop_mat});
                     }
                 }
             }
@@ -1687,34 +1645,24 @@ template<CheckerboardMethod CB, int OPDIM>
 template<class Matrix>
 void DetSDW<CB, OPDIM>::cb_assaad_applyBondFactorsLeft_precalcedMatrices(Matrix& result, uint32_t subgroup,
                                                                          const ExpHop4SiteStorage& expHop4SiteMatrices) {
-    const auto N = pars.N;
-    const auto L = pars.L;
     assert(subgroup == 0 or subgroup == 1);
-    arma::Row<DataType> new_row_i(N);
-    arma::Row<DataType> new_row_j(N);
-    arma::Row<DataType> new_row_k(N);
-    for (uint32_t i1 = subgroup; i1 < L; i1 += 2) {
-        for (uint32_t i2 = subgroup; i2 < L; i2 += 2) {
-            uint32_t i = this->coordsToSite(i1, i2);
-            uint32_t j = spaceNeigh(XPLUS, i);
-            uint32_t k = spaceNeigh(YPLUS, i);
-            uint32_t l = spaceNeigh(XPLUS, k);
-            //change rows i,j,k,l of result
-            const arma::Row<DataType>& ri = result.row(i);
-            const arma::Row<DataType>& rj = result.row(j);
-            const arma::Row<DataType>& rk = result.row(k);
-            const arma::Row<DataType>& rl = result.row(l);
-
-            const Mat4Site& mat = expHop4SiteMatrices[subgroup].find(i)->second;
-
-            // indexes (0,1,2,3) correspond to (i,j,k,l)
-            new_row_i     = mat(0,0)*ri + mat(0,1)*rj + mat(0,2)*rk + mat(0,3)*rl;
-            new_row_j     = mat(1,0)*ri + mat(1,1)*rj + mat(1,2)*rk + mat(1,3)*rl;
-            new_row_k     = mat(2,0)*ri + mat(2,1)*rj + mat(2,2)*rk + mat(2,3)*rl;
-            result.row(l) = mat(3,0)*ri + mat(3,1)*rj + mat(3,2)*rk + mat(3,3)*rl;
-            result.row(i) = new_row_i;
-            result.row(j) = new_row_j;
-            result.row(k) = new_row_k;
+    DataType* const A = result.colptr(0);
+    const uint32_t ld = cb_leadingDim(result);
+    const uint32_t ncols = result.n_cols;
+    //change rows i,j,k,l of result, treat all plaquettes for a block of columns at a time;
+    //the blocks are independent and can be distributed over threads
+    const int nblocks = int((ncols + cb_ColumnBlockSize - 1) / cb_ColumnBlockSize);
+#ifdef _OPENMP
+    const int nthreads = int(pars.checkerboardThreads);
+#pragma omp parallel for num_threads(nthreads) schedule(static) if(nthreads > 1)
+#endif
+    for (int block = 0; block < nblocks; ++block) {
+        const uint32_t colBegin = uint32_t(block) * cb_ColumnBlockSize;
+        const uint32_t colEnd = std::min(colBegin + cb_ColumnBlockSize, ncols);
+        for (const ExpHop4SitePlaquette& plaq : expHop4SiteMatrices[subgroup]) {
+            // indexes (0,1,2,3) of mat correspond to (i,j,k,l)
+            cb_plaquetteRows(A, ld, colBegin, colEnd, plaq.i, plaq.j, plaq.k, plaq.l,
+                             plaq.mat.memptr());
         }
     }
 }
@@ -1723,34 +1671,22 @@ template<CheckerboardMethod CB, int OPDIM>
 template<class Matrix>
 void DetSDW<CB, OPDIM>::cb_assaad_applyBondFactorsRight_precalcedMatrices(Matrix& result, uint32_t subgroup,
                                                                           const ExpHop4SiteStorage& expHop4SiteMatrices) {
-    const auto N = pars.N;
-    const auto L = pars.L;
     assert(subgroup == 0 or subgroup == 1);
-    arma::Col<DataType> new_col_i(N);
-    arma::Col<DataType> new_col_j(N);
-    arma::Col<DataType> new_col_k(N);
-    for (uint32_t i1 = subgroup; i1 < L; i1 += 2) {
-        for (uint32_t i2 = subgroup; i2 < L; i2 += 2) {
-            uint32_t i = this->coordsToSite(i1, i2);
-            uint32_t j = spaceNeigh(XPLUS, i);
-            uint32_t k = spaceNeigh(YPLUS, i);
-            uint32_t l = spaceNeigh(XPLUS, k);
+    const uint32_t nrows = result.n_rows;
+    //the rows are independent: split them into one panel per thread
+    const int npanels = int(pars.checkerboardThreads);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(npanels) schedule(static) if(npanels > 1)
+#endif
+    for (int panel = 0; panel < npanels; ++panel) {
+        const uint32_t rowBegin = uint32_t(uint64_t(panel) * nrows / npanels);
+        const uint32_t rowEnd = uint32_t(uint64_t(panel + 1) * nrows / npanels);
+        for (const ExpHop4SitePlaquette& plaq : expHop4SiteMatrices[subgroup]) {
             //change cols i,j,k,l of result
-            const arma::Col<DataType>& ci = result.col(i);
-            const arma::Col<DataType>& cj = result.col(j);
-            const arma::Col<DataType>& ck = result.col(k);
-            const arma::Col<DataType>& cl = result.col(l);
-
-            const Mat4Site& mat = expHop4SiteMatrices[subgroup].find(i)->second;
-
-            // indexes (0,1,2,3) correspond to (i,j,k,l)
-            new_col_i     = ci*mat(0,0) + cj*mat(1,0) + ck*mat(2,0) + cl*mat(3,0);
-            new_col_j     = ci*mat(0,1) + cj*mat(1,1) + ck*mat(2,1) + cl*mat(3,1);
-            new_col_k     = ci*mat(0,2) + cj*mat(1,2) + ck*mat(2,2) + cl*mat(3,2);
-            result.col(l) = ci*mat(0,3) + cj*mat(1,3) + ck*mat(2,3) + cl*mat(3,3);            
-            result.col(i) = new_col_i;
-            result.col(j) = new_col_j;
-            result.col(k) = new_col_k;
+            // indexes (0,1,2,3) of mat correspond to (i,j,k,l)
+            cb_plaquetteCols(result.colptr(plaq.i) + rowBegin, result.colptr(plaq.j) + rowBegin,
+                             result.colptr(plaq.k) + rowBegin, result.colptr(plaq.l) + rowBegin,
+                             rowEnd - rowBegin, plaq.mat.memptr());
         }
     }
 }
@@ -1761,12 +1697,10 @@ void DetSDW<CB, OPDIM>::cb_assaad_applyBondFactorsRight_precalcedMatrices(Matrix
 
 template<CheckerboardMethod CB, int OPDIM>
 template<class Matrix> inline
-typename DetSDW<CB, OPDIM>::MatData
-DetSDW<CB, OPDIM>::cbLMultHoppingExp_impl(std::integral_constant<CheckerboardMethod, CB_NONE>,
-                                          const Matrix&, Band, int, bool) {
+void DetSDW<CB, OPDIM>::cbLMultHoppingExp_impl(std::integral_constant<CheckerboardMethod, CB_NONE>,
+                                               Matrix&, Band, int, bool) {
     throw_GeneralError("CB_NONE makes no sense for the checkerboard multiplication routines");
     //TODO change things so this codepath is not needed
-    return MatData();
 }
 
 
@@ -1787,40 +1721,41 @@ template<CheckerboardMethod CB, int OPDIM>
 template<class Matrix>
 void DetSDW<CB, OPDIM>::cb_assaad_applyBondFactorsLeft(Matrix& result, uint32_t subgroup,
                                                        num ch_hor, num sh_hor, num ch_ver, num sh_ver) {
-    const auto N = pars.N;
     const auto L = pars.L;
     assert(subgroup == 0 or subgroup == 1);
-    arma::Row<DataType> new_row_i(N);
-    arma::Row<DataType> new_row_j(N);
-    arma::Row<DataType> new_row_k(N);
-    for (uint32_t i1 = subgroup; i1 < L; i1 += 2) {
-        for (uint32_t i2 = subgroup; i2 < L; i2 += 2) {
-            uint32_t i = this->coordsToSite(i1, i2);
-            uint32_t j = spaceNeigh(XPLUS, i);
-            uint32_t k = spaceNeigh(YPLUS, i);
-            uint32_t l = spaceNeigh(XPLUS, k);
-            //change rows i,j,k,l of result
-            const arma::Row<DataType>& ri = result.row(i);
-            const arma::Row<DataType>& rj = result.row(j);
-            const arma::Row<DataType>& rk = result.row(k);
-            const arma::Row<DataType>& rl = result.row(l);
-            num b_sh_hor = sh_hor;
-            num b_sh_ver = sh_ver;
-            if ((pars.bc == BC_Type::APBC_X or pars.bc == BC_Type::APBC_XY) and i1 == L-1) {
-                //this plaquette has horizontal boundary crossing bonds and APBC
-                b_sh_hor *= -1;
-            }
-            if ((pars.bc == BC_Type::APBC_Y or pars.bc == BC_Type::APBC_XY) and i2 == L-1) {
-                //this plaquette has vertical boundary crossing bonds and APBC
-                b_sh_ver *= -1;
+    DataType* const A = result.colptr(0);
+    const uint32_t ld = cb_leadingDim(result);
+    const uint32_t ncols = result.n_cols;
+    //change rows i,j,k,l of result, treat all plaquettes for a block of columns at a time;
+    //the blocks are independent and can be distributed over threads
+    const int nblocks = int((ncols + cb_ColumnBlockSize - 1) / cb_ColumnBlockSize);
+#ifdef _OPENMP
+    const int nthreads = int(pars.checkerboardThreads);
+#pragma omp parallel for num_threads(nthreads) schedule(static) if(nthreads > 1)
+#endif
+    for (int block = 0; block < nblocks; ++block) {
+        const uint32_t colBegin = uint32_t(block) * cb_ColumnBlockSize;
+        const uint32_t colEnd = std::min(colBegin + cb_ColumnBlockSize, ncols);
+        num mat[16];
+        for (uint32_t i1 = subgroup; i1 < L; i1 += 2) {
+            for (uint32_t i2 = subgroup; i2 < L; i2 += 2) {
+                uint32_t i = this->coordsToSite(i1, i2);
+                uint32_t j = spaceNeigh(XPLUS, i);
+                uint32_t k = spaceNeigh(YPLUS, i);
+                uint32_t l = spaceNeigh(XPLUS, k);
+                num b_sh_hor = sh_hor;
+                num b_sh_ver = sh_ver;
+                if ((pars.bc == BC_Type::APBC_X or pars.bc == BC_Type::APBC_XY) and i1 == L-1) {
+                    //this plaquette has horizontal boundary crossing bonds and APBC
+                    b_sh_hor *= -1;
+                }
+                if ((pars.bc == BC_Type::APBC_Y or pars.bc == BC_Type::APBC_XY) and i2 == L-1) {
+                    //this plaquette has vertical boundary crossing bonds and APBC
+                    b_sh_ver *= -1;
+                }
+                cb_bondFactorMatrix(mat, ch_hor, b_sh_hor, ch_ver, b_sh_ver);
+                cb_plaquetteRows(A, ld, colBegin, colEnd, i, j, k, l, mat);
             }
-            new_row_i     = ch_hor*ch_ver*ri + ch_ver*b_sh_hor*rj + ch_hor*b_sh_ver*rk + b_sh_hor*b_sh_ver*rl;
-            new_row_j     = ch_ver*b_sh_hor*ri + ch_hor*ch_ver*rj + b_sh_hor*b_sh_ver*rk + ch_hor*b_sh_ver*rl;
-            new_row_k     = ch_hor*b_sh_ver*ri + b_sh_hor*b_sh_ver*rj + ch_hor*ch_ver*rk + ch_ver*b_sh_hor*rl;
-            result.row(l) = b_sh_hor*b_sh_ver*ri + ch_hor*b_sh_ver*rj + ch_ver*b_sh_hor*rk + ch_hor*ch_ver*rl;
-            result.row(i) = new_row_i;
-            result.row(j) = new_row_j;
-            result.row(k) = new_row_k;
         }
     }
 }
@@ -1831,15 +1766,12 @@ void DetSDW<CB, OPDIM>::cb_assaad_applyBondFactorsLeft(Matrix& result, uint32_t
 
 
 
-// with sign = +/- 1, band = XBAND|YBAND: set R := E^(sign * dtau * K_band) * A
+// with sign = +/- 1, band = XBAND|YBAND: set A := E^(sign * dtau * K_band) * A
 // using the symmetric checkerboard break up
 template<CheckerboardMethod CB, int OPDIM>
 template<class Matrix> inline
-typename DetSDW<CB, OPDIM>::MatData
-DetSDW<CB, OPDIM>::cbLMultHoppingExp_impl(std::integral_constant<CheckerboardMethod, CB_ASSAAD_BERG>,
-                                          const Matrix& A, Band band, int sign, bool) {
-    MatData result = A;      //can't avoid this copy
-
+void DetSDW<CB, OPDIM>::cbLMultHoppingExp_impl(std::integral_constant<CheckerboardMethod, CB_ASSAAD_BERG>,
+                                               Matrix& result, Band band, int sign, bool) {
     assert(sign == 1 or sign == -1);
 
     if (not pars.weakZflux) {
@@ -1864,17 +1796,14 @@ DetSDW<CB, OPDIM>::cbLMultHoppingExp_impl(std::integral_constant<CheckerboardMet
             cb_assaad_applyBondFactorsLeft_precalcedMatrices(result, 1, expHop4Site_minusHalf[band]);
         }
     }
-
-    return result;
 }
 
-// with A: NxN, sign = +/- 1, band = XBAND|YBAND: return a matrix equal to A * E^(sign * dtau * K_band)
+// with A: NxN, sign = +/- 1, band = XBAND|YBAND: set A := E^(sign * dtau * K_band) * A
 template<CheckerboardMethod CB, int OPDIM>
 template <class Matrix> inline
-typename DetSDW<CB, OPDIM>::MatData
-DetSDW<CB, OPDIM>::cbLMultHoppingExp(const Matrix& A, Band band, int sign, bool invertedCbOrder) {
-    return cbLMultHoppingExp_impl(std::integral_constant<CheckerboardMethod, CB>(),
-                                  A, band, sign, invertedCbOrder);
+void DetSDW<CB, OPDIM>::cbLMultHoppingExp(Matrix& A, Band band, int sign, bool invertedCbOrder) {
+    cbLMultHoppingExp_impl(std::integral_constant<CheckerboardMethod, CB>(),
+                           A, band, sign, invertedCbOrder);
 }
 
 
@@ -1882,11 +1811,9 @@ DetSDW<CB, OPDIM>::cbLMultHoppingExp(const Matrix& A, Band band, int sign, bool
 
 template<CheckerboardMethod CB, int OPDIM>
 template<class Matrix> inline
-typename DetSDW<CB, OPDIM>::MatData
-DetSDW<CB, OPDIM>::cbRMultHoppingExp_impl(std::integral_constant<CheckerboardMethod, CB_NONE>,
-                                          const Matrix&, Band, int, bool) {
+void DetSDW<CB, OPDIM>::cbRMultHoppingExp_impl(std::integral_constant<CheckerboardMethod, CB_NONE>,
+                                               Matrix&, Band, int, bool) {
     throw_GeneralError("CB_NONE makes no sense for the checkerboard multiplication routines");
-    return MatData();
 }
 
 
@@ -1904,51 +1831,50 @@ template<CheckerboardMethod CB, int OPDIM>
 template<class Matrix>
 void DetSDW<CB, OPDIM>::cb_assaad_applyBondFactorsRight(Matrix& result, uint32_t subgroup,
                                                         num ch_hor, num sh_hor, num ch_ver, num sh_ver) {
-    const auto N = pars.N;
     const auto L = pars.L;
     assert(subgroup == 0 or subgroup == 1);
-    arma::Col<DataType> new_col_i(N);
-    arma::Col<DataType> new_col_j(N);
-    arma::Col<DataType> new_col_k(N);
-    for (uint32_t i1 = subgroup; i1 < L; i1 += 2) {
-        for (uint32_t i2 = subgroup; i2 < L; i2 += 2) {
-            uint32_t i = this->coordsToSite(i1, i2);
-            uint32_t j = spaceNeigh(XPLUS, i);
-            uint32_t k = spaceNeigh(YPLUS, i);
-            uint32_t l = spaceNeigh(XPLUS, k);
-            //change cols i,j,k,l of result
-            const arma::Col<DataType>& ci = result.col(i);
-            const arma::Col<DataType>& cj = result.col(j);
-            const arma::Col<DataType>& ck = result.col(k);
-            const arma::Col<DataType>& cl = result.col(l);
-            num b_sh_hor = sh_hor;
-            num b_sh_ver = sh_ver;
-            if ((pars.bc == BC_Type::APBC_X or pars.bc == BC_Type::APBC_XY) and i1 == L-1) {
-                //this plaquette has horizontal boundary crossing bonds and APBC
-                b_sh_hor *= -1;
-            }
-            if ((pars.bc == BC_Type::APBC_Y or pars.bc == BC_Type::APBC_XY) and i2 == L-1) {
-                //this plaquette has vertical boundary crossing bonds and APBC
-                b_sh_ver *= -1;
+    const uint32_t nrows = result.n_rows;
+    //the rows are independent: split them into one panel per thread
+    const int npanels = int(pars.checkerboardThreads);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(npanels) schedule(static) if(npanels > 1)
+#endif
+    for (int panel = 0; panel < npanels; ++panel) {
+        const uint32_t rowBegin = uint32_t(uint64_t(panel) * nrows / npanels);
+        const uint32_t rowEnd = uint32_t(uint64_t(panel + 1) * nrows / npanels);
+        num mat[16];
+        for (uint32_t i1 = subgroup; i1 < L; i1 += 2) {
+            for (uint32_t i2 = subgroup; i2 < L; i2 += 2) {
+                uint32_t i = this->coordsToSite(i1, i2);
+                uint32_t j = spaceNeigh(XPLUS, i);
+                uint32_t k = spaceNeigh(YPLUS, i);
+                uint32_t l = spaceNeigh(XPLUS, k);
+                num b_sh_hor = sh_hor;
+                num b_sh_ver = sh_ver;
+                if ((pars.bc == BC_Type::APBC_X or pars.bc == BC_Type::APBC_XY) and i1 == L-1) {
+                    //this plaquette has horizontal boundary crossing bonds and APBC
+                    b_sh_hor *= -1;
+                }
+                if ((pars.bc == BC_Type::APBC_Y or pars.bc == BC_Type::APBC_XY) and i2 == L-1) {
+                    //this plaquette has vertical boundary crossing bonds and APBC
+                    b_sh_ver *= -1;
+                }
+                //change cols i,j,k,l of result
+                cb_bondFactorMatrix(mat, ch_hor, b_sh_hor, ch_ver, b_sh_ver);
+                cb_plaquetteCols(result.colptr(i) + rowBegin, result.colptr(j) + rowBegin,
+                                 result.colptr(k) + rowBegin, result.colptr(l) + rowBegin,
+                                 rowEnd - rowBegin, mat);
             }
-            new_col_i     = ch_hor*ch_ver*ci + ch_ver*b_sh_hor*cj + ch_hor*b_sh_ver*ck + b_sh_hor*b_sh_ver*cl;
-            new_col_j     = ch_ver*b_sh_hor*ci + ch_hor*ch_ver*cj + b_sh_hor*b_sh_ver*ck + ch_hor*b_sh_ver*cl;
-            new_col_k     = ch_hor*b_sh_ver*ci + b_sh_hor*b_sh_ver*cj + ch_hor*ch_ver*ck + ch_ver*b_sh_hor*cl;
-            result.col(l) = b_sh_hor*b_sh_ver*ci + ch_hor*b_sh_ver*cj + ch_ver*b_sh_hor*ck + ch_hor*ch_ver*cl;
-            result.col(i) = new_col_i;
-            result.col(j) = new_col_j;
-            result.col(k) = new_col_k;
         }
     }
 }
 
+// with sign = +/- 1, band = XBAND|YBAND: set A := A * E^(sign * dtau * K_band)
+// using the symmetric checkerboard break up
 template<CheckerboardMethod CB, int OPDIM>
 template<class Matrix> inline
-typename DetSDW<CB, OPDIM>::MatData
-DetSDW<CB, OPDIM>::cbRMultHoppingExp_impl(std::integral_constant<CheckerboardMethod, CB_ASSAAD_BERG>,
-                                          const Matrix& A, Band band, int sign, bool) {
-    typename DetSDW<CB, OPDIM>::MatData result = A;      //can't avoid this copy
-
+void DetSDW<CB, OPDIM>::cbRMultHoppingExp_impl(std::integral_constant<CheckerboardMethod, CB_ASSAAD_BERG>,
+                                               Matrix& result, Band band, int sign, bool) {
     assert(sign == 1 or sign == -1);
 
     if (not pars.weakZflux) {
@@ -1974,449 +1900,254 @@ DetSDW<CB, OPDIM>::cbRMultHoppingExp_impl(std::integral_constant<CheckerboardMet
             cb_assaad_applyBondFactorsRight_precalcedMatrices(result, 1, expHop4Site_minusHalf[band]);
         }
     }
-
-    return result;
 }
 
-// with sign = +/- 1, band = XBAND|YBAND: return A * E^(sign * dtau * K_band)
+// with sign = +/- 1, band = XBAND|YBAND: set A := A * E^(sign * dtau * K_band)
 template<CheckerboardMethod CB, int OPDIM>
 template <class Matrix> inline
-typename DetSDW<CB, OPDIM>::MatData
-DetSDW<CB, OPDIM>::cbRMultHoppingExp(const Matrix& A, Band band, int sign, bool invertedCbOrder) {
-    return cbRMultHoppingExp_impl(std::integral_constant<CheckerboardMethod, CB>(),
-                                  A, band, sign, invertedCbOrder);
+void DetSDW<CB, OPDIM>::cbRMultHoppingExp(Matrix& A, Band band, int sign, bool invertedCbOrder) {
+    cbRMultHoppingExp_impl(std::integral_constant<CheckerboardMethod, CB>(),
+                           A, band, sign, invertedCbOrder);
 }
 
 
 
 
 
-template<CheckerboardMethod CB, int OPDIM> inline
-typename DetSDW<CB, OPDIM>::MatData
-DetSDW<CB, OPDIM>::leftMultiplyBk(const typename DetSDW<CB, OPDIM>::MatData& orig, uint32_t k) {
-    const auto N = pars.N;
-    //helper: submatrix block for a matrix
-#define block(mat,row,col) mat.submat( (row) * N, (col) * N, ((row) + 1) * N - 1, ((col) + 1) * N - 1)
-
-    const auto& ksinhTermPhi = sinhTermPhi.col(k);
-    const auto& kcoshTermPhi = coshTermPhi.col(k);
-    const auto& ksinhTermCDWl = sinhTermCDWl.col(k);
-    const auto& kcoshTermCDWl = coshTermCDWl.col(k);
-    const VecNum cd  = (pars.cdwU ? (kcoshTermPhi % kcoshTermCDWl + ksinhTermCDWl).eval() : kcoshTermPhi);
-    const VecNum cmd = (pars.cdwU ? (kcoshTermPhi % kcoshTermCDWl - ksinhTermCDWl).eval() : kcoshTermPhi);
-
-    VecNum ax, max;
-    if (OPDIM == 3) {
-        const auto& kphi2 = phi.slice(k).col(2);
-        ax  = (pars.cdwU ? (kphi2 % ksinhTermPhi % kcoshTermCDWl).eval() : (kphi2 % ksinhTermPhi).eval());
-        max = -ax;
-    }
-    VecData b, bc;
-    const auto& kphi0 = phi.slice(k).col(0);
-    b.set_size( N);
-    bc.set_size(N);
-    // b.set_real( kphi0);
-    // bc.set_real(kphi0);
-    setVectorReal(b,  kphi0);
-    setVectorReal(bc, kphi0);
-    if (OPDIM >  1) {
-        const auto& kphi1 = (OPDIM >  1 ? phi.slice(k).col(1) : kphi0);
-        // b.set_imag( -kphi1);
-        // bc.set_imag( kphi1);
-        setVectorImag(b, -kphi1);
-        setVectorImag(bc, kphi1);
-    }
-    VecData mbx  = (pars.cdwU ? (-b  % ksinhTermPhi % kcoshTermCDWl).eval() : (-b  % ksinhTermPhi).eval());
-    VecData mbcx = (pars.cdwU ? (-bc % ksinhTermPhi % kcoshTermCDWl).eval() : (-bc % ksinhTermPhi).eval());
-
-    //overall factor for entire matrix for chemical potential
-//    num ovFac = std::exp(pars.dtau*pars.mu);
-    checkarray<num, 2> mu;
-    mu[XBAND] = pars.mux;
-    mu[YBAND] = pars.muy;
-    num ovFacXBAND = std::exp(pars.dtau*mu[XBAND]);
-    num ovFacYBAND = std::exp(pars.dtau*mu[YBAND]);
-    
-    // CHECK_VEC_NAN(mbx);
-    // CHECK_VEC_NAN(mbcx);
-
-    MatData result(MatrixSizeFactor*N, MatrixSizeFactor*N);
-
-    for (uint32_t col = 0; col < MatrixSizeFactor; ++col) {
-        using arma::diagmat;
-        block(result, 0, col) = diagmat(ovFacXBAND * cd)   * cbLMultHoppingExp(block(orig, 0, col), XBAND, -1, false)
-                              + diagmat(ovFacYBAND * mbx)  * cbLMultHoppingExp(block(orig, 1, col), YBAND, -1, false);
-
-        block(result, 1, col) = diagmat(ovFacXBAND * mbcx) * cbLMultHoppingExp(block(orig, 0, col), XBAND, -1, false)
-                              + diagmat(ovFacYBAND * cmd)  * cbLMultHoppingExp(block(orig, 1, col), YBAND, -1, false);
-
+// Per-site matrix elements of E^(-dtau*V) [sign = -1] or E^(+dtau*V) [sign = +1]
+// for timeslice k, including the chemical potential factors, as used by
+// leftMultiplyBk() etc. below.  Block (r,c) of the exponential is
+// diag(cbPotentialFactor[r][c]) [zero blocks see cbZeroBlock()].
+template<CheckerboardMethod CB, int OPDIM>
+void DetSDW<CB, OPDIM>::cbSetPotentialFactors(uint32_t k, int sign) {
+    assert(sign == 1 or sign == -1);
+    const uint32_t N = pars.N;
+
+    //overall factors for the chemical potential
+    const num ovFacXBAND = std::exp(-sign * pars.dtau * pars.mux);
+    const num ovFacYBAND = std::exp(-sign * pars.dtau * pars.muy);
+
+    auto& F = cbPotentialFactor;
+    for (uint32_t i = 0; i < N; ++i) {
+        const num kcoshTermPhi = coshTermPhi(i, k);
+        const num ksinhTermPhi = sinhTermPhi(i, k);
+        num cd  = kcoshTermPhi;
+        num cmd = kcoshTermPhi;
+        num x   = ksinhTermPhi;
+        if (pars.cdwU) {
+            const num kcoshTermCDWl = coshTermCDWl(i, k);
+            const num ksinhTermCDWl = sinhTermCDWl(i, k);
+            cd  = kcoshTermPhi * kcoshTermCDWl + ksinhTermCDWl;
+            cmd = kcoshTermPhi * kcoshTermCDWl - ksinhTermCDWl;
+            x   = ksinhTermPhi * kcoshTermCDWl;
+        }
+        // bx = (phi0 - i phi1) x,  bcx = (phi0 + i phi1) x
+        DataType bx  = DataType(0);
+        DataType bcx = DataType(0);
+        setReal(bx,  phi(i, 0, k) * x);
+        setReal(bcx, phi(i, 0, k) * x);
+        if (OPDIM > 1) {
+            setImag(bx,  -phi(i, OPDIM > 1 ? 1 : 0, k) * x);
+            setImag(bcx, +phi(i, OPDIM > 1 ? 1 : 0, k) * x);
+        }
+        if (sign == -1) {
+            F[0][0][i] = ovFacXBAND * cd;
+            F[0][1][i] = ovFacYBAND * (-bx);
+            F[1][0][i] = ovFacXBAND * (-bcx);
+            F[1][1][i] = ovFacYBAND * cmd;
+        } else {
+            F[0][0][i] = ovFacXBAND * cmd;
+            F[0][1][i] = ovFacXBAND * bx;
+            F[1][0][i] = ovFacYBAND * bcx;
+            F[1][1][i] = ovFacYBAND * cd;
+        }
         if (OPDIM == 3) {
-            block(result, 0, col) += diagmat(ovFacYBAND * max) * cbLMultHoppingExp(block(orig, 3, col), YBAND, -1, false);
-            block(result, 1, col) += diagmat(ovFacXBAND * ax)  * cbLMultHoppingExp(block(orig, 2, col), XBAND, -1, false);
-
-            //only a total of three terms each time because of zero blocks in the E^(-dtau*V) matrix
-            block(result, 2, col) = diagmat(ovFacYBAND * ax)   * cbLMultHoppingExp(block(orig, 1, col), YBAND, -1, false)
-                                  + diagmat(ovFacXBAND * cd)   * cbLMultHoppingExp(block(orig, 2, col), XBAND, -1, false)
-                                  + diagmat(ovFacYBAND * mbcx) * cbLMultHoppingExp(block(orig, 3, col), YBAND, -1, false);
-
-            block(result, 3, col) = diagmat(ovFacXBAND * max)  * cbLMultHoppingExp(block(orig, 0, col), XBAND, -1, false)
-                                  + diagmat(ovFacXBAND * mbx)  * cbLMultHoppingExp(block(orig, 2, col), XBAND, -1, false)
-                                  + diagmat(ovFacYBAND * cmd)  * cbLMultHoppingExp(block(orig, 3, col), YBAND, -1, false);
+            const num ax = phi(i, OPDIM == 3 ? 2 : 0, k) * x;
+            const uint32_t b2 = (OPDIM == 3 ? 2 : 0), b3 = (OPDIM == 3 ? 3 : 0);
+            if (sign == -1) {
+                F[0][b3][i] = ovFacYBAND * (-ax);
+                F[1][b2][i] = ovFacXBAND * ax;
+                F[b2][1][i] = ovFacYBAND * ax;
+                F[b2][b2][i] = ovFacXBAND * cd;
+                F[b2][b3][i] = ovFacYBAND * (-bcx);
+                F[b3][0][i] = ovFacXBAND * (-ax);
+                F[b3][b2][i] = ovFacXBAND * (-bx);
+                F[b3][b3][i] = ovFacYBAND * cmd;
+            } else {
+                F[0][b3][i] = ovFacXBAND * ax;
+                F[1][b2][i] = ovFacYBAND * (-ax);
+                F[b2][1][i] = ovFacXBAND * (-ax);
+                F[b2][b2][i] = ovFacXBAND * cmd;
+                F[b2][b3][i] = ovFacXBAND * bcx;
+                F[b3][0][i] = ovFacYBAND * ax;
+                F[b3][b2][i] = ovFacYBAND * bx;
+                F[b3][b3][i] = ovFacYBAND * cd;
+            }
         }
     }
-
-#undef block
-    return result;
 }
 
-
-
+// out := E^(+-dtau*V) * A, the blocks of E^(+-dtau*V) as set by cbSetPotentialFactors()
 template<CheckerboardMethod CB, int OPDIM>
-typename DetSDW<CB, OPDIM>::MatData
-DetSDW<CB, OPDIM>::checkerboardLeftMultiplyBmat(const typename DetSDW<CB, OPDIM>::MatData& A, uint32_t k2, uint32_t k1) {
-    assert(k2 > k1);
-    assert(k2 <= pars.m);
-
-    MatData result = leftMultiplyBk(A, k1 + 1);
-
-    for (uint32_t k = k1 + 2; k <= k2; ++k) {
-        result = leftMultiplyBk(result, k);
+void DetSDW<CB, OPDIM>::cbLeftMultiplyPotential(MatData& out, const MatData& A) {
+    const uint32_t N = pars.N;
+    const uint32_t ncols = A.n_cols;
+    for (uint32_t j = 0; j < ncols; ++j) {
+        const DataType* a = A.colptr(j);
+        DataType* o = out.colptr(j);
+        for (uint32_t r = 0; r < MatrixSizeFactor; ++r) {
+            DataType* o_r = o + r * N;
+            std::fill(o_r, o_r + N, DataType(0));
+            for (uint32_t c = 0; c < MatrixSizeFactor; ++c) {
+                if (cbZeroBlock(r, c)) {
+                    continue;
+                }
+                const DataType* f = cbPotentialFactor[r][c].memptr();
+                const DataType* a_c = a + c * N;
+                for (uint32_t i = 0; i < N; ++i) {
+                    o_r[i] += f[i] * a_c[i];
+                }
+            }
+        }
     }
+}
 
-    //chemical potential terms included by leftMultiplyBk
-    //result *= std::exp(+dtau * (k2 - k1) * mu);
-
-    return result;
+// out := A * E^(+-dtau*V), the blocks of E^(+-dtau*V) as set by cbSetPotentialFactors()
+template<CheckerboardMethod CB, int OPDIM>
+void DetSDW<CB, OPDIM>::cbRightMultiplyPotential(MatData& out, const MatData& A) {
+    const uint32_t N = pars.N;
+    const uint32_t nrows = A.n_rows;
+    for (uint32_t c = 0; c < MatrixSizeFactor; ++c) {
+        for (uint32_t i = 0; i < N; ++i) {
+            DataType* o = out.colptr(c * N + i);
+            std::fill(o, o + nrows, DataType(0));
+            for (uint32_t r = 0; r < MatrixSizeFactor; ++r) {
+                if (cbZeroBlock(r, c)) {
+                    continue;
+                }
+                const DataType f = cbPotentialFactor[r][c][i];
+                const DataType* a = A.colptr(r * N + i);
+                for (uint32_t row = 0; row < nrows; ++row) {
+                    o[row] += f * a[row];
+                }
+            }
+        }
+    }
 }
 
+// The following compute the products with a single B(k,k-1) = E^(-dtau*V) E^(-dtau*K)
+// [or its inverse] in two steps: the hopping exponentials act in place on the row
+// or column blocks of a matrix, the potential exponentials are applied into
+// the output matrix.  Scratch space: workspace[0].bmat_temp_2
 
 template<CheckerboardMethod CB, int OPDIM> inline
-typename DetSDW<CB, OPDIM>::MatData
-DetSDW<CB, OPDIM>::leftMultiplyBkInv(const typename DetSDW<CB, OPDIM>::MatData& orig, uint32_t k) {
-    const auto N = pars.N;
-    //helper: submatrix block for a matrix
-#define block(mat,row,col) mat.submat( (row) * N, (col) * N, ((row) + 1) * N - 1, ((col) + 1) * N - 1)
-
-    const auto& ksinhTermPhi = sinhTermPhi.col(k);
-    const auto& kcoshTermPhi = coshTermPhi.col(k);
-    const auto& ksinhTermCDWl = sinhTermCDWl.col(k);
-    const auto& kcoshTermCDWl = coshTermCDWl.col(k);
-    const VecNum cd  = (pars.cdwU ? (kcoshTermPhi % kcoshTermCDWl + ksinhTermCDWl).eval() : kcoshTermPhi);
-    const VecNum cmd = (pars.cdwU ? (kcoshTermPhi % kcoshTermCDWl - ksinhTermCDWl).eval() : kcoshTermPhi);
+void DetSDW<CB, OPDIM>::leftMultiplyBk(MatData& out, const MatData& orig, uint32_t k) {
+    const uint32_t N = pars.N;
+    MatData& hopped = workspace[0].bmat_temp_2;
+    hopped = orig;
+    for (uint32_t c = 0; c < MatrixSizeFactor; ++c) {
+        arma::subview<DataType> rowblock = hopped.rows(c * N, (c + 1) * N - 1);
+        cbLMultHoppingExp(rowblock, Band(c % 2), -1, false);
+    }
+    cbSetPotentialFactors(k, -1);
+    cbLeftMultiplyPotential(out, hopped);
+}
 
-    VecNum ax, max;
-    if (OPDIM == 3) {
-        const auto& kphi2 = phi.slice(k).col(2);
-        ax  = (pars.cdwU ? (kphi2 % ksinhTermPhi % kcoshTermCDWl).eval() : (kphi2 % ksinhTermPhi).eval());
-        max = -ax;
+template<CheckerboardMethod CB, int OPDIM> inline
+void DetSDW<CB, OPDIM>::leftMultiplyBkInv(MatData& out, const MatData& orig, uint32_t k) {
+    const uint32_t N = pars.N;
+    cbSetPotentialFactors(k, +1);
+    cbLeftMultiplyPotential(out, orig);
+    for (uint32_t r = 0; r < MatrixSizeFactor; ++r) {
+        arma::subview<DataType> rowblock = out.rows(r * N, (r + 1) * N - 1);
+        cbLMultHoppingExp(rowblock, Band(r % 2), +1, true);
     }
+}
 
-    const auto& kphi0 = phi.slice(k).col(0);
-    VecData b, bc;
-    b.set_size( N);
-    bc.set_size(N);
-    // b.set_real( kphi0);
-    // bc.set_real(kphi0);
-    setVectorReal(b,  kphi0);
-    setVectorReal(bc, kphi0);
-    if (OPDIM >  1) {
-        const auto& kphi1 = (OPDIM >  1 ? phi.slice(k).col(1) : kphi0);
-        // b.set_imag( -kphi1);
-        // bc.set_imag( kphi1);
-        setVectorImag(b,  -kphi1);
-        setVectorImag(bc,  kphi1);
-    }
-    VecData bx  = (pars.cdwU ? (b  % ksinhTermPhi % kcoshTermCDWl).eval() : (b  % ksinhTermPhi).eval());
-    VecData bcx = (pars.cdwU ? (bc % ksinhTermPhi % kcoshTermCDWl).eval() : (bc % ksinhTermPhi).eval());
-
-    //overall factor for entire matrix for chemical potential
-//    num ovFac = std::exp(-pars.dtau*pars.mu);
-    checkarray<num, 2> mu;
-    mu[XBAND] = pars.mux;
-    mu[YBAND] = pars.muy;
-    num ovFacXBAND = std::exp(-pars.dtau*mu[XBAND]);
-    num ovFacYBAND = std::exp(-pars.dtau*mu[YBAND]);
-    
-    MatData result(MatrixSizeFactor*N, MatrixSizeFactor*N);
-
-    for (uint32_t col = 0; col < MatrixSizeFactor; ++col) {
-        using arma::diagmat;
-        block(result, 0, col) = cbLMultHoppingExp(diagmat(ovFacXBAND * cmd) * block(orig, 0, col), XBAND, +1, true)
-                              + cbLMultHoppingExp(diagmat(ovFacXBAND * bx)  * block(orig, 1, col), XBAND, +1, true);
-
-        block(result, 1, col) = cbLMultHoppingExp(diagmat(ovFacYBAND * bcx) * block(orig, 0, col), YBAND, +1, true)
-                              + cbLMultHoppingExp(diagmat(ovFacYBAND * cd)  * block(orig, 1, col), YBAND, +1, true);
-
-        if (OPDIM == 3) {
-            block(result, 0, col) += cbLMultHoppingExp(diagmat(ovFacXBAND * ax)  * block(orig, 3, col), XBAND, +1, true);
-            block(result, 1, col) += cbLMultHoppingExp(diagmat(ovFacYBAND * max) * block(orig, 2, col), YBAND, +1, true);
-
-            //only a total of three terms each time because of zero blocks in the E^(+dtau*V) matrix
-            block(result, 2, col) = cbLMultHoppingExp(diagmat(ovFacXBAND * max)  * block(orig, 1, col), XBAND, +1, true)
-                                  + cbLMultHoppingExp(diagmat(ovFacXBAND * cmd)  * block(orig, 2, col), XBAND, +1, true)
-                                  + cbLMultHoppingExp(diagmat(ovFacXBAND * bcx)  * block(orig, 3, col), XBAND, +1, true);
-
-            block(result, 3, col) = cbLMultHoppingExp(diagmat(ovFacYBAND * ax)   * block(orig, 0, col), YBAND, +1, true)
-                                  + cbLMultHoppingExp(diagmat(ovFacYBAND * bx)   * block(orig, 2, col), YBAND, +1, true)
-                                  + cbLMultHoppingExp(diagmat(ovFacYBAND * cd)   * block(orig, 3, col), YBAND, +1, true);
-        }
+template<CheckerboardMethod CB, int OPDIM> inline
+void DetSDW<CB, OPDIM>::rightMultiplyBk(MatData& out, const MatData& orig, uint32_t k) {
+    const uint32_t N = pars.N;
+    cbSetPotentialFactors(k, -1);
+    cbRightMultiplyPotential(out, orig);
+    for (uint32_t c = 0; c < MatrixSizeFactor; ++c) {
+        arma::subview<DataType> colblock = out.cols(c * N, (c + 1) * N - 1);
+        cbRMultHoppingExp(colblock, Band(c % 2), -1, false);
     }
+}
 
-#undef block
-    return result;
+template<CheckerboardMethod CB, int OPDIM> inline
+void DetSDW<CB, OPDIM>::rightMultiplyBkInv(MatData& out, const MatData& orig, uint32_t k) {
+    const uint32_t N = pars.N;
+    MatData& hopped = workspace[0].bmat_temp_2;
+    hopped = orig;
+    for (uint32_t r = 0; r < MatrixSizeFactor; ++r) {
+        arma::subview<DataType> colblock = hopped.cols(r * N, (r + 1) * N - 1);
+        cbRMultHoppingExp(colblock, Band(r % 2), +1, true);
+    }
+    cbSetPotentialFactors(k, +1);
+    cbRightMultiplyPotential(out, hopped);
 }
 
+// The products over several timeslices: the intermediate results alternate
+// between out and workspace[0].bmat_temp_1, the first one is put where the
+// last one ends up in out.
+//
+// Chemical potential terms are included by *MultiplyBk*.
 
 template<CheckerboardMethod CB, int OPDIM>
-typename DetSDW<CB, OPDIM>::MatData
-DetSDW<CB, OPDIM>::checkerboardLeftMultiplyBmatInv(const typename DetSDW<CB, OPDIM>::MatData& A, uint32_t k2, uint32_t k1) {
+void DetSDW<CB, OPDIM>::checkerboardLeftMultiplyBmat(MatData& out, const MatData& A, uint32_t k2, uint32_t k1) {
     assert(k2 > k1);
     assert(k2 <= pars.m);
-
-    MatData result = leftMultiplyBkInv(A, k2);
-
-    for (uint32_t k = k2 - 1; k >= k1 + 1; --k) {
-        result = leftMultiplyBkInv(result, k);
+    MatData* dst = ((k2 - k1) % 2 == 1) ? &out : &workspace[0].bmat_temp_1;
+    MatData* other = (dst == &out) ? &workspace[0].bmat_temp_1 : &out;
+    const MatData* src = &A;
+    for (uint32_t k = k1 + 1; k <= k2; ++k) {
+        leftMultiplyBk(*dst, *src, k);
+        src = dst;
+        std::swap(dst, other);
     }
-
-    //chemical potential terms already included
-    //result *= std::exp(-dtau * (k2 - k1) * mu);
-
-    return result;
-}
-
-template<CheckerboardMethod CB, int OPDIM> inline
-typename DetSDW<CB, OPDIM>::MatData
-DetSDW<CB, OPDIM>::rightMultiplyBk(const typename DetSDW<CB, OPDIM>::MatData& orig, uint32_t k) {
-    const auto N = pars.N;
-    //helper: submatrix block for a matrix
-#define block(mat,row,col) mat.submat( (row) * N, (col) * N, ((row) + 1) * N - 1, ((col) + 1) * N - 1)
-
-    const auto& ksinhTermPhi = sinhTermPhi.col(k);
-    const auto& kcoshTermPhi = coshTermPhi.col(k);
-    const auto& ksinhTermCDWl = sinhTermCDWl.col(k);
-    const auto& kcoshTermCDWl = coshTermCDWl.col(k);
-    // // define is safer than auto...
-    // #define ksinhTermPhi sinhTermPhi.col(k)
-    // #define kcoshTermPhi coshTermPhi.col(k)
-    // #define ksinhTermCDWl sinhTermCDWl.col(k)
-    // #define kcoshTermCDWl coshTermCDWl.col(k)
-
-    const VecNum cd  = (pars.cdwU ? (kcoshTermPhi % kcoshTermCDWl + ksinhTermCDWl).eval() : kcoshTermPhi);
-    const VecNum cmd = (pars.cdwU ? (kcoshTermPhi % kcoshTermCDWl - ksinhTermCDWl).eval() : kcoshTermPhi);
-
-    VecNum ax, max;
-    if (OPDIM == 3) {
-        #define kphi2  phi.slice(k).col(2)
-        ax  = (pars.cdwU ? (kphi2 % ksinhTermPhi % kcoshTermCDWl).eval() : (kphi2 % ksinhTermPhi).eval());
-        max = -ax;
-        #undef kphi2
-    }
-    #define kphi0 phi.slice(k).col(0)
-    // CHECK_VEC_NAN(phi.slice(k).col(0));
-    VecData b, bc;
-    b.set_size( N);
-    bc.set_size(N);
-//    b.set_real( kphi0);
-//    bc.set_real(kphi0);
-    setVectorReal(b,  kphi0);
-    setVectorReal(bc, kphi0);
-    #undef kphi0
-    //DEBUG
-    // for (uint32_t count = 0; count < N; ++count) {
-    //     b[count].real(kphi0[count]);
-    //     bc[count].real(kphi0[count]);
-    // }
-    // CHECK_VEC_NAN(b);
-    // CHECK_VEC_NAN(bc);
-    //ENDDEBUG
-    if (OPDIM >  1) {
-#define kphi1 (phi.slice(k).col(OPDIM >  1 ? 1 : 0))
-        // CHECK_VEC_NAN(phi.slice(k).col(OPDIM >  1 ? 1 : 0))
-        // b.set_imag( -kphi1);
-        // bc.set_imag( kphi1);
-        setVectorImag(b, -kphi1);
-        setVectorImag(bc, kphi1);
-        // CHECK_VEC_NAN(b);
-        // CHECK_VEC_NAN(bc);
-        #undef kphi1
-    }
-    VecData mbx  = (pars.cdwU ? (-b  % ksinhTermPhi % kcoshTermCDWl).eval() : (-b  % ksinhTermPhi).eval());
-    VecData mbcx = (pars.cdwU ? (-bc % ksinhTermPhi % kcoshTermCDWl).eval() : (-bc % ksinhTermPhi).eval());
-
-    // #undef ksinhTermPhi
-    // #undef kcoshTermPhi
-    // #undef ksinhTermCDWl
-    // #undef kcoshTermCDWl
-
-    //DEBUG
-    // CHECK_VEC_NAN(ksinhTermPhi);
-    // CHECK_VEC_NAN(kcoshTermPhi);
-    // CHECK_VEC_NAN(ksinhTermPhi);
-    // CHECK_VEC_NAN(kcoshTermCDWl);
-    // CHECK_VEC_NAN(ksinhTermCDWl);
-    // CHECK_VEC_NAN(cd);
-    // CHECK_VEC_NAN(cmd);
-    // CHECK_VEC_NAN(ax);
-    // CHECK_VEC_NAN(max);
-    // CHECK_VEC_NAN(b);
-    // CHECK_VEC_NAN(bc);
-    // CHECK_VEC_NAN(mbx);
-    // CHECK_VEC_NAN(mbcx);
-    //END DEBUG
-
-    //overall factor for entire matrix for chemical potential
-//    num ovFac = std::exp(pars.dtau*pars.mu);
-    checkarray<num, 2> mu;
-    mu[XBAND] = pars.mux;
-    mu[YBAND] = pars.muy;
-    num ovFacXBAND = std::exp(pars.dtau*mu[XBAND]);
-    num ovFacYBAND = std::exp(pars.dtau*mu[YBAND]);
-
-    MatData result(MatrixSizeFactor*N, MatrixSizeFactor*N);
-
-    for (uint32_t row = 0; row < MatrixSizeFactor; ++row) {
-        using arma::diagmat;
-        block(result, row, 0) = cbRMultHoppingExp(block(orig, row, 0) * ovFacXBAND * diagmat(cd),   XBAND, -1, false)
-                              + cbRMultHoppingExp(block(orig, row, 1) * ovFacXBAND * diagmat(mbcx), XBAND, -1, false);
-
-        block(result, row, 1) = cbRMultHoppingExp(block(orig, row, 0) * ovFacYBAND * diagmat(mbx),  YBAND, -1, false)
-                              + cbRMultHoppingExp(block(orig, row, 1) * ovFacYBAND * diagmat(cmd),  YBAND, -1, false);
-
-        if (OPDIM == 3) {
-            //only a total of three terms each time because of zero blocks in the E^(-dtau*V) matrix
-            block(result, row, 0) += cbRMultHoppingExp(block(orig, row, 3) * ovFacXBAND * diagmat(max), XBAND, -1, false);
-            block(result, row, 1) += cbRMultHoppingExp(block(orig, row, 2) * ovFacYBAND * diagmat(ax),  YBAND, -1, false);
-
-            block(result, row, 2) = cbRMultHoppingExp(block(orig, row, 1) * ovFacXBAND * diagmat(ax),   XBAND, -1, false)
-                                  + cbRMultHoppingExp(block(orig, row, 2) * ovFacXBAND * diagmat(cd),   XBAND, -1, false)
-                                  + cbRMultHoppingExp(block(orig, row, 3) * ovFacXBAND * diagmat(mbx),  XBAND, -1, false);
-
-            block(result, row, 3) = cbRMultHoppingExp(block(orig, row, 0) * ovFacYBAND * diagmat(max),  YBAND, -1, false)
-                                  + cbRMultHoppingExp(block(orig, row, 2) * ovFacYBAND * diagmat(mbcx), YBAND, -1, false)
-                                  + cbRMultHoppingExp(block(orig, row, 3) * ovFacYBAND * diagmat(cmd),  YBAND, -1, false);
-        }
-    }
-
-#undef block
-    return result;
 }
 
 template<CheckerboardMethod CB, int OPDIM>
-typename DetSDW<CB, OPDIM>::MatData
-DetSDW<CB, OPDIM>::checkerboardRightMultiplyBmat(const typename DetSDW<CB, OPDIM>::MatData& A, uint32_t k2, uint32_t k1) {
+void DetSDW<CB, OPDIM>::checkerboardLeftMultiplyBmatInv(MatData& out, const MatData& A, uint32_t k2, uint32_t k1) {
     assert(k2 > k1);
     assert(k2 <= pars.m);
-
-    MatData result = rightMultiplyBk(A, k2);
-
-    // std::cout << k2 << " "; CHECK_NAN(result);
-
-    for (uint32_t k = k2 - 1; k >= k1 +1; --k) {
-        result = rightMultiplyBk(result, k);
-        // std::cout << k << " "; CHECK_NAN(result);
+    MatData* dst = ((k2 - k1) % 2 == 1) ? &out : &workspace[0].bmat_temp_1;
+    MatData* other = (dst == &out) ? &workspace[0].bmat_temp_1 : &out;
+    const MatData* src = &A;
+    for (uint32_t k = k2; k >= k1 + 1; --k) {
+        leftMultiplyBkInv(*dst, *src, k);
+        src = dst;
+        std::swap(dst, other);
     }
-
-    //chemical potential terms included above
-    //result *= std::exp(+dtau * (k2 - k1) * mu);
-
-    return result;
 }
 
-template<CheckerboardMethod CB, int OPDIM> inline
-typename DetSDW<CB, OPDIM>::MatData
-DetSDW<CB, OPDIM>::rightMultiplyBkInv(const typename DetSDW<CB, OPDIM>::MatData& orig, uint32_t k) {
-    const auto N = pars.N;
-    //helper: submatrix block for a matrix
-#define block(mat,row,col) mat.submat( (row) * N, (col) * N, ((row) + 1) * N - 1, ((col) + 1) * N - 1)
-
-    const auto& ksinhTermPhi = sinhTermPhi.col(k);
-    const auto& kcoshTermPhi = coshTermPhi.col(k);
-    const auto& ksinhTermCDWl = sinhTermCDWl.col(k);
-    const auto& kcoshTermCDWl = coshTermCDWl.col(k);
-    // const VecNum cd  = kcoshTermPhi % kcoshTermCDWl + ksinhTermCDWl;
-    // const VecNum cmd = kcoshTermPhi % kcoshTermCDWl - ksinhTermCDWl;
-    const VecNum cd  = (pars.cdwU ? (kcoshTermPhi % kcoshTermCDWl + ksinhTermCDWl).eval() : kcoshTermPhi);
-    const VecNum cmd = (pars.cdwU ? (kcoshTermPhi % kcoshTermCDWl - ksinhTermCDWl).eval() : kcoshTermPhi);
-
-    VecNum ax, max;
-    if (OPDIM == 3) {
-        const auto& kphi2 = phi.slice(k).col(2);
-        ax  =  (pars.cdwU ? (kphi2 % ksinhTermPhi % kcoshTermCDWl).eval() : (kphi2 % ksinhTermPhi).eval());
-        max = -ax;
-    }
-
-    const auto& kphi0 = phi.slice(k).col(0);
-    VecData b, bc;
-    b.set_size( N);
-    bc.set_size(N);
-    // b.set_real( kphi0);
-    // bc.set_real(kphi0);
-    setVectorReal(b,  kphi0);
-    setVectorReal(bc, kphi0);
-    if (OPDIM >  1) {
-        const auto& kphi1 = (OPDIM >  1 ? phi.slice(k).col(1) : kphi0);
-        // b.set_imag( -kphi1);
-        // bc.set_imag( kphi1);
-        setVectorImag(b, -kphi1);
-        setVectorImag(bc, kphi1);
-    }
-    VecData bx  = (pars.cdwU ? (b  % ksinhTermPhi % kcoshTermCDWl).eval() : (b  % ksinhTermPhi).eval());
-    VecData bcx = (pars.cdwU ? (bc % ksinhTermPhi % kcoshTermCDWl).eval() : (bc % ksinhTermPhi).eval());
-
-    //overall factor for entire matrix for chemical potential
-//    num ovFac = std::exp(-pars.dtau*pars.mu);
-    checkarray<num, 2> mu;
-    mu[XBAND] = pars.mux;
-    mu[YBAND] = pars.muy;
-    num ovFacXBAND = std::exp(-pars.dtau*mu[XBAND]);
-    num ovFacYBAND = std::exp(-pars.dtau*mu[YBAND]);
-    
-    MatData result(MatrixSizeFactor*N, MatrixSizeFactor*N);
-
-    for (uint32_t row = 0; row < MatrixSizeFactor; ++row) {
-        using arma::diagmat;
-        block(result, row, 0) = cbRMultHoppingExp(block(orig, row, 0), XBAND, +1, true) * ovFacXBAND * diagmat(cmd)
-                              + cbRMultHoppingExp(block(orig, row, 1), YBAND, +1, true) * ovFacYBAND * diagmat(bcx);
-
-        block(result, row, 1) = cbRMultHoppingExp(block(orig, row, 0), XBAND, +1, true) * ovFacXBAND * diagmat(bx)
-                              + cbRMultHoppingExp(block(orig, row, 1), YBAND, +1, true) * ovFacYBAND * diagmat(cd);
-
-        if (OPDIM == 3) {
-            //only a total of three terms each time because of zero blocks in the E^(-dtau*V) matrix
-            block(result, row, 0) += cbRMultHoppingExp(block(orig, row, 3), YBAND, +1, true) * ovFacYBAND * diagmat(ax);
-            block(result, row, 1) += cbRMultHoppingExp(block(orig, row, 2), XBAND, +1, true) * ovFacXBAND * diagmat(max);
-
-            block(result, row, 2) = cbRMultHoppingExp(block(orig, row, 1),  YBAND, +1, true) * ovFacYBAND * diagmat(max)
-                                  + cbRMultHoppingExp(block(orig, row, 2),  XBAND, +1, true) * ovFacXBAND * diagmat(cmd)
-                                  + cbRMultHoppingExp(block(orig, row, 3),  YBAND, +1, true) * ovFacYBAND * diagmat(bx);
-
-            block(result, row, 3) = cbRMultHoppingExp(block(orig, row, 0),  XBAND, +1, true) * ovFacXBAND * diagmat(ax)
-                                  + cbRMultHoppingExp(block(orig, row, 2),  XBAND, +1, true) * ovFacXBAND * diagmat(bcx)
-                                  + cbRMultHoppingExp(block(orig, row, 3),  YBAND, +1, true) * ovFacYBAND * diagmat(cd);
-        }
-
+template<CheckerboardMethod CB, int OPDIM>
+void DetSDW<CB, OPDIM>::checkerboardRightMultiplyBmat(MatData& out, const MatData& A, uint32_t k2, uint32_t k1) {
+    assert(k2 > k1);
+    assert(k2 <= pars.m);
+    MatData* dst = ((k2 - k1) % 2 == 1) ? &out : &workspace[0].bmat_temp_1;
+    MatData* other = (dst == &out) ? &workspace[0].bmat_temp_1 : &out;
+    const MatData* src = &A;
+    for (uint32_t k = k2; k >= k1 + 1; --k) {
+        rightMultiplyBk(*dst, *src, k);
+        src = dst;
+        std::swap(dst, other);
     }
-    return result;
-#undef block
 }
 
 template<CheckerboardMethod CB, int OPDIM>
-typename DetSDW<CB, OPDIM>::MatData
-DetSDW<CB, OPDIM>::checkerboardRightMultiplyBmatInv(const typename DetSDW<CB, OPDIM>::MatData& A, uint32_t k2, uint32_t k1) {
+void DetSDW<CB, OPDIM>::checkerboardRightMultiplyBmatInv(MatData& out, const MatData& A, uint32_t k2, uint32_t k1) {
     assert(k2 > k1);
     assert(k2 <= pars.m);
-
-    MatData result = rightMultiplyBkInv(A, k1 + 1);
-
-    for (uint32_t k = k1 + 2; k <= k2; ++k) {
-        result = rightMultiplyBkInv(result, k);
+    MatData* dst = ((k2 - k1) % 2 == 1) ? &out : &workspace[0].bmat_temp_1;
+    MatData* other = (dst == &out) ? &workspace[0].bmat_temp_1 : &out;
+    const MatData* src = &A;
+    for (uint32_t k = k1 + 1; k <= k2; ++k) {
+        rightMultiplyBkInv(*dst, *src, k);
+        src = dst;
+        std::swap(dst, other);
     }
-
-    //chemical potential terms included above
-    //result *= std::exp(-dtau * (k2 - k1) * mu);
-
-    return result;
 }
 
 
@@ -3027,149 +2758,110 @@ num DetSDW<CB, OPDIM>::updateInSlice_delayed(uint32_t timeslice, Callable propos
     const auto N = pars.N;
     num accratio = 0.;
 
-    auto getX = [this, MSF](uint32_t step) {
-        return dud.X.cols(MSF*step, MSF*step + MSF-1);
-    };
-    auto getY = [this, MSF](uint32_t step) {
-        return dud.Y.rows(MSF*step, MSF*step + MSF-1);
-    };
-
-    // these two helper functions return submatrices containing just 2
-    // (OPDIM == 1 or 2) or 4 (OPDIM == 3) rows or columns
-    auto takesomerows = [this, N, MSF](MatData& target, const MatData& source, uint32_t for_site) {
-        for (uint32_t r = 0; r < MSF; ++r) {
-            target.row(r) = source.row(for_site + r*N);
+    // flush the pending updates into g
+    auto flushUpdates = [&, this](uint32_t site) {
+        //consistency check
+        std::unique_ptr<MatData> ref_g;
+        if (loggingParams.checkAndLogGreen and performedSweeps >= 10) {
+            ref_g = std::unique_ptr<MatData>(new MatData(computeGreenFromScratch(timeslice, phi)));
         }
-    };
-    auto takesomecols = [this, N, MSF](MatData& target, const MatData& source, uint32_t for_site) {
-        for (uint32_t c = 0; c < MSF; ++c) {
-            target.col(c) = source.col(for_site + c*N);
+
+        //carry out the delayed updates of the Green's function
+        dud.flush(g);
+
+        //consistency check
+        if (loggingParams.checkAndLogGreen and performedSweeps >= 10) {
+            MatNum abs_diff = arma::abs(g - *ref_g);
+            num mean_rel_abs_diff = arma::mean(arma::mean(abs_diff / arma::abs(*ref_g)));
+            num max_diff = arma::max(arma::max(abs_diff));
+            num mean_diff = arma::mean(arma::mean(abs_diff));
+            greenLogging->writeData("t=" + numToString(timeslice) + ",i=" + numToString(site) +
+                                    " ref - delayed: " +
+                                    "max diff: " + numToString(max_diff) +
+                                    " mean diff: " + numToString(mean_diff) +
+                                    " mean rel diff: " + numToString(mean_rel_abs_diff));
+            delete ref_g.release();
         }
     };
 
-    uint32_t site = 0;
-    while (site < N) {
-        uint32_t delayStepsNow = std::min(pars.delaySteps, N - site);
-        dud.X.set_size(MSF*N, MSF*delayStepsNow);
-        dud.Y.set_size(MSF*delayStepsNow, MSF*N);
-        uint32_t j = 0;
-        while (j < delayStepsNow and site < N) {
-            Phi newphi;
-            int32_t new_cdwl;
-            Changed changed;
-            std::tie(changed, newphi, new_cdwl) = proposeLocalUpdate(site, timeslice);
-
-            if (changed != NONE) {
-                //local update is not rejected immeadiately, figure out if we should accept it
-            	num probSPhi = 1.0;
-            	if (changed == PHI) {
-                    num dsphi = deltaSPhi(site, timeslice, newphi);
-                    probSPhi = std::exp(-dsphi);
-            	}
-
-                MatSmall delta_forsite =
-                    get_delta_forsite(newphi, new_cdwl, timeslice, site);
-
-                takesomerows(dud.Rj, g, site);
-                for (uint32_t l = 0; l < j; ++l) {
-                    takesomerows(dud.tempBlock, getX(l), site);
-                    dud.Rj += dud.tempBlock * getY(l);
-                }
+    for (uint32_t site = 0; site < N; ++site) {
+        Phi newphi;
+        int32_t new_cdwl;
+        Changed changed;
+        std::tie(changed, newphi, new_cdwl) = proposeLocalUpdate(site, timeslice);
 
-                takesomecols(dud.Sj, dud.Rj, site);
+        if (changed != NONE) {
+            //local update is not rejected immeadiately, figure out if we should accept it
+            num probSPhi = 1.0;
+            if (changed == PHI) {
+                num dsphi = deltaSPhi(site, timeslice, newphi);
+                probSPhi = std::exp(-dsphi);
+            }
 
-                dud.Mj = smalleye - dud.Sj * delta_forsite + delta_forsite; // should work with new workaround in Armadillo
-                // dud.Mj = (smalleye - dud.Sj * delta_forsite + delta_forsite).eval(); // work around Intel compiler bug
+            MatSmall delta_forsite =
+                get_delta_forsite(newphi, new_cdwl, timeslice, site);
 
-                DataType det = arma::det(dud.Mj);
+            //rows of the current Green's function, including the pending updates
+            const MatData& Rj = dud.computeRows(g, site);
+            MatSmall Sj;
+            for (uint32_t c = 0; c < MSF; ++c) {
+                Sj.col(c) = Rj.col(site + c*N);
+            }
 
-                // consistency check
-                if (loggingParams.checkAndLogDetRatio and performedSweeps >= 10 and changed == PHI) {
-                    num det_abs = std::abs(det);
-                    num ref_det = computeGreenDetRatioFromScratch(site, timeslice, newphi);
-                    num diff = ref_det - det_abs;
-                    num reldiff = diff / ref_det;
+            MatSmall Mj = smalleye - Sj * delta_forsite + delta_forsite;
 
-                    detRatioLogging->writeData("t=" + numToString(timeslice) + ",i=" + numToString(site) +
-                                               " ref - delayed: " +
-                                               numToString(ref_det) + " - " +
-                                               numToString(det_abs) + " = " +
-                                               numToString(diff) + ", relative: " +
-                                               numToString(reldiff));
-                }
+            DataType det = arma::det(Mj);
 
-                num probSFermion;
-                if (OPDIM == 3) {
-                    probSFermion = dataReal(det);
-                } else {
-                    //      /G 0 \             .
-                    //  det \0 G*/ = |det G|^2
-                    probSFermion = std::pow(std::abs(det), 2);
-                }
+            // consistency check
+            if (loggingParams.checkAndLogDetRatio and performedSweeps >= 10 and changed == PHI) {
+                num det_abs = std::abs(det);
+                num ref_det = computeGreenDetRatioFromScratch(site, timeslice, newphi);
+                num diff = ref_det - det_abs;
+                num reldiff = diff / ref_det;
 
-                num prob_cdwl = cdwl_gamma(new_cdwl) / cdwl_gamma(cdwl(site, timeslice));
+                detRatioLogging->writeData("t=" + numToString(timeslice) + ",i=" + numToString(site) +
+                                           " ref - delayed: " +
+                                           numToString(ref_det) + " - " +
+                                           numToString(det_abs) + " = " +
+                                           numToString(diff) + ", relative: " +
+                                           numToString(reldiff));
+            }
 
-                num prob = probSPhi * probSFermion * prob_cdwl;
-                if (prob > 1.0 or rng.rand01() < prob) {
-                    //count accepted update
-                    accratio += 1.0;
-                    for (uint32_t dim = 0; dim < OPDIM; ++dim) {
-                        phi(site, dim, timeslice) = newphi[dim];
-                    }
-                    cdwl(site, timeslice) = new_cdwl;
-                    updateCoshSinhTerms(site, timeslice);
-
-                    //we need Cj only to update X
-                    takesomecols(dud.Cj, g, site);
-                    for (uint32_t l = 0; l < j; ++l) {
-                        takesomecols(dud.tempBlock, getY(l), site);
-                        dud.Cj += getX(l) * dud.tempBlock;
-                    }
-                    //Rj is now Rj - \Id_j, for updating Y
-                    for (uint32_t rc = 0; rc < MSF; ++rc) {
-                        uint32_t entry = site + rc * N;
-                        dud.Rj(rc, entry) -= DataType(1);
-                    }
+            num probSFermion;
+            if (OPDIM == 3) {
+                probSFermion = dataReal(det);
+            } else {
+                //      /G 0 \             .
+                //  det \0 G*/ = |det G|^2
+                probSFermion = std::pow(std::abs(det), 2);
+            }
+
+            num prob_cdwl = cdwl_gamma(new_cdwl) / cdwl_gamma(cdwl(site, timeslice));
 
-                    //update X and Y
-                    getX(j) = dud.Cj * delta_forsite;
-                    getY(j) = arma::inv(dud.Mj) * dud.Rj;
-                    //count successful delayed update
-                    j += 1;
+            num prob = probSPhi * probSFermion * prob_cdwl;
+            if (prob > 1.0 or rng.rand01() < prob) {
+                //count accepted update
+                accratio += 1.0;
+                for (uint32_t dim = 0; dim < OPDIM; ++dim) {
+                    phi(site, dim, timeslice) = newphi[dim];
                 }
-            }
-            ++site;
-        }
-        if (j > 0) {
-            if (j < delayStepsNow) {
-                dud.X.resize(MSF*N, MSF*j);
-                dud.Y.resize(MSF*j, MSF*N);
-            }
+                cdwl(site, timeslice) = new_cdwl;
+                updateCoshSinhTerms(site, timeslice);
 
-            //consistency check
-            std::unique_ptr<MatData> ref_g;
-            if (loggingParams.checkAndLogGreen and performedSweeps >= 10) {
-                ref_g = std::unique_ptr<MatData>(new MatData(computeGreenFromScratch(timeslice, phi)));
-            }
+                //the columns are only needed for accepted updates
+                dud.computeCols(g, site);
+                MatSmall Mj_inv = arma::inv(Mj);
+                dud.push(site, delta_forsite, Mj_inv);
 
-            //carry out the delayed updates of the Green's function
-            g += dud.X*dud.Y;
-
-            //consistency check
-            if (loggingParams.checkAndLogGreen and performedSweeps >= 10) {
-                MatNum abs_diff = arma::abs(g - *ref_g);
-                num mean_rel_abs_diff = arma::mean(arma::mean(abs_diff / arma::abs(*ref_g)));
-                num max_diff = arma::max(arma::max(abs_diff));
-                num mean_diff = arma::mean(arma::mean(abs_diff));
-                greenLogging->writeData("t=" + numToString(timeslice) + ",i=" + numToString(site) +
-                                        " ref - delayed: " +
-                                        "max diff: " + numToString(max_diff) +
-                                        " mean diff: " + numToString(mean_diff) +
-                                        " mean rel diff: " + numToString(mean_rel_abs_diff));
-                delete ref_g.release();
+                if (dud.full()) {
+                    flushUpdates(site + 1);
+                }
             }
         }
     }
+    if (dud.size() > 0) {
+        flushUpdates(N);
+    }
     accratio /= num(N);
     return accratio;
 }
@@ -3591,7 +3283,7 @@ void DetSDW<CB, OPDIM>::attemptGlobalShiftMove() {
 
     if (not pars.turnoffFermions) {
 
-        updateCoshSinhTermsPhi();
+        globalMoveUpdateCoshSinhTermsPhi();
 
         //recompute Green's function and its singular values
         setupUdVStorage_and_calculateGreen();
@@ -3700,7 +3392,7 @@ void DetSDW<CB, OPDIM>::attemptWolffClusterShiftUpdate() {
 
     if (not pars.turnoffFermions) {
 
-        updateCoshSinhTermsPhi();
+        globalMoveUpdateCoshSinhTermsPhi();
 
         //recompute Green's function
         setupUdVStorage_and_calculateGreen();
@@ -3750,15 +3442,32 @@ void DetSDW<CB, OPDIM>::attemptWolffClusterShiftUpdate() {
 
 //helper functions for global updates:
 
-// works directly on phi0,phi1,phi2:
+// Changes all of phi: the shifted field is written to the backup
+// buffer gmd.phi, which is then swapped in, so the previous field is
+// kept without copying it.
 template<CheckerboardMethod CB, int OPDIM>
 void DetSDW<CB, OPDIM>::addGlobalRandomDisplacement() {
     // shift fields by a random, constant displacement
     for (uint32_t dim = 0; dim < OPDIM; ++dim) {
         num r = rng.randRange(-ad.phiDelta, +ad.phiDelta);
-        phi( arma::span::all,
-             arma::span(dim, dim),
-             arma::span::all       ) += r;
+        if (gmd.phiSwapped) {
+            // previous field already backed up
+            phi( arma::span::all,
+                 arma::span(dim, dim),
+                 arma::span::all       ) += r;
+        } else {
+            gmd.phi( arma::span::all,
+                     arma::span(dim, dim),
+                     arma::span::all       ) =
+                phi( arma::span::all,
+                     arma::span(dim, dim),
+                     arma::span::all       ) + r;
+        }
+    }
+    if (not gmd.phiSwapped) {
+        phi.swap(gmd.phi);
+        gmd.phiSwapped = true;
+        gmd.phiSwappedAt = gmd.siteBackups.size();
     }
 }
 
@@ -3814,6 +3523,7 @@ uint32_t DetSDW<CB, OPDIM>::buildAndFlipCluster(bool updateCoshSinh) {
         return arma::dot(this->getPhi(site,timeslice), rd);
     };
     auto setPhi = [&](uint32_t site, uint32_t timeslice, Phi this_phi) -> void {
+        this->globalMoveBackupSite(site, timeslice);
         for (uint32_t dim = 0; dim < OPDIM; ++dim) {
             phi(site, dim, timeslice) = this_phi[dim];
         }
@@ -3827,7 +3537,9 @@ uint32_t DetSDW<CB, OPDIM>::buildAndFlipCluster(bool updateCoshSinh) {
     };
 
     // construct cluster
-    gmd.visited.zeros(pars.N, pars.m+1);
+    // gmd.visited is all zeros here, the sites of this cluster are
+    // reset from their backup entries at the end
+    const std::size_t firstBackup = gmd.siteBackups.size();
     typedef typename GlobalMoveData::SpaceTimeIndex STI;
     //next_sites contains the sites for which we still need to check the neighbors
     gmd.next_sites = std::stack<STI>();
@@ -3879,20 +3591,25 @@ uint32_t DetSDW<CB, OPDIM>::buildAndFlipCluster(bool updateCoshSinh) {
         }
     } while (not gmd.next_sites.empty());
 
+    for (std::size_t b = firstBackup; b < gmd.siteBackups.size(); ++b) {
+        gmd.visited(gmd.siteBackups[b].site, gmd.siteBackups[b].timeslice) = 0;
+    }
+
     return cluster_size;
 }
 
 template<CheckerboardMethod CB, int OPDIM>
 void DetSDW<CB, OPDIM>::globalMoveStoreBackups() {
-    // Backup phi, Green's function and UdV-storage.  For Quantities
-    // which are recomputed entirely in each global update, we just
-    // swap the contents.
-    gmd.phi = phi;
+    // Backup Green's function and UdV-storage.  These are recomputed
+    // entirely in each global update, so we just swap the contents.
+    // The field data are backed up incrementally as they are changed:
+    // globalMoveBackupSite(), globalMoveSetPhi(),
+    // globalMoveUpdateCoshSinhTermsPhi().
+    gmd.siteBackups.clear();
+    gmd.phiSwapped = gmd.coshSinhSwapped = false;
 
     if (not pars.turnoffFermions) {
 
-        gmd.coshTermPhi = coshTermPhi;
-        gmd.sinhTermPhi = sinhTermPhi;
         gmd.g.swap(g);
         gmd.g_inv_sv.swap(g_inv_sv);
         gmd.UdVStorage.swap(UdVStorage);
@@ -3903,12 +3620,36 @@ void DetSDW<CB, OPDIM>::globalMoveStoreBackups() {
 
 template<CheckerboardMethod CB, int OPDIM>
 void DetSDW<CB, OPDIM>::globalMoveRestoreBackups() {
-    phi.swap(gmd.phi);
+    // fields replaced as a whole: swap back the state at that point
+    // then undo the single-site changes made before, latest first
+    std::size_t phiBackups = gmd.siteBackups.size();
+    if (gmd.phiSwapped) {
+        phi.swap(gmd.phi);
+        phiBackups = gmd.phiSwappedAt;
+    }
+    std::size_t coshSinhBackups = gmd.siteBackups.size();
+    if (gmd.coshSinhSwapped) {
+        coshTermPhi.swap(gmd.coshTermPhi);
+        sinhTermPhi.swap(gmd.sinhTermPhi);
+        coshSinhBackups = gmd.coshSinhSwappedAt;
+    }
+    for (std::size_t b = gmd.siteBackups.size(); b-- > 0; ) {
+        const typename GlobalMoveData::SiteBackup& backup = gmd.siteBackups[b];
+        if (b < phiBackups) {
+            for (uint32_t dim = 0; dim < OPDIM; ++dim) {
+                phi(backup.site, dim, backup.timeslice) = backup.phi[dim];
+            }
+        }
+        if (b < coshSinhBackups and not pars.turnoffFermions) {
+            coshTermPhi(backup.site, backup.timeslice) = backup.coshTermPhi;
+            sinhTermPhi(backup.site, backup.timeslice) = backup.sinhTermPhi;
+        }
+    }
+    gmd.siteBackups.clear();
+    gmd.phiSwapped = gmd.coshSinhSwapped = false;
 
     if (not pars.turnoffFermions) {
 
-        coshTermPhi.swap(gmd.coshTermPhi);
-        sinhTermPhi.swap(gmd.sinhTermPhi);
         g.swap(gmd.g);
         g_inv_sv.swap(gmd.g_inv_sv);
         UdVStorage.swap(gmd.UdVStorage);
@@ -3916,6 +3657,43 @@ void DetSDW<CB, OPDIM>::globalMoveRestoreBackups() {
     }
 }
 
+template<CheckerboardMethod CB, int OPDIM>
+void DetSDW<CB, OPDIM>::globalMoveBackupSite(uint32_t site, uint32_t timeslice) {
+    typename GlobalMoveData::SiteBackup backup;
+    backup.site = site;
+    backup.timeslice = timeslice;
+    backup.phi = getPhi(site, timeslice);
+    backup.coshTermPhi = coshTermPhi(site, timeslice);
+    backup.sinhTermPhi = sinhTermPhi(site, timeslice);
+    gmd.siteBackups.push_back(backup);
+}
+
+template<CheckerboardMethod CB, int OPDIM>
+void DetSDW<CB, OPDIM>::globalMoveSetPhi(const CubeNum& newPhi) {
+    if (gmd.phiSwapped) {
+        phi = newPhi;
+    } else {
+        gmd.phi = newPhi;
+        phi.swap(gmd.phi);
+        gmd.phiSwapped = true;
+        gmd.phiSwappedAt = gmd.siteBackups.size();
+    }
+}
+
+template<CheckerboardMethod CB, int OPDIM>
+void DetSDW<CB, OPDIM>::globalMoveUpdateCoshSinhTermsPhi() {
+    if (not gmd.coshSinhSwapped and not pars.turnoffFermions) {
+        coshTermPhi.swap(gmd.coshTermPhi);
+        sinhTermPhi.swap(gmd.sinhTermPhi);
+        // timeslice 0 is not recomputed
+        coshTermPhi.col(0) = gmd.coshTermPhi.col(0);
+        sinhTermPhi.col(0) = gmd.sinhTermPhi.col(0);
+        gmd.coshSinhSwapped = true;
+        gmd.coshSinhSwappedAt = gmd.siteBackups.size();
+    }
+    updateCoshSinhTermsPhi();
+}
+
 
 template<CheckerboardMethod CB, int OPDIM>
 typename DetSDW<CB, OPDIM>::changedPhiInt
@@ -4505,10 +4283,24 @@ void DetSDW<CB, OPDIM>::sweepThermalization() {
 template<CheckerboardMethod CB, int OPDIM>
 typename DetSDW<CB, OPDIM>::MatData
 DetSDW<CB, OPDIM>::shiftGreenSymmetric() {
+    computeShiftedGreenSymmetric();
+    return gshifted;
+}
+
+template<CheckerboardMethod CB, int OPDIM>
+const typename DetSDW<CB, OPDIM>::MatData&
+DetSDW<CB, OPDIM>::shiftGreenSymmetricInPlace() {
+    computeShiftedGreenSymmetric();
+    return gshifted;
+}
+
+template<CheckerboardMethod CB, int OPDIM>
+void DetSDW<CB, OPDIM>::computeShiftedGreenSymmetric() {
     typedef arma::subview<DataType> SubMatData;            //don't do references or const-references of this type
     if (CB == CB_NONE){
         //non-checkerboard
-        return shiftGreenSymmetric_impl(
+        shiftGreenSymmetric_impl(
+            gshifted, gshiftedTemp,
             //rightMultiply
             [this](SubMatData output, SubMatData input, Band band) -> void {
                 output = input * propK_half_inv[band];
@@ -4524,7 +4316,8 @@ DetSDW<CB, OPDIM>::shiftGreenSymmetric() {
         // terms, since those multiplied from the left and right would
         // cancel.  e^{-mu dtau / 2} \Id from one side, e^{+mu dtau / 2} \Id
         if (not pars.weakZflux) {
-            return shiftGreenSymmetric_impl(
+            shiftGreenSymmetric_impl(
+                gshifted, gshiftedTemp,
                 //rightMultiply
                 // output and input are NxN blocks of a complex matrix
                 // this effectively multiplies [Input] * e^{+ dtau K^band_1 / 2} e^{+ dtau K^band_0 / 2}
@@ -4549,7 +4342,8 @@ DetSDW<CB, OPDIM>::shiftGreenSymmetric() {
                 }
                 );
         } else {
-            return shiftGreenSymmetric_impl(
+            shiftGreenSymmetric_impl(
+                gshifted, gshiftedTemp,
                 //rightMultiply
                 // output and input are NxN blocks of a complex matrix
                 // this effectively multiplies [Input] * e^{+ dtau K^band_1 / 2} e^{+ dtau K^band_0 / 2}
@@ -4579,12 +4373,14 @@ DetSDW<CB, OPDIM>::shiftGreenSymmetric() {
 //references in a sense)
 template<CheckerboardMethod CB, int OPDIM>
 template<class RightMultiply, class LeftMultiply>
-typename DetSDW<CB, OPDIM>::MatData
-DetSDW<CB, OPDIM>::shiftGreenSymmetric_impl(RightMultiply rightMultiply, LeftMultiply leftMultiply) {
+void DetSDW<CB, OPDIM>::shiftGreenSymmetric_impl(MatData& newG, MatData& tempG,
+                                                 RightMultiply rightMultiply, LeftMultiply leftMultiply) {
     const auto N = pars.N;
     //submatrix view helper for a 4N*4N or 2N*2N matrix
 #define block(matrix, row, col) matrix.submat((row) * N, (col) * N, ((row) + 1) * N - 1, ((col) + 1) * N - 1)
-    MatData tempG(MatrixSizeFactor*N, MatrixSizeFactor*N);
+    //no reallocation if the sizes already match
+    tempG.set_size(MatrixSizeFactor*N, MatrixSizeFactor*N);
+    newG.set_size(MatrixSizeFactor*N, MatrixSizeFactor*N);
     const MatData& oldG = g;
     //multiply e^(dtau/2 K) from the right
     for (uint32_t row = 0; row < MatrixSizeFactor; ++row) {
@@ -4597,7 +4393,6 @@ DetSDW<CB, OPDIM>::shiftGreenSymmetric_impl(RightMultiply rightMultiply, LeftMul
         }
     }
     //multiply e^(-dtau/2 K) from the left
-    MatData newG(MatrixSizeFactor*N, MatrixSizeFactor*N);
     for (uint32_t col = 0; col < MatrixSizeFactor; ++col) {
         //block(newG, 0, col) = propKx_half * block(tempG, 0, col);
         leftMultiply( block(newG, 0, col), block(tempG, 0, col), XBAND );
@@ -4608,7 +4403,6 @@ DetSDW<CB, OPDIM>::shiftGreenSymmetric_impl(RightMultiply rightMultiply, LeftMul
         }
     }
 #undef block
-    return newG;
 }
 
 
@@ -4671,18 +4465,15 @@ void DetSDW<CB, OPDIM>::consistencyCheck() {
         for (uint32_t k = 1; k <= m; ++k) {
             MatData bk = computeBmatSDW(k, k-1);
             MatData bk_inv = arma::inv(bk);
-            MatData checkbk_left = checkerboardLeftMultiplyBmat(
-                arma::eye<MatData>(MSF*N,MSF*N),
-                k, k-1);
-            MatData checkbk_right = checkerboardRightMultiplyBmat(
-                arma::eye<MatData>(MSF*N,MSF*N),
-                k, k-1);
-            MatData checkbk_inv_left = checkerboardLeftMultiplyBmatInv(
-                arma::eye<MatData>(MSF*N,MSF*N),
-                k, k-1);
-            MatData checkbk_inv_right = checkerboardRightMultiplyBmatInv(
-                arma::eye<MatData>(MSF*N,MSF*N),
-                k, k-1);
+            const MatData unity = arma::eye<MatData>(MSF*N,MSF*N);
+            MatData checkbk_left(MSF*N, MSF*N);
+            checkerboardLeftMultiplyBmat(checkbk_left, unity, k, k-1);
+            MatData checkbk_right(MSF*N, MSF*N);
+            checkerboardRightMultiplyBmat(checkbk_right, unity, k, k-1);
+            MatData checkbk_inv_left(MSF*N, MSF*N);
+            checkerboardLeftMultiplyBmatInv(checkbk_inv_left, unity, k, k-1);
+            MatData checkbk_inv_right(MSF*N, MSF*N);
+            checkerboardRightMultiplyBmatInv(checkbk_inv_right, unity, k, k-1);
             std::cout << "cb:" << CB << " " << k << "\n";
             print_matrix_diff(bk, checkbk_left, "bk_left");
             print_matrix_diff(bk_inv, checkbk_inv_left, "bk_inv_left");
@@ -4867,8 +4658,8 @@ num DetSDW<CB, OPDIM>::computeGreenDetRatioFromScratch(uint32_t timeslice, const
     VecNum old_g_inv_sv = g_inv_sv;
 
     // temporarily go to newPhi
-    phi = newPhi;
-    updateCoshSinhTerms();
+    globalMoveSetPhi(newPhi);
+    globalMoveUpdateCoshSinhTermsPhi();
 
     // recompute new Green's function and its singular values
     setupUdVStorage_and_calculateGreen_forTimeslice(timeslice);
@@ -4908,8 +4699,8 @@ typename DetSDW<CB, OPDIM>::MatData DetSDW<CB, OPDIM>::computeGreenFromScratch(u
     globalMoveStoreBackups();
 
     // temporarily go to newPhi
-    phi = newPhi;
-    updateCoshSinhTerms();
+    globalMoveSetPhi(newPhi);
+    globalMoveUpdateCoshSinhTermsPhi();
 
     // recompute new Green's function and its singular values
     setupUdVStorage_and_calculateGreen_forTimeslice(timeslice);
@@ -5034,6 +4825,51 @@ void DetSDW<CB, OPDIM>::saveConfigurationStreamBinary(const std::string& directo
     }
 }
 
+template<CheckerboardMethod CB, int OPDIM>
+void DetSDW<CB, OPDIM>::saveConfigurationStreamIndexed(const std::string& directory) {
+    fs::path phi_filepath = fs::path(directory) /
+        fs::path("configs-phi.configstream");
+    ConfigStreamWriter phi_output(phi_filepath.string(), ConfigStreamHeader::DTypeFloat64,
+                                  pars.L, pars.m, OPDIM);
+    if (phi_output) {
+        std::vector<double> record;
+        record.reserve(pars.L * pars.L * pars.m * OPDIM);
+        for (uint32_t ix = 0; ix < pars.L; ++ix) {
+            for (uint32_t iy = 0; iy < pars.L; ++iy) {
+                uint32_t i = iy*pars.L + ix;
+                for (uint32_t k = 1; k <= pars.m; ++k) {
+                    for (uint32_t dim = 0; dim < OPDIM; ++dim) {
+                        record.push_back(phi(i, dim, k));
+                    }
+                }
+            }
+        }
+        phi_output.writeRecord(record.data());
+        phi_output.flush();
+    }
+
+    if (pars.cdwU) {                 // we have not assigned 0.0 to cdwU
+        fs::path cdwl_filepath = fs::path(directory) /
+            fs::path("configs-l.configstream");
+        ConfigStreamWriter cdwl_output(cdwl_filepath.string(), ConfigStreamHeader::DTypeInt32,
+                                       pars.L, pars.m, 1);
+        if (cdwl_output) {
+            std::vector<int32_t> record;
+            record.reserve(pars.L * pars.L * pars.m);
+            for (uint32_t ix = 0; ix < pars.L; ++ix) {
+                for (uint32_t iy = 0; iy < pars.L; ++iy) {
+                    uint32_t i = iy*pars.L + ix;
+                    for (uint32_t k = 1; k <= pars.m; ++k) {
+                        record.push_back(cdwl(i, k));
+                    }
+                }
+            }
+            cdwl_output.writeRecord(record.data());
+            cdwl_output.flush();
+        }
+    }
+}
+
 template<CheckerboardMethod CB, int OPDIM>
 void DetSDW<CB, OPDIM>::saveConfigurationStreamTextHeader(
     const std::string& simInfoHeaderText, const std::string& directory) {
@@ -5123,9 +4959,9 @@ DetSDW_SystemConfig DetSDW<CB, OPDIM>::getCurrentSystemConfiguration() {
 
 template<CheckerboardMethod CB, int OPDIM>
 DetSDW_SystemConfig_FileHandle DetSDW<CB, OPDIM>::prepareSystemConfigurationStreamFileHandle(
-        bool binaryStream, bool textStream, const std::string& directory) {
-    if (not (binaryStream or textStream)) {
-        throw_GeneralError("binaryStream or textStream must be sepcified to create file handle");
+        bool binaryStream, bool textStream, bool indexedStream, const std::string& directory) {
+    if (not (binaryStream or textStream or indexedStream)) {
+        throw_GeneralError("binaryStream, textStream or indexedStream must be sepcified to create file handle");
     }
 
     DetSDW_SystemConfig_FileHandle file_handle;
@@ -5154,6 +4990,13 @@ DetSDW_SystemConfig_FileHandle DetSDW<CB, OPDIM>::prepareSystemConfigurationStre
         file_handle.phi_output_text->precision(14);
         file_handle.phi_output_text->setf(std::ios::scientific, std::ios::floatfield);
     }
+    if (indexedStream) {
+        fs::path phi_filepath = fs::path(directory) /
+            fs::path("configs-phi.configstream");
+        file_handle.phi_output_indexed = DetSDW_SystemConfig_FileHandle::ConfigStreamPointer(
+            new ConfigStreamWriter(phi_filepath.string(), ConfigStreamHeader::DTypeFloat64,
+                                   pars.L, pars.m, OPDIM) );
+    }
     
     if (pars.cdwU) {
         if (binaryStream) {
@@ -5178,6 +5021,13 @@ DetSDW_SystemConfig_FileHandle DetSDW<CB, OPDIM>::prepareSystemConfigurationStre
                 std::cerr << "Error code: " << strerror(errno) << "\n";
             }
         }
+        if (indexedStream) {
+            fs::path cdwl_filepath = fs::path(directory) /
+                fs::path("configs-l.configstream");
+            file_handle.cdwl_output_indexed = DetSDW_SystemConfig_FileHandle::ConfigStreamPointer(
+                new ConfigStreamWriter(cdwl_filepath.string(), ConfigStreamHeader::DTypeInt32,
+                                       pars.L, pars.m, 1) );
+        }
     }
 
     return file_handle;
@@ -22,6 +22,7 @@
 #include <complex>
 #include <type_traits>          // std::conditional
 #include <string>
+#include <stack>                // wolff cluster sites
 #include "rngwrapper.h"
 #include "detmodel.h"
 #include "detsdwparams.h"
@@ -32,6 +33,8 @@
 #include "symmat.h"
 #include "detsdwsystemconfig.h"
 #include "detsdwsystemconfigfilehandle.h"
+#include "delayedupdates.h"
+#include "latticefourier.h"
 
 typedef std::complex<num> cpx;
 typedef arma::Mat<cpx> MatCpx;
@@ -60,16 +63,12 @@ void createReplica(std::unique_ptr<DetSDW<CBM, OPDIM>>& replica_out,
 //   - values of 1, 2, 3 to be supported
 //   - dimension of the order parameter field phi
 template<CheckerboardMethod Checkerboard, int OPDIM>
-// class DetSDW: public DetModelGC<1,
-//                                 // the basic data type is complex for
-//                                 // O(3) or O(2) order parameters, real
-//                                 // for O(1):
-//                                 typename std::conditional<OPDIM==1, num, cpx>::type > {
 class DetSDW: public DetModelGC<1,
-                                // to support an extra magnetic field, we use
-                                // a complex basic data type for the O(1), O(2),
-                                // and O(3) models. ~~ no good way around this, unfortunately.
-                                cpx> {
+                                // the basic data type is complex for
+                                // O(3) or O(2) order parameters, real
+                                // for O(1) [the magnetic field is only
+                                // supported for O(2)]:
+                                typename std::conditional<OPDIM==1, num, cpx>::type > {
 public:
     static_assert(OPDIM==1 or OPDIM==2 or OPDIM==3,
                   "Supported order parameter dimensions: 1, 2, or 3");
@@ -105,6 +104,8 @@ public:
     //----------------------------------------------------------------
     void saveConfigurationStreamText(const std::string& directory = ".");
     void saveConfigurationStreamBinary(const std::string& directory = ".");
+    // indexed binary container (*.configstream), self-describing, no separate header file
+    void saveConfigurationStreamIndexed(const std::string& directory = ".");
     // If the file does not already exist, write an informative human
     // readable header. For binary: write it to a separate text file.
     // Only write this file if it does not exist already.
@@ -123,7 +124,7 @@ public:
     // be used by other replicas simulated on other processors if this
     // is used by DetQMCPT
     DetSDW_SystemConfig_FileHandle prepareSystemConfigurationStreamFileHandle(
-        bool binaryStream, bool textStream,
+        bool binaryStream, bool textStream, bool indexedStream,
         const std::string& directory = ".");
 
     
@@ -161,12 +162,13 @@ protected:
     static constexpr uint32_t MatrixSizeFactor = (OPDIM == 3 ? 4 : 2);
 
 /*
-    Originally the basic data type here used to be complex for O(3) or
-    O(2) order parameters, real for O(1).  However, this is not compatible
-    to having a magnetic field => need to use complex variables in all cases.
+    The basic data type is complex for O(3) or O(2) order parameters
+    [the coupling to phi_2 has imaginary matrix elements, and the magnetic
+    field enters via complex hopping phases], real for O(1).  The weak
+    magnetic field is only supported for O(2), so the O(1) model can
+    always be simulated with real arithmetic.
 */
-    // typedef typename std::conditional<OPDIM==1, num, cpx>::type DataType;
-    typedef cpx DataType;
+    typedef typename std::conditional<OPDIM==1, num, cpx>::type DataType;
     typedef arma::Mat<DataType> MatData;
     typedef typename arma::Mat<DataType>::template fixed<MatrixSizeFactor,MatrixSizeFactor> MatSmall;
     typedef arma::Col<DataType> VecData;
@@ -178,6 +180,8 @@ protected:
     static void setReal(num& value, num realPart) { value = realPart; }
     static void setImag(cpx& value, num imagPart) { value.imag(imagPart); }
     static void setImag(num& value, num imagPart) { value = imagPart; }
+    static cpx dataConj(const cpx& value) { return std::conj(value); }
+    static num dataConj(const num& value) { return value; }
 
     //need these to have the same code handle real/complex subviews
     //subviews do not have members set_real or set_imag.
@@ -193,6 +197,14 @@ protected:
                             const Matrix1& realPart, const Matrix2& imagPart) {
         subv = MatCpx(realPart, imagPart);
     }
+
+    //store complex matrices [hopping terms with magnetic field phases]
+    //in the basic data type.  For real data: discard the imaginary part,
+    //which vanishes as we have no magnetic field then.
+    static void setFromCpx(arma::subview<num> subv, const MatCpx& m) { subv = arma::real(m); }
+    static void setFromCpx(arma::subview<cpx> subv, const MatCpx& m) { subv = m; }
+    static void setFromCpx(MatNum& target, const MatCpx& m) { target = arma::real(m); }
+    static void setFromCpx(MatCpx& target, const MatCpx& m) { target = m; }
     
    
     
@@ -215,6 +227,7 @@ protected:
     // using Base::greenBwd;
     using Base::UdVStorage;
     using Base::eye_gc;
+    using Base::workspace;
     using Base::lastSweepDir;
     using Base::obsScalar;
     using Base::obsVector;
@@ -357,8 +370,14 @@ protected:
   To precalculate these, call precalc_4site_hopping_exponentials 
   
 */
-    typedef MatData::fixed<4,4> Mat4Site;
-    typedef checkarray<std::map<uint32_t, Mat4Site>, 2> ExpHop4SiteStorage; // indexed first by subgroup, then by site i
+    typedef typename MatData::template fixed<4,4> Mat4Site;
+    // one entry per plaquette [i j k l] of a subgroup, the entries are stored in
+    // the same order in which the checkerboard routines traverse the plaquettes
+    struct ExpHop4SitePlaquette {
+        uint32_t i, j, k, l;
+        Mat4Site mat;
+    };
+    typedef checkarray<std::vector<ExpHop4SitePlaquette>, 2> ExpHop4SiteStorage; // indexed first by subgroup, then by plaquette
 
     // these are first indexed by band index XBAND or YBAND:
     checkarray<ExpHop4SiteStorage, 2> expHop4Site_minus;       // contains terms to compute exp(-dtau K_band)
@@ -405,21 +424,22 @@ protected:
     sensitive) when we need to involve the kinetic part of the
     Hamiltonian.
 
-    They are complex to allow for a magnetic field.
+    They are complex to allow for a magnetic field, unless the basic
+    data type is real.
 
 */
-    checkarray<MatCpx, 2> propK; // e^{-dtau K[band]}
-    MatCpx& propKx;
-    MatCpx& propKy;
+    checkarray<MatData, 2> propK; // e^{-dtau K[band]}
+    MatData& propKx;
+    MatData& propKy;
 
     //for shifting green functions to obtain equivalency of symmetric Trotter decomposition
     //[checker board decomposition could be applied alternatively]
-    checkarray<MatCpx, 2> propK_half;       //factor of -dtau/2 in exponential
-    MatCpx& propKx_half;
-    MatCpx& propKy_half;
-    checkarray<MatCpx, 2> propK_half_inv;   //factor of +dtau/2 in exponential
-    MatCpx& propKx_half_inv;
-    MatCpx& propKy_half_inv;
+    checkarray<MatData, 2> propK_half;       //factor of -dtau/2 in exponential
+    MatData& propKx_half;
+    MatData& propKy_half;
+    checkarray<MatData, 2> propK_half_inv;   //factor of +dtau/2 in exponential
+    MatData& propKx_half_inv;
+    MatData& propKy_half_inv;
 
 
 
@@ -585,6 +605,16 @@ protected:
     uint32_t performedSweeps;
 
 
+/*
+
+    Buffers for the symmetrically shifted Green's function used in
+    measurements, reused for every timeslice.
+
+*/
+    MatData gshifted;
+    MatData gshiftedTemp;
+
+
 /*
     
     Observables:
@@ -627,6 +657,10 @@ protected:
     checkarray<VecNum, 2> kOcc;     //Fermion occupation number in momentum space for x/y-band; site-index: k-vectors
     VecNum& kOccX;
     VecNum& kOccY;
+    // Fourier transforms for the k-space measurements, not allocated without fermions
+    std::unique_ptr<LatticeFourier> latticeFourier;
+    MatData kOccGreen;              // G_{up,up} + G_{down,down} of one band, real space
+    VecCpx kOccTransformed;
 //    checkarray<VecNum, 2> kOccImag;
 //    VecNum& kOccXimag;
 //    VecNum& kOccYimag;
@@ -783,12 +817,12 @@ protected:
     //if invertedCbOrder = true: use the following checkerbaord decomposition:
     //    e^{+-K} = e^{+-K_a} e^{+-K_b}
     //for the symmetric checkerboard break-up (CB_ASSAAD_BERG) this is ignored
-    // with A: NxN, sign = +/- 1, band = XBAND|YBAND: return a matrix equal to E^(sign * dtau * K_band) * A
+    // with A: NxN, sign = +/- 1, band = XBAND|YBAND: set A := E^(sign * dtau * K_band) * A  [in place]
     template <class Matrix>
-    MatData cbLMultHoppingExp(const Matrix& A, Band band, int sign, bool invertedCbOrder = false);
-    // with A: NxN, sign = +/- 1, band = XBAND|YBAND: return a matrix equal to A * E^(sign * dtau * K_band)
+    void cbLMultHoppingExp(Matrix& A, Band band, int sign, bool invertedCbOrder = false);
+    // with A: NxN, sign = +/- 1, band = XBAND|YBAND: set A := A * E^(sign * dtau * K_band)  [in place]
     template <class Matrix>
-    MatData cbRMultHoppingExp(const Matrix& A, Band band, int sign, bool invertedCbOrder = false);
+    void cbRMultHoppingExp(Matrix& A, Band band, int sign, bool invertedCbOrder = false);
 
     //cbLMultHoppingExp and cbRMultHoppingExp need separate implementations for each CheckerboardMethod,
     //this cannot be realized by a direct partial template specialization, but we need to have a proxy
@@ -796,17 +830,17 @@ protected:
     //compare first solution in winning answer at:
     //http://stackoverflow.com/questions/1501357/template-specialization-of-particular-members
     template <class Matrix>
-    MatData cbLMultHoppingExp_impl(std::integral_constant<CheckerboardMethod, CB_NONE>,
-                                   const Matrix& A, Band band, int sign, bool invertedCbOrder = false);
+    void cbLMultHoppingExp_impl(std::integral_constant<CheckerboardMethod, CB_NONE>,
+                                Matrix& A, Band band, int sign, bool invertedCbOrder = false);
     template <class Matrix>
-    MatData cbRMultHoppingExp_impl(std::integral_constant<CheckerboardMethod, CB_NONE>,
-                                   const Matrix& A, Band band, int sign, bool invertedCbOrder = false);
+    void cbRMultHoppingExp_impl(std::integral_constant<CheckerboardMethod, CB_NONE>,
+                                Matrix& A, Band band, int sign, bool invertedCbOrder = false);
     template <class Matrix>
-    MatData cbLMultHoppingExp_impl(std::integral_constant<CheckerboardMethod, CB_ASSAAD_BERG>,
-                                   const Matrix& A, Band band, int sign, bool invertedCbOrder = false);
+    void cbLMultHoppingExp_impl(std::integral_constant<CheckerboardMethod, CB_ASSAAD_BERG>,
+                                Matrix& A, Band band, int sign, bool invertedCbOrder = false);
     template <class Matrix>
-    MatData cbRMultHoppingExp_impl(std::integral_constant<CheckerboardMethod, CB_ASSAAD_BERG>,
-                                   const Matrix& A, Band band, int sign, bool invertedCbOrder = false);
+    void cbRMultHoppingExp_impl(std::integral_constant<CheckerboardMethod, CB_ASSAAD_BERG>,
+                                Matrix& A, Band band, int sign, bool invertedCbOrder = false);
     //functions called by the above if no magnetic field is applied:
     template<class Matrix>
     void cb_assaad_applyBondFactorsLeft(Matrix& result, uint32_t subgroup, num ch_hor, num sh_hor, num ch_ver, num sh_ver);
@@ -831,17 +865,29 @@ protected:
 
     //the following take a MatrixSizeFactor*N x MatrixSizeFactor*N
     //matrix A and effectively multiply B(k2,k1) or its inverse to the
-    //left or right of it and return the result
-    MatData checkerboardLeftMultiplyBmat(const MatData& A, uint32_t k2, uint32_t k1);
-    MatData checkerboardRightMultiplyBmat(const MatData& A, uint32_t k2, uint32_t k1);
-    MatData checkerboardLeftMultiplyBmatInv(const MatData& A, uint32_t k2, uint32_t k1);
-    MatData checkerboardRightMultiplyBmatInv(const MatData& A, uint32_t k2, uint32_t k1);
+    //left or right of it and store the result in out [out and A must be
+    //distinct, neither may be workspace[0].bmat_temp_1 or bmat_temp_2,
+    //which are used as scratch space]
+    void checkerboardLeftMultiplyBmat(MatData& out, const MatData& A, uint32_t k2, uint32_t k1);
+    void checkerboardRightMultiplyBmat(MatData& out, const MatData& A, uint32_t k2, uint32_t k1);
+    void checkerboardLeftMultiplyBmatInv(MatData& out, const MatData& A, uint32_t k2, uint32_t k1);
+    void checkerboardRightMultiplyBmatInv(MatData& out, const MatData& A, uint32_t k2, uint32_t k1);
 
     //helpers for the checkerboardMultiplyFunctions
-    MatData rightMultiplyBk(const MatData& orig, uint32_t k);     //multiply B(k,k-1) from right to orig, return result
-    MatData rightMultiplyBkInv(const MatData& orig, uint32_t k);  //multiply B(k,k-1)^-1 from right to orig, return result
-    MatData leftMultiplyBk(const MatData& orig, uint32_t k);      //multiply B(k,k-1) from left to orig, return result
-    MatData leftMultiplyBkInv(const MatData& orig, uint32_t k);   //multiply B(k,k-1)^-1 from left to orig, return result
+    void rightMultiplyBk(MatData& out, const MatData& orig, uint32_t k);     //multiply B(k,k-1) from right to orig, store in out
+    void rightMultiplyBkInv(MatData& out, const MatData& orig, uint32_t k);  //multiply B(k,k-1)^-1 from right to orig, store in out
+    void leftMultiplyBk(MatData& out, const MatData& orig, uint32_t k);      //multiply B(k,k-1) from left to orig, store in out
+    void leftMultiplyBkInv(MatData& out, const MatData& orig, uint32_t k);   //multiply B(k,k-1)^-1 from left to orig, store in out
+
+    //diagonal entries of the blocks of E^(sign*dtau*V) for timeslice k,
+    //including the chemical potential, set by cbSetPotentialFactors()
+    checkarray<checkarray<VecData, MatrixSizeFactor>, MatrixSizeFactor> cbPotentialFactor;
+    void cbSetPotentialFactors(uint32_t k, int sign);
+    //blocks (r,c) of E^(sign*dtau*V) that vanish identically
+    static bool cbZeroBlock(uint32_t r, uint32_t c) { return r != c and r % 2 == c % 2; }
+    //out := E^(sign*dtau*V) * A  and  out := A * E^(sign*dtau*V)
+    void cbLeftMultiplyPotential(MatData& out, const MatData& A);
+    void cbRightMultiplyPotential(MatData& out, const MatData& A);
 
 /*
   
@@ -902,18 +948,28 @@ protected:
     //shifted matrix for the current timeslice.  This should be done
     //before measurements.
     virtual MatData shiftGreenSymmetric();
+
+    //In-place variant of the above: the shifted matrix is stored in
+    //the buffer gshifted.  The returned reference is valid until the
+    //next call.
+    const MatData& shiftGreenSymmetricInPlace();
+
+    //the upper functions call the following to compute the shifted
+    //matrix into gshifted
+    void computeShiftedGreenSymmetric();
     
-    //the upper function shiftGreenSymmetric() calls the following
+    //computeShiftedGreenSymmetric() calls the following
     //helper with functors RightMultiply, LeftMultiply depending on
-    //the CheckerboardMethod
+    //the CheckerboardMethod.  tempG and newG are resized if necessary.
     template<class RightMultiply, class LeftMultiply>
-    MatData shiftGreenSymmetric_impl(RightMultiply, LeftMultiply);
+    void shiftGreenSymmetric_impl(MatData& newG, MatData& tempG,
+                                  RightMultiply, LeftMultiply);
 
     //measuring observables
     void initMeasurements();				//reset stored observable values (beginning of a sweep)
     void measure(uint32_t timeslice);                   //measure observables for one timeslice
     void finishMeasurements();				//finalize stored observable values (end of a sweep)
-    std::set<uint32_t> timeslices_included_in_measurement; 	//for a consistency check -- sweep includes correct #timeslices
+    std::vector<bool> timeslices_included_in_measurement; 	//for a consistency check -- sweep includes correct #timeslices [flag per timeslice]
     // compute the structure factor from a matrix of real space correlations
     void computeStructureFactor(VecNum& out_k, const MatNum& in_r);
     void computeStructureFactor(VecNum& out_k, const MatCpx& in_r); // this computes the real part of the Fourier transform of in_r
@@ -952,26 +1008,11 @@ protected:
     num updateInSlice_iterative(uint32_t timeslice, CallableProposeLocalUpdate proposeLocalUpdate);
     template<class CallableProposeLocalUpdate>
     num updateInSlice_woodbury(uint32_t timeslice, CallableProposeLocalUpdate proposeLocalUpdate);
-   	//this one uses a nested struct because for some status
+    //this one collects accepted updates in a DelayedUpdates engine and applies them
+    //to g in blocks of up to pars.delaySteps
     template<class CallableProposeLocalUpdate>
     num updateInSlice_delayed(uint32_t timeslice, CallableProposeLocalUpdate proposeLocalUpdate);
-    struct DelayedUpdatesData {		//some helper data for updatesInSlice_delayed that should not be realloced all the time
-    	MatData X;
-    	MatData Y;
-    	MatData Rj;
-        MatSmall Sj;
-    	MatData Cj;
-    	MatSmall tempBlock;
-	MatSmall Mj;
-    	DelayedUpdatesData(uint32_t N, uint32_t delaySteps)
-            : X(MatrixSizeFactor*N, MatrixSizeFactor*delaySteps),
-              Y(MatrixSizeFactor*delaySteps, MatrixSizeFactor*N),
-              Rj(MatrixSizeFactor, MatrixSizeFactor*N),
-              Cj(MatrixSizeFactor*N, MatrixSizeFactor) {
-            X.zeros();
-            Y.zeros();
-    	}
-    } dud;
+    DelayedUpdates<DataType, MatrixSizeFactor> dud;
 
     //this one does some adjusting of the box size from which new fields are chosen:
     void updateInSliceThermalization(uint32_t timeslice);
@@ -1030,7 +1071,11 @@ protected:
     // attempt a combined update
     void attemptWolffClusterShiftUpdate(); 
     struct GlobalMoveData {		//some helper data that should not be reallocated all the time
-        // quantities to be backed up:
+        // quantities to be backed up.  g, g_inv_sv and UdVStorage are
+        // recomputed entirely by each global update, they are swapped
+        // with the current ones.  phi and the cosh/sinh terms only hold
+        // the previous values once they have been replaced as a whole
+        // (global shift), see phiSwapped and coshSinhSwapped.
         CubeNum phi;
     	MatNum coshTermPhi;
     	MatNum sinhTermPhi;
@@ -1038,6 +1083,24 @@ protected:
         VecNum  g_inv_sv;
     	std::unique_ptr<checkarray<std::vector<UdVV>, 1>> UdVStorage;
 
+        // previous values at single sites changed since the last
+        // globalMoveStoreBackups(), in the order of the changes
+        struct SiteBackup {
+            uint32_t site;
+            uint32_t timeslice;
+            Phi phi;
+            num coshTermPhi;
+            num sinhTermPhi;
+        };
+        std::vector<SiteBackup> siteBackups;
+        // if phi [the cosh/sinh terms] have been swapped with the buffers
+        // above, only the first phiSwappedAt [coshSinhSwappedAt] entries of
+        // siteBackups refer to the state stored there
+        bool phiSwapped;
+        bool coshSinhSwapped;
+        std::size_t phiSwappedAt;
+        std::size_t coshSinhSwappedAt;
+
     	//for the cluster update: mark visited sites by 1, else 0
     	MatUint visited;		//as usual: row is spatial index, col is time index
     	typedef std::tuple<uint32_t, uint32_t> SpaceTimeIndex;
@@ -1045,8 +1108,10 @@ protected:
     	std::stack<SpaceTimeIndex> next_sites;
     	GlobalMoveData(uint32_t N, uint32_t m, bool noFermions = false) {
             phi.resize(N, OPDIM, m+1);
-            visited.resize(N, m+1);
+            visited.zeros(N, m+1);
             next_sites = std::stack<SpaceTimeIndex>();            
+            phiSwapped = coshSinhSwapped = false;
+            phiSwappedAt = coshSinhSwappedAt = 0;
 
             if (not noFermions) {
                 coshTermPhi.resize(N, m+1);
@@ -1059,10 +1124,16 @@ protected:
         }
     } gmd;
     //helper functions for global updates:
-    void addGlobalRandomDisplacement(); // works directly on phi0,phi1,phi2
+    void addGlobalRandomDisplacement(); // works on phi, needs globalMoveStoreBackups() before
     uint32_t buildAndFlipCluster(bool updateCoshSinh = true); // returns size of cluster
     void globalMoveStoreBackups();
     void globalMoveRestoreBackups();
+    // record the current values at (site, timeslice) before changing them
+    void globalMoveBackupSite(uint32_t site, uint32_t timeslice);
+    // replace phi as a whole, the previous field is kept in gmd.phi
+    void globalMoveSetPhi(const CubeNum& newPhi);
+    // recompute all cosh/sinh terms of phi, keeping the previous ones in gmd
+    void globalMoveUpdateCoshSinhTermsPhi();
     
 
     //compute the total value of the action associated with the field phi
@@ -1307,13 +1378,13 @@ struct DetSDW<CBM, OPDIM>::sdwLeftMultiplyBmat {
     sdwLeftMultiplyBmat(DetSDW<CBM, OPDIM>* parent_) :
         parent(parent_)
     { }
-    MatData operator()(uint32_t gc, const MatData& mat, uint32_t k2, uint32_t k1) {
+    void operator()(uint32_t gc, MatData& out, const MatData& mat, uint32_t k2, uint32_t k1) {
         (void)gc;
         assert(gc == 0);
         if (CBM != CB_NONE) {
-            return parent->checkerboardLeftMultiplyBmat(mat, k2, k1);
+            parent->checkerboardLeftMultiplyBmat(out, mat, k2, k1);
         } else {
-            return parent->computeBmatSDW(k2, k1) * mat;
+            out = parent->computeBmatSDW(k2, k1) * mat;
         }
     }
 };
@@ -1324,13 +1395,13 @@ struct DetSDW<CBM, OPDIM>::sdwRightMultiplyBmat {
     sdwRightMultiplyBmat(DetSDW<CBM, OPDIM>* parent_) :
         parent(parent_)
         { }
-    MatData operator()(uint32_t gc, const MatData& mat, uint32_t k2, uint32_t k1) {
+    void operator()(uint32_t gc, MatData& out, const MatData& mat, uint32_t k2, uint32_t k1) {
         (void)gc;
         assert(gc == 0);
         if (CBM != CB_NONE) {
-            return parent->checkerboardRightMultiplyBmat(mat, k2, k1);
+            parent->checkerboardRightMultiplyBmat(out, mat, k2, k1);
         } else {
-            return mat * parent->computeBmatSDW(k2, k1);
+            out = mat * parent->computeBmatSDW(k2, k1);
         }
     }
 };
@@ -1341,13 +1412,13 @@ struct DetSDW<CBM, OPDIM>::sdwLeftMultiplyBmatInv {
     sdwLeftMultiplyBmatInv(DetSDW<CBM, OPDIM>* parent_) :
         parent(parent_)
         { }
-    MatData operator()(uint32_t gc, const MatData& mat, uint32_t k2, uint32_t k1) {
+    void operator()(uint32_t gc, MatData& out, const MatData& mat, uint32_t k2, uint32_t k1) {
         (void)gc;
         assert(gc == 0);
         if (CBM != CB_NONE) {
-            return parent->checkerboardLeftMultiplyBmatInv(mat, k2, k1);
+            parent->checkerboardLeftMultiplyBmatInv(out, mat, k2, k1);
         } else {
-            return arma::inv(parent->computeBmatSDW(k2, k1)) * mat;
+            out = arma::inv(parent->computeBmatSDW(k2, k1)) * mat;
         }
     }
 };
@@ -1358,13 +1429,13 @@ struct DetSDW<CBM, OPDIM>::sdwRightMultiplyBmatInv {
     sdwRightMultiplyBmatInv(DetSDW<CBM, OPDIM>* parent_) :
         parent(parent_)
         { }
-    MatData operator()(uint32_t gc, const MatData& mat, uint32_t k2, uint32_t k1) {
+    void operator()(uint32_t gc, MatData& out, const MatData& mat, uint32_t k2, uint32_t k1) {
         (void)gc;
         assert(gc == 0);
         if (CBM != CB_NONE) {
-            return parent->checkerboardRightMultiplyBmatInv(mat, k2, k1);
+            parent->checkerboardRightMultiplyBmatInv(out, mat, k2, k1);
         } else {
-            return mat * arma::inv(parent->computeBmatSDW(k2, k1));
+            out = mat * arma::inv(parent->computeBmatSDW(k2, k1));
         }
     }
 };
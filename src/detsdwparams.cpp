@@ -10,6 +10,7 @@
 #include "detsdwparams.h"
 
 #include <vector>
+#include <iostream>
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
 #pragma GCC diagnostic ignored "-Wshadow"
@@ -18,6 +19,16 @@
 
 #include "exceptions.h"
 
+void ModelParamsDetSDW::takeRuntimeParameters(const ModelParamsDetSDW& current, bool verbose) {
+    if (current.checkerboardThreads != checkerboardThreads) {
+        if (verbose) {
+            std::cout << "checkerboardThreads will be changed from " << checkerboardThreads
+                      << " to " << current.checkerboardThreads << std::endl;
+        }
+        checkerboardThreads = current.checkerboardThreads;
+    }
+}
+
 void ModelParamsDetSDW::check() {
     //check parameters: passed all that are necessary
     using namespace boost::assign;
@@ -77,6 +88,14 @@ void ModelParamsDetSDW::check() {
         }
     }    
     
+    if (udvMethod_string == "svd") {
+        udvMethod = UDV_SVD;
+    } else if (udvMethod_string == "qr") {
+        udvMethod = UDV_QR;
+    } else {
+        throw_ParameterWrong("udvMethod", udvMethod_string);
+    }
+
     std::string possibleSpinProposalMethods[] = {"box", "rotate_then_scale", "rotate_and_scale"};
     bool spinProposalMethod_is_one_of_the_possible = false;
     for (const std::string& test_spinProposalMethod: possibleSpinProposalMethods) {
@@ -95,6 +114,9 @@ void ModelParamsDetSDW::check() {
         throw_ParameterWrong_message("Either use combined wolffClusterShiftUpdate or individual global updates");
     }
 
+    if (checkerboardThreads == 0) {
+        throw_ParameterWrong("checkerboardThreads", checkerboardThreads);
+    }
     if (checkerboard and L % 2 != 0) {
         throw_ParameterWrong_message("Checker board decomposition only supported for even linear lattice sizes");
     }
@@ -200,6 +222,9 @@ MetadataMap ModelParamsDetSDW::prepareMetadataMap() const {
     meta["model"] = "sdw";
     meta["opdim"] = numToString(opdim);
     META_INSERT_TRUE_FALSE(checkerboard);
+    if (checkerboard) {
+        META_INSERT(checkerboardThreads);
+    }
     META_INSERT_TRUE_FALSE(phi2bosons);
     META_INSERT_TRUE_FALSE(phiFixed);
     META_INSERT_TRUE_FALSE(dumpGreensFunction);
@@ -214,6 +239,7 @@ MetadataMap ModelParamsDetSDW::prepareMetadataMap() const {
     if (updateMethod == DELAYED) {
         META_INSERT(delaySteps);
     }
+    meta["udvMethod"] = udvMethod_string;
     if (bc == PBC) {
         meta["bc"] = "pbc";
     } else if (bc == APBC_X) {
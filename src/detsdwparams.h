@@ -34,6 +34,7 @@ struct ModelParamsDetSDW {
     bool dumpGreensFunction;    // dump the various blocks of the Green's function in real space when measuring.  Defaults to false, use very sparingly!
     
     bool checkerboard;               //use a checkerboard decomposition for computing the propagator
+    uint32_t checkerboardThreads;    //number of OpenMP threads for the checkerboard B-matrix multiplications, default: 1
     std::string updateMethod_string; //"iterative", "woodbury", or "delayed"
     enum UpdateMethod_Type { ITERATIVE, WOODBURY, DELAYED };
     UpdateMethod_Type updateMethod;
@@ -42,6 +43,8 @@ struct ModelParamsDetSDW {
     SpinProposalMethod_Type spinProposalMethod;
     bool adaptScaleVariance;         //valid unless spinProposalMethod=="box" -- this controls if the variance of the spin updates should be adapted during thermalization
     uint32_t delaySteps;             //parameter in case updateMethod is "delayed"
+    std::string udvMethod_string;    //"svd" or "qr": decomposition used for numerical stabilization
+    UdVMethod udvMethod;
 
     bool overRelaxation;        // for no-fermion simulations:  additional non-ergodic, microcanonical over relaxation sweeps
     uint32_t repeatOverRelaxation;
@@ -94,10 +97,12 @@ struct ModelParamsDetSDW {
     ModelParamsDetSDW() :
         model("sdw"), turnoffFermions(false), turnoffFermionMeasurements(false),
         dumpGreensFunction(false),
-        checkerboard(),
+        checkerboard(), checkerboardThreads(1),
         updateMethod_string("woodbury"), updateMethod(WOODBURY),
         spinProposalMethod_string("box"), spinProposalMethod(BOX),
-        adaptScaleVariance(), delaySteps(), overRelaxation(false),
+        adaptScaleVariance(), delaySteps(),
+        udvMethod_string("svd"), udvMethod(UDV_SVD),
+        overRelaxation(false),
         repeatOverRelaxation(1), repeatOverRelaxation_string(""),
         opdim(3), phi2bosons(false), phiFixed(false), r(), c(1.0), u(1.0), lambda(),
         txhor(), txver(), tyhor(), tyver(), cdwU(), mu(), mux(0.), muy(0.), weakZflux(false), L(), N(), d(2),
@@ -110,6 +115,10 @@ struct ModelParamsDetSDW {
     void check();
     MetadataMap prepareMetadataMap() const;
 
+    //on resuming from a state file: take the runtime-only parameters
+    //[checkerboardThreads] from the current invocation
+    void takeRuntimeParameters(const ModelParamsDetSDW& current, bool verbose = true);
+
     void set_exchange_parameter_value(num val) {
         r = val;
         specified.insert("r");
@@ -120,14 +129,21 @@ private:
 
     template<class Archive>
         void serialize(Archive& ar, const uint32_t version) {
-        (void)version;
+        //version 1: udvMethod; version 2: checkerboardThreads.  Older
+        //state files keep the defaults for these
         ar  & model & turnoffFermions & turnoffFermionMeasurements
             & dumpGreensFunction
-            & checkerboard
-            & updateMethod_string & updateMethod
+            & checkerboard;
+        if (version >= 2) {
+            ar & checkerboardThreads;
+        }
+        ar  & updateMethod_string & updateMethod
             & spinProposalMethod_string & spinProposalMethod
-            & adaptScaleVariance & delaySteps
-            & overRelaxation
+            & adaptScaleVariance & delaySteps;
+        if (version >= 1) {
+            ar & udvMethod_string & udvMethod;
+        }
+        ar  & overRelaxation
             & repeatOverRelaxation & repeatOverRelaxation_string
             & opdim & phi2bosons & phiFixed & r & c & u & lambda
             & txhor & txver & tyhor & tyver
@@ -166,6 +182,7 @@ private:
     }
     
 };
+BOOST_CLASS_VERSION(ModelParamsDetSDW, 2)
 
 
 #endif /* DETSDWPARAMS_H */
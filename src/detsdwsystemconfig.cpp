@@ -60,6 +60,14 @@ void DetSDW_SystemConfig::write_to_disk(DetSDW_SystemConfig_FileHandle& file_han
                 throw_GeneralError("std::ofstream *file_handle.phi_output_binary is not ready");
             }
         }
+        if (file_handle.phi_output_indexed) {
+            if (*(file_handle.phi_output_indexed)) {
+                write_to_disk_phi_indexed(file_handle);
+                could_save_phi = true;
+            } else {
+                throw_GeneralError("ConfigStreamWriter *file_handle.phi_output_indexed is not ready");
+            }
+        }
         if (not could_save_phi) {
             throw_GeneralError("file_handle does not have a valid handle to save phi system configuration");
         }
@@ -89,6 +97,14 @@ void DetSDW_SystemConfig::write_to_disk(DetSDW_SystemConfig_FileHandle& file_han
                 throw_GeneralError("std::ofstream *file_handle.cdwl_output_binary is not ready");
             }
         }
+        if (file_handle.cdwl_output_indexed) {
+            if (*(file_handle.cdwl_output_indexed)) {
+                write_to_disk_cdwl_indexed(file_handle);
+                could_save_cdwl = true;
+            } else {
+                throw_GeneralError("ConfigStreamWriter *file_handle.cdwl_output_indexed is not ready");
+            }
+        }
         if (not could_save_cdwl) {
             throw_GeneralError("file_handle does not have a valid handle to save cdwl system configuration");
         }
@@ -147,6 +163,39 @@ void DetSDW_SystemConfig::write_to_disk_cdwl_binary(DetSDW_SystemConfig_FileHand
 }
 
 
+// the indexed stream stores the same element order as the binary stream,
+// but writes each record in one piece
+
+void DetSDW_SystemConfig::write_to_disk_phi_indexed(DetSDW_SystemConfig_FileHandle& file_handle) const {
+    std::vector<double> record;
+    record.reserve(L*L*m*opdim);
+    for (uint32_t ix = 0; ix < L; ++ix) {
+        for (uint32_t iy = 0; iy < L; ++iy) {
+            uint32_t i = iy*L + ix;
+            for (uint32_t k = 1; k <= m; ++k) {
+                for (uint32_t dim = 0; dim < opdim; ++dim) {
+                    record.push_back(phi(i, dim, k));
+                }
+            }
+        }
+    }
+    file_handle.phi_output_indexed->writeRecord(record.data());
+}
+
+void DetSDW_SystemConfig::write_to_disk_cdwl_indexed(DetSDW_SystemConfig_FileHandle& file_handle) const {
+    std::vector<int32_t> record;
+    record.reserve(L*L*m);
+    for (uint32_t ix = 0; ix < L; ++ix) {
+        for (uint32_t iy = 0; iy < L; ++iy) {
+            uint32_t i = iy*L + ix;
+            for (uint32_t k = 1; k <= m; ++k) {
+                record.push_back(cdwl(i, k));
+            }
+        }
+    }
+    file_handle.cdwl_output_indexed->writeRecord(record.data());
+}
+
 
 
 void serialize_systemConfig_to_buffer(std::string& buffer, const DetSDW_SystemConfig& systemConfig) {
@@ -47,6 +47,8 @@ private:
     void write_to_disk_cdwl_text(DetSDW_SystemConfig_FileHandle& file_handle) const;
     void write_to_disk_phi_binary(DetSDW_SystemConfig_FileHandle& file_handle) const;
     void write_to_disk_cdwl_binary(DetSDW_SystemConfig_FileHandle& file_handle) const;
+    void write_to_disk_phi_indexed(DetSDW_SystemConfig_FileHandle& file_handle) const;
+    void write_to_disk_cdwl_indexed(DetSDW_SystemConfig_FileHandle& file_handle) const;
 
 private:
     friend class boost::serialization::access;
@@ -12,6 +12,7 @@
 
 #include <memory>
 #include <fstream>
+#include "configstream.h"
 
 struct DetSDW_SystemConfig_FileHandle {
     typedef std::shared_ptr<std::ofstream> OfstreamPointer;
@@ -19,12 +20,17 @@ struct DetSDW_SystemConfig_FileHandle {
     OfstreamPointer cdwl_output_text; 
     OfstreamPointer phi_output_binary;
     OfstreamPointer cdwl_output_binary;
+    typedef std::shared_ptr<ConfigStreamWriter> ConfigStreamPointer;
+    ConfigStreamPointer phi_output_indexed;
+    ConfigStreamPointer cdwl_output_indexed;
 
     void flush() {
         if (phi_output_text) phi_output_text->flush();
         if (cdwl_output_text) cdwl_output_text->flush();        
         if (phi_output_binary) phi_output_binary->flush();
         if (cdwl_output_binary) cdwl_output_binary->flush();        
+        if (phi_output_indexed) phi_output_indexed->flush();
+        if (cdwl_output_indexed) cdwl_output_indexed->flush();
     }
 };
 
@@ -0,0 +1,162 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  See the enclosed file LICENSE for a copy or if
+ * that was not distributed with this file, You can obtain one at
+ * http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2017 Max H. Gerlach
+ *
+ * */
+
+/*
+ * latticefourier.h
+ *
+ * Lattice Fourier transforms for the k-space measurements of DetSDW.
+ *
+ * For an N x N matrix M(i,j) of real space sites i = x + L*y on an
+ * L x L lattice, compute
+ *
+ *     S(k) = sum_{i,j} exp(i k.(r_i - r_j)) M(i,j)
+ *
+ * on the momenta k = -pi + (n + offset) * 2pi/L, n = nx + L*ny.
+ *
+ * Splitting off the constant part of k, the sum over i is a 2D discrete
+ * Fourier transform of each column of M.  With FFTW (HAVE_FFTW3) these
+ * N transforms are done by one plan, which is created once in the
+ * constructor.  Without FFTW they are done as separable matrix
+ * products with a precomputed L x L phase matrix.  The remaining sum
+ * over j is only needed on the diagonal n = n', it is an elementwise
+ * product with a precomputed phase table.  In total this costs
+ * O(N^2 log N) [O(N^2 L) without FFTW] instead of O(N^3).
+ */
+
+#ifndef LATTICEFOURIER_H_
+#define LATTICEFOURIER_H_
+
+#include <complex>
+#include <cstdint>
+#include <cmath>
+#include <armadillo>
+#ifdef HAVE_FFTW3
+#include <fftw3.h>
+#endif
+
+
+class LatticeFourier {
+public:
+    typedef std::complex<double> cpx;
+    typedef arma::Col<cpx> VecCpx;
+    typedef arma::Mat<cpx> MatCpx;
+
+    LatticeFourier(uint32_t L_)
+        : L(L_), N(L_*L_), phase(L_, L_), phaseTable(N, N), work(N, N), modulation(N)
+#ifndef HAVE_FFTW3
+        , spare(N, N), columnTemp(L_, L_)
+#endif
+    {
+        // phase(n, x) = exp(2 pi i n x / L)
+        for (uint32_t n = 0; n < L; ++n) {
+            for (uint32_t x = 0; x < L; ++x) {
+                phase(n, x) = unitPhase(n * x);
+            }
+        }
+        // phaseTable(n, j) = exp(-2 pi i n.r_j / L)
+        for (uint32_t j = 0; j < N; ++j) {
+            uint32_t jx = j % L, jy = j / L;
+            for (uint32_t n = 0; n < N; ++n) {
+                uint32_t nx = n % L, ny = n / L;
+                phaseTable(n, j) = std::conj(unitPhase(nx * jx + ny * jy));
+            }
+        }
+#ifdef HAVE_FFTW3
+        // a 2D transform for each column of work, in place.  Sites are
+        // stored with x running fastest, that is row-major [y][x] for FFTW.
+        // FFTW_BACKWARD has the positive sign in the exponent.
+        int dims[2] = { int(L), int(L) };
+        fftw_complex* data = reinterpret_cast<fftw_complex*>(work.memptr());
+        plan = fftw_plan_many_dft(2, dims, int(N),
+                                  data, NULL, 1, int(N),
+                                  data, NULL, 1, int(N),
+                                  FFTW_BACKWARD, FFTW_MEASURE);
+#endif
+    }
+
+    ~LatticeFourier() {
+#ifdef HAVE_FFTW3
+        fftw_destroy_plan(plan);
+#endif
+    }
+
+    // out(n) = S(k_n) as defined above, in: N x N
+    template<typename Matrix>
+    void transform(VecCpx& out, const Matrix& in, double offset_x = 0, double offset_y = 0) {
+        // constant part of k: exp(i k0.r_i)
+        const double k0x = -M_PI + offset_x * 2*M_PI / double(L);
+        const double k0y = -M_PI + offset_y * 2*M_PI / double(L);
+        for (uint32_t i = 0; i < N; ++i) {
+            modulation[i] = std::exp(cpx(0, k0x * double(i % L) + k0y * double(i / L)));
+        }
+        // work(i, j) = exp(i k0.r_i) M(i,j) exp(-i k0.r_j)
+        for (uint32_t j = 0; j < N; ++j) {
+            const cpx modulation_j = std::conj(modulation[j]);
+            for (uint32_t i = 0; i < N; ++i) {
+                work(i, j) = modulation[i] * cpx(in(i, j)) * modulation_j;
+            }
+        }
+
+        // work(n, j) = sum_i exp(2 pi i n.r_i / L) work(i, j)
+#ifdef HAVE_FFTW3
+        fftw_execute(plan);
+#else
+        // transform along x: work viewed as an L x (L*N) matrix, the
+        // product goes to the spare buffer, which then becomes work
+        {
+            const MatCpx alongX(work.memptr(), L, L*N, false, true);
+            MatCpx alongXResult(spare.memptr(), L, L*N, false, true);
+            alongXResult = phase * alongX;
+        }
+        work.swap(spare);
+        // transform along y: each column viewed as an L x L matrix,
+        // multiplied by phase^T = phase from the right
+        for (uint32_t j = 0; j < N; ++j) {
+            MatCpx column(work.colptr(j), L, L, false, true);
+            columnTemp = column * phase;
+            column = columnTemp;
+        }
+#endif
+
+        // out(n) = sum_j work(n, j) exp(-2 pi i n.r_j / L)
+        out.zeros(N);
+        for (uint32_t j = 0; j < N; ++j) {
+            for (uint32_t n = 0; n < N; ++n) {
+                out[n] += work(n, j) * phaseTable(n, j);
+            }
+        }
+    }
+
+private:
+    const uint32_t L;
+    const uint32_t N;
+    MatCpx phase;           // L x L
+    MatCpx phaseTable;      // N x N
+    MatCpx work;            // N x N
+    VecCpx modulation;      // N
+#ifdef HAVE_FFTW3
+    fftw_plan plan;
+#else
+    MatCpx spare;           // N x N, swapped with work
+    MatCpx columnTemp;      // L x L
+#endif
+
+    // exp(2 pi i m / L)
+    cpx unitPhase(uint32_t m) const {
+        double arg = 2*M_PI * double(m % L) / double(L);
+        return cpx(std::cos(arg), std::sin(arg));
+    }
+
+    // plans and table sizes are fixed at construction
+    LatticeFourier(const LatticeFourier&);
+    LatticeFourier& operator=(const LatticeFourier&);
+};
+
+
+#endif /* LATTICEFOURIER_H_ */
@@ -0,0 +1,303 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  See the enclosed file LICENSE for a copy or if
+ * that was not distributed with this file, You can obtain one at
+ * http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2017 Max H. Gerlach
+ *
+ * */
+
+/*
+ * logvalkernels.h
+ *
+ * Batch operations on arrays of logarithms, as stored by LogVal.
+ *
+ * Adding up n LogVals one pair at a time costs n calls of exp() and
+ * n calls of log1p().  The sums below shift by the maximum instead,
+ *   ln sum_i e^{x_i} = x_max + ln sum_i e^{x_i - x_max},
+ * which costs n exponentials that are evaluated in batches and a
+ * single logarithm.
+ *
+ * lv_exp() uses AVX-512 or AVX2+FMA intrinsics if the compiler targets
+ * these instruction sets (e.g. with -march=native), with std::exp() as
+ * the fallback, for the remainder and for arguments outside the normal
+ * range of double results.  The vector version agrees with std::exp()
+ * to a few ulp.
+ *
+ * A LogVal only holds its logarithm, so an array of LogVals (a
+ * std::vector or boost::multi_array) is used directly as a contiguous
+ * array of doubles via lv_lnx().
+ */
+
+#ifndef LOGVALKERNELS_H_
+#define LOGVALKERNELS_H_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <vector>
+#include "logval.h"
+#if defined(__AVX512F__) || (defined(__AVX2__) && defined(__FMA__))
+#include <immintrin.h>
+#endif
+
+static_assert(sizeof(LogVal) == sizeof(double), "LogVal must only hold its logarithm");
+
+// the logarithms of an array of LogVals
+inline double* lv_lnx(LogVal* values) {
+    return &values->lnx;
+}
+inline const double* lv_lnx(const LogVal* values) {
+    return &values->lnx;
+}
+
+// false for +-inf and nan.  Tests the exponent bits, as std::isfinite() is
+// folded to true under -ffast-math [-ffinite-math-only], but the logarithm
+// of a LogVal zero is -inf.
+inline bool lv_isFinite(double x) {
+    uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    const uint64_t exponentMask = 0x7FF0000000000000ull;
+    return (bits & exponentMask) != exponentMask;
+}
+
+// number of values processed at once by the sums below (buffers on the stack)
+const std::size_t lv_ChunkSize = 256;
+
+
+// e^x = 2^n e^r with n = round(x / ln 2), |r| <= ln(2) / 2;
+// e^r by its Taylor series to order 13 (truncation error < 1e-17)
+const double lv_Log2e = 1.4426950408889634074;
+const double lv_Ln2Hi = 6.93147180369123816490e-01;    // ln 2 split for an exact n * ln2Hi
+const double lv_Ln2Lo = 1.90821492927058770002e-10;
+// arguments for which e^x is a normal double
+const double lv_ExpMinArg = -708.0;
+const double lv_ExpMaxArg = 709.0;
+// 1 / k!, for k = 13 down to 2
+const double lv_ExpCoeffs[] = {
+    1.6059043836821614599e-10, 2.0876756987868098979e-09, 2.5052108385441718775e-08,
+    2.7557319223985890653e-07, 2.7557319223985890653e-06, 2.4801587301587301587e-05,
+    1.9841269841269841270e-04, 1.3888888888888888889e-03, 8.3333333333333333333e-03,
+    4.1666666666666666667e-02, 1.6666666666666666667e-01, 5.0000000000000000000e-01
+};
+
+#if defined(__AVX512F__)
+
+typedef __m512d lv_simd_t;
+inline lv_simd_t lv_simd_load(const double* p) {
+    return _mm512_loadu_pd(p);
+}
+inline void lv_simd_store(double* p, lv_simd_t x) {
+    _mm512_storeu_pd(p, x);
+}
+inline lv_simd_t lv_simd_set1(double a) {
+    return _mm512_set1_pd(a);
+}
+inline lv_simd_t lv_simd_mul(lv_simd_t a, lv_simd_t x) {
+    return _mm512_mul_pd(a, x);
+}
+// acc + a * x
+inline lv_simd_t lv_simd_fmadd(lv_simd_t a, lv_simd_t x, lv_simd_t acc) {
+    return _mm512_fmadd_pd(a, x, acc);
+}
+// acc - a * x
+inline lv_simd_t lv_simd_fnmadd(lv_simd_t a, lv_simd_t x, lv_simd_t acc) {
+    return _mm512_fnmadd_pd(a, x, acc);
+}
+// the masked forms with a full mask avoid the _mm512_undefined_* passthrough
+// of the plain intrinsics, which trips -Wmaybe-uninitialized
+inline lv_simd_t lv_simd_round(lv_simd_t x) {
+    return _mm512_mask_roundscale_pd(x, 0xFF, x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+// all elements in [lo, hi] (false for nan)
+inline bool lv_simd_allInRange(lv_simd_t x, lv_simd_t lo, lv_simd_t hi) {
+    return _mm512_cmp_pd_mask(x, lo, _CMP_GE_OQ) == 0xFF and
+           _mm512_cmp_pd_mask(x, hi, _CMP_LE_OQ) == 0xFF;
+}
+// p * 2^n, for integral n such that the result is normal
+inline lv_simd_t lv_simd_scale2(lv_simd_t p, lv_simd_t n) {
+    // n + 1.5 * 2^52 holds n in the lowest mantissa bits
+    const __m512i bits = _mm512_castpd_si512(_mm512_add_pd(n, _mm512_set1_pd(6755399441055744.0)));
+    return _mm512_castsi512_pd(_mm512_add_epi64(_mm512_castpd_si512(p),
+                                                _mm512_mask_slli_epi64(bits, 0xFF, bits, 52)));
+}
+#define LV_HAVE_SIMD
+
+#elif defined(__AVX2__) && defined(__FMA__)
+
+typedef __m256d lv_simd_t;
+inline lv_simd_t lv_simd_load(const double* p) {
+    return _mm256_loadu_pd(p);
+}
+inline void lv_simd_store(double* p, lv_simd_t x) {
+    _mm256_storeu_pd(p, x);
+}
+inline lv_simd_t lv_simd_set1(double a) {
+    return _mm256_set1_pd(a);
+}
+inline lv_simd_t lv_simd_mul(lv_simd_t a, lv_simd_t x) {
+    return _mm256_mul_pd(a, x);
+}
+// acc + a * x
+inline lv_simd_t lv_simd_fmadd(lv_simd_t a, lv_simd_t x, lv_simd_t acc) {
+    return _mm256_fmadd_pd(a, x, acc);
+}
+// acc - a * x
+inline lv_simd_t lv_simd_fnmadd(lv_simd_t a, lv_simd_t x, lv_simd_t acc) {
+    return _mm256_fnmadd_pd(a, x, acc);
+}
+inline lv_simd_t lv_simd_round(lv_simd_t x) {
+    return _mm256_round_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+// all elements in [lo, hi] (false for nan)
+inline bool lv_simd_allInRange(lv_simd_t x, lv_simd_t lo, lv_simd_t hi) {
+    const lv_simd_t inRange = _mm256_and_pd(_mm256_cmp_pd(x, lo, _CMP_GE_OQ),
+                                            _mm256_cmp_pd(x, hi, _CMP_LE_OQ));
+    return _mm256_movemask_pd(inRange) == 0xF;
+}
+// p * 2^n, for integral n such that the result is normal
+inline lv_simd_t lv_simd_scale2(lv_simd_t p, lv_simd_t n) {
+    // n + 1.5 * 2^52 holds n in the lowest mantissa bits
+    const __m256i bits = _mm256_castpd_si256(_mm256_add_pd(n, _mm256_set1_pd(6755399441055744.0)));
+    return _mm256_castsi256_pd(_mm256_add_epi64(_mm256_castpd_si256(p),
+                                                _mm256_slli_epi64(bits, 52)));
+}
+#define LV_HAVE_SIMD
+
+#endif
+
+
+// y[i] = e^{x[i]} for i < n, y may be x
+inline void lv_exp(double* y, const double* x, std::size_t n) {
+    std::size_t i = 0;
+#ifdef LV_HAVE_SIMD
+    const std::size_t step = sizeof(lv_simd_t) / sizeof(double);
+    const lv_simd_t lo = lv_simd_set1(lv_ExpMinArg);
+    const lv_simd_t hi = lv_simd_set1(lv_ExpMaxArg);
+    const lv_simd_t log2e = lv_simd_set1(lv_Log2e);
+    const lv_simd_t ln2Hi = lv_simd_set1(lv_Ln2Hi);
+    const lv_simd_t ln2Lo = lv_simd_set1(lv_Ln2Lo);
+    const lv_simd_t one = lv_simd_set1(1.0);
+    for (; i + step <= n; i += step) {
+        const lv_simd_t xv = lv_simd_load(x + i);
+        if (not lv_simd_allInRange(xv, lo, hi)) {
+            for (std::size_t j = i; j < i + step; ++j) {
+                y[j] = std::exp(x[j]);
+            }
+            continue;
+        }
+        const lv_simd_t nv = lv_simd_round(lv_simd_mul(xv, log2e));
+        const lv_simd_t r = lv_simd_fnmadd(nv, ln2Lo, lv_simd_fnmadd(nv, ln2Hi, xv));
+        lv_simd_t p = lv_simd_set1(lv_ExpCoeffs[0]);
+        for (std::size_t c = 1; c < sizeof(lv_ExpCoeffs) / sizeof(double); ++c) {
+            p = lv_simd_fmadd(p, r, lv_simd_set1(lv_ExpCoeffs[c]));
+        }
+        p = lv_simd_fmadd(p, r, one);       // 1 + r + r^2/2 + ...
+        p = lv_simd_fmadd(p, r, one);
+        lv_simd_store(y + i, lv_simd_scale2(p, nv));
+    }
+#endif
+    for (; i < n; ++i) {
+        y[i] = std::exp(x[i]);
+    }
+}
+
+
+// sum_i e^{a[i] + c u[i] - shift}; u may be 0, then c is ignored
+inline double lv_sumExpShifted(const double* a, const double* u, double c,
+                               double shift, std::size_t n) {
+    double buffer[lv_ChunkSize];
+    double sum = 0;
+    for (std::size_t begin = 0; begin < n; begin += lv_ChunkSize) {
+        const std::size_t len = std::min(lv_ChunkSize, n - begin);
+        if (u) {
+            for (std::size_t i = 0; i < len; ++i) {
+                buffer[i] = a[begin + i] + c * u[begin + i] - shift;
+            }
+        } else {
+            for (std::size_t i = 0; i < len; ++i) {
+                buffer[i] = a[begin + i] - shift;
+            }
+        }
+        lv_exp(buffer, buffer, len);
+        for (std::size_t i = 0; i < len; ++i) {
+            sum += buffer[i];
+        }
+    }
+    return sum;
+}
+
+// ln sum_i e^{a[i] + c u[i]}, -inf for n == 0
+inline double lv_logSumExp(const double* a, const double* u, double c, std::size_t n) {
+    double max = -std::numeric_limits<double>::infinity();
+    for (std::size_t i = 0; i < n; ++i) {
+        max = std::max(max, a[i] + c * u[i]);
+    }
+    if (not lv_isFinite(max)) {
+        return max;
+    }
+    return max + std::log(lv_sumExpShifted(a, u, c, max, n));
+}
+
+// ln sum_i e^{x[i]}, -inf for n == 0
+inline double lv_logSumExp(const double* x, std::size_t n) {
+    double max = -std::numeric_limits<double>::infinity();
+    for (std::size_t i = 0; i < n; ++i) {
+        max = std::max(max, x[i]);
+    }
+    if (not lv_isFinite(max)) {
+        return max;
+    }
+    return max + std::log(lv_sumExpShifted(x, 0, 0, max, n));
+}
+
+// column sums of a row-major matrix x with `rows` rows of `cols` values
+// each, and a distance ld between subsequent rows; row r is divided by
+// e^{rowShift[r]}:
+//   result[j] = ln sum_r e^{x[r*ld + j] - rowShift[r]}
+inline void lv_logSumExpColumns(double* result, const double* x, std::size_t rows,
+                                std::size_t cols, std::size_t ld, const double* rowShift) {
+    double max[lv_ChunkSize];
+    double sum[lv_ChunkSize];
+    double buffer[lv_ChunkSize];
+    for (std::size_t begin = 0; begin < cols; begin += lv_ChunkSize) {
+        const std::size_t len = std::min(lv_ChunkSize, cols - begin);
+        std::fill(max, max + len, -std::numeric_limits<double>::infinity());
+        for (std::size_t r = 0; r < rows; ++r) {
+            const double* row = x + r * ld + begin;
+            for (std::size_t j = 0; j < len; ++j) {
+                max[j] = std::max(max[j], row[j] - rowShift[r]);
+            }
+        }
+        std::fill(sum, sum + len, 0.0);
+        for (std::size_t r = 0; r < rows; ++r) {
+            const double* row = x + r * ld + begin;
+            for (std::size_t j = 0; j < len; ++j) {
+                // all-(-inf) columns: keep the difference finite, their sum stays 0
+                buffer[j] = row[j] - rowShift[r] - (lv_isFinite(max[j]) ? max[j] : 0.0);
+            }
+            lv_exp(buffer, buffer, len);
+            for (std::size_t j = 0; j < len; ++j) {
+                sum[j] += buffer[j];
+            }
+        }
+        for (std::size_t j = 0; j < len; ++j) {
+            result[begin + j] = lv_isFinite(max[j]) ? max[j] + std::log(sum[j]) : max[j];
+        }
+    }
+}
+
+
+// sum of LogVals, the batch version of logSum() in logval.h
+inline LogVal logSumExp(const LogVal* values, std::size_t n) {
+    return toLogValExp(lv_logSumExp(lv_lnx(values), n));
+}
+inline LogVal logSumExp(const std::vector<LogVal>& values) {
+    return logSumExp(values.data(), values.size());
+}
+
+
+#endif /* LOGVALKERNELS_H_ */
@@ -58,6 +58,8 @@ std::tuple<bool,bool,ModelParams<DetHubbard>,DetQMCParams> configureSimulation(i
     modelOptions.add_options()
         ("model", po::value<string>(&modelpar.model)->default_value("hubbard"), "only the Hubbard model is supported")
         ("checkerboard", po::value<bool>(&modelpar.checkerboard)->default_value(false), "use a checkerboard decomposition to compute the propagator for the SDW model")
+        ("timedisplaced", po::value<bool>(&modelpar.timedisplaced)->default_value(false), "measure time-displaced observables (q=0 susceptibility, Fourier transformed Green's function for d=2), this takes an extra pass over all timeslices after each sweep")
+        ("greenComponentThreads", po::value<uint32_t>(&modelpar.greenComponentThreads)->default_value(1), "number of OpenMP threads used to propagate and stabilize the spin up and spin down Green's functions concurrently; 2 gives one thread per spin direction")
         ("t", po::value<num>(&modelpar.t), "Hubbard: hopping energy scale")
         ("U", po::value<num>(&modelpar.U), "Hubbard-U: potential energy scale")
         ("mu", po::value<num>(&modelpar.mu)->default_value(0.5), "chemical potential")
@@ -68,6 +70,7 @@ std::tuple<bool,bool,ModelParams<DetHubbard>,DetQMCParams> configureSimulation(i
         ("dtau", po::value<num>(&modelpar.dtau), "imaginary time discretization step size (beta = m*dtau). Pass either this or m. If dtau is specified, m is chosen to be compatible with s and beta. In turn the value of dtau actually used in the simulation may be smaller than this.")
         ("m", po::value<uint32_t>(&modelpar.m), "number of imaginary time discretization levels (beta = m*dtau). Pass either this or dtau.")
         ("s", po::value<uint32_t>(&modelpar.s)->default_value(1), "separation of timeslices where the Green-function is calculated from scratch with stabilized updates.")
+        ("udvMethod", po::value<std::string>(&modelpar.udvMethod_string)->default_value("svd"), "decomposition used for the numerically stabilized computation of the Green's function: svd or qr (QR decomposition with column pivoting, faster)")
         ;
 
     po::options_description mcOptions("Parameters for Monte Carlo simulation, specify via command line or config file");
@@ -164,18 +167,13 @@ int main(int argc, char **argv) {
     bool resumeSimulation;
     std::tie(runSimulation, resumeSimulation, parmodel, parmc) = configureSimulation(argc, argv);
 
-    // if (parmodel.timedisplaced) {
-    // 	std::cerr << "timedisplaced routines not implemented currently \n";
-    // 	return 1;
-    // }
-
     timing.start("total");
     if (runSimulation) {
         if (not resumeSimulation) {
             DetQMC<DetHubbard> simulation(parmodel, parmc);
             simulation.run();
         } else if (resumeSimulation) {
-            DetQMC<DetHubbard> simulation(parmc.stateFileName, parmc);
+            DetQMC<DetHubbard> simulation(parmc.stateFileName, parmc, parmodel);
             //only very select parameters given in parmc are updated for the resumed simulation
             simulation.run();
         }
@@ -96,10 +96,12 @@ std::tuple<bool,bool,DetModelLoggingParams,ModelParamsDetSDW,DetQMCParams> confi
         ("turnoffFermionMeasurements", po::value<bool>(&modelpar.turnoffFermionMeasurements)->default_value(false), "normally false. If turnoffFermions is true, but this is false, we simulate a model with fermions, but don't compute observables from the Green's function.")
         ("opdim", po::value<uint32_t>(&modelpar.opdim)->default_value(default_opdim), "Dimension of the antiferromagneic order parameter.  O(1), O(2) and O(3) models are supported.  If specified explicitly, must agree with the template instantiations included in the compiled executable")
         ("checkerboard", po::value<bool>(&modelpar.checkerboard)->default_value(false), "use a checkerboard decomposition to compute the propagator for the SDW model")
+        ("checkerboardThreads", po::value<uint32_t>(&modelpar.checkerboardThreads)->default_value(1), "number of OpenMP threads used for the checkerboard multiplications with B-matrices, which are split into panels of rows or columns")
         ("spinProposalMethod", po::value<std::string>(&modelpar.spinProposalMethod_string)->default_value("box"), "SDW model: method how new field values are proposed for local values: box, rotate_then_scale, or rotate_and_scale")
         ("adaptScaleVariance", po::value<bool>(&modelpar.adaptScaleVariance)->default_value(true), "valid unless spinProposalMethod=='box' -- this controls if the variance of the spin updates should be adapted during thermalization")
         ("updateMethod", po::value<std::string>(&modelpar.updateMethod_string)->default_value("iterative"), "How to do the local updates: iterative, woodbury or delayed")
         ("delaySteps", po::value<uint32_t>(&modelpar.delaySteps)->default_value(16), "parameter to use with delayedUpdates")
+        ("udvMethod", po::value<std::string>(&modelpar.udvMethod_string)->default_value("svd"), "decomposition used for the numerically stabilized computation of the Green's function: svd or qr (QR decomposition with column pivoting, faster)")
         ("overRelaxation", po::value<bool>(&modelpar.overRelaxation)->default_value(false), "for no-fermion simulations:  additional non-ergodic, microcanonical over relaxation moves")
         ("repeatOverRelaxation", po::value<std::string>(&modelpar.repeatOverRelaxation_string)->default_value("1"), "how many overRelaxationSweeps to carry out in a row during a single sweep if they are turned on; only if the fermions are turned off.  Pass \"systemSize\" to use a number growing with system size: N * m <-- this is way too much, though.  Other options:  \"systemL\", \"systemm\", \"sqrtSystemLm\".  Default: 1")
         ("phi2bosons", po::value<bool>(&modelpar.phi2bosons)->default_value(false), "if this is true: run calculations with a simple theory (r/2)\\sum_i \\phi_i^2 -- ignores parameter u and spatial terms in the bosonic action")
@@ -153,6 +155,7 @@ std::tuple<bool,bool,DetModelLoggingParams,ModelParamsDetSDW,DetQMCParams> confi
         ("thermalization", po::value<uint32_t>(&mcpar.thermalization), "number of warm-up sweeps, must be even for serialization consistency")
         ("jkBlocks", po::value<uint32_t>(&mcpar.jkBlocks)->default_value(1), "number of jackknife blocks for error estimation")
         ("timeseries", po::value<bool>(&mcpar.timeseries)->default_value(false), "if specified, write time series of individual measurements to disk")
+        ("timeseriesFormat", po::value<std::string>(&mcpar.timeseriesFormat_string)->default_value("text"), "format of the time series files *.series: text or binary [columnar float64, smaller and faster to load, read transparently by the evaluation tools]")
         ("measureInterval", po::value<uint32_t>(&mcpar.measureInterval)->default_value(1), "take measurements every [arg] sweeps")
         ("saveInterval", po::value<uint32_t>(&mcpar.saveInterval), "write measurements to disk every [arg] sweeps; default: only at end of simulation, must be even for serialization consistency")
         ("saveConfigurationStreamInterval", po::value<uint32_t>(&mcpar.saveConfigurationStreamInterval), "interval in sweeps where full system configurations are buffered and saved to disk.  Must be an integer multiple of measureInterval.  This is only effective if one of the boolean flags for saving configurations is set to true.  Default value: measureInterval")
@@ -163,6 +166,10 @@ std::tuple<bool,bool,DetModelLoggingParams,ModelParamsDetSDW,DetQMCParams> confi
          "when measuring, also save raw system configurations to disk, in text format")
         ("saveConfigurationStreamBinary", po::value<bool>(&mcpar.saveConfigurationStreamBinary)->default_value(false),
          "when measuring, also save raw system configurations to disk, in binary format")
+        ("saveConfigurationStreamIndexed", po::value<bool>(&mcpar.saveConfigurationStreamIndexed)->default_value(false),
+         "when measuring, also save raw system configurations to disk, in an indexed binary container with a self-describing header that can be memory-mapped (*.configstream)")
+        ("asyncOutputQueue", po::value<uint32_t>(&mcpar.asyncOutputQueue)->default_value(0),
+         "if > 0, write configuration streams, time series and state files on a background thread, the simulation only blocks if more than [arg] write operations are pending.  0: write synchronously")
         ;
 
     po::variables_map vm;
@@ -270,7 +277,7 @@ int main(int argc, char **argv) {
                                 break;                                  \
                             }
 #define RESUME_CASE(cb, opdim) case opdim: {                            \
-                                   DetQMC<DetSDW<cb, opdim>, ModelParamsDetSDW> simulation(parmc.stateFileName, parmc); \
+                                   DetQMC<DetSDW<cb, opdim>, ModelParamsDetSDW> simulation(parmc.stateFileName, parmc, parmodel); \
                                    simulation.run();                    \
                                    break;                               \
                                }
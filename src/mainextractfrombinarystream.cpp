@@ -23,6 +23,12 @@
 //    extracted-configs-phi.infoheader
 //    extracted-configs-phi.binarystream
 //
+// if instead an indexed stream is found in the working directory:
+//    configs-phi.configstream  ... phi configurations with header
+// output:
+//    extracted-configs-phi.infoheader
+//    extracted-configs-phi.configstream
+//
 // commandline parameters
 //    -d M   ...  M: number of samples to discard at beginning
 //    -s N   ...  then take only every N'th sample
@@ -33,6 +39,7 @@
 #pragma GCC diagnostic ignored "-Wshadow"
 #include "boost/program_options.hpp"
 #pragma GCC diagnostic pop
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -40,6 +47,7 @@
 #include "metadata.h"
 #include "git-revision.h"
 #include "tools.h"
+#include "configstream.h"
 
 // returns number of samples written to output file
 uint32_t extract(const std::string& input_data_file,
@@ -87,6 +95,35 @@ uint32_t extract(const std::string& input_data_file,
     return extracted_counter;    
 }
 
+// indexed stream: jump directly to the selected records in the
+// memory mapped input, returns number of samples written to output file
+uint32_t extract_indexed(const std::string& input_data_file,
+                         const std::string& output_data_file,
+                         uint32_t discard, uint32_t subsample_interval) {
+    ConfigStreamReader input(input_data_file);
+    const ConfigStreamHeader& h = input.getHeader();
+    if (h.dtype != ConfigStreamHeader::DTypeFloat64) {
+        throw_GeneralError(input_data_file + " does not contain double precision samples");
+    }
+
+    // start a fresh output file
+    std::remove(output_data_file.c_str());
+    ConfigStreamWriter output(output_data_file, ConfigStreamHeader::DTypeFloat64,
+                              h.L, h.m, h.opdim);
+    if (not output) {
+        throw_GeneralError("Could not open file " + output_data_file + " for writing");
+    }
+
+    uint32_t extracted_counter = 0;
+    for (uint64_t r = discard; r < input.getRecordCount(); r += subsample_interval) {
+        output.writeRecord(input.recordFloat64(r));
+        ++extracted_counter;
+    }
+    output.flush();
+
+    return extracted_counter;
+}
+
 // return size of sample in units of doubles
 uint32_t get_size_of_one_sample(const MetadataMap& meta) {
     uint32_t N = fromString<uint32_t>(meta.at("N"));
@@ -134,10 +171,12 @@ int main(int argc, char *argv[]) {
                   << " input expected in working directory: \n"
                   << "    configs-phi.infoheader    ... metadata about this timeseries \n"
                   << "    configs-phi.binarystream  ... phi configurations in binary doubles \n"
+                  << " or: \n"
+                  << "    configs-phi.configstream  ... indexed phi configurations with header \n"
                   << " \n"
                   << " output written into working directory: \n"
                   << "    extracted-configs-phi.infoheader \n"
-                  << "    extracted-configs-phi.binarystream \n"
+                  << "    extracted-configs-phi.binarystream [or .configstream] \n"
                   << " \n"
                   << extractOptions << std::endl;
         return 0;
@@ -148,6 +187,30 @@ int main(int argc, char *argv[]) {
                   << std::endl;
         return 0;
     }
+
+    if (subsample_interval == 0) {
+        std::cerr << "subsample interval must be positive\n";
+        return 1;
+    }
+
+    if (isConfigStreamFile("configs-phi.configstream")) {
+        // the indexed stream carries its own header
+        MetadataMap meta;
+        {
+            ConfigStreamReader input("configs-phi.configstream");
+            const ConfigStreamHeader& h = input.getHeader();
+            meta["L"] = numToString(h.L);
+            meta["N"] = numToString(h.L * h.L);
+            meta["m"] = numToString(h.m);
+            meta["opdim"] = numToString(h.opdim);
+        }
+        uint32_t extracted_samples = extract_indexed("configs-phi.configstream",
+                                                     "extracted-configs-phi.configstream",
+                                                     discard, subsample_interval);
+        write_info("extracted-configs-phi.infoheader", meta,
+                   discard, subsample_interval, extracted_samples);
+        return 0;
+    }
     
     // read meta information about configuration time series
     MetadataMap meta = readOnlyMetadata("configs-phi.infoheader");
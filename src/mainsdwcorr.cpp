@@ -33,6 +33,7 @@
 #include "git-revision.h"
 #include "statistics.h"
 #include "tools.h"
+#include "configstream.h"
 
 
 typedef double num;
@@ -93,6 +94,33 @@ uint32_t get_size_of_one_sample(const ConfigParameters& conf_params) {
 }
 
 
+// store one sample, as laid out in the configuration stream files, in phi_target
+void storeSystemConfiguration(PhiConfig& phi_target, const double* one_sample,
+                              const ConfigParameters& conf_params) {
+    phi_target.set_size(conf_params.N,     // rows ... sites
+                        conf_params.opdim, // cols ... op dim
+                        conf_params.m + 1  // slcs ... time slices
+        );
+    uint32_t n = 0;
+    for (uint32_t ix = 0; ix < conf_params.L; ++ix) {
+        for (uint32_t iy = 0; iy < conf_params.L; ++iy) {
+            uint32_t i = iy*conf_params.L + ix;
+            for (uint32_t k = 1; k <= conf_params.m; ++k) {
+                for (uint32_t dim = 0; dim < conf_params.opdim; ++dim) {
+                    phi_target(i, dim, k) = one_sample[n];
+                    ++n;
+                }
+            }
+        }
+    }
+    // in the files on disk we stored time slices 1 ... m,
+    // for our calculations here it is easier to consider time slices,
+    // 0 ... m-1, where, due to periodic boundary conditions, slice m ==
+    // slice 0
+    phi_target.slice(0) = phi_target.slice(conf_params.m);
+    phi_target.shed_slice(conf_params.m);
+}
+
 // returns false on failure
 bool readSystemConfiguration(PhiConfig& phi_target, std::ifstream& binary_float_input,
                              const ConfigParameters& conf_params) {
@@ -104,35 +132,30 @@ bool readSystemConfiguration(PhiConfig& phi_target, std::ifstream& binary_float_
         binary_float_input.read(reinterpret_cast<char*>(&(*one_sample.begin())), sizeof(double) * sample_size);
         if (binary_float_input) {
             // no failure: store configuration
-            phi_target.set_size(conf_params.N,     // rows ... sites
-                                conf_params.opdim, // cols ... op dim
-                                conf_params.m + 1  // slcs ... time slices
-                );
-            uint32_t n = 0;
-            for (uint32_t ix = 0; ix < conf_params.L; ++ix) {
-                for (uint32_t iy = 0; iy < conf_params.L; ++iy) {
-                    uint32_t i = iy*conf_params.L + ix;
-                    for (uint32_t k = 1; k <= conf_params.m; ++k) {
-                        for (uint32_t dim = 0; dim < conf_params.opdim; ++dim) {
-                            phi_target(i, dim, k) = one_sample[n];
-                            ++n;
-                        }
-                    }
-                }
-            }
-            // in the files on disk we stored time slices 1 ... m,
-            // for our calculations here it is easier to consider time slices,
-            // 0 ... m-1, where, due to periodic boundary conditions, slice m ==
-            // slice 0
-            phi_target.slice(0) = phi_target.slice(conf_params.m);
-            phi_target.shed_slice(conf_params.m);
-            
+            storeSystemConfiguration(phi_target, one_sample.data(), conf_params);
             return_success  = true;
         }
     }
     return return_success;
 }
 
+// random access to sample r of an indexed configuration stream, read
+// directly from the memory mapped file
+void readSystemConfiguration(PhiConfig& phi_target, const ConfigStreamReader& input,
+                             uint64_t r, const ConfigParameters& conf_params) {
+    storeSystemConfiguration(phi_target, input.recordFloat64(r), conf_params);
+}
+
+// throw if the header of an indexed configuration stream does not match
+void checkConfigStreamHeader(const ConfigStreamReader& input, const std::string& filename,
+                             const ConfigParameters& conf_params) {
+    const ConfigStreamHeader& h = input.getHeader();
+    if (h.L != conf_params.L or h.m != conf_params.m or h.opdim != conf_params.opdim
+        or h.recordElements() != get_size_of_one_sample(conf_params)) {
+        throw_GeneralError("configuration parameters in " + filename + " do not agree with info.dat");
+    }
+}
+
 
 // compute delta_x = x2 - x1 on a periodic ring of length ring_length,
 // -L/2 < delta_x <= +L/2
@@ -650,20 +673,27 @@ ConfigParameters get_conf_params_for_directories(const std::vector< std::string
     return params;
 }
 
-//return path to configs-phi.binarystream or extracted-configs-phi.binarystream
-//if more appropriate
+//return path to configs-phi.configstream, configs-phi.binarystream,
+//extracted-configs-phi.binarystream or extracted-configs-phi.configstream,
+//in this order of preference
 boost::filesystem::path get_input_file_path(const std::string& input_directory) {
     namespace fs = boost::filesystem;
     fs::path p_result;
+    fs::path p_0 = fs::path(input_directory) / "configs-phi.configstream";
     fs::path p_1 = fs::path(input_directory) / "configs-phi.binarystream";
     fs::path p_2 = fs::path(input_directory) / "extracted-configs-phi.binarystream";
-    if (fs::exists(p_1)) {
+    fs::path p_3 = fs::path(input_directory) / "extracted-configs-phi.configstream";
+    if (fs::exists(p_0)) {
+        p_result = p_0;
+    } else if (fs::exists(p_1)) {
         p_result = p_1;
+    } else if (fs::exists(p_2)) {
+        p_result = p_2;
     } else {
-        if (not fs::exists(p_2)) {
+        if (not fs::exists(p_3)) {
             throw_GeneralError("No binary configuration stream file found");
         }
-        p_result = p_2;
+        p_result = p_3;
     }
     return p_result;
 }
@@ -676,6 +706,12 @@ std::vector<uintmax_t> get_sample_counts_for_directories(const std::vector< std:
     uintmax_t sample_size = get_size_of_one_sample(params);
     for (const auto& d : input_directories) {
         std::string f = get_input_file_path(d).string();
+        if (isConfigStreamFile(f)) {
+            ConfigStreamReader input(f);
+            checkConfigStreamHeader(input, f, params);
+            sample_counts.push_back(input.getRecordCount());
+            continue;
+        }
         uintmax_t file_size = get_file_size(f);
         if (file_size % (sample_size * sizeof(double)) != 0) {
             throw_GeneralError("unexpected binarystream file size");
@@ -740,8 +776,38 @@ void process(const std::vector< std::string >& input_directories,
             continue;
         }
         
+        auto accumulate_sample = [&]() {
+            computeCorrelations_fft(cur_corr_ft, cur_config,
+                                    params, fft);
+            if (jkblocks > 1) {
+                uintmax_t cur_block = effective_sample_counter / jkblock_size;
+                for (uint32_t jb = 0; jb < jkblocks; ++jb) {
+                    if (jb != cur_block) {
+                        jkblock_corr_ft[jb] += cur_corr_ft;
+                    }
+                }
+            } else {
+                jkblock_corr_ft[0] += cur_corr_ft;
+            }
+            ++effective_sample_counter;
+        };
+
         std::string d = input_directories[i];
         std::string f = get_input_file_path(d).string();
+        if (isConfigStreamFile(f)) {
+            // indexed stream: skip the discarded configurations without reading them
+            ConfigStreamReader input(f);
+            checkConfigStreamHeader(input, f, params);
+            for (uint64_t r = discard; r < input.getRecordCount(); ++r) {
+                if (effective_sample_counter > total_sample_count_jk) {
+                    // too many samples, skip the remaining
+                    break;
+                }
+                readSystemConfiguration(cur_config, input, r, params);
+                accumulate_sample();
+            }
+            continue;
+        }
         std::ifstream binary_float_input(f.c_str(),
                                          std::ios::in | std::ios::binary);
         if (not binary_float_input) {
@@ -758,20 +824,7 @@ void process(const std::vector< std::string >& input_directories,
                 // discard some initial configurations
                 continue;
             } else {
-                computeCorrelations_fft(cur_corr_ft, cur_config,
-                                        params, fft);
-                if (jkblocks > 1) {
-                    uintmax_t cur_block = effective_sample_counter / jkblock_size;
-                    for (uint32_t jb = 0; jb < jkblocks; ++jb) {
-                        if (jb != cur_block) {
-                            jkblock_corr_ft[jb] += cur_corr_ft;
-                        }
-                    }
-                } else {
-                    jkblock_corr_ft[0] += cur_corr_ft;
-                }
-
-                ++effective_sample_counter;
+                accumulate_sample();
             }
         }
     }
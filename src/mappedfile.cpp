@@ -0,0 +1,56 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  See the enclosed file LICENSE for a copy or if
+ * that was not distributed with this file, You can obtain one at
+ * http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2017 Max H. Gerlach
+ *
+ * */
+
+/*
+ * mappedfile.cpp
+ */
+
+#include <cstring>
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "mappedfile.h"
+#include "exceptions.h"
+
+MappedFile::MappedFile(const std::string& filename, bool sequential)
+    : mapped(0), mappedSize(0)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw_ReadError(filename);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw_ReadError(filename);
+    }
+    mappedSize = std::size_t(st.st_size);
+    if (mappedSize == 0) {
+        close(fd);
+        return;
+    }
+    void* p = mmap(0, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);                  // the mapping stays valid
+    if (p == MAP_FAILED) {
+        mappedSize = 0;
+        throw_GeneralError("Could not mmap " + filename + ": " + strerror(errno));
+    }
+    mapped = static_cast<const char*>(p);
+    if (sequential) {
+        madvise(p, mappedSize, MADV_SEQUENTIAL);
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (mapped) {
+        munmap(const_cast<char*>(mapped), mappedSize);
+    }
+}
@@ -0,0 +1,41 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  See the enclosed file LICENSE for a copy or if
+ * that was not distributed with this file, You can obtain one at
+ * http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2017 Max H. Gerlach
+ *
+ * */
+
+/*
+ * mappedfile.h
+ *
+ * Read-only view of a whole file mapped into memory with POSIX mmap.
+ * An empty file is not mapped, then data() is 0 and size() is 0.
+ */
+
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+
+#include <cstddef>
+#include <string>
+
+class MappedFile {
+public:
+    // sequential: hint to the kernel that the file is read front to back
+    explicit MappedFile(const std::string& filename, bool sequential = true);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return mapped; }
+    std::size_t size() const { return mappedSize; }
+    const char* begin() const { return mapped; }
+    const char* end() const { return mapped + mappedSize; }
+private:
+    const char* mapped;
+    std::size_t mappedSize;
+};
+
+
+#endif /* MAPPEDFILE_H_ */
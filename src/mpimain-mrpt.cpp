@@ -0,0 +1,36 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  See the enclosed file LICENSE for a copy or if
+ * that was not distributed with this file, You can obtain one at
+ * http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2017 Max H. Gerlach
+ * 
+ * */
+
+#if defined (MAX_DEBUG) && ! defined(DUMA_NO_DUMA)
+#include "dumapp.h"
+#endif
+
+/*
+ * mpimain-mrpt.cpp
+ *
+ * Same command line as mrpt, but the replica time series and the
+ * jackknife blocks are distributed over the MPI processes.  Only
+ * process 0 writes output files.
+ */
+
+#include <memory>
+#include "boost/mpi.hpp"
+#include "mrpt-highlevel.h"
+#include "mpimrpt-distribution.h"
+
+namespace mpi = boost::mpi;
+
+int main(int argc, char **argv) {
+    mpi::environment env(argc, argv);
+
+    setDistribution(std::shared_ptr<MrptDistribution>(new MrptDistributionMPI));
+    initFromCommandLine(argc, argv);
+
+    return 0;
+}
@@ -0,0 +1,66 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  See the enclosed file LICENSE for a copy or if
+ * that was not distributed with this file, You can obtain one at
+ * http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2017 Max H. Gerlach
+ *
+ * */
+
+/*
+ * mpimrpt-distribution.cpp
+ */
+
+#include <algorithm>
+#include <climits>
+#include "mpimrpt-distribution.h"
+
+namespace mpi = boost::mpi;
+
+//in place MPI_Allreduce, split into pieces whose element count fits into an int
+template<typename T>
+static void allreduceSumInPlace(const mpi::communicator& comm, T* data, std::size_t count,
+                                MPI_Datatype datatype) {
+    const std::size_t maxChunk = INT_MAX;
+    for (std::size_t offset = 0; offset < count; offset += maxChunk) {
+        int chunk = int(std::min(maxChunk, count - offset));
+        MPI_Allreduce(MPI_IN_PLACE, data + offset, chunk, datatype, MPI_SUM, MPI_Comm(comm));
+    }
+}
+
+//in place MPI_Reduce to process root, split like allreduceSumInPlace
+template<typename T>
+static void reduceSumInPlace(const mpi::communicator& comm, unsigned root, T* data, std::size_t count,
+                             MPI_Datatype datatype) {
+    const std::size_t maxChunk = INT_MAX;
+    const bool isRoot = (unsigned(comm.rank()) == root);
+    for (std::size_t offset = 0; offset < count; offset += maxChunk) {
+        int chunk = int(std::min(maxChunk, count - offset));
+        if (isRoot) {
+            MPI_Reduce(MPI_IN_PLACE, data + offset, chunk, datatype, MPI_SUM, int(root), MPI_Comm(comm));
+        } else {
+            MPI_Reduce(data + offset, 0, chunk, datatype, MPI_SUM, int(root), MPI_Comm(comm));
+        }
+    }
+}
+
+MrptDistributionMPI::MrptDistributionMPI()
+    : world(), rank(unsigned(world.rank())), size(unsigned(world.size()))
+{ }
+
+void MrptDistributionMPI::sum(double* data, std::size_t count) {
+    allreduceSumInPlace(world, data, count, MPI_DOUBLE);
+}
+
+void MrptDistributionMPI::sum(int* data, std::size_t count) {
+    allreduceSumInPlace(world, data, count, MPI_INT);
+}
+
+void MrptDistributionMPI::sumOnProcess(unsigned p, int* data, std::size_t count) {
+    reduceSumInPlace(world, p, data, count, MPI_INT);
+}
+
+void MrptDistributionMPI::minMax(double& min, double& max) {
+    min = mpi::all_reduce(world, min, mpi::minimum<double>());
+    max = mpi::all_reduce(world, max, mpi::maximum<double>());
+}
@@ -0,0 +1,42 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  See the enclosed file LICENSE for a copy or if
+ * that was not distributed with this file, You can obtain one at
+ * http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2017 Max H. Gerlach
+ *
+ * */
+
+/*
+ * mpimrpt-distribution.h
+ *
+ * Multiple histogram reweighting distributed over the processes of
+ * MPI_COMM_WORLD.  All processes must take part in the same sequence
+ * of reweighting calls, the reductions are collective.
+ */
+
+#ifndef MPIMRPT_DISTRIBUTION_H_
+#define MPIMRPT_DISTRIBUTION_H_
+
+#include "boost/mpi.hpp"
+#include "mrpt-distribution.h"
+
+class MrptDistributionMPI : public MrptDistribution {
+public:
+    MrptDistributionMPI();
+
+    virtual unsigned processIndex() const { return rank; }
+    virtual unsigned numProcesses() const { return size; }
+
+    virtual void sum(double* data, std::size_t count);
+    virtual void sum(int* data, std::size_t count);
+    virtual void sumOnProcess(unsigned p, int* data, std::size_t count);
+    virtual void minMax(double& min, double& max);
+private:
+    boost::mpi::communicator world;
+    unsigned rank;
+    unsigned size;
+};
+
+
+#endif /* MPIMRPT_DISTRIBUTION_H_ */
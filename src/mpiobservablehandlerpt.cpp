@@ -22,13 +22,13 @@ namespace mpi = boost::mpi;
 
 ScalarObservableHandlerPT::ScalarObservableHandlerPT(
         const ScalarObservable& localObservable,
-        const std::vector<int>& current_process_par,
+        const std::vector<int>& current_replica_par,
         const DetQMCParams& simulationParameters,
         const DetQMCPTParams& ptParams,
         const MetadataMap& metadataToStoreModel,
         const MetadataMap& metadataToStoreMC,
         const MetadataMap& metadataToStorePT)
-    : ObservableHandlerPTCommon<double>(localObservable, current_process_par,
+    : ObservableHandlerPTCommon<double>(localObservable, current_replica_par,
                                         simulationParameters, ptParams,
                                         metadataToStoreModel, metadataToStoreMC,
                                         metadataToStorePT),
@@ -38,12 +38,12 @@ ScalarObservableHandlerPT::ScalarObservableHandlerPT(
 {
     if (processIndex == 0) {
         //by default one empty vector for each control parameter value
-        //(as many as there are processes)
-        par_timeseriesBuffer.resize(numProcesses, std::vector<double>());
+        //(as many as there are replicas)
+        par_timeseriesBuffer.resize(numReplicas, std::vector<double>());
         //initialize to a vector of something like a nullptr
-        par_storage.resize(numProcesses);
+        par_storage.resize(numReplicas);
         //boolean false stored as char
-        par_storageFileStarted.resize(numProcesses, false);
+        par_storageFileStarted.resize(numReplicas, false);
     }
 }
 
@@ -52,9 +52,9 @@ ScalarObservableHandlerPT::ScalarObservableHandlerPT(
 void ScalarObservableHandlerPT::handleValues(uint32_t curSweep) {
     if (processIndex == 0) {
         if (mcparams.timeseries) {
-            for (int p_i = 0; p_i < numProcesses; ++p_i) {
-                int controlParameterIndex = process_par[p_i];
-                par_timeseriesBuffer[controlParameterIndex].push_back(process_cur_value[p_i]);
+            for (int r_i = 0; r_i < numReplicas; ++r_i) {
+                int controlParameterIndex = replica_par[r_i];
+                par_timeseriesBuffer[controlParameterIndex].push_back(replica_cur_value[r_i]);
             }
 
         }
@@ -63,8 +63,8 @@ void ScalarObservableHandlerPT::handleValues(uint32_t curSweep) {
 }
 
 void ScalarObservableHandlerPT::insertValue(uint32_t curSweep) {
-    //MPI: gather the value of localObs from each replica in the
-    //buffer at the root process: process_cur_value
+    //MPI: gather the values of localObs from each replica in the
+    //buffer at the root process: replica_cur_value
     
     // MPI_Gather( const_cast<double*>(&(localObs.valRef.get())), // sendbuf :
     //             // pass memory address of what localObs references | need to cast away const for mpi < 3.0
@@ -76,15 +76,34 @@ void ScalarObservableHandlerPT::insertValue(uint32_t curSweep) {
     //             0,                        // root
     //             MPI_COMM_WORLD            // comm
     //     );
+    std::vector<double> localValues(localReplicas);
+    for (int lri = 0; lri < localReplicas; ++lri) {
+        localValues[lri] = localObs[lri].valRef.get(); // what localObs references
+    }
     mpi::communicator world;
-    mpi::gather(world,
-                localObs.valRef.get(), // send: what localObs references
-                process_cur_value,     // recv
-                0);
+    if (processIndex == 0) {
+        mpi::gather(world,
+                    localValues.data(),       // send
+                    localReplicas,            // sendcount
+                    replica_cur_value.data(), // recv
+                    0);
+    } else {
+        mpi::gather(world, localValues.data(), localReplicas, 0);
+    }
                 
     this->handleValues(curSweep);
 }
 
+void ScalarObservableHandlerPT::insertPackedValues(uint32_t curSweep, const double* gathered,
+                                                   uint32_t replicaStride) {
+    if (processIndex == 0) {
+        for (int r_i = 0; r_i < numReplicas; ++r_i) {
+            replica_cur_value[r_i] = gathered[r_i * replicaStride];
+        }
+    }
+    this->handleValues(curSweep);
+}
+
 
 
 std::tuple<double, double> ScalarObservableHandlerPT::evaluateJackknife(
@@ -105,79 +124,94 @@ std::tuple<double, double> ScalarObservableHandlerPT::evaluateJackknife(
 }
 
 
-void ScalarObservableHandlerPT::outputTimeseries() {
+void ScalarObservableHandlerPT::outputTimeseries(AsyncWriter& writer) {
     //TODO: float precision
     if (processIndex == 0 and mcparams.timeseries) {
-        for (int p_i = 0; p_i < numProcesses; ++p_i) {
-            int cpi = process_par[p_i];
+        for (int r_i = 0; r_i < numReplicas; ++r_i) {
+            int cpi = replica_par[r_i];
 
             std::string subdirectory = "p" + numToString(cpi) + "_" +
                 ptparams.controlParameterName +
                 numToString(ptparams.controlParameterValues[cpi]);
-            fs::create_directories(fs::path(subdirectory));            
-        
-            if (not par_storage[cpi]) {
-                std::string filename = (fs::path(subdirectory) / fs::path(name + ".series")).string();
-                if (not par_storageFileStarted[cpi]) {
-                    par_storage[cpi] =
-                        std::unique_ptr<DoubleVectorWriterSuccessive>(
+
+            //no need to keep the last batch of measurements in memory anymore
+            std::shared_ptr<std::vector<double>> batch(new std::vector<double>);
+            batch->swap(par_timeseriesBuffer[cpi]);
+            bool startFile = not par_storageFileStarted[cpi];
+            par_storageFileStarted[cpi] = true;
+            MetadataMap metaModel_cpi = par_metaModel[cpi];
+            MetadataMap metaPT_ = metaPT;
+            SeriesFormat format = (mcparams.timeseriesFormat == DetQMCParams::TimeseriesFormatBinary)
+                ? SeriesFormatBinary : SeriesFormatText;
+
+            writer.submit([this, cpi, subdirectory, batch, startFile, metaModel_cpi, metaPT_, format]() {
+                fs::create_directories(fs::path(subdirectory));
+                if (not par_storage[cpi]) {
+                    std::string filename = (fs::path(subdirectory) / fs::path(name + ".series")).string();
+                    if (startFile) {
+                        par_storage[cpi] =
+                            std::unique_ptr<DoubleVectorWriterSuccessive>(
+                                new DoubleVectorWriterSuccessive(filename,
+                                                                 false, // create a new file
+                                                                 format
+                                    ));
+                        par_storage[cpi]->setColumnName(name);
+                        par_storage[cpi]->addHeaderText("Timeseries for observable " + name);
+                        par_storage[cpi]->addMetadataMap(metaModel_cpi);
+                        par_storage[cpi]->addMetadataMap(metaMC);
+                        par_storage[cpi]->addMetadataMap(metaPT_);
+                        par_storage[cpi]->addMeta("observable", name);
+                        par_storage[cpi]->writeHeader();
+                    } else {
+                        par_storage[cpi] = std::unique_ptr<DoubleVectorWriterSuccessive>(
                             new DoubleVectorWriterSuccessive(filename,
-                                                             false // create a new file
+                                                             true, // append to file
+                                                             format
                                 ));
-                    par_storage[cpi]->addHeaderText("Timeseries for observable " + name);
-                    par_storage[cpi]->addMetadataMap(par_metaModel[cpi]);
-                    par_storage[cpi]->addMetadataMap(metaMC);
-                    par_storage[cpi]->addMetadataMap(metaPT);
-                    par_storage[cpi]->addMeta("observable", name);
-                    par_storage[cpi]->writeHeader();
-                    par_storageFileStarted[cpi] = true;
-                } else {
-                    par_storage[cpi] = std::unique_ptr<DoubleVectorWriterSuccessive>(
-                        new DoubleVectorWriterSuccessive(filename,
-                                                         true// append to file
-                            ));
+                    }
                 }
-            }
-            //append last batch of measurements
-            par_storage[cpi]->writeData(par_timeseriesBuffer[cpi]);
-            //no need to keep it in memory anymore
-            par_timeseriesBuffer[cpi].resize(0);
+                //append last batch of measurements
+                par_storage[cpi]->writeData(*batch);
+            });
         }
     }
 }
 
 
 VectorObservableHandlerPT::VectorObservableHandlerPT(const VectorObservable& localObservable,
-                                                     const std::vector<int>& current_process_par,
+                                                     const std::vector<int>& current_replica_par,
                                                      const DetQMCParams& simulationParameters,
                                                      const DetQMCPTParams& ptParams,
                                                      const MetadataMap& metadataToStoreModel,
                                                      const MetadataMap& metadataToStoreMC,
                                                      const MetadataMap& metadataToStorePT)
 : ObservableHandlerPTCommon<arma::Col<double>>(
-    localObservable, current_process_par,
+    localObservable, current_replica_par,
     simulationParameters, ptParams,
     metadataToStoreModel, metadataToStoreMC,
     metadataToStorePT,
     arma::zeros<arma::Col<double>>(localObservable.vectorSize)),
     vsize(localObservable.vectorSize), indexes(vsize), indexName("site"),
-    mpi_gather_buffer()
+    mpi_gather_buffer(), mpi_send_buffer()
 {
     for (uint32_t counter = 0; counter < vsize; ++counter) {
         indexes[counter] = counter;
     }
     if (processIndex == 0) {
-        mpi_gather_buffer.resize(numProcesses * vsize, 0.0);
+        mpi_gather_buffer.resize(numReplicas * vsize, 0.0);
     } else {
         mpi_gather_buffer.resize(1, 0.0);
     }
+    mpi_send_buffer.resize(localReplicas * vsize, 0.0);
 }
 
 void VectorObservableHandlerPT::insertValue(uint32_t curSweep) {
     mpi::communicator world;
-    //MPI: gather the value of localObs from each replica in the
-    //buffer at the root process: process_cur_value
-    assert(vsize == localObs.valRef.get().n_elem);
+    //MPI: gather the values of localObs from each replica in the
+    //buffer at the root process: replica_cur_value
+    for (int lri = 0; lri < localReplicas; ++lri) {
+        packValue(lri, mpi_send_buffer.data() + lri * vsize);
+    }
     // MPI_Gather( const_cast<double*>(localObs.valRef.get().memptr()),  // sendbuf
     //             // pass arma vector data behind localObs reference,
     //             // need to cast away const for MPI < 3.0
@@ -190,8 +224,8 @@ void VectorObservableHandlerPT::insertValue(uint32_t curSweep) {
     //             MPI_COMM_WORLD                   // comm
     //     );
     mpi::gather(world,
-                localObs.valRef.get().memptr(), // send: pass arma vector data behind localObs reference
-                vsize,                          // sendcount
+                mpi_send_buffer.data(),         // send: copied arma vector data behind localObs references
+                localReplicas * vsize,          // sendcount
                 mpi_gather_buffer,              // recv
                 0                               // root
         );
@@ -200,11 +234,11 @@ void VectorObservableHandlerPT::insertValue(uint32_t curSweep) {
     // for the Armadillo vectors used for the individual replica measurements
     // at the root process
     if (processIndex == 0) {
-        assert(mpi_gather_buffer.size() == numProcesses * vsize);
-        for (int p_i = 0; p_i < numProcesses; ++p_i) {
-            assert(process_cur_value[p_i].n_elem == vsize);
-            process_cur_value[p_i] = arma::Col<double>(
-                mpi_gather_buffer.data() + p_i * vsize, // aux_mem*  [typed pointer: we do not need a sizeof(double) factor]
+        assert(mpi_gather_buffer.size() == numReplicas * vsize);
+        for (int r_i = 0; r_i < numReplicas; ++r_i) {
+            assert(replica_cur_value[r_i].n_elem == vsize);
+            replica_cur_value[r_i] = arma::Col<double>(
+                mpi_gather_buffer.data() + r_i * vsize, // aux_mem*  [typed pointer: we do not need a sizeof(double) factor]
                 vsize,          // number_of_elements
                 false,          // copy_aux_mem [will continue to use the mpi_gather_buffer memory]
                 true            // strict [vector will remain bound to this memory for its lifetime]
@@ -215,25 +249,101 @@ void VectorObservableHandlerPT::insertValue(uint32_t curSweep) {
     this->handleValues(curSweep);
 }
 
+void VectorObservableHandlerPT::insertPackedValues(uint32_t curSweep, const double* gathered,
+                                                   uint32_t replicaStride) {
+    if (processIndex == 0) {
+        for (int r_i = 0; r_i < numReplicas; ++r_i) {
+            assert(replica_cur_value[r_i].n_elem == vsize);
+            // copy into the existing vector memory [which may be bound to
+            // mpi_gather_buffer if insertValue() has been used before]
+            const double* src = gathered + r_i * replicaStride;
+            std::copy(src, src + vsize, replica_cur_value[r_i].memptr());
+        }
+    }
+    this->handleValues(curSweep);
+}
+
+
+
+void PackedObservableGathererPT::insertValues(
+    uint32_t curSweep, int localReplicas,
+    const std::vector<std::unique_ptr<ScalarObservableHandlerPT>>& obsHandlers,
+    const std::vector<std::unique_ptr<VectorObservableHandlerPT>>& vecObsHandlers) {
+    uint32_t packedSize = 0;
+    for (const auto& ph : obsHandlers) {
+        packedSize += ph->getPackedSize();
+    }
+    for (const auto& ph : vecObsHandlers) {
+        packedSize += ph->getPackedSize();
+    }
+    if (packedSize == 0) {
+        return;
+    }
+
+    //pack for each local replica: scalar observables first, then
+    //vector observables
+    sendBuffer.resize(localReplicas * packedSize);
+    uint32_t offset = 0;
+    for (int lri = 0; lri < localReplicas; ++lri) {
+        for (const auto& ph : obsHandlers) {
+            ph->packValue(lri, sendBuffer.data() + offset);
+            offset += ph->getPackedSize();
+        }
+        for (const auto& ph : vecObsHandlers) {
+            ph->packValue(lri, sendBuffer.data() + offset);
+            offset += ph->getPackedSize();
+        }
+    }
+    assert(offset == localReplicas * packedSize);
+
+    //one MPI_Gather of plain doubles, no serialization involved
+    //[mpi::gather does not resize the receive buffer]
+    mpi::communicator world;
+    if (world.rank() == 0) {
+        recvBuffer.resize(world.size() * localReplicas * packedSize);
+    } else {
+        recvBuffer.resize(1, 0.0);
+    }
+    mpi::gather(world,
+                sendBuffer.data(),      // send
+                int(localReplicas * packedSize), // sendcount
+                recvBuffer,             // recv
+                0                       // root
+        );
+
+    //unpack into the handlers, the values of each handler are found
+    //at the same offset within each replica's part of recvBuffer
+    const double* gathered = recvBuffer.data();
+    offset = 0;
+    for (const auto& ph : obsHandlers) {
+        ph->insertPackedValues(curSweep, gathered + offset, packedSize);
+        offset += ph->getPackedSize();
+    }
+    for (const auto& ph : vecObsHandlers) {
+        ph->insertPackedValues(curSweep, gathered + offset, packedSize);
+        offset += ph->getPackedSize();
+    }
+}
+
 
 
 
-void outputResults(const std::vector<std::unique_ptr<ScalarObservableHandlerPT>>& obsHandlers) {
+void outputResults(const std::vector<std::unique_ptr<ScalarObservableHandlerPT>>& obsHandlers,
+                   AsyncWriter& writer) {
     boost::mpi::communicator world;
     int processIndex = world.rank();
-    int numProcesses = world.size();
     if (processIndex == 0 and obsHandlers.size() > 0) {
         typedef std::map<std::string, num> StringNumMap;
         typedef std::shared_ptr<StringNumMap> StringNumMapPtr;
 
-        for (int cpi = 0; cpi < numProcesses; ++cpi) {
+        int numReplicas = (*obsHandlers.begin())->numReplicas;
+        for (int cpi = 0; cpi < numReplicas; ++cpi) {
             StringNumMapPtr values(new StringNumMap);
             StringNumMapPtr errors(new StringNumMap);
 
             std::string subdirectory = "p" + numToString(cpi) + "_" +
                 (*obsHandlers.begin())->ptparams.controlParameterName +
                 numToString((*obsHandlers.begin())->ptparams.controlParameterValues[cpi]);
-            fs::create_directories(fs::path(subdirectory));            
 
             for (auto p = obsHandlers.cbegin(); p != obsHandlers.cend(); ++p) {
                 num val, err;
@@ -242,30 +352,34 @@ void outputResults(const std::vector<std::unique_ptr<ScalarObservableHandlerPT>>
                 (*values)[obsname] = val;
                 (*errors)[obsname] = err;
             }
-            DataMapWriter<std::string, num> output;
-            output.setData(values);
-            output.setErrors(errors);
-            output.addHeaderText("Monte Carlo results for observable expectation values");
-            output.addMetadataMap((*obsHandlers.begin())->par_metaModel[cpi]);
-            output.addMetadataMap((*obsHandlers.begin())->metaMC);
-            output.addMetadataMap((*obsHandlers.begin())->metaPT);            
-            output.addMeta("key", "observable");
-            output.addHeaderText("observable\t value \t error");
-            output.writeToFile((fs::path(subdirectory) / fs::path("results.values")).string());
+            std::shared_ptr<DataMapWriter<std::string, num>> output(new DataMapWriter<std::string, num>);
+            output->setData(values);
+            output->setErrors(errors);
+            output->addHeaderText("Monte Carlo results for observable expectation values");
+            output->addMetadataMap((*obsHandlers.begin())->par_metaModel[cpi]);
+            output->addMetadataMap((*obsHandlers.begin())->metaMC);
+            output->addMetadataMap((*obsHandlers.begin())->metaPT);            
+            output->addMeta("key", "observable");
+            output->addHeaderText("observable\t value \t error");
+            writer.submit([output, subdirectory]() {
+                fs::create_directories(fs::path(subdirectory));
+                output->writeToFile((fs::path(subdirectory) / fs::path("results.values")).string());
+            });
         }
     }
 }
 
-void outputResults(const std::vector<std::unique_ptr<VectorObservableHandlerPT>>& obsHandlers) {
+void outputResults(const std::vector<std::unique_ptr<VectorObservableHandlerPT>>& obsHandlers,
+                   AsyncWriter& writer) {
     boost::mpi::communicator world;
     int processIndex = world.rank();
-    int numProcesses = world.size();
     if (processIndex == 0 and obsHandlers.size() > 0) {    
         typedef std::map<num, num> NumMap;
         typedef std::shared_ptr<NumMap> NumMapPtr;
         typedef DataMapWriter<num,num> NumMapWriter;
         
-        for (int cpi = 0; cpi < numProcesses; ++cpi) {
+        int numReplicas = (*obsHandlers.begin())->numReplicas;
+        for (int cpi = 0; cpi < numReplicas; ++cpi) {
             std::string subdirectory = "p" + numToString(cpi) + "_" +
                 (*obsHandlers.begin())->ptparams.controlParameterName +
                 numToString((*obsHandlers.begin())->ptparams.controlParameterValues[cpi]);
@@ -282,18 +396,19 @@ void outputResults(const std::vector<std::unique_ptr<VectorObservableHandlerPT>>
                     valmap->insert(std::make_pair(index, values[counter]));
                     errmap->insert(std::make_pair(index, errors[counter]));
                 }
-                NumMapWriter output;
-                output.setData(valmap);
-                output.setErrors(errmap);
-                output.addHeaderText("Monte Carlo results for vector observable " + obsptr->name +
-                                     " expectation values");
-                output.addMetadataMap(obsptr->par_metaModel[cpi]);
-                output.addMetadataMap(obsptr->metaMC);
-                output.addMetadataMap(obsptr->metaPT);                
-                output.addMeta("key", obsptr->indexName);
-                output.addMeta("observable", obsptr->name);
-                output.addHeaderText("key\t value \t error");
-                output.writeToFile(subdirectory + "/results-" + obsptr->name + ".values");
+                std::shared_ptr<NumMapWriter> output(new NumMapWriter);
+                output->setData(valmap);
+                output->setErrors(errmap);
+                output->addHeaderText("Monte Carlo results for vector observable " + obsptr->name +
+                                      " expectation values");
+                output->addMetadataMap(obsptr->par_metaModel[cpi]);
+                output->addMetadataMap(obsptr->metaMC);
+                output->addMetadataMap(obsptr->metaPT);                
+                output->addMeta("key", obsptr->indexName);
+                output->addMeta("observable", obsptr->name);
+                output->addHeaderText("key\t value \t error");
+                std::string filename = subdirectory + "/results-" + obsptr->name + ".values";
+                writer.submit([output, filename]() { output->writeToFile(filename); });
             }
         }
     }
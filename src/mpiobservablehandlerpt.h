@@ -13,7 +13,12 @@
 // manage measurements of an observable, gather measurement values
 // from various replicas, calculate expectation values and jackknife
 // error bars; optionally store time series
+//
+// Each process may host several replicas [ptParams.replicasPerProcess],
+// the replica with local index lri at process p has the global
+// replica index p * replicasPerProcess + lri.
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <map>
@@ -28,6 +33,7 @@
 #include "dataserieswritersucc.h"
 #include "datamapwriter.h"
 #include "statistics.h"
+#include "asyncwriter.h"
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
@@ -45,7 +51,7 @@ class ObservableHandlerPTCommon {
 public:
     ObservableHandlerPTCommon(
         const Observable<ObsType>& localObservable,
-        const std::vector<int>& current_process_par,
+        const std::vector<int>& current_replica_par,
         const DetQMCParams& simulationParameters,
         const DetQMCPTParams& ptParams,
         const MetadataMap& metadataToStoreModel,
@@ -53,6 +59,10 @@ public:
         const MetadataMap& metadataToStorePT,
         ObsType zeroValue = ObsType());
     virtual ~ObservableHandlerPTCommon() { }
+    // with several replicas per process: the constructor takes the
+    // observable of the first local replica, add the same observable
+    // of the other local replicas in order with this
+    void addLocalReplicaObservable(const Observable<ObsType>& localObservable);
     //To be called from rank 0:
     //return [mean value, error] at end of simulation
     //if jkBlockCount <= 1, only estimate an error (using variance()) if the whole
@@ -61,15 +71,20 @@ public:
     //return [mean value, 0] if this is called earlier.
     //return [0, 0] if this is called from rank != 0.
     std::tuple<ObsType,ObsType> evaluateJackknife(int control_parameter_index) const;    
+
+    // the control parameter values have been changed [adaptive placement
+    // during thermalization, before any measurements]
+    void updateControlParameters(const DetQMCPTParams& ptParams,
+                                 const MetadataMap& metadataToStorePT);
 protected:
     // this is to be called at rank0 by method insertValue() of a
     // derived class
     void handleValues(uint32_t curSweep);
 
-    Observable<ObsType> localObs; // Handle containing the last measured value for
-                                  // the observable, at the local replica    
+    std::vector<Observable<ObsType>> localObs; // Handles containing the last measured value for
+                                               // the observable, for each local replica
     
-    const std::string& name;    //reference to name in obs
+    std::string name;           //name of the observable
     ObsType zero;               //an instance of ObsType that works like the number zero
                                 //for addition -- this is not totally trivial for vector
                                 //valued observables
@@ -88,22 +103,25 @@ protected:
     //MPI specifics
     int numProcesses;      //total number of parallel processes
     int processIndex;      //MPI-rank of the current process
+    int numReplicas;       //total number of replicas [= number of control parameter values]
+    int localReplicas;     //number of replicas at each process
     
     // root process specifics:
     // -----------------------
-    // This is indexed by process number, and contains the control
-    // parameter value currently associated to each process. It is a reference
+    // This is indexed by global replica index, and contains the control
+    // parameter value currently associated to each replica. It is a reference
     // to the vector held and kept uptodate by DetQMCPT. It is only sensible
     // at the root process.
-    const std::vector<int>& process_par;
+    const std::vector<int>& replica_par;
     //This is the receive buffer of most recently measured observable
-    //values for each replica, ordered by process.  The method
+    //values for each replica, ordered by global replica index.  The method
     //insertValue() of the derived classes below fill this, then
     //call handleValues() defined above in this base class.
-    std::vector<ObsType> process_cur_value;
+    std::vector<ObsType> replica_cur_value;
     // These vectors contain one entry per control parameter value,
     // they are indexed by the control parameter index.
-    std::vector<std::vector<ObsType>> par_jkBlockValues; // running counts of jackknife block values
+    std::vector<std::vector<ObsType>> par_jkBlockSums; // running sums of values in each jackknife block,
+                                                       // last entry: values after the last complete block
     std::vector<ObsType> par_total; // running accumulation regardless of jackknife block
     // for each control parameter value [sorted by index]: store a
     // separate MetadataMap with just that entry replaced
@@ -114,24 +132,47 @@ public:
     void serializeContents(Archive &ar) {
         ar & lastSweepLogged;
         ar & countValues;
-        ar & par_jkBlockValues;
-        ar & par_total;
+        if (Archive::is_loading::value and mcparams.stateVersion < 4) {
+            //older state file: leave-one-out sums for the jackknife blocks
+            std::vector<std::vector<ObsType>> par_jkLeaveOneOutSums;
+            ar & par_jkLeaveOneOutSums;
+            ar & par_total;
+            par_jkBlockSums.resize(par_jkLeaveOneOutSums.size());
+            for (std::size_t cpi = 0; cpi < par_jkLeaveOneOutSums.size(); ++cpi) {
+                checkJkBlockCount(par_jkLeaveOneOutSums[cpi].size(), jkBlockCount);
+                par_jkBlockSums[cpi] = jackknifeBlockSumsFromLeaveOneOutSums(
+                    par_jkLeaveOneOutSums[cpi], par_total.at(cpi), zero);
+            }
+        } else {
+            ar & par_jkBlockSums;
+            ar & par_total;
+            for (std::size_t cpi = 0; cpi < par_jkBlockSums.size(); ++cpi) {
+                checkJkBlockCount(par_jkBlockSums[cpi].size(), jkBlockCount + 1);
+            }
+        }
         // par_metaModel does not need to be serialized -- is reset
         // upon initialization
     }
+private:
+    void checkJkBlockCount(std::size_t loaded, std::size_t expected) const {
+        if (loaded != expected) {
+            throw_GeneralError("State file holds " + numToString(loaded) + " jackknife entries for observable "
+                               + name + ", expected " + numToString(expected));
+        }
+    }
 };
 
 template <typename ObsType>
 ObservableHandlerPTCommon<ObsType>::ObservableHandlerPTCommon(
     const Observable<ObsType>& localObservable,
-    const std::vector<int>& current_process_par,
+    const std::vector<int>& current_replica_par,
     const DetQMCParams& simulationParameters,
     const DetQMCPTParams& ptParams,
     const MetadataMap& metadataToStoreModel,
     const MetadataMap& metadataToStoreMC,
     const MetadataMap& metadataToStorePT,
     ObsType zeroValue)
-    : localObs(localObservable), name(localObs.name),
+    : localObs(1, localObservable), name(localObservable.name),
       zero(zeroValue),          //ObsType() may not be a valid choice!
       mcparams(simulationParameters),
       ptparams(ptParams),
@@ -144,22 +185,26 @@ ObservableHandlerPTCommon<ObsType>::ObservableHandlerPTCommon(
       countValues(0),
       numProcesses(1),
       processIndex(0),
-      process_par(current_process_par),
-      process_cur_value(),
-      par_jkBlockValues(),
+      numReplicas(1),
+      localReplicas(1),
+      replica_par(current_replica_par),
+      replica_cur_value(),
+      par_jkBlockSums(),
       par_total(),
       par_metaModel()
 {
     boost::mpi::communicator world;
     processIndex = world.rank();
     numProcesses = world.size();
-    assert(int(ptparams.controlParameterValues.size()) == numProcesses);
+    localReplicas = int(ptparams.replicasPerProcess);
+    numReplicas = numProcesses * localReplicas;
+    assert(int(ptparams.controlParameterValues.size()) == numReplicas);
     if (processIndex == 0) {
-        process_cur_value.resize(numProcesses, zero);
-        par_jkBlockValues.resize(numProcesses, std::vector<ObsType>(jkBlockCount, zero));
-        par_total.resize(numProcesses, zero);
-        par_metaModel.resize(numProcesses, metaModel);
-        for (int cpi = 0; cpi < numProcesses; ++cpi) {
+        replica_cur_value.resize(numReplicas, zero);
+        par_jkBlockSums.resize(numReplicas, std::vector<ObsType>(jkBlockCount + 1, zero));
+        par_total.resize(numReplicas, zero);
+        par_metaModel.resize(numReplicas, metaModel);
+        for (int cpi = 0; cpi < numReplicas; ++cpi) {
             par_metaModel[cpi][ptparams.controlParameterName] =
                 numToString(ptparams.controlParameterValues[cpi]);
         }
@@ -167,18 +212,35 @@ ObservableHandlerPTCommon<ObsType>::ObservableHandlerPTCommon(
 }
 
 
+template <typename ObsType>
+void ObservableHandlerPTCommon<ObsType>::addLocalReplicaObservable(
+    const Observable<ObsType>& localObservable) {
+    assert(localObservable.name == name);
+    assert(int(localObs.size()) < localReplicas);
+    localObs.push_back(localObservable);
+}
+
+template <typename ObsType>
+void ObservableHandlerPTCommon<ObsType>::updateControlParameters(
+    const DetQMCPTParams& ptParams, const MetadataMap& metadataToStorePT) {
+    ptparams = ptParams;
+    metaPT = metadataToStorePT;
+    if (processIndex == 0) {
+        for (int cpi = 0; cpi < numReplicas; ++cpi) {
+            par_metaModel[cpi][ptparams.controlParameterName] =
+                numToString(ptparams.controlParameterValues[cpi]);
+        }
+    }
+}
+
 template <typename ObsType>
 void ObservableHandlerPTCommon<ObsType>::handleValues(uint32_t curSweep) {
     if (processIndex == 0) {
-        uint32_t curJkBlock = curSweep / jkBlockSizeSweeps;
-        for (int p_i = 0; p_i < numProcesses; ++p_i) {
-            int controlParameterIndex = process_par[p_i];
-            for (uint32_t jb = 0; jb < jkBlockCount; ++jb) {
-                if (jb != curJkBlock) {
-                    par_jkBlockValues[controlParameterIndex][jb] += process_cur_value[p_i];
-                }
-            }
-            par_total[controlParameterIndex] += process_cur_value[p_i];
+        uint32_t curJkBlock = std::min(curSweep / jkBlockSizeSweeps, jkBlockCount);
+        for (int r_i = 0; r_i < numReplicas; ++r_i) {
+            int controlParameterIndex = replica_par[r_i];
+            par_jkBlockSums[controlParameterIndex][curJkBlock] += replica_cur_value[r_i];
+            par_total[controlParameterIndex] += replica_cur_value[r_i];
         }
     }
     ++countValues;
@@ -200,7 +262,7 @@ std::tuple<ObsType,ObsType> ObservableHandlerPTCommon<ObsType>::evaluateJackknif
                 uint32_t jkBlockSizeSamples = countValues / jkBlockCount;
                 uint32_t jkTotalSamples = countValues - jkBlockSizeSamples;
 //              std::cout << jkTotalSamples << std::endl;
-                std::vector<ObsType> jkBlockAverages = par_jkBlockValues[cpi];   //copy
+                std::vector<ObsType> jkBlockAverages = jackknifeLeaveOneOutSums(par_jkBlockSums[cpi], zero);
                 for (uint32_t jb = 0; jb < jkBlockCount; ++jb) {
                     jkBlockAverages[jb] /= jkTotalSamples;
                 }
@@ -224,7 +286,7 @@ std::tuple<ObsType,ObsType> ObservableHandlerPTCommon<ObsType>::evaluateJackknif
 class ScalarObservableHandlerPT : public ObservableHandlerPTCommon<double> {
 public:
     ScalarObservableHandlerPT(const ScalarObservable& localObservable,
-                              const std::vector<int>& current_process_par,
+                              const std::vector<int>& current_replica_par,
                               const DetQMCParams& simulationParameters,
                               const DetQMCPTParams& ptParams,
                               const MetadataMap& metadataToStoreModel,
@@ -233,22 +295,41 @@ public:
         );
 
     // Log newly measured observable value at each replica via the the
-    // reference contained in this->obs, pass the number of the
+    // references contained in this->localObs, pass the number of the
     // current sweep.  Measurements from all replicas are gathered at
     // the root process.  Measurements do not need to be stored at
     // every sweep, but the number of skipped sweeps must be constant.
     void insertValue(uint32_t curSweep);    
 
+    // Alternative to insertValue() used by PackedObservableGathererPT:
+    // number of doubles this observable contributes to the packed
+    // measurement buffer of a replica
+    uint32_t getPackedSize() const {
+        return 1;
+    }
+    // copy the measurement of local replica lri to dest
+    void packValue(int lri, double* dest) const {
+        *dest = localObs[lri].valRef.get();
+    }
+    // gathered: at the root process, the packed values of the
+    // replica with global index r_i start at gathered + r_i * replicaStride;
+    // not accessed at the other processes
+    void insertPackedValues(uint32_t curSweep, const double* gathered,
+                            uint32_t replicaStride);
+
     //If we don't have multiple jackknife blocks and the whole timeseries is stored
     //in memory, this can also give a naive variance estimate for the error
     std::tuple<double, double> evaluateJackknife(int control_parameter_index) const;
 
     //update timeseries files, discard batch of
-    //data written to files from memory
-    void outputTimeseries(); 
+    //data written to files from memory.
+    //The batches are handed over to writer, which also exclusively
+    //accesses par_storage.
+    void outputTimeseries(AsyncWriter& writer); 
 
     friend void outputResults(
-        const std::vector<std::unique_ptr<ScalarObservableHandlerPT>>& obsHandlers);
+        const std::vector<std::unique_ptr<ScalarObservableHandlerPT>>& obsHandlers,
+        AsyncWriter& writer);
 protected:
     //in addition to base class functionality supports adding to the timeseries buffers
     void handleValues(uint32_t curSweep);
@@ -281,7 +362,7 @@ public:
 class VectorObservableHandlerPT : public ObservableHandlerPTCommon<arma::Col<double>> {
 public:
     VectorObservableHandlerPT(const VectorObservable& localObservable,
-                              const std::vector<int>& current_process_par,
+                              const std::vector<int>& current_replica_par,
                               const DetQMCParams& simulationParameters,
                               const DetQMCPTParams& ptParams,
                               const MetadataMap& metadataToStoreModel,
@@ -291,8 +372,19 @@ public:
     uint32_t getVectorSize() {
         return vsize;
     }
+    //compare to ScalarObservableHandlerPT functions
+    uint32_t getPackedSize() const {
+        return vsize;
+    }
+    void packValue(int lri, double* dest) const {
+        assert(vsize == localObs[lri].valRef.get().n_elem);
+        std::copy(localObs[lri].valRef.get().begin(), localObs[lri].valRef.get().end(), dest);
+    }
+    void insertPackedValues(uint32_t curSweep, const double* gathered,
+                            uint32_t replicaStride);
     friend void outputResults(
-        const std::vector<std::unique_ptr<VectorObservableHandlerPT>>& obsHandlers);
+        const std::vector<std::unique_ptr<VectorObservableHandlerPT>>& obsHandlers,
+        AsyncWriter& writer);
 protected:
     uint32_t vsize;
     arma::Col<double> indexes;
@@ -300,6 +392,8 @@ protected:
     // at rank 0 this holds contiguous memory where the vector data
     // gathered from all replicas is stored
     std::vector<double> mpi_gather_buffer; 
+    // the vector data of the local replicas, contiguous for sending
+    std::vector<double> mpi_send_buffer;
 };
 
 
@@ -310,13 +404,13 @@ protected:
 class KeyValueObservableHandlerPT : public VectorObservableHandlerPT {
 public:
     KeyValueObservableHandlerPT(const KeyValueObservable& observable,
-                                const std::vector<int>& current_process_par,                              
+                                const std::vector<int>& current_replica_par,                              
                                 const DetQMCParams& simulationParameters,
                                 const DetQMCPTParams& ptParams,
                                 const MetadataMap& metadataToStoreModel,
                                 const MetadataMap& metadataToStoreMC,
                                 const MetadataMap& metadataToStorePT) :
-        VectorObservableHandlerPT(observable, current_process_par,
+        VectorObservableHandlerPT(observable, current_replica_par,
                                   simulationParameters, ptParams,
                                   metadataToStoreModel, metadataToStoreMC,
                                   metadataToStorePT) {
@@ -327,13 +421,38 @@ public:
 };
 
 
+//Gather the measurements of all scalar and vector observables of
+//each replica with a single collective: every process packs the
+//current values of the observables of its local replicas into one
+//contiguous buffer of doubles [replica after replica], these are
+//gathered at the root process and unpacked into the handlers.  This
+//replaces separate calls of insertValue() for each handler.  The
+//buffers are kept between calls.
+class PackedObservableGathererPT {
+public:
+    PackedObservableGathererPT() : sendBuffer(), recvBuffer() { }
+
+    //to be called by all processes after each measurement, with the
+    //same handlers in the same order
+    void insertValues(uint32_t curSweep, int localReplicas,
+                      const std::vector<std::unique_ptr<ScalarObservableHandlerPT>>& obsHandlers,
+                      const std::vector<std::unique_ptr<VectorObservableHandlerPT>>& vecObsHandlers);
+private:
+    std::vector<double> sendBuffer;     // values of the local replicas
+    std::vector<double> recvBuffer;     // at rank 0: ordered by global replica index
+};
+
+
 //Write expectation values and error bars for all observables to a file
 //take metadata to store from the first entry in obsHandlers
 //This is to be called by rank 0
-void outputResults(const std::vector<std::unique_ptr<ScalarObservableHandlerPT>>& obsHandlers);
+//[the files are written by writer]
+void outputResults(const std::vector<std::unique_ptr<ScalarObservableHandlerPT>>& obsHandlers,
+                   AsyncWriter& writer);
 
 //write the results for each vector observable into a seperate file
-void outputResults(const std::vector<std::unique_ptr<VectorObservableHandlerPT>>& obsHandlers);
+void outputResults(const std::vector<std::unique_ptr<VectorObservableHandlerPT>>& obsHandlers,
+                   AsyncWriter& writer);
 
 
 
@@ -0,0 +1,83 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  See the enclosed file LICENSE for a copy or if
+ * that was not distributed with this file, You can obtain one at
+ * http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2017 Max H. Gerlach
+ *
+ * */
+
+/*
+ * mrpt-distribution.h
+ *
+ * Distribution of the multiple histogram reweighting analysis over
+ * several processes: every process holds the time series of some of
+ * the replicas and iterates the density of states for some of the
+ * jackknife blocks.  Partial results are combined with the reductions
+ * below.
+ *
+ * This base class describes the serial case of a single process that
+ * holds everything, the reductions are no-ops.  The MPI implementation
+ * is MrptDistributionMPI in mpimrpt-distribution.h.
+ */
+
+#ifndef MRPT_DISTRIBUTION_H_
+#define MRPT_DISTRIBUTION_H_
+
+#include <cstddef>
+
+class MrptDistribution {
+public:
+    virtual ~MrptDistribution() { }
+
+    virtual unsigned processIndex() const { return 0; }
+    virtual unsigned numProcesses() const { return 1; }
+
+    bool isRoot() const { return processIndex() == 0; }
+    bool isDistributed() const { return numProcesses() > 1; }
+
+    //replicas and jackknife blocks are dealt out round-robin
+    bool ownsReplica(unsigned k) const {
+        return k % numProcesses() == processIndex();
+    }
+    bool ownsBlock(unsigned b) const {
+        return b % numProcesses() == processIndex();
+    }
+    //number of jackknife blocks owned by this process (or by process p)
+    //and the local index of an owned block b
+    unsigned localBlockCount(unsigned blockCount) const {
+        return localBlockCount(blockCount, processIndex());
+    }
+    unsigned localBlockCount(unsigned blockCount, unsigned p) const {
+        return (blockCount + numProcesses() - 1 - p) / numProcesses();
+    }
+    unsigned localBlockIndex(unsigned b) const {
+        return b / numProcesses();
+    }
+    //global index of the jackknife block with local index lb on process p
+    unsigned blockIndex(unsigned lb, unsigned p) const {
+        return lb * numProcesses() + p;
+    }
+
+    //replace the count values at data by their sums over all processes
+    virtual void sum(double* data, std::size_t count) {
+        (void) data; (void) count;
+    }
+    virtual void sum(int* data, std::size_t count) {
+        (void) data; (void) count;
+    }
+
+    //replace the count values at data on process p by their sums over
+    //all processes, the values on the other processes are left unspecified
+    virtual void sumOnProcess(unsigned p, int* data, std::size_t count) {
+        (void) p; (void) data; (void) count;
+    }
+
+    //replace min and max by the minimum and maximum over all processes
+    virtual void minMax(double& min, double& max) {
+        (void) min; (void) max;
+    }
+};
+
+
+#endif /* MRPT_DISTRIBUTION_H_ */
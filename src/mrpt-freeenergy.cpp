@@ -0,0 +1,204 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  See the enclosed file LICENSE for a copy or if
+ * that was not distributed with this file, You can obtain one at
+ * http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2017 Max H. Gerlach
+ *
+ * */
+
+/*
+ * mrpt-freeenergy.cpp
+ *
+ * MultireweightHistosPT::minimizeFreeEnergies(): Newton's method for the
+ * multiple histogram equations with dlib's trust region minimizer.  This
+ * is kept apart from mrpt.cpp, because the dlib templates instantiated
+ * here do not build cleanly with our warning flags.
+ */
+
+#include <cmath>
+#include <vector>
+#include "mrpt.h"
+#include "logvalkernels.h"
+// no pop: the dlib templates are instantiated by the code below
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wconversion"
+#pragma GCC diagnostic ignored "-Wfloat-conversion"
+#pragma GCC diagnostic ignored "-Wshadow"
+#pragma GCC diagnostic ignored "-Wunused-local-typedefs"
+#pragma GCC diagnostic ignored "-Wunused-but-set-variable"
+#pragma GCC diagnostic ignored "-Wmisleading-indentation"
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#pragma GCC diagnostic ignored "-Wterminate"
+#include "dlib/optimization.h"
+
+using namespace std;
+
+namespace {
+    //The multiple histogram equations for f_l = ln Z_l are the stationarity
+    //conditions of the convex function
+    //  F(f) = sum_m heff_m ln D_m(f) + sum_l neff_l f_l,
+    //  D_m(f) = sum_l neff_l binSize e^{-cp_l U_m - f_l},
+    //if the effective counts neff_l do not depend on the bin [Zhu and Hummer, 2012].
+    //heff and neff are both normalized to unit sum, so that F does not change
+    //under f -> f + const.  f_0 = 0 fixes that gauge, the variables are
+    //x = (f_1, ..., f_{L-1}).
+    //
+    //This is the model interface of dlib::find_min_trust_region.
+    class FreeEnergyModel {
+    public:
+        typedef dlib::matrix<double, 0, 1> column_vector;
+        typedef dlib::matrix<double> general_matrix;
+
+        FreeEnergyModel(const double* lnHeff, const double* lnPrecalc_,
+                        const std::vector<double>& lnNeff, unsigned numReplicas, unsigned binCount)
+            : lnPrecalc(lnPrecalc_), L(numReplicas), M(binCount), heff(binCount), neff(numReplicas)
+        {
+            const double lnHeffTotal = lv_logSumExp(lnHeff, M);
+            for (unsigned m = 0; m < M; ++m) {
+                heff[m] = std::exp(lnHeff[m] - lnHeffTotal);
+            }
+            const double lnNeffTotal = lv_logSumExp(lnNeff.data(), L);
+            for (unsigned l = 0; l < L; ++l) {
+                neff[l] = std::exp(lnNeff[l] - lnNeffTotal);
+            }
+        }
+
+        const std::vector<double>& effectiveCounts() const { return neff; }
+
+        double operator()(const column_vector& x) const {
+            std::vector<double> f = freeEnergies(x);
+            std::vector<double> lnD(M);
+            lv_logSumExpColumns(lnD.data(), lnPrecalc, L, M, M, f.data());
+            double F = 0;
+            for (unsigned m = 0; m < M; ++m) {
+                F += heff[m] * lnD[m];
+            }
+            for (unsigned l = 1; l < L; ++l) {
+                F += neff[l] * f[l];
+            }
+            return F;
+        }
+
+        //with w_lm = neff_l binSize e^{-cp_l U_m - f_l} / D_m:
+        //  dF/df_l = neff_l - sum_m heff_m w_lm
+        //  d^2F/df_l df_j = sum_m heff_m (delta_lj w_lm - w_lm w_jm)
+        void get_derivative_and_hessian(const column_vector& x, column_vector& d,
+                                        general_matrix& h) const {
+            std::vector<double> f = freeEnergies(x);
+            std::vector<double> lnD(M);
+            lv_logSumExpColumns(lnD.data(), lnPrecalc, L, M, M, f.data());
+            general_matrix w(L - 1, M);
+            general_matrix hw(L - 1, M);
+            d.set_size(L - 1);
+            for (unsigned l = 1; l < L; ++l) {
+                double* row = &w(l - 1, 0);
+                for (unsigned m = 0; m < M; ++m) {
+                    row[m] = lnPrecalc[l * M + m] - f[l] - lnD[m];
+                }
+                lv_exp(row, row, M);
+                double sum = 0;
+                for (unsigned m = 0; m < M; ++m) {
+                    hw(l - 1, m) = heff[m] * row[m];
+                    sum += hw(l - 1, m);
+                }
+                d(l - 1) = neff[l] - sum;
+            }
+            h = -hw * dlib::trans(w);
+            for (unsigned l = 1; l < L; ++l) {
+                h(l - 1, l - 1) += dlib::sum(dlib::rowm(hw, l - 1));
+            }
+        }
+
+    private:
+        const double* lnPrecalc;        //[l][m]: ln(Neff_l binSize e^{-cp_l U_m})
+        unsigned L, M;
+        std::vector<double> heff;
+        std::vector<double> neff;
+
+        //f_l including f_0 = 0
+        std::vector<double> freeEnergies(const column_vector& x) const {
+            std::vector<double> f(L, 0.0);
+            for (unsigned l = 1; l < L; ++l) {
+                f[l] = x(l - 1);
+            }
+            return f;
+        }
+    };
+
+    //Stop once the relative changes of Z_l a step of the fixed-point iteration
+    //would make, -g_l / neff_l, satisfy the convergence criterion of that iteration.
+    //dlib takes the stop strategy by value, so the progress is kept outside.
+    struct FreeEnergyProgress {
+        int iterations;
+        double deltaSquared;
+        FreeEnergyProgress() : iterations(0), deltaSquared(0) { }
+    };
+    class FreeEnergyStopStrategy {
+    public:
+        FreeEnergyStopStrategy(const std::vector<double>& neff_, double tolerance_,
+                               int maxIterations_, FreeEnergyProgress* progress_)
+            : neff(neff_), tolerance(tolerance_), maxIterations(maxIterations_), progress(progress_)
+        { }
+
+        template <typename T>
+        bool should_continue_search(const T&, const double, const T& g) {
+            double deltaSquared = 0;
+            for (unsigned l = 1; l < neff.size(); ++l) {
+                deltaSquared += std::pow(g(l - 1) / neff[l], 2);
+            }
+            progress->deltaSquared = deltaSquared;
+            if (deltaSquared < tolerance * tolerance or progress->iterations >= maxIterations) {
+                return false;
+            }
+            ++progress->iterations;
+            return true;
+        }
+    private:
+        std::vector<double> neff;
+        double tolerance;
+        int maxIterations;
+        FreeEnergyProgress* progress;
+    };
+}
+
+bool MultireweightHistosPT::minimizeFreeEnergies(LogVal* lZ, const LogVal* lHeff, const LogVal* lPrecalc,
+                                                 const LogVal* lNeff, double tolerance, int maxIterations,
+                                                 bool verbose) {
+    if (numReplicas < 2) {
+        return false;
+    }
+    //the objective requires effectiveCountsBinIndependent(lNeff), use the first bin
+    std::vector<double> lnNeff(numReplicas);
+    for (unsigned l = 0; l < numReplicas; ++l) {
+        lnNeff[l] = lNeff[l * binCount].lnx;
+    }
+
+    FreeEnergyModel model(lv_lnx(lHeff), lv_lnx(lPrecalc), lnNeff, numReplicas, binCount);
+    FreeEnergyModel::column_vector x(numReplicas - 1);
+    for (unsigned l = 1; l < numReplicas; ++l) {
+        x(l - 1) = lZ[l].lnx - lZ[0].lnx;
+    }
+    FreeEnergyProgress progress;
+    FreeEnergyStopStrategy stop(model.effectiveCounts(), tolerance, maxIterations, &progress);
+    dlib::find_min_trust_region(stop, model, x);
+    for (unsigned l = 1; l < numReplicas; ++l) {
+        //not std::isfinite(), which is always true with -ffast-math
+        if (not lv_isFinite(x(l - 1))) {
+            if (verbose) {
+                out << "Newton's method failed, falling back to the iteration." << endl;
+            }
+            return false;
+        }
+    }
+
+    lZ[0].lnx = 0;
+    for (unsigned l = 1; l < numReplicas; ++l) {
+        lZ[l].lnx = x(l - 1);
+    }
+    if (verbose) {
+        out << "Newton's method: Iterations: " << progress.iterations
+            << "  deltaSquared: " << progress.deltaSquared << endl;
+    }
+    return true;
+}
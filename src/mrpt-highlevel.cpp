@@ -36,6 +36,7 @@
 #pragma GCC diagnostic pop
 #include "mrpt.h"
 #include "mrpt-jk.h"
+#include "mrpt-distribution.h"
 #include "mrpt-highlevel.h"
 
 using namespace std;
@@ -44,6 +45,10 @@ using namespace std;
 namespace {
     MultireweightHistosPT* mr = 0;
 
+    //with several processes only the first one writes output
+    std::shared_ptr<MrptDistribution> distribution(new MrptDistribution);
+    bool writesFiles() { return distribution->isRoot(); }
+
     enum BC { PBC=0, APBCX=1, APBCY=2, APBCXY=3, NONE };
     const std::array<BC, 4> all_BC = {{PBC, APBCX, APBCY, APBCXY}};
     std::array<std::shared_ptr<MultireweightHistosPT>, 4> mrbc;
@@ -59,6 +64,7 @@ namespace {
     bool non_iterative = true;
     unsigned maxIterations = 10000;
     double iterationTolerance = 1E-7;
+    bool newtonSolver = false;
 
     bool be_quiet = false;
     ofstream dev_null("/dev/null");
@@ -90,6 +96,10 @@ namespace {
 
 
 
+void setDistribution(std::shared_ptr<MrptDistribution> dist) {
+    distribution = dist;
+}
+
 void initFromCommandLine(int argc, char** argv) {
     //Command line parsing
     parser.add_option("help", "display this help message");
@@ -99,6 +109,7 @@ void initFromCommandLine(int argc, char** argv) {
     parser.add_option("discrete-ising-bins", "Pass this instead of -b to set up energy bins that match the natural discrete energies of the 2D Ising model of this system size.");
     parser.add_option("i", "max number of iterations to determine Z[cp]", 1);
     parser.add_option("t", "tolerance in iterative determination of Z[cp]", 1);
+    parser.add_option("newton", "determine Z[cp] by a trust region Newton minimization, the iteration then only checks the result");
     parser.add_option("loadz", "load partition functions from the indicated file", 1);
     parser.add_option("savez", "save partition functions to the indicated file", 1);
 
@@ -143,11 +154,13 @@ void initFromCommandLine(int argc, char** argv) {
     parser.parse(argc, argv);
 
     //echo whole commandline:
-    cout << "command line: ";
-    for (int arg = 0; arg < argc; ++arg) {
-        cout << argv[arg] << " ";
+    if (writesFiles()) {
+        cout << "command line: ";
+        for (int arg = 0; arg < argc; ++arg) {
+            cout << argv[arg] << " ";
+        }
+        cout << endl;
     }
-    cout << endl;
 
     const char* one_time_opts[] = {"info", "b", "loadz", "savez", "n", "cp-range", "cp-auto-range", "j", "i", "sub-sample", "sort", "time-series-format"};
     parser.check_one_time_options(one_time_opts);
@@ -196,6 +209,7 @@ void initFromCommandLine(int argc, char** argv) {
     if (parser.option("t")) {
         iterationTolerance = dlib::sa = parser.option("t").argument();
     }
+    newtonSolver = parser.option("newton");
 
     bool createHistograms = parser.option("h");
 
@@ -218,6 +232,12 @@ void initFromCommandLine(int argc, char** argv) {
     crossCorr = parser.option("cross-corr");
     crossCorrAlt = parser.option("cross-corr-alt");
 
+    if (distribution->isDistributed() and
+        (do_directEstimates or sortByCp or saveTauInt or crossCorr or crossCorrAlt)) {
+        throw_GeneralError("--direct, --sort, --save-tau-int, --cross-corr and --cross-corr-alt "
+                           "are not supported with several processes");
+    }
+
     if (const clp::option_type& tsf_opt = parser.option("time-series-format")) {
         std::string tsf = tsf_opt.argument();
         if (tsf == "1") {
@@ -336,6 +356,9 @@ MapPtr direct_binderRatioError;
 
 //internal function to output the above maps
 void writeOutResults() {
+    if (not writesFiles()) {
+        return;
+    }
     //reweighting results:
     if (energy and not energy->empty()) {
         DoubleMapWriter energyOut;
@@ -600,6 +623,10 @@ void setTolerance(double tolerance) {
     iterationTolerance = tolerance;
 }
 
+void setNewtonSolver(bool useNewton) {
+    newtonSolver = useNewton;
+}
+
 void init() {
     destroy(mr);
     energy = MapPtr(new Map());
@@ -630,9 +657,11 @@ void init() {
     direct_susceptibilityError = MapPtr(new Map());
     direct_binderError = MapPtr(new Map());
     direct_binderRatioError = MapPtr(new Map());    
+    std::ostream& out = (be_quiet or not writesFiles()) ? dev_null : cout;
     mr = (use_jackknife ?
-        new MultireweightHistosPTJK(jackknifeBlocks, be_quiet ? dev_null : cout) :
-        new MultireweightHistosPT(be_quiet ? dev_null : cout));
+        new MultireweightHistosPTJK(jackknifeBlocks, out) :
+        new MultireweightHistosPT(out));
+    mr->setDistribution(distribution);
 
     mr->addSimulationInfo(infoFilename);
 
@@ -662,7 +691,9 @@ void init() {
     } else {
         mr->createHistograms(binCount);
     }
-    mr->saveH_km(outputDirPrefix + "Hkm.table");
+    if (writesFiles()) {
+        mr->saveH_km(outputDirPrefix + "Hkm.table");
+    }
 
     if (crossCorr) {
         mr->computeAndSaveHistogramCrossCorr();
@@ -671,12 +702,14 @@ void init() {
         mr->computeAndSaveHistogramCrossCorrAlt();
     }
 
-    if (use_jackknife) {
-        //TODO: ugly, ugly, ugly
-        dynamic_cast<MultireweightHistosPTJK*>(mr)->
-                saveH_km_errors(outputDirPrefix + "Hkm-errors.table");
+    if (writesFiles()) {
+        if (use_jackknife) {
+            //TODO: ugly, ugly, ugly
+            dynamic_cast<MultireweightHistosPTJK*>(mr)->
+                    saveH_km_errors(outputDirPrefix + "Hkm-errors.table");
+        }
+        mr->saveU_m(outputDirPrefix + "Um.table");
     }
-    mr->saveU_m(outputDirPrefix + "Um.table");
 
     if (non_iterative) {
         mr->findDensityOfStatesNonIteratively();
@@ -695,7 +728,9 @@ void init() {
         mr->writeOutObsTauInt("mrpt-tauint-" + mr->observable + ".dat");
     }
 
-    mr->saveg_km(outputDirPrefix + "gkm.table");
+    if (writesFiles()) {
+        mr->saveg_km(outputDirPrefix + "gkm.table");
+    }
 
     mr->updateEffectiveCounts();
 
@@ -709,9 +744,14 @@ void init() {
     }
 
     if (maxIterations > 0) {
+        mr->setNewtonSolver(newtonSolver);
         mr->findPartitionFunctionsAndDensityOfStates(iterationTolerance, maxIterations);
     }
 
+    if (not writesFiles()) {
+        return;
+    }
+
     if (discreteIsingBins) {
         mr->saveLogDensityOfStatesIsing(outputDirPrefix + "mrpt-dos.dat");
     } else {
@@ -784,7 +824,7 @@ public:
             (*binderError)[cp] = result.obsBinderError;            
             (*binderRatioError)[cp] = result.obsBinderRatioError;
         }
-        if (createHistograms) {
+        if (createHistograms and writesFiles()) {
             result.energyHistogram->save("mrpt-energy-" + getControlParameterName() +
                                          numToString(cp) + ".hist");
             result.obsHistogram->save("mrpt-" + getObservableName() + "-" +
@@ -810,8 +850,10 @@ public:
         }
         if (createHistogram) {
             result.energyHistogram = mr->reweightEnergyHistogram(cp);
-            result.energyHistogram->save("mrpt-energy-" + getControlParameterName()
-                                         + numToString(cp) + ".hist");
+            if (writesFiles()) {
+                result.energyHistogram->save("mrpt-energy-" + getControlParameterName()
+                                             + numToString(cp) + ".hist");
+            }
         }
         result.freeMemory();
     }
@@ -833,15 +875,19 @@ void reweightDiscrete(double cp, bool createHistogramToo) {
 
 void reweightEnergyHistogram(double cp) {
     HistogramDouble* histo = mr->reweightEnergyHistogram(cp);
-    histo->save("mrpt-energy-" + getControlParameterName()
-                + numToString(cp) + ".hist");
+    if (writesFiles()) {
+        histo->save("mrpt-energy-" + getControlParameterName()
+                    + numToString(cp) + ".hist");
+    }
     destroy(histo);
 }
 
 void reweightObservableHistogram(double cp) {
     HistogramDouble* histo = mr->reweightObservableHistogram(cp, binCount);
-    histo->save("mrpt-" + getObservableName() + "-" + getControlParameterName()
-                + numToString(cp) + ".hist");
+    if (writesFiles()) {
+        histo->save("mrpt-" + getObservableName() + "-" + getControlParameterName()
+                    + numToString(cp) + ".hist");
+    }
     destroy(histo);
 }
 
@@ -884,7 +930,9 @@ void findMaxSusc(double cpStart, double cpEnd) {
     }
     HistogramDouble* histo = mr->
             reweightObservableHistogram(cpMax, binCount);
-    histo->save(outputDirPrefix + "mrpt-max-susc.hist");
+    if (writesFiles()) {
+        histo->save(outputDirPrefix + "mrpt-max-susc.hist");
+    }
     destroy(histo);
 
     MetadataMap meta;
@@ -902,8 +950,10 @@ void findMaxSusc(double cpStart, double cpEnd) {
         comments += "Jackknife error estimation, blockCount: "
                 + numToString(jackknifeBlocks) + "\n";
     }
-    writeOnlyMetaData(outputDirPrefix + "mrpt-max-susc.dat", meta,
-            comments);
+    if (writesFiles()) {
+        writeOnlyMetaData(outputDirPrefix + "mrpt-max-susc.dat", meta,
+                comments);
+    }
 
     writeOutResults();
 }
@@ -927,7 +977,9 @@ void findMinBinder(double cpStart, double cpEnd) {
     }
     HistogramDouble* histo = mr->
             reweightObservableHistogram(cpMin, binCount);
-    histo->save(outputDirPrefix + "mrpt-min-binder.hist");
+    if (writesFiles()) {
+        histo->save(outputDirPrefix + "mrpt-min-binder.hist");
+    }
     destroy(histo);
 
     MetadataMap meta;
@@ -945,8 +997,10 @@ void findMinBinder(double cpStart, double cpEnd) {
         comments += "Jackknife error estimation, blockCount: "
                 + numToString(jackknifeBlocks) + "\n";
     }
-    writeOnlyMetaData(outputDirPrefix + "mrpt-min-binder.dat", meta,
-            comments);
+    if (writesFiles()) {
+        writeOnlyMetaData(outputDirPrefix + "mrpt-min-binder.dat", meta,
+                comments);
+    }
 
     writeOutResults();
 }
@@ -970,7 +1024,9 @@ void findMaxSpecificHeat(double cpStart, double cpEnd) {
                                         cpStart, cpEnd);
     }
     HistogramDouble* histo = mr->reweightEnergyHistogram(cpMax);
-    histo->save(outputDirPrefix + "mrpt-max-heat-capacity.hist");
+    if (writesFiles()) {
+        histo->save(outputDirPrefix + "mrpt-max-heat-capacity.hist");
+    }
     destroy(histo);
 
     MetadataMap meta;
@@ -988,8 +1044,10 @@ void findMaxSpecificHeat(double cpStart, double cpEnd) {
         comments += "Jackknife error estimation, blockCount: "
                 + numToString(jackknifeBlocks) + "\n";
     }
-    writeOnlyMetaData(outputDirPrefix + "mrpt-heat-capacity.dat", meta,
-            comments);
+    if (writesFiles()) {
+        writeOnlyMetaData(outputDirPrefix + "mrpt-heat-capacity.dat", meta,
+                comments);
+    }
 
     writeOutResults();
 }
@@ -1018,7 +1076,9 @@ void findEnergyDoublePeak(double cpStart, double cpEnd, double tolerance) {
                                         relDipErrorEW, histoEW,
                                         cpStart, cpEnd, tolerance);
     }
-    histoEH->save(outputDirPrefix + "mrpt-energy-equal-height.hist");
+    if (writesFiles()) {
+        histoEH->save(outputDirPrefix + "mrpt-energy-equal-height.hist");
+    }
 
     MetadataMap metaEH;
     metaEH["observable"] = "energy";
@@ -1037,10 +1097,14 @@ void findEnergyDoublePeak(double cpStart, double cpEnd, double tolerance) {
         comments += "Jackknife error estimation, blockCount: "
                 + numToString(jackknifeBlocks) + "\n";
     }
-    writeOnlyMetaData(outputDirPrefix + "mrpt-energy-equal-height.dat", metaEH,
-            comments);
+    if (writesFiles()) {
+        writeOnlyMetaData(outputDirPrefix + "mrpt-energy-equal-height.dat", metaEH,
+                comments);
+    }
 
-    histoEW->save(outputDirPrefix + "mrpt-energy-equal-weight.hist");
+    if (writesFiles()) {
+        histoEW->save(outputDirPrefix + "mrpt-energy-equal-weight.hist");
+    }
 
     MetadataMap metaEW;
     metaEW["observable"] = "energy";
@@ -1059,8 +1123,10 @@ void findEnergyDoublePeak(double cpStart, double cpEnd, double tolerance) {
         comments += "Jackknife error estimation, blockCount: "
                 + numToString(jackknifeBlocks) + "\n";
     }
-    writeOnlyMetaData(outputDirPrefix + "mrpt-energy-equal-weight.dat", metaEW,
-            comments);
+    if (writesFiles()) {
+        writeOnlyMetaData(outputDirPrefix + "mrpt-energy-equal-weight.dat", metaEW,
+                comments);
+    }
 
     destroy(histoEH);
     destroy(histoEW);
@@ -1093,7 +1159,9 @@ void findObservableDoublePeak(double cpStart, double cpEnd, double tolerance) {
     }
     string obs = mr->observable;
 
-    histoEH->save(outputDirPrefix + "mrpt-" + obs + "-equal-height.hist");
+    if (writesFiles()) {
+        histoEH->save(outputDirPrefix + "mrpt-" + obs + "-equal-height.hist");
+    }
 
     MetadataMap metaEH;
     metaEH["observable"] = obs;
@@ -1113,11 +1181,15 @@ void findObservableDoublePeak(double cpStart, double cpEnd, double tolerance) {
         comments += "Jackknife error estimation, blockCount: "
                 + numToString(jackknifeBlocks) + "\n";
     }
-    writeOnlyMetaData(outputDirPrefix + "mrpt-" + obs +
-            "-equal-height.dat", metaEH, comments);
+    if (writesFiles()) {
+        writeOnlyMetaData(outputDirPrefix + "mrpt-" + obs +
+                "-equal-height.dat", metaEH, comments);
+    }
 
-    histoEW->save(outputDirPrefix + "mrpt-" + obs +
-            "-equal-weight.hist");
+    if (writesFiles()) {
+        histoEW->save(outputDirPrefix + "mrpt-" + obs +
+                "-equal-weight.hist");
+    }
 
     MetadataMap metaEW;
     metaEW["observable"] = obs;
@@ -1137,8 +1209,10 @@ void findObservableDoublePeak(double cpStart, double cpEnd, double tolerance) {
         comments += "Jackknife error estimation, blockCount: "
                 + numToString(jackknifeBlocks) + "\n";
     }
-    writeOnlyMetaData(outputDirPrefix + "mrpt-" + obs +
-            "-equal-weight.dat", metaEW, comments);
+    if (writesFiles()) {
+        writeOnlyMetaData(outputDirPrefix + "mrpt-" + obs +
+                "-equal-weight.dat", metaEW, comments);
+    }
 
     destroy(histoEH);
     destroy(histoEW);
@@ -1158,8 +1232,10 @@ void findEnergyRelDip(double targetControlParameter, double tolerance) {
     }
     string obs = "energy";
 
-    histo->save(outputDirPrefix + "mrpt-" + obs + "-b" +
-            numToString(targetControlParameter) + ".hist");
+    if (writesFiles()) {
+        histo->save(outputDirPrefix + "mrpt-" + obs + "-b" +
+                numToString(targetControlParameter) + ".hist");
+    }
 
     MetadataMap meta;
     meta["observable"] = obs;
@@ -1176,9 +1252,11 @@ void findEnergyRelDip(double targetControlParameter, double tolerance) {
         comments += "Jackknife error estimation, blockCount: "
                 + numToString(jackknifeBlocks) + "\n";
     }
-    writeOnlyMetaData(outputDirPrefix + "mrpt-" + obs +
-            "-b" + numToString(targetControlParameter) +
-            "-reldip.dat", meta, comments);
+    if (writesFiles()) {
+        writeOnlyMetaData(outputDirPrefix + "mrpt-" + obs +
+                "-b" + numToString(targetControlParameter) +
+                "-reldip.dat", meta, comments);
+    }
 
     destroy(histo);
 }
@@ -1196,8 +1274,10 @@ void findObservableRelDip(double targetControlParameter, double tolerance) {
     }
     string obs = mr->observable;
 
-    histo->save(outputDirPrefix + "mrpt-" + obs + "-b" +
-            numToString(targetControlParameter) + ".hist");
+    if (writesFiles()) {
+        histo->save(outputDirPrefix + "mrpt-" + obs + "-b" +
+                numToString(targetControlParameter) + ".hist");
+    }
 
     MetadataMap meta;
     meta["observable"] = obs;
@@ -1214,9 +1294,11 @@ void findObservableRelDip(double targetControlParameter, double tolerance) {
         comments += "Jackknife error estimation, blockCount: "
                 + numToString(jackknifeBlocks) + "\n";
     }
-    writeOnlyMetaData(outputDirPrefix + "mrpt-" + obs +
-                      "-" + getControlParameterName() + numToString(targetControlParameter) +
-                      "-reldip.dat", meta, comments);
+    if (writesFiles()) {
+        writeOnlyMetaData(outputDirPrefix + "mrpt-" + obs +
+                          "-" + getControlParameterName() + numToString(targetControlParameter) +
+                          "-reldip.dat", meta, comments);
+    }
 
     destroy(histo);
 }
@@ -1421,6 +1503,7 @@ void initBC() {
         mr_instance->updateEffectiveCounts();        
 
         if (maxIterations > 0) {
+            mr_instance->setNewtonSolver(newtonSolver);
             mr_instance->findPartitionFunctionsAndDensityOfStates(iterationTolerance, maxIterations);
         }
         
@@ -1439,6 +1522,7 @@ void initFromCommandLineBC(int argc, char** argv) {
     parser.add_option("b", "number of energy bins", 1);
     parser.add_option("i", "max number of iterations to determine Z[cp]", 1);
     parser.add_option("t", "tolerance in iterative determination of Z[cp]", 1);
+    parser.add_option("newton", "determine Z[cp] by a trust region Newton minimization, the iteration then only checks the result");
 
     // parser.add_option("direct", "also calculate direct averages from the time series at the original temperatures without any reweighting");
 
@@ -1515,6 +1599,7 @@ void initFromCommandLineBC(int argc, char** argv) {
     if (parser.option("t")) {
         iterationTolerance = dlib::sa = parser.option("t").argument();
     }
+    newtonSolver = parser.option("newton");
 
     if (const clp::option_type& ss = parser.option("sub-sample")) {
         subsampleHowMuch = dlib::sa = ss.argument();
@@ -19,11 +19,14 @@
 #define MRPT_HIGHLEVEL_H_
 
 #include <string>
+#include <memory>
+#include "mrpt-distribution.h"
 
 // Common routines
 //////////////////
 
 //set options first, then call init
+void setDistribution(std::shared_ptr<MrptDistribution> dist);  //default: a single process
 void setOutputDirectory(const char* dir);       //if set: write all files to this sub-directory
 void setSubsample(unsigned samplesSize = 1);
 void setBins(unsigned bins);
@@ -33,6 +36,7 @@ void setQuiet(bool quiet);
 //for finding density of states
 void setMaxIterations(unsigned maxIterations);
 void setTolerance(double tolerance);
+void setNewtonSolver(bool useNewton);
 
 void getOriginalControlParameterValues(int* outK, double** outArray1);
 
@@ -20,6 +20,7 @@
 #include "tools.h"
 #include "statistics.h"
 #include "numerics.h"
+#include "logvalkernels.h"
 
 using namespace std;
 
@@ -36,13 +37,13 @@ void MultireweightHistosPTJK::setUpHistogramsHelperJK() {
     lZ_bl.resize(boost::extents[blockCount][numReplicas]);
     initArray(lZ_bl, LogVal(1.0));
 
-    H_bkm.resize(boost::extents[blockCount][numReplicas][binCount]);
+    //only the jackknife blocks owned by this process
+    const unsigned localBlocks = distribution->localBlockCount(blockCount);
+    H_bkm.resize(boost::extents[localBlocks][numReplicas][binCount]);
     initArray(H_bkm, 0);
-    g_bkm.resize(boost::extents[blockCount][numReplicas][binCount]);
-    initArray(g_bkm, 0);
-    H_blm.resize(boost::extents[blockCount][numReplicas][binCount]);
+    H_blm.resize(boost::extents[localBlocks][numReplicas][binCount]);
     initArray(H_blm, 0);
-    N_bkl.resize(boost::extents[blockCount][numReplicas][numReplicas]);
+    N_bkl.resize(boost::extents[localBlocks][numReplicas][numReplicas]);
     initArray(N_bkl, 0);
 
     H_bm.resize(boost::extents[blockCount][binCount]);
@@ -85,25 +86,127 @@ void MultireweightHistosPTJK::createHistogramsHelperJK() {
 
             unsigned curBlock = (n * blockCount) / N_k;     //integer division rounds down
             for (signed b = 0; b < (signed)curBlock; ++b) {
-                N_bkl[b][k][l] += 1;
-                ++H_bkm[b][k][m];
                 ++H_bm[b][m];       //!!!
-                ++H_blm[b][l][m];   //!!!
             }
             for (signed b = curBlock + 1; b < (signed)blockCount; ++b) {
-                N_bkl[b][k][l] += 1;
-                ++H_bkm[b][k][m];
                 ++H_bm[b][m];       //!!!
-                ++H_blm[b][l][m];   //!!!
             }
         }
         out << "." << flush;
     }
+    combineHistograms();
+    combineHistogramsJK();
+    createBlockHistogramsJK();
+    estimateH_km_errors();
     //not needed any more
     cpiTimeSeries.clear();  //    destroyAll(cpiTimeSeries);                    
     out << " done" << endl;
 }
 
+void MultireweightHistosPTJK::combineHistogramsJK() {
+    distribution->sum(H_bm.data(), H_bm.num_elements());
+}
+
+void MultireweightHistosPTJK::createBlockHistogramsJK() {
+    //Only the process owning a jackknife block keeps its rows of H_bkm,
+    //H_blm and N_bkl.  Taking one process after the other, every process
+    //counts its replicas into rows for the blocks of that process, which
+    //are then summed up there.  This way no process holds more than
+    //the rows of two processes at a time.
+    const unsigned processCount = distribution->numProcesses();
+    for (unsigned p = 0; p < processCount; ++p) {
+        const unsigned pBlocks = distribution->localBlockCount(blockCount, p);
+        const bool own = (p == distribution->processIndex());
+        Int3Array sendH_bkm, sendH_blm, sendN_bkl;
+        if (not own) {
+            sendH_bkm.resize(boost::extents[pBlocks][numReplicas][binCount]);
+            initArray(sendH_bkm, 0);
+            sendH_blm.resize(boost::extents[pBlocks][numReplicas][binCount]);
+            initArray(sendH_blm, 0);
+            sendN_bkl.resize(boost::extents[pBlocks][numReplicas][numReplicas]);
+            initArray(sendN_bkl, 0);
+        }
+        Int3Array& pH_bkm = (own ? H_bkm : sendH_bkm);
+        Int3Array& pH_blm = (own ? H_blm : sendH_blm);
+        Int3Array& pN_bkl = (own ? N_bkl : sendN_bkl);
+
+        for (unsigned k = 0; k < numReplicas; ++k) {
+            unsigned N_k = (unsigned)energyTimeSeries[k]->size();
+            for (unsigned n = 0; n < N_k; ++n) {
+                int m = (*m_kn[k])[n];
+                int l = (*(cpiTimeSeries[k]))[n];
+                unsigned curBlock = (n * blockCount) / N_k;     //integer division rounds down
+                for (unsigned lb = 0; lb < pBlocks; ++lb) {
+                    if (distribution->blockIndex(lb, p) == curBlock) {
+                        continue;
+                    }
+                    pN_bkl[lb][k][l] += 1;
+                    ++pH_bkm[lb][k][m];
+                    ++pH_blm[lb][l][m];
+                }
+            }
+        }
+        distribution->sumOnProcess(p, pH_bkm.data(), pH_bkm.num_elements());
+        distribution->sumOnProcess(p, pH_blm.data(), pH_blm.num_elements());
+        distribution->sumOnProcess(p, pN_bkl.data(), pN_bkl.num_elements());
+    }
+}
+
+//TODO: error estimation really should be put into a more general
+//function
+void MultireweightHistosPTJK::estimateH_km_errors() {
+    //every sample is left out of exactly one block, so the average of
+    //H_bkm over the blocks is (blockCount - 1) / blockCount * H_km
+    Double2Array sqDev_km(boost::extents[numReplicas][binCount]);
+    initArray(sqDev_km, 0.0);
+    for (unsigned b = 0; b < blockCount; ++b) {
+        if (not distribution->ownsBlock(b)) {
+            continue;
+        }
+        const unsigned lb = distribution->localBlockIndex(b);
+        for (unsigned k = 0; k < numReplicas; ++k) {
+            for (unsigned m = 0; m < binCount; ++m) {
+                double avgH_bkm = double(blockCount - 1) * H_km[k][m] / blockCount;
+                //the following original calculation was wrong:
+                //sqDev += pow(H_bkm[b][k][m] - H_km[k][m], 2);
+                //the totals of H_bkm are always smaller than the
+                //totals of H_km !
+                sqDev_km[k][m] += pow(H_bkm[lb][k][m] - avgH_bkm, 2);
+            }
+        }
+    }
+    distribution->sum(sqDev_km.data(), sqDev_km.num_elements());
+
+    double factor = double(blockCount - 1) / double(blockCount);
+    HError_km.resize(boost::extents[numReplicas][binCount]);
+    for (unsigned k = 0; k < numReplicas; ++k) {
+        for (unsigned m = 0; m < binCount; ++m) {
+            HError_km[k][m] = sqrt(factor * sqDev_km[k][m]);
+        }
+    }
+}
+
+void MultireweightHistosPTJK::combineBlockRows(LogVal2Array& array_bx) {
+    if (not distribution->isDistributed()) {
+        return;
+    }
+    const unsigned rowLength = unsigned(array_bx.shape()[1]);
+    vector<double> lnx(array_bx.num_elements(), 0.0);
+    for (unsigned b = 0; b < blockCount; ++b) {
+        if (distribution->ownsBlock(b)) {
+            for (unsigned x = 0; x < rowLength; ++x) {
+                lnx[b * rowLength + x] = array_bx[b][x].lnx;
+            }
+        }
+    }
+    distribution->sum(lnx.data(), lnx.size());
+    for (unsigned b = 0; b < blockCount; ++b) {
+        for (unsigned x = 0; x < rowLength; ++x) {
+            array_bx[b][x].lnx = lnx[b * rowLength + x];
+        }
+    }
+}
+
 void MultireweightHistosPTJK::createHistogramsHelperDiscreteJK() {
     out << "Creating energy histograms etc., jackknife ready. minEnergyNormalized=" << minEnergyNormalized
         << " maxEnergyNormalized=" << maxEnergyNormalized
@@ -130,20 +233,18 @@ void MultireweightHistosPTJK::createHistogramsHelperDiscreteJK() {
 
             unsigned curBlock = (n * blockCount) / N_k;     //integer division rounds down
             for (signed b = 0; b < (signed)curBlock; ++b) {
-                N_bkl[b][k][l] += 1;
-                ++H_bkm[b][k][m];
                 ++H_bm[b][m];       //!!!
-                ++H_blm[b][l][m];   //!!!
             }
             for (signed b = curBlock + 1; b < (signed)blockCount; ++b) {
-                N_bkl[b][k][l] += 1;
-                ++H_bkm[b][k][m];
                 ++H_bm[b][m];       //!!!
-                ++H_blm[b][l][m];   //!!!
             }
         }
         out << "." << flush;
     }
+    combineHistograms();
+    combineHistogramsJK();
+    createBlockHistogramsJK();
+    estimateH_km_errors();
     //not needed any more
     cpiTimeSeries.clear();
     //destroyAll(cpiTimeSeries);
@@ -161,6 +262,7 @@ void MultireweightHistosPTJK::createHistogramsIsing() {
 }
 
 MultireweightHistosPT::ResultsMap* MultireweightHistosPTJK::directNoReweighting() {
+    checkNotDistributed("Direct estimation without reweighting");
     out << "Computing estimates from time series without any reweighting, jackknifed... "
         << flush;
     ResultsMap* results = new ResultsMap;
@@ -336,14 +438,18 @@ void MultireweightHistosPTJK::findDensityOfStatesNonIteratively() {
     const double deltaU = binSize * systemSize;
 
     for (int b = 0; b < (signed)blockCount; ++b) {
+        if (not distribution->ownsBlock(b)) {
+            continue;
+        }
+        const unsigned lb = distribution->localBlockIndex(b);
         LogVal2Array x_lm(boost::extents[numReplicas][binCount - 1]);       // <-> difference of microcanonical entropies at bins m, m+1
         Double2Array w_lm(boost::extents[numReplicas][binCount - 1]);       //weights at temperature l, energy bin m
         vector<double> w_m(binCount - 1, 0);                                //sum_l { w_lm }
         for (unsigned l = 0; l < numReplicas; ++l) {
             double temperatureExponenet = +controlParameterValues[l] * deltaU;
             for (unsigned m = 0; m < binCount - 1; ++m) {
-                double curHist = H_blm[b][l][m];
-                double nextHist = H_blm[b][l][m + 1];
+                double curHist = H_blm[lb][l][m];
+                double nextHist = H_blm[lb][l][m + 1];
                 if (curHist > 0 and nextHist > 0) {
                     x_lm[l][m] = (LogVal(nextHist * deltaU) / LogVal(curHist * deltaU)) * toLogValExp(temperatureExponenet);
                     w_lm[l][m] = curHist * nextHist / (curHist + nextHist);
@@ -367,6 +473,7 @@ void MultireweightHistosPTJK::findDensityOfStatesNonIteratively() {
 
         out << "." << flush;
     }
+    combineBlockRows(lOmega_bm);
 
     out << "Done" << endl;
 }
@@ -374,30 +481,36 @@ void MultireweightHistosPTJK::findDensityOfStatesNonIteratively() {
 void MultireweightHistosPTJK::updateEffectiveCountsJK() {
     //jackknife-blocked:
 
-    Heff_bm.resize(boost::extents[blockCount][binCount]);
+    //only for the blocks owned by this process
+    const unsigned localBlocks = distribution->localBlockCount(blockCount);
+    Heff_bm.resize(boost::extents[localBlocks][binCount]);
     initArray(Heff_bm, 0);
-    Neff_blm.resize(boost::extents[blockCount][numReplicas][binCount]);
+    Neff_blm.resize(boost::extents[localBlocks][numReplicas][binCount]);
     initArray(Neff_blm, 0);
-    lHeff_bm.resize(boost::extents[blockCount][binCount]);
-    lNeff_blm.resize(boost::extents[blockCount][numReplicas][binCount]);
-    lPrecalc_blm.resize(boost::extents[blockCount][numReplicas][binCount]);
+    lHeff_bm.resize(boost::extents[localBlocks][binCount]);
+    lNeff_blm.resize(boost::extents[localBlocks][numReplicas][binCount]);
+    lPrecalc_blm.resize(boost::extents[localBlocks][numReplicas][binCount]);
 
     #pragma omp parallel for
     for (signed b = 0; b < (signed)blockCount; ++b) {
+        if (not distribution->ownsBlock(b)) {
+            continue;
+        }
+        const unsigned lb = distribution->localBlockIndex(b);
         for (unsigned k = 0; k < numReplicas; ++k) {
             for (unsigned m = 0; m < binCount; ++m) {
-                Heff_bm[b][m] += double(H_bkm[b][k][m]) / g_km[k][m];
+                Heff_bm[lb][m] += double(H_bkm[lb][k][m]) / g_km[k][m];
                 for (unsigned l = 0; l < numReplicas; ++l) {
-                    Neff_blm[b][l][m] += double(N_bkl[b][k][l]) / g_km[k][m];
+                    Neff_blm[lb][l][m] += double(N_bkl[lb][k][l]) / g_km[k][m];
                 }
             }
         }
 
         for (unsigned m = 0; m < binCount; ++m) {
-            lHeff_bm[b][m] = (Heff_bm[b][m] != 0 ? LogVal(Heff_bm[b][m]) : LogVal(LogVal::LogZero));
+            lHeff_bm[lb][m] = (Heff_bm[lb][m] != 0 ? LogVal(Heff_bm[lb][m]) : LogVal(LogVal::LogZero));
             for (unsigned l = 0; l < numReplicas; ++l) {
-                lNeff_blm[b][l][m] = (Neff_blm[b][l][m] != 0 ? LogVal(Neff_blm[b][l][m]) : LogVal(LogVal::LogZero));
-                lPrecalc_blm[b][l][m] = lNeff_blm[b][l][m] * lBinSize * toLogValExp(-controlParameterValues[l] * U_m[m]);    //for updateDensityOfStates
+                lNeff_blm[lb][l][m] = (Neff_blm[lb][l][m] != 0 ? LogVal(Neff_blm[lb][l][m]) : LogVal(LogVal::LogZero));
+                lPrecalc_blm[lb][l][m] = lNeff_blm[lb][l][m] * lBinSize * toLogValExp(-controlParameterValues[l] * U_m[m]);    //for updateDensityOfStates
             }
         }
     }
@@ -406,13 +519,12 @@ void MultireweightHistosPTJK::updateEffectiveCountsJK() {
 inline void MultireweightHistosPTJK::updateDensityOfStatesJK(unsigned b) {
     //precalculated the part that does not depend on the estimates of the partition functions
     //lPrecalc_blm[b][l][m] = lNeff_blm[b][l][m] * lBinSize * toLogValExp(-controlParameterValues[l] * U_m[m]);
-    for (int m = 0; m < (signed)binCount; ++m) {
-        lOmega_bm[b][m] = lHeff_bm[b][m];
-        LogVal denominator = lPrecalc_blm[b][0][m] / lZ_bl[b][0];
-        for (unsigned l = 1; l < numReplicas; ++l) {
-            denominator += lPrecalc_blm[b][l][m] / lZ_bl[b][l];
-        }
-        lOmega_bm[b][m] /= denominator;
+    const unsigned lb = distribution->localBlockIndex(b);
+    //ln of the denominators sum_l lPrecalc_blm[lb][l][m] / lZ_bl[b][l] in lOmega_bm[b], then divide
+    lv_logSumExpColumns(lv_lnx(lOmega_bm[b].origin()), lv_lnx(lPrecalc_blm[lb].origin()),
+                        numReplicas, binCount, binCount, lv_lnx(lZ_bl[b].origin()));
+    for (unsigned m = 0; m < binCount; ++m) {
+        lOmega_bm[b][m].lnx = lHeff_bm[lb][m].lnx - lOmega_bm[b][m].lnx;
     }
 }
 
@@ -429,13 +541,39 @@ void MultireweightHistosPTJK::findPartitionFunctionsAndDensityOfStates(double to
 
     out << "Starting iteration to estimate density of states (jackknife), tolerance=" << tolerance << " maxIterations=" << maxIterations << endl;
 
-    #pragma omp parallel for
+    //decide on Newton's method once for all blocks, it stays quiet inside the loop
+    bool useNewton = newtonSolver and numReplicas >= 2;
+    if (useNewton) {
+        for (unsigned b = 0; b < blockCount; ++b) {
+            if (distribution->ownsBlock(b) and
+                not effectiveCountsBinIndependent(lNeff_blm[distribution->localBlockIndex(b)].origin())) {
+                out << "Effective counts (JK) depend on the energy bin, not using Newton's method." << endl;
+                useNewton = false;
+                break;
+            }
+        }
+    }
+    unsigned newtonFailures = 0;
+
+    #pragma omp parallel for reduction(+:newtonFailures)
     for (signed b = 0; b < (signed)blockCount; ++b) {
+        if (not distribution->ownsBlock(b)) {
+            continue;
+        }
         //starting value: result for the whole data set
         for (unsigned l = 0; l < numReplicas; ++l) {
             lZ_bl[b][l] = lZ_l[l];
         }
         updateDensityOfStatesJK(b);
+        if (useNewton) {
+            const unsigned lb = distribution->localBlockIndex(b);
+            if (minimizeFreeEnergies(lZ_bl[b].origin(), lHeff_bm[lb].origin(), lPrecalc_blm[lb].origin(),
+                                     lNeff_blm[lb].origin(), tolerance, maxIterations, false)) {
+                updateDensityOfStatesJK(b);
+            } else {
+                ++newtonFailures;
+            }
+        }
 
         boost::multi_array<LogVal, 1> lZ_l_lastIteration = lZ_bl[b];
 
@@ -448,16 +586,10 @@ void MultireweightHistosPTJK::findPartitionFunctionsAndDensityOfStates(double to
             deltaSquared = 0;
 
             //update estimates of partition functions
-            lZ_bl[b][0] = lOmega_bm[b][0] * lBinSize * toLogValExp(-controlParameterValues[0] * U_m[0]);
-            for (unsigned m = 1; m < binCount; ++m) {
-                lZ_bl[b][0] += lOmega_bm[b][m] * lBinSize * toLogValExp(-controlParameterValues[0] * U_m[m]);
-            }
+            lZ_bl[b][0] = partitionFunction(lOmega_bm[b].origin(), controlParameterValues[0]);
             for (int l = 1; l < (signed)numReplicas; ++l) {
                 lZ_l_lastIteration[l] = lZ_bl[b][l];            //store old value
-                lZ_bl[b][l] = lOmega_bm[b][0] * lBinSize * toLogValExp(-controlParameterValues[l] * U_m[0]);
-                for (unsigned m = 1; m < binCount; ++m) {
-                    lZ_bl[b][l] += lOmega_bm[b][m] * lBinSize * toLogValExp(-controlParameterValues[l] * U_m[m]);
-                }
+                lZ_bl[b][l] = partitionFunction(lOmega_bm[b].origin(), controlParameterValues[l]);
                 lZ_bl[b][l] /= lZ_bl[b][0];             //normalize
 
                 deltaSquared += pow(expm1(lZ_bl[b][l].lnx - lZ_l_lastIteration[l].lnx), 2);     //gauge change from last iteration
@@ -472,6 +604,12 @@ void MultireweightHistosPTJK::findPartitionFunctionsAndDensityOfStates(double to
         } while (iterations < maxIterations and deltaSquared >= tolerance * tolerance);
         out << "block " << b << ": Iterations: " << iterations << "  deltaSquared: " << deltaSquared << endl;        
     }
+    if (newtonFailures > 0) {
+        out << "Newton's method failed for " << newtonFailures
+            << " jackknife block(s), used the iteration only." << endl;
+    }
+    combineBlockRows(lZ_bl);
+    combineBlockRows(lOmega_bm);
     out << "Done." << endl;
 }
 
@@ -549,9 +687,8 @@ void MultireweightHistosPTJK::saveLogDensityOfStatesIsing(const std::string& fil
 
 
 
-ReweightingResult MultireweightHistosPTJK::reweightJackknifeInternal(
-        double targetControlParameter, unsigned jkBlock,
-        const DoubleSeriesCollection& w_kn) {
+void MultireweightHistosPTJK::reweightJackknifeSumsInternal(
+        unsigned jkBlock, const DoubleSeriesCollection& w_kn, double* sums) {
     //everything normalized by system volume:
     double meanEnergy = 0;
     double meanEnergySquared = 0;
@@ -579,15 +716,11 @@ ReweightingResult MultireweightHistosPTJK::reweightJackknifeInternal(
         }
     }
 
-    double heatCapacity = systemSize * targetControlParameter * targetControlParameter
-        * (meanEnergySquared - pow(meanEnergy, 2));
-    double suscObservable = systemSize * (meanObservableSquared - pow(meanObservable, 2));
-    double binderObservable = 1.0 - (meanObservableToTheFourth / (3 * pow(meanObservableSquared, 2)));
-    double binderRatioObservable = meanObservableToTheFourth / pow(meanObservableSquared, 2);
-    double suscPartObservable = systemSize * meanObservableSquared;
-
-    return ReweightingResult(meanEnergy, heatCapacity, meanObservable,
-                             suscPartObservable, suscObservable, binderObservable, binderRatioObservable);
+    sums[SumEnergy] = meanEnergy;
+    sums[SumEnergySquared] = meanEnergySquared;
+    sums[SumObservable] = meanObservable;
+    sums[SumObservableSquared] = meanObservableSquared;
+    sums[SumObservableToTheFourth] = meanObservableToTheFourth;
 }
 
 
@@ -686,6 +819,7 @@ double MultireweightHistosPTJK::reweightEnergyJK(double targetControlParameter,
 
     double result = 0;
     reweight1stMomentInternalJK(energyTimeSeries, w_kn, jkBlock, result);
+    distribution->sum(&result, 1);
 
     //destroyAll(w_kn);
 
@@ -698,6 +832,10 @@ double MultireweightHistosPTJK::reweightSpecificHeatJK(double targetControlParam
     double firstMoment = 0;
     double secondMoment = 0;
     reweight1stMoment2ndMomentInternalJK(energyTimeSeries, w_kn, jkBlock, firstMoment, secondMoment);
+    double sums[2] = {firstMoment, secondMoment};
+    distribution->sum(sums, 2);
+    firstMoment = sums[0];
+    secondMoment = sums[1];
     double result = systemSize * pow(targetControlParameter, 2) *
         (secondMoment - pow(firstMoment, 2));;
 
@@ -711,6 +849,7 @@ double MultireweightHistosPTJK::reweightObservableJK(double targetControlParamet
 
     double result = 0;
     reweight1stMomentInternalJK(observableTimeSeries, w_kn, jkBlock, result);
+    distribution->sum(&result, 1);
 
     //destroyAll(w_kn);
 
@@ -722,6 +861,7 @@ double MultireweightHistosPTJK::reweightObservableSusceptibilityPartJK(double ta
 
     double secondMoment = 0;
     reweight2ndMomentInternalJK(observableTimeSeries, w_kn, jkBlock, secondMoment);
+    distribution->sum(&secondMoment, 1);
     double result = systemSize * secondMoment;
 
     //destroyAll(w_kn);
@@ -736,6 +876,10 @@ double MultireweightHistosPTJK::reweightObservableSusceptibilityJK(
     double firstMoment = 0;
     double secondMoment = 0;
     reweight1stMoment2ndMomentInternalJK(observableTimeSeries, w_kn, jkBlock, firstMoment, secondMoment);
+    double sums[2] = {firstMoment, secondMoment};
+    distribution->sum(sums, 2);
+    firstMoment = sums[0];
+    secondMoment = sums[1];
     double result = systemSize * (secondMoment - pow(firstMoment, 2));;
 
     // destroyAll(w_kn);
@@ -751,6 +895,10 @@ double MultireweightHistosPTJK::reweightObservableBinderJK(double targetControlP
     double fourthMoment = 0;
     reweight2ndMoment4thMomentInternalJK(observableTimeSeries, w_kn, jkBlock,
             secondMoment, fourthMoment);
+    double sums[2] = {secondMoment, fourthMoment};
+    distribution->sum(sums, 2);
+    secondMoment = sums[0];
+    fourthMoment = sums[1];
     double result = 1.0 - (fourthMoment / (3 * pow(secondMoment, 2)));
 
     // destroyAll(w_kn);
@@ -766,6 +914,10 @@ void MultireweightHistosPTJK::reweightObservableSecondFourthMomentJK(
 
     reweight2ndMoment4thMomentInternalJK(observableTimeSeries, w_kn, jkBlock,
                                          outSecondMoment, outFourthMoment);
+    double sums[2] = {outSecondMoment, outFourthMoment};
+    distribution->sum(sums, 2);
+    outSecondMoment = sums[0];
+    outFourthMoment = sums[1];
 }
 
 
@@ -777,6 +929,10 @@ double MultireweightHistosPTJK::reweightObservableBinderRatioJK(
     double fourthMoment = 0;
     reweight2ndMoment4thMomentInternalJK(observableTimeSeries, w_kn, jkBlock,
                                          secondMoment, fourthMoment);
+    double sums[2] = {secondMoment, fourthMoment};
+    distribution->sum(sums, 2);
+    secondMoment = sums[0];
+    fourthMoment = sums[1];
     double result = (fourthMoment / (pow(secondMoment, 2)));
 
     // destroyAll(w_kn);
@@ -789,12 +945,10 @@ MultireweightHistosPTJK::DoubleSeriesCollection MultireweightHistosPTJK::compute
 //  out << "Computing weights w_kn at cp=" << targetControlParameter << ", jackknife block:" << jkBlock << endl;
 
     vector<LogVal> arguments(binCount);
-    arguments[0] = lOmega_bm[jkBlock][0] * toLogValExp(-targetControlParameter * U_m[0]);
-    LogVal normalization = arguments[0];
-    for (unsigned m = 1; m < binCount; ++m) {
+    for (unsigned m = 0; m < binCount; ++m) {
         arguments[m] = lOmega_bm[jkBlock][m] * toLogValExp(-targetControlParameter * U_m[m]);
-        normalization += arguments[m];
     }
+    LogVal normalization = logSumExp(arguments);
     //normalize arguments, calculate weight corresponding to bin
     vector<double> weightFromBin(binCount);
     for (unsigned m = 0; m < binCount; ++m) {
@@ -839,12 +993,21 @@ ReweightingResult MultireweightHistosPTJK::reweight(double targetControlParamete
     vector<double> jkSusc_b(blockCount);
     vector<double> jkBinder_b(blockCount);
     vector<double> jkBinderRatio_b(blockCount);    
+    //weighted sums of moments for each block, from the local replicas
+    vector<double> sums_b(blockCount * MomentSumCount);
     #pragma omp parallel for
     for (signed b = 0; b < (signed)blockCount; ++b) {
         DoubleSeriesCollection w_kn = computeWeightsJK(targetControlParameter, b);
 
+        reweightJackknifeSumsInternal(b, w_kn, &sums_b[b * MomentSumCount]);
+
+        // destroyAll(w_kn);
+        out << '#' << flush;
+    }
+    distribution->sum(sums_b.data(), sums_b.size());
+    for (unsigned b = 0; b < blockCount; ++b) {
         ReweightingResult results =
-                reweightJackknifeInternal(targetControlParameter, b, w_kn);
+                resultFromMomentSums(targetControlParameter, &sums_b[b * MomentSumCount]);
         jkEnergy_b[b] = results.energyAvg;
         jkHeatCapacity_b[b] = results.heatCapacity;
         jkObs_b[b] = results.obsAvg;
@@ -852,9 +1015,6 @@ ReweightingResult MultireweightHistosPTJK::reweight(double targetControlParamete
         jkSusc_b[b] = results.obsSusc;
         jkBinder_b[b] = results.obsBinder;
         jkBinderRatio_b[b] = results.obsBinderRatio;
-
-        // destroyAll(w_kn);
-        out << '#' << flush;
     }
 
     //Jackknife for error and average (--> bias correction)
@@ -896,6 +1056,9 @@ ReweightedMomentsJK MultireweightHistosPTJK::reweightObservableMoments(
         
         out << '#' << flush;
     }
+    distribution->sum(jkBlocks_o.data(), jkBlocks_o.size());
+    distribution->sum(jkBlocks_o2.data(), jkBlocks_o2.size());
+    distribution->sum(jkBlocks_o4.data(), jkBlocks_o4.size());
 
     double mean_o  = 0;
     double mean_o2 = 0;
@@ -921,12 +1084,10 @@ HistogramDouble* MultireweightHistosPTJK::reweightEnergyHistogram(double targetC
     vector<LogVal> arguments(binCount);
     //histogram from whole data set
     vector<double> histo_m(binCount);
-    arguments[0] = lOmega_m[0] * toLogValExp(-targetControlParameter * U_m[0]);
-    LogVal normalization = arguments[0];
-    for (unsigned m = 1; m < binCount; ++m) {
+    for (unsigned m = 0; m < binCount; ++m) {
         arguments[m] = lOmega_m[m] * toLogValExp(-targetControlParameter * U_m[m]);
-        normalization += arguments[m];
     }
+    LogVal normalization = logSumExp(arguments);
     for (unsigned m = 0; m < binCount; ++m) {
         arguments[m] /= normalization;
         histo_m[m] = toDouble(arguments[m]);
@@ -938,12 +1099,10 @@ HistogramDouble* MultireweightHistosPTJK::reweightEnergyHistogram(double targetC
     #pragma omp parallel for
     for (signed b = 0; b < (signed)blockCount; ++ b) {
         vector<LogVal> args(binCount);
-        args[0] = lOmega_bm[b][0] * toLogValExp(-targetControlParameter * U_m[0]);
-        LogVal normalization = args[0];
-        for (unsigned m = 1; m < binCount; ++m) {
+        for (unsigned m = 0; m < binCount; ++m) {
             args[m] = lOmega_bm[b][m] * toLogValExp(-targetControlParameter * U_m[m]);
-            normalization += args[m];
         }
+        LogVal normalization = logSumExp(args);
         for (unsigned m = 0; m < binCount; ++m) {
             args[m] /= normalization;
             histo_bm[b][m] = toDouble(args[m]);
@@ -1016,6 +1175,7 @@ HistogramDouble* MultireweightHistosPTJK::reweightObservableHistogram(double tar
         // destroyAll(w_kn);
         cout << "#" << flush;
     }
+    distribution->sum(obsHisto_bm.data(), obsHisto_bm.num_elements());
 
     vector<double> sqDev(obsBinCount, 0);
     for (unsigned b = 0; b < blockCount; ++b) {
@@ -1041,12 +1201,10 @@ HistogramDouble* MultireweightHistosPTJK::reweightEnergyHistogramJK(
     vector<double> histo_m(binCount, 0.0);
 
     vector<LogVal> args(binCount);
-    args[0] = lOmega_bm[jkBlock][0] * toLogValExp(-targetControlParameter * U_m[0]);
-    LogVal normalization = args[0];
-    for (unsigned m = 1; m < binCount; ++m) {
+    for (unsigned m = 0; m < binCount; ++m) {
         args[m] = lOmega_bm[jkBlock][m] * toLogValExp(-targetControlParameter * U_m[m]);
-        normalization += args[m];
     }
+    LogVal normalization = logSumExp(args);
     for (unsigned m = 0; m < binCount; ++m) {
         args[m] /= normalization;
         histo_m[m] = toDouble(args[m]);
@@ -1087,6 +1245,7 @@ HistogramDouble* MultireweightHistosPTJK::reweightObservableHistogramJK(
         }
     }
     // destroyAll(w_kn);
+    distribution->sum(obsHisto_m.data(), obsHisto_m.size());
 
     HistogramDouble* result = new HistogramDouble;
     result->assignVector(obsHisto_m, minObservableNormalized, maxObservableNormalized,
@@ -1271,7 +1430,9 @@ void MultireweightHistosPTJK::findMaxObservableSusceptibility(double& cpMax, dou
     //jackknife blocking
     vector<double> jkSusc_b(blockCount);
     vector<double> jkCp_b(blockCount);
-    #pragma omp parallel for
+    //with several processes every evaluation sums over all of them:
+    //search the blocks one after the other, in lockstep on all processes
+    #pragma omp parallel for if (not distribution->isDistributed())
     for (signed b = 0; b < (signed)blockCount; ++b) {
         SuscMinCallableJK f(this, pointsEvaluatedJK[b], b);
         brentMinimize(jkCp_b[b], jkSusc_b[b], f, cpStart, cpEnd);
@@ -1305,7 +1466,8 @@ void MultireweightHistosPTJK::findMinBinder(double& cpMin,
     //jackknife blocking
     vector<double> jkBinder_b(blockCount);
     vector<double> jkCp_b(blockCount);
-    #pragma omp parallel for
+    //in lockstep with several processes, see findMaxObservableSusceptibility
+    #pragma omp parallel for if (not distribution->isDistributed())
     for (signed b = 0; b < (signed)blockCount; ++b) {
         BinderMinCallableJK f(this, pointsEvaluatedJK[b], b);
         brentMinimize(jkCp_b[b], jkBinder_b[b], f, cpStart, cpEnd);
@@ -1411,7 +1573,8 @@ void MultireweightHistosPTJK::findObservableEqualHeight(
     //jackknife blocking
     vector<double> jkRelDip_b(blockCount);
     vector<double> jkCp_b(blockCount);
-    #pragma omp parallel for
+    //in lockstep with several processes, see findMaxObservableSusceptibility
+    #pragma omp parallel for if (not distribution->isDistributed())
     for (signed b = 0; b < (signed)blockCount; ++b) {
         ObsHistogramPeakDiffMinCallableJK f(tolerance, numBins, this, b);
         double peakDiff = -1.;
@@ -1523,7 +1686,8 @@ void MultireweightHistosPTJK::findObservableEqualHeightWeight(
     vector<double> jkRelDipEW_b(blockCount);
     vector<double> jkCpEW_b(blockCount);
 
-    #pragma omp parallel for
+    //in lockstep with several processes, see findMaxObservableSusceptibility
+    #pragma omp parallel for if (not distribution->isDistributed())
     for (signed b = 0; b < (signed)blockCount; ++b) {
         ObsHistogramPeakDiffMinCallableJK fEH(tolerance, numBins, this, b);
         double peakDiff = -1.;
@@ -1596,7 +1760,8 @@ void MultireweightHistosPTJK::obsRelDip(
 
     //jackknife blocking
     vector<double> jkRelDip_b(blockCount);
-    #pragma omp parallel for
+    //in lockstep with several processes, see findMaxObservableSusceptibility
+    #pragma omp parallel for if (not distribution->isDistributed())
     for (signed b = 0; b < (signed)blockCount; ++b) {
         HistogramDouble* histojk = reweightObservableHistogramJK(
                 targetControlParameter, numBins, b);
@@ -1609,30 +1774,11 @@ void MultireweightHistosPTJK::obsRelDip(
 }
 
 
-//TODO: error estimation really should be put into a more general
-//function
 void MultireweightHistosPTJK::saveH_km_errors(const std::string & filename) {
     ofstream outHkmErrors(filename.c_str());
-    double factor = double(blockCount - 1) / double(blockCount);
     for (unsigned k = 0; k < numReplicas; ++k) {
         for (unsigned m = 0; m < binCount; ++m) {
-            //error estimation
-            double sqDev = 0;
-            double avgH_bkm = 0;
-            for (unsigned b = 0; b < blockCount; ++b) {
-                avgH_bkm += H_bkm[b][k][m];
-            }
-            avgH_bkm /= blockCount;
-            for (unsigned b = 0; b < blockCount; ++b) {
-                //the following original calculation was wrong:
-                //sqDev += pow(H_bkm[b][k][m] - H_km[k][m], 2);
-                //the totals of H_bkm are always smaller than the
-                //totals of H_km !
-                sqDev += pow(H_bkm[b][k][m] - avgH_bkm, 2);
-            }
-            double error = sqrt(factor * sqDev);
-
-            outHkmErrors << error << '\t';
+            outHkmErrors << HError_km[k][m] << '\t';
         }
         outHkmErrors << '\n';
     }
@@ -1652,12 +1798,10 @@ ReweightingResult MultireweightHistosPTJK::reweightDiscrete(double cp) {
     for (signed b = 0; b < (signed)blockCount; ++b) {
         //helper array:
         vector<LogVal> args(binCount);
-        args[0] = lOmega_bm[b][0] * toLogValExp(-cp * U_m[0]);
-        LogVal normalization = args[0];
-        for (unsigned m = 1; m < binCount; ++m) {
+        for (unsigned m = 0; m < binCount; ++m) {
             args[m] = lOmega_bm[b][m] * toLogValExp(-cp * U_m[m]);
-            normalization += args[m];
         }
+        LogVal normalization = logSumExp(args);
         double estEnergyNorm = 0;
         double estEnergySqNorm = 0;
         for (unsigned m = 0; m < binCount; ++m) {
@@ -1686,12 +1830,10 @@ double MultireweightHistosPTJK::reweightSpecificHeatDiscreteJK(
         double targetControlParameter, unsigned jkBlock) {
     //helper array:
     vector<LogVal> args(binCount);
-    args[0] = lOmega_bm[jkBlock][0] * toLogValExp(-targetControlParameter * U_m[0]);
-    LogVal normalization = args[0];
-    for (unsigned m = 1; m < binCount; ++m) {
+    for (unsigned m = 0; m < binCount; ++m) {
         args[m] = lOmega_bm[jkBlock][m] * toLogValExp(-targetControlParameter * U_m[m]);
-        normalization += args[m];
     }
+    LogVal normalization = logSumExp(args);
     double estEnergyNorm = 0;
     double estEnergySqNorm = 0;
     for (unsigned m = 0; m < binCount; ++m) {
@@ -33,11 +33,13 @@ private:
 
     //the following are related to data sets with one jackknife block left out
 
+    Int2Array H_bm;         //H_bm = sum_k {H_bkm}
+
+    //the following are only kept for the jackknife blocks owned by this
+    //process, indexed by distribution->localBlockIndex(b)
     typedef boost::multi_array<int, 3> Int3Array;
     Int3Array H_bkm;        //energy histogram: H_bkm[b][k][m] --> count of bin m from replica k, jackknife block b
-    Int2Array H_bm;         //H_bm = sum_k {H_bkm}
     typedef boost::multi_array<double, 3> Double3Array;
-    Double3Array g_bkm;     //g_bkm[b][k][m] --> statistical inefficiency of bin m in replica k, jackknife block b
 
     Int3Array H_blm;        //energy histogram: H_blm[b][l][m] --> count of bin m at inverse temperature l (accumulated from all replicas), jackknife block b
 
@@ -54,7 +56,13 @@ private:
 
     LogVal2Array lOmega_bm; //estimate of density of states (up to multiplicative factor), jackknife block b
 
+    Double2Array HError_km; //jackknife error of H_km, for saveH_km_errors
+
     void createHistogramsHelperJK();
+    void combineHistogramsJK();                     //sum over processes
+    void createBlockHistogramsJK();                 //H_bkm, H_blm, N_bkl for the blocks owned by each process
+    void estimateH_km_errors();
+    void combineBlockRows(LogVal2Array& array_bx);  //gather rows iterated by the owning processes
     void createHistogramsHelperDiscreteJK();
     void setUpHistogramsHelperJK();
     void setUpHistogramsJK(int binCount_);
@@ -64,7 +72,8 @@ private:
     void updateEffectiveCountsJK();                 //for all blocks
     void updateDensityOfStatesJK(unsigned block);   //for the indicated block
 
-    ReweightingResult reweightJackknifeInternal(double targetControlParameter, unsigned jkBlock, const DoubleSeriesCollection& w_kn);
+    //put the weighted sums of moments (indexed by MomentSum) with jackknife block jkBlock left out into sums
+    void reweightJackknifeSumsInternal(unsigned jkBlock, const DoubleSeriesCollection& w_kn, double* sums);
 
     //FS-multi-reweighting for one specific observable, one jackknife block
     void reweight1stMomentInternalJK(const DoubleSeriesCollection& timeSeries,
@@ -81,6 +90,8 @@ private:
             const DoubleSeriesCollection& timeSeries,
             const DoubleSeriesCollection& w_kn, unsigned jkBlock,
             double& secondMoment, double& fourthMoment);
+    //the following combine the sums over all processes: every process
+    //has to evaluate the same blocks at the same control parameters
     double reweightEnergyJK(double targetControlParameter, unsigned jkBlock);
     double reweightSpecificHeatJK(double targetControlParameter, unsigned jkBlock);
     double reweightSpecificHeatDiscreteJK(double targetControlParameter, unsigned jkBlock);
@@ -93,7 +104,8 @@ private:
                                                 double targetControlParameter, unsigned jkBlock);
     double reweightObservableBinderRatioJK(double targetControlParameter, unsigned jkBlock);    
 
-    //reweight histograms taking only data from one of the jackknife blocks
+    //reweight histograms taking only data from one of the jackknife blocks,
+    //the observable histogram is summed over all processes as above
     HistogramDouble* reweightEnergyHistogramJK(double targetControlParameter,
             unsigned jkBlock);
     HistogramDouble* reweightObservableHistogramJK(double targetControlParameter,
@@ -125,8 +137,8 @@ public:
     //here: additional Jackknife error estimation
     virtual ResultsMap* directNoReweighting();
 
-    //estimate jackknife errors of H_km, write them out as simple table
-    //("companion" to saveH_km)
+    //write out the jackknife errors of H_km, estimated while creating the
+    //histograms, as simple table ("companion" to saveH_km)
     void saveH_km_errors(const std::string& filename);
 
     virtual void findDensityOfStatesNonIteratively();
@@ -18,6 +18,7 @@
 
 
 #include <algorithm>
+#include <limits>
 #include <omp.h>
 #include <memory>
 #include "boost/algorithm/string.hpp" // boost::split
@@ -29,6 +30,7 @@
 #include "datamapwriter.h"
 #include "statistics.h"
 #include "numerics.h"
+#include "logvalkernels.h"
 
 using namespace std;
 
@@ -38,7 +40,7 @@ template void printVector<double>(const vector<double>&);
 MultireweightHistosPT::MultireweightHistosPT(ostream& outStream) :
     numReplicas(0), systemN(0), systemSize(0),
     minEnergyNormalized(0), maxEnergyNormalized(0), binCount(0), binSize(0), lBinSize(1.0),
-    out(outStream), basicConfig(false)
+    out(outStream), basicConfig(false), newtonSolver(false), distribution(new MrptDistribution)
 {
     out << "max threads: " << omp_get_max_threads() << endl;
 }
@@ -46,6 +48,64 @@ MultireweightHistosPT::MultireweightHistosPT(ostream& outStream) :
 MultireweightHistosPT::~MultireweightHistosPT() {
 }
 
+void MultireweightHistosPT::setDistribution(std::shared_ptr<MrptDistribution> distribution_) {
+    distribution = distribution_;
+    if (distribution->isDistributed()) {
+        out << "process " << distribution->processIndex() << " of "
+            << distribution->numProcesses() << endl;
+    }
+}
+
+void MultireweightHistosPT::checkNotDistributed(const std::string& feature) const {
+    if (distribution->isDistributed()) {
+        throw GeneralError(feature + " is not supported when the analysis is distributed over several processes");
+    }
+}
+
+void MultireweightHistosPT::checkSystemN(const std::string& filename, unsigned N) {
+    if (systemN == 0) {
+        systemN = N;
+    } else if (systemN != N) {
+        throw GeneralError("in " + filename + ": Non matching system sizes: " +
+                           numToString(N) + " vs. " + numToString(systemN));
+    }
+}
+
+void MultireweightHistosPT::addRemoteTimeSeries(const std::string& filename, const std::string& obs,
+                                                bool isEnergy, unsigned N) {
+    out << obs << " - held by another process" << endl;
+    if (isEnergy) {
+        ++addedEnergyTimeSeries;
+    } else if (observable == "" or obs == observable) {
+        observable = obs;
+        ++addedObservableTimeSeries;
+    } else {
+        throw GeneralError("in " + filename + ": Observable doesn't match previous\n" +
+                           obs + " vs. " + observable + "\n");
+    }
+    checkSystemN(filename, N);
+}
+
+//replica index of a single column time series from its meta data
+static unsigned singleColumnReplicaIndex(DoubleSeriesLoader& input,
+                                         const std::string& controlParameterName,
+                                         const std::vector<double>& controlParameterValues) {
+    unsigned replicaIndex;
+    try {
+        input.getMeta("replicaIndex", replicaIndex);
+    } catch (KeyUndefined& exc) {
+        try {
+            input.getMeta("controlParameterIndex", replicaIndex);
+        } catch (KeyUndefined& exc) {
+            // controlParameterIndex not defined --> get it from the actual controlParameter value
+            double targetValue;
+            input.getMeta(controlParameterName, targetValue);
+            replicaIndex = (uint32_t)findNearest(controlParameterValues, targetValue);
+        }
+    }
+    return replicaIndex;
+}
+
 void MultireweightHistosPT::addSimulationInfo(const std::string& filename) {
     MetadataMap info = readOnlyMetadata(filename);
 
@@ -164,9 +224,23 @@ void MultireweightHistosPT::addInputTimeSeries_twoColumn(const std::string& file
     }
     DoubleSeriesLoader input;
     out << "adding time-series " << filename << " - " << flush;
+    unsigned replicaIndex;
+    if (distribution->isDistributed()) {
+        //look at the meta data and the first row only, the time series
+        //is loaded by the process owning the replica
+        input.readFromFile(filename, 1, 0, 1);
+        input.getMeta("r", replicaIndex);
+        if (not distribution->ownsReplica(replicaIndex)) {
+            string obs;
+            input.getMeta("observable", obs);
+            unsigned N;
+            input.getMeta("N", N);
+            addRemoteTimeSeries(filename, obs, obs == "energy", N);
+            return;
+        }
+    }
     input.readFromFile(filename, subsample, discardEntries, infoNumSamples);
     
-    unsigned replicaIndex;
     input.getMeta("r", replicaIndex);
     string obs;
     input.getMeta("observable", obs);
@@ -214,12 +288,7 @@ void MultireweightHistosPT::addInputTimeSeries_twoColumn(const std::string& file
     }
     unsigned N;
     input.getMeta("N", N);
-    if (systemN == 0) {
-        systemN = N;
-    } else if (systemN != N) {
-        throw GeneralError("in " + filename + ": Non matching system sizes: " +
-                           numToString(N) + " vs. " + numToString(systemN));
-    }
+    checkSystemN(filename, N);
 }
 
 void MultireweightHistosPT::addInputTimeSeries_singleColumn(const std::string& filename, unsigned subsample, unsigned discardEntries) {
@@ -229,6 +298,21 @@ void MultireweightHistosPT::addInputTimeSeries_singleColumn(const std::string& f
     
     DoubleSeriesLoader input;
     out << "adding time-series " << filename << " - " << flush;
+    if (distribution->isDistributed()) {
+        //look at the meta data and the first row only, the time series
+        //is loaded by the process owning the replica
+        input.readFromFile(filename, 1, 0, 1);
+        unsigned replicaIndex = singleColumnReplicaIndex(input, controlParameterName,
+                                                         controlParameterValues);
+        if (not distribution->ownsReplica(replicaIndex)) {
+            string obs;
+            input.getMeta("observable", obs);
+            unsigned N;
+            input.getMeta("N", N);
+            addRemoteTimeSeries(filename, obs, obs == "energy" or obs == "associatedEnergy", N);
+            return;
+        }
+    }
     input.readFromFile(filename, subsample, discardEntries, infoNumSamples);
 
     if (input.getColumns() != 1) {
@@ -236,19 +320,8 @@ void MultireweightHistosPT::addInputTimeSeries_singleColumn(const std::string& f
                            numToString(input.getColumns()) + " columns");
     }
     
-    unsigned replicaIndex;
-    try {
-        input.getMeta("replicaIndex", replicaIndex);
-    } catch (KeyUndefined& exc) {
-        try {
-            input.getMeta("controlParameterIndex", replicaIndex);
-        } catch (KeyUndefined& exc) {
-            // controlParameterIndex not defined --> get it from the actual controlParameter value
-            double targetValue;
-            input.getMeta(controlParameterName, targetValue);
-            replicaIndex = (uint32_t)findNearest(controlParameterValues, targetValue);
-        }
-    }
+    unsigned replicaIndex = singleColumnReplicaIndex(input, controlParameterName,
+                                                     controlParameterValues);
     
     string obs;
     input.getMeta("observable", obs);
@@ -293,15 +366,11 @@ void MultireweightHistosPT::addInputTimeSeries_singleColumn(const std::string& f
     }
     unsigned N;
     input.getMeta("N", N);
-    if (systemN == 0) {
-        systemN = N;
-    } else if (systemN != N) {
-        throw GeneralError("in " + filename + ": Non matching system sizes: " +
-                           numToString(N) + " vs. " + numToString(systemN));
-    }
+    checkSystemN(filename, N);
 }
 
 void MultireweightHistosPT::sortTimeSeriesByControlParameter() {
+    checkNotDistributed("Sorting time series by control parameter");
     out << "Sorting time series by control parameter..." << flush;
 
     if (addedObservableTimeSeries > 0) {
@@ -366,6 +435,7 @@ void MultireweightHistosPT::sortTimeSeriesByControlParameter() {
 
 MultireweightHistosPT::ResultsMap* MultireweightHistosPT::
         directNoReweighting() {
+    checkNotDistributed("Direct estimation without reweighting");
     out << "Computing estimates from time series without any reweighting... "
         << flush;
 
@@ -456,6 +526,48 @@ MultireweightHistosPT::ResultsMap* MultireweightHistosPT::
     return results;
 }
 
+void MultireweightHistosPT::findGlobalMinMax(const DoubleSeriesCollection& timeSeries,
+                                             double& min, double& max) {
+    bool haveLocalData = false;
+    for (const auto& series : timeSeries) {
+        if (series and series->size() > 0) {
+            haveLocalData = true;
+            break;
+        }
+    }
+    if (haveLocalData) {
+        findMinMax(timeSeries, min, max);
+    } else {
+        min = std::numeric_limits<double>::infinity();
+        max = -std::numeric_limits<double>::infinity();
+    }
+    distribution->minMax(min, max);
+    if (min > max) {
+        //no data at all
+        min = 0;
+        max = 0;
+    }
+}
+
+void MultireweightHistosPT::combineHistograms() {
+    distribution->sum(H_km.data(), H_km.num_elements());
+    distribution->sum(H_m.data(), H_m.size());
+    distribution->sum(H_lm.data(), H_lm.num_elements());
+    distribution->sum(N_kl.data(), N_kl.num_elements());
+}
+
+void MultireweightHistosPT::combineReplicaRows(Double2Array& array_km) {
+    if (not distribution->isDistributed()) {
+        return;
+    }
+    for (unsigned k = 0; k < numReplicas; ++k) {
+        if (not distribution->ownsReplica(k)) {
+            std::fill(array_km[k].begin(), array_km[k].end(), 0.0);
+        }
+    }
+    distribution->sum(array_km.data(), array_km.num_elements());
+}
+
 void MultireweightHistosPT::setUpHistograms(int binCount_) {
     if (addedEnergyTimeSeries == 0) {
         throw GeneralError("No energy time series added!");
@@ -486,7 +598,7 @@ void MultireweightHistosPT::setUpHistograms(int binCount_) {
 
     binCount = binCount_;
 
-    findMinMax(energyTimeSeries, minEnergyNormalized, maxEnergyNormalized);
+    findGlobalMinMax(energyTimeSeries, minEnergyNormalized, maxEnergyNormalized);
     minEnergy = minEnergyNormalized * systemSize;
     maxEnergy = maxEnergyNormalized * systemSize;
     deltaU = (maxEnergyNormalized - minEnergyNormalized) / binCount;
@@ -495,7 +607,7 @@ void MultireweightHistosPT::setUpHistograms(int binCount_) {
     lBinSize = LogVal(binSize);
 
     if (addedObservableTimeSeries > 0) {
-        findMinMax(observableTimeSeries, minObservableNormalized, maxObservableNormalized);
+        findGlobalMinMax(observableTimeSeries, minObservableNormalized, maxObservableNormalized);
     }
 
     U_m.resize(binCount);
@@ -553,7 +665,7 @@ void MultireweightHistosPT::setUpHistogramsIsing() {
         }
     }
 
-    findMinMax(energyTimeSeries, minEnergyNormalized, maxEnergyNormalized);
+    findGlobalMinMax(energyTimeSeries, minEnergyNormalized, maxEnergyNormalized);
 
     //actual min and max energies:
     minEnergy = round(minEnergyNormalized * double(systemSize));
@@ -573,7 +685,7 @@ void MultireweightHistosPT::setUpHistogramsIsing() {
     lBinSize = LogVal(binSize);
 
     if (addedObservableTimeSeries) {
-        findMinMax(observableTimeSeries, minObservableNormalized, maxObservableNormalized);
+        findGlobalMinMax(observableTimeSeries, minObservableNormalized, maxObservableNormalized);
     }
 
     U_m.resize(binCount);
@@ -627,6 +739,7 @@ void MultireweightHistosPT::createHistogramsHelper() {
         }
         out << "." << flush;
     }
+    combineHistograms();
 
     //not needed any more
     cpiTimeSeries.clear();  
@@ -661,6 +774,7 @@ void MultireweightHistosPT::createHistogramsHelperDiscrete() {
         }
         out << "." << flush;
     }
+    combineHistograms();
 
     //not needed any more
     cpiTimeSeries.clear();
@@ -696,6 +810,9 @@ void MultireweightHistosPT::measureGlobalInefficiencies(bool saveAutocorr) {
 
     #pragma omp parallel for
     for (int k = 0; k < (signed)numReplicas; ++k) {
+        if (not distribution->ownsReplica(k)) {
+            continue;
+        }
         std::shared_ptr<AutoCorrMap> autocorr;
         if (saveAutocorr) {
             autocorr.reset(new AutoCorrMap);
@@ -724,10 +841,13 @@ void MultireweightHistosPT::measureGlobalInefficiencies(bool saveAutocorr) {
         fs::current_path("..");
     }
 
+    combineReplicaRows(g_km);
+
     out << " done" << endl;
 }
 
 void MultireweightHistosPT::writeOutEnergyTauInt(const std::string& filename) {
+    checkNotDistributed("Writing out integrated autocorrelation times");
     out << "Estimating energy tau-ints... " << endl;
     std::shared_ptr<map<double, double> > tauint(new map<double, double>);
     #pragma omp parallel for
@@ -753,6 +873,7 @@ void MultireweightHistosPT::writeOutEnergyTauInt(const std::string& filename) {
 }
 
 void MultireweightHistosPT::writeOutObsTauInt(const std::string& filename) {
+    checkNotDistributed("Writing out integrated autocorrelation times");
     out << "Estimating " << observable << " tau-ints... " << endl;
     std::shared_ptr<map<double, double> > tauint(new map<double, double>);
     #pragma omp parallel for
@@ -908,6 +1029,8 @@ void MultireweightHistosPT::measureBinInefficiencies(bool saveAutocorr) {
         fs::current_path("..");
     }
 
+    combineReplicaRows(g_km);
+
     out << " done" << endl;
 }
 
@@ -998,16 +1121,19 @@ inline void MultireweightHistosPT::updateEffectiveCounts() {
 inline void MultireweightHistosPT::updateDensityOfStates() {
     //precalculated the part that does not depend on the estimates of the partition functions
     //lPrecalc_lm[l][m] = lNeff_lm[l][m] * lBinSize * toLogValExp(-betas[l] * U_m[m]);
-    for (int m = 0; m < (signed)binCount; ++m) {
-        lOmega_m[m] = lHeff_m[m];
-        LogVal denominator = lPrecalc_lm[0][m] / lZ_l[0];
-        for (unsigned l = 1; l < numReplicas; ++l) {
-            denominator += lPrecalc_lm[l][m] / lZ_l[l];
-        }
-        lOmega_m[m] /= denominator;
+    //ln of the denominators sum_l lPrecalc_lm[l][m] / lZ_l[l] in lOmega_m, then divide
+    lv_logSumExpColumns(lv_lnx(lOmega_m.data()), lv_lnx(lPrecalc_lm.data()),
+                        numReplicas, binCount, binCount, lv_lnx(lZ_l.data()));
+    for (unsigned m = 0; m < binCount; ++m) {
+        lOmega_m[m].lnx = lHeff_m[m].lnx - lOmega_m[m].lnx;
     }
 }
 
+LogVal MultireweightHistosPT::partitionFunction(const LogVal* lOmega, double controlParameter) const {
+    return lBinSize * toLogValExp(lv_logSumExp(lv_lnx(lOmega), U_m.data(),
+                                               -controlParameter, binCount));
+}
+
 void MultireweightHistosPT::findDensityOfStatesNonIteratively() {
     out << "Non-iterative estimate of the density of states... " << flush;
 
@@ -1064,12 +1190,10 @@ void MultireweightHistosPT::findDensityOfStatesNonIteratively() {
 
 ReweightingResult MultireweightHistosPT::reweightDiscrete(double targetControlParameter) {
     vector<LogVal> arguments(binCount);
-    arguments[0] = lOmega_m[0] * toLogValExp(-targetControlParameter * U_m[0]);
-    LogVal normalization = arguments[0];
-    for (unsigned m = 1; m < binCount; ++m) {
+    for (unsigned m = 0; m < binCount; ++m) {
         arguments[m] = lOmega_m[m] * toLogValExp(-targetControlParameter * U_m[m]);
-        normalization += arguments[m];
     }
+    LogVal normalization = logSumExp(arguments);
 
     double estEnergyNorm = 0;
     double estEnergySqNorm = 0;
@@ -1091,11 +1215,37 @@ ReweightingResult MultireweightHistosPT::reweightDiscrete(double targetControlPa
     return result;
 }
 
+void MultireweightHistosPT::setNewtonSolver(bool useNewton) {
+    newtonSolver = useNewton;
+}
+
+bool MultireweightHistosPT::effectiveCountsBinIndependent(const LogVal* lNeff) const {
+    const double binIndependenceTolerance = 1e-10;
+    for (unsigned l = 0; l < numReplicas; ++l) {
+        for (unsigned m = 1; m < binCount; ++m) {
+            if (std::fabs(lNeff[l * binCount + m].lnx - lNeff[l * binCount].lnx) > binIndependenceTolerance) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 void MultireweightHistosPT::findPartitionFunctionsAndDensityOfStates(double tolerance, int maxIterations) {
     out << "Updating effective counts... " << flush;
     updateEffectiveCounts();
     out << "Done." << endl;
 
+    if (newtonSolver) {
+        if (not effectiveCountsBinIndependent(lNeff_lm.data())) {
+            out << "Effective counts depend on the energy bin, not using Newton's method." << endl;
+        } else if (minimizeFreeEnergies(lZ_l.data(), lHeff_m.data(), lPrecalc_lm.data(), lNeff_lm.data(),
+                                        tolerance, maxIterations)) {
+            updateDensityOfStates();
+            out << "Checking the result with the fixed-point iteration" << endl;
+        }
+    }
+
     out << "Starting iteration to estimate density of states, tolerance=" << tolerance << " maxIterations=" << maxIterations << endl;
 
 //  updateDensityOfStates();
@@ -1111,17 +1261,11 @@ void MultireweightHistosPT::findPartitionFunctionsAndDensityOfStates(double tole
         deltaSquared = 0;
 
         //update estimates of partition functions
-        lZ_l[0] = lOmega_m[0] * lBinSize * toLogValExp(-controlParameterValues[0] * U_m[0]);
-        for (unsigned m = 1; m < binCount; ++m) {
-            lZ_l[0] += lOmega_m[m] * lBinSize * toLogValExp(-controlParameterValues[0] * U_m[m]);
-        }
+        lZ_l[0] = partitionFunction(lOmega_m.data(), controlParameterValues[0]);
         #pragma omp parallel for reduction(+: deltaSquared)
         for (int l = 1; l < (signed)numReplicas; ++l) {
             lZ_l_lastIteration[l] = lZ_l[l];            //store old value
-            lZ_l[l] = lOmega_m[0] * lBinSize * toLogValExp(-controlParameterValues[l] * U_m[0]);
-            for (unsigned m = 1; m < binCount; ++m) {
-                lZ_l[l] += lOmega_m[m] * lBinSize * toLogValExp(-controlParameterValues[l] * U_m[m]);
-            }
+            lZ_l[l] = partitionFunction(lOmega_m.data(), controlParameterValues[l]);
             lZ_l[l] /= lZ_l[0];             //normalize
 
             deltaSquared += pow(expm1(lZ_l[l].lnx - lZ_l_lastIteration[l].lnx), 2);     //gauge change from last iteration
@@ -1142,12 +1286,10 @@ MultireweightHistosPT::DoubleSeriesCollection MultireweightHistosPT::computeWeig
     out << " " << targetControlParameter << flush;
 
     vector<LogVal> arguments(binCount);
-    arguments[0] = lOmega_m[0] * toLogValExp(-targetControlParameter * U_m[0]);
-    LogVal normalization = arguments[0];
-    for (unsigned m = 1; m < binCount; ++m) {
+    for (unsigned m = 0; m < binCount; ++m) {
         arguments[m] = lOmega_m[m] * toLogValExp(-targetControlParameter * U_m[m]);
-        normalization += arguments[m];
     }
+    LogVal normalization = logSumExp(arguments);
     //normalize arguments, calculate weight corresponding to bin
     vector<double> weightFromBin(binCount);
     for (unsigned m = 0; m < binCount; ++m) {
@@ -1242,6 +1384,7 @@ void MultireweightHistosPT::reweight1stMomentInternalWithoutErrors(const DoubleS
         out << ".";
     }
     out << '\n';
+    distribution->sum(&first, 1);
     firstMoment = first;
 }
 
@@ -1257,6 +1400,7 @@ void MultireweightHistosPT::reweight2ndMomentInternalWithoutErrors(const DoubleS
         out << ".";
     }
     out << '\n';
+    distribution->sum(&second, 1);
     secondMoment = second;
 }
 
@@ -1277,8 +1421,10 @@ void MultireweightHistosPT::reweight1stMoment2ndMomentInternalWithoutErrors(
         }
     }
     out << '#' << flush;
-    firstMoment = first;
-    secondMoment = second;
+    double sums[2] = {first, second};
+    distribution->sum(sums, 2);
+    firstMoment = sums[0];
+    secondMoment = sums[1];
 }
 
 void MultireweightHistosPT::reweight2ndMoment4thMomentInternalWithoutErrors(
@@ -1297,8 +1443,10 @@ void MultireweightHistosPT::reweight2ndMoment4thMomentInternalWithoutErrors(
         }
     }
     out << '#' << flush;
-    fourthMoment = fourth;
-    secondMoment = second;
+    double sums[2] = {second, fourth};
+    distribution->sum(sums, 2);
+    secondMoment = sums[0];
+    fourthMoment = sums[1];
 }
 
 ReweightingResult MultireweightHistosPT::reweightWithoutErrorsInternal
@@ -1327,14 +1475,33 @@ ReweightingResult MultireweightHistosPT::reweightWithoutErrorsInternal
         out << ".";
     }
 
+    double sums[MomentSumCount];
+    sums[SumEnergy] = meanEnergy;
+    sums[SumEnergySquared] = meanEnergySquared;
+    sums[SumObservable] = meanObservable;
+    sums[SumObservableSquared] = meanObservableSquared;
+    sums[SumObservableToTheFourth] = meanObservableToTheFourth;
+    distribution->sum(sums, MomentSumCount);
+
+    out << " Done." << endl;
+
+    return resultFromMomentSums(targetControlParameter, sums);
+}
+
+ReweightingResult MultireweightHistosPT::resultFromMomentSums(double targetControlParameter,
+                                                              const double* sums) const {
+    double meanEnergy = sums[SumEnergy];
+    double meanEnergySquared = sums[SumEnergySquared];
+    double meanObservable = sums[SumObservable];
+    double meanObservableSquared = sums[SumObservableSquared];
+    double meanObservableToTheFourth = sums[SumObservableToTheFourth];
+
     double heatCapacity = systemSize * targetControlParameter * targetControlParameter * (meanEnergySquared - pow(meanEnergy, 2));
     double suscObservable = systemSize * (meanObservableSquared - pow(meanObservable, 2));
     double binderObservable = 1.0 - (meanObservableToTheFourth / (3 * pow(meanObservableSquared, 2)));
     double binderRatioObservable = meanObservableToTheFourth / pow(meanObservableSquared, 2);
     double suscPartObservable = systemSize * meanObservableSquared;
 
-    out << " Done." << endl;
-
     return ReweightingResult(meanEnergy, heatCapacity, meanObservable,
         suscPartObservable, suscObservable, binderObservable, binderRatioObservable);
 }
@@ -1492,12 +1659,10 @@ HistogramDouble* MultireweightHistosPT::reweightEnergyHistogramWithoutErrors(
     result->total = 0;
 
     vector<LogVal> arguments(binCount);
-    arguments[0] = lOmega_m[0] * toLogValExp(-targetControlParameter * U_m[0]);
-    LogVal normalization = arguments[0];
-    for (unsigned m = 1; m < binCount; ++m) {
+    for (unsigned m = 0; m < binCount; ++m) {
         arguments[m] = lOmega_m[m] * toLogValExp(-targetControlParameter * U_m[m]);
-        normalization += arguments[m];
     }
+    LogVal normalization = logSumExp(arguments);
     for (unsigned m = 0; m < binCount; ++m) {
         arguments[m] /= normalization;
         double prob = toDouble(arguments[m]);
@@ -1527,6 +1692,7 @@ HistogramDouble* MultireweightHistosPT::reweightObservableHistogramUsingWeights(
 }
 
 void MultireweightHistosPT::computeAndSaveHistogramCrossCorr() {
+    checkNotDistributed("Estimating histogram cross correlations");
     out << "Estimating and saving histogram cross correlation tables... " << flush;
     typedef boost::multi_array<double, 3> Double3Array;
     Double3Array rho_kmm;      //cross correlation coefficients
@@ -1582,6 +1748,7 @@ void MultireweightHistosPT::computeAndSaveHistogramCrossCorr() {
 }
 
 void MultireweightHistosPT::computeAndSaveHistogramCrossCorrAlt() {
+    checkNotDistributed("Estimating histogram cross correlations");
     out << "Estimating and saving histogram cross correlation tables (alternative version) " << endl;
     typedef boost::multi_array<double, 3> Double3Array;
     Double3Array rho_kmm;      //cross correlation coefficients
@@ -1676,6 +1843,7 @@ void MultireweightHistosPT::reweightObservableHistogramInternal(double targetCon
             obsHisto[curBin] += (*w_kn[k])[n];
         }
     }
+    distribution->sum(obsHisto.data(), obsHisto.size());
 }
 
 HistogramDouble* MultireweightHistosPT::reweightObservableHistogramWithoutErrors(
@@ -31,6 +31,7 @@
 #include "histogram.h"
 #include "reweightingresult.h"
 #include "reweightedmomentsjk.h"
+#include "mrpt-distribution.h"
 
 //internally don't use the HistogramT class, which would use maps internally
 
@@ -107,6 +108,10 @@ public:
     MultireweightHistosPT(std::ostream& outStream = std::cout);
     virtual ~MultireweightHistosPT();
 
+    //the analysis can be distributed over several processes, each holding
+    //the time series of some replicas -- set this before adding time series
+    void setDistribution(std::shared_ptr<MrptDistribution> distribution_);
+
     void addSimulationInfo(const std::string& filename);        //pass "info.dat"...
     unsigned getSystemN() const { return systemN; }
     unsigned getSystemL() const { return systemL; }
@@ -180,6 +185,10 @@ public:
 
     virtual void findDensityOfStatesNonIteratively();       //using the method described in Fenwick, 2008 (uses histograms by temperature)
     virtual void findPartitionFunctionsAndDensityOfStates(double tolerance = 1E-7, int maxIterations = 1000);
+    //if set: before the fixed-point iteration above, minimize the equivalent convex
+    //objective for ln Z_l with Newton's method, the iteration then only checks the
+    //result.  Falls back to the plain iteration for bin-dependent inefficiencies.
+    void setNewtonSolver(bool useNewton);
 
     virtual void saveLogDensityOfStates(const std::string& filename);       //saves the logarithm. normalized to 0 for the central entry
     virtual void saveLogDensityOfStatesIsing(const std::string& filename);  //saves the logarithm. normalized to ln(2) for the lowest energy entry
@@ -287,20 +296,52 @@ protected:
     //interna
 
     bool basicConfig;
+    bool newtonSolver;
 
     unsigned addedEnergyTimeSeries;
     unsigned addedObservableTimeSeries;
 
+    std::shared_ptr<MrptDistribution> distribution;
+
+    //throw if the analysis is distributed, for features that need all time series in one process
+    void checkNotDistributed(const std::string& feature) const;
+    //count a time series that is held by another process
+    void addRemoteTimeSeries(const std::string& filename, const std::string& obs,
+                             bool isEnergy, unsigned N);
+    void checkSystemN(const std::string& filename, unsigned N);
+    //minimum and maximum over the time series of all processes
+    void findGlobalMinMax(const DoubleSeriesCollection& timeSeries, double& min, double& max);
+    //sum histograms and counts over all processes
+    void combineHistograms();
+    //combine per-replica rows computed by the owning processes
+    void combineReplicaRows(Double2Array& array_km);
+
     void createHistogramsHelper();
     void createHistogramsHelperDiscrete();
     void setUpHistograms(int binCount_);            //used in createHistograms (initializes data structures but does not set actual values)
     void setUpHistogramsIsing();
 
     void updateDensityOfStates();
+    //true if the effective counts lNeff[l][m] are the same for all bins m, as with
+    //global or unit inefficiencies -- required by minimizeFreeEnergies
+    bool effectiveCountsBinIndependent(const LogVal* lNeff) const;
+    //Newton minimization for lZ[l] given lHeff[m], lPrecalc[l][m], lNeff[l][m],
+    //lZ holds the starting values; returns false if it failed or is not applicable
+    bool minimizeFreeEnergies(LogVal* lZ, const LogVal* lHeff, const LogVal* lPrecalc,
+                              const LogVal* lNeff, double tolerance, int maxIterations,
+                              bool verbose = true);
+    //binSize * sum_m Omega_m e^{-cp U_m}, for the binCount values at lOmega
+    LogVal partitionFunction(const LogVal* lOmega, double controlParameter) const;
 
     DoubleSeriesCollection computeWeights(double targetControlParameter);       //determine weights w_kn(cp) (occupies a lot of memory, free later)
     ReweightingResult reweightWithoutErrorsInternal(double targetControlParameter, const DoubleSeriesCollection& w_kn);
 
+    //weighted sums of energy and observable moments, they are summed over
+    //processes before the derived quantities are computed
+    enum MomentSum { SumEnergy, SumEnergySquared, SumObservable, SumObservableSquared,
+                     SumObservableToTheFourth, MomentSumCount };
+    ReweightingResult resultFromMomentSums(double targetControlParameter, const double* sums) const;
+
     //return the expectation value of the first moment of some observable
     //with given weights, put the result into firstMoment
     void reweight1stMomentInternalWithoutErrors(
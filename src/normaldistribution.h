@@ -17,60 +17,48 @@
 #ifndef NORMALDISTRIBUTION_H_
 #define NORMALDISTRIBUTION_H_
 
-#include <stack>
+#include <vector>
 #include <cmath>
 #include "rngwrapper.h"
 
 typedef double num;
 
+// Standard normal variates are generated in blocks of blockSize by
+// RngWrapper::fillNormal() and handed out one by one.
 class NormalDistribution {
 	RngWrapper& rng;
-	std::stack<num> standard_normal_random_variables;			//stack is really overkill, but won't matter for now
-	void generate_box_muller();
+	std::vector<num> standard_normal_random_variables;
+	std::size_t next;			//index of the next variable to hand out
+	void generate_block();
 public:
-	NormalDistribution(RngWrapper& rng);
+	NormalDistribution(RngWrapper& rng, std::size_t blockSize = 64);
 
 	num get(num sigma, num mean);
 
 	void reset();			//clear internal state (standard_normal_random_variables) -- no worrying about serialization
 };
 
-inline NormalDistribution::NormalDistribution(RngWrapper& rng_)
-	: rng(rng_) {
+inline NormalDistribution::NormalDistribution(RngWrapper& rng_, std::size_t blockSize)
+	: rng(rng_), standard_normal_random_variables(blockSize > 0 ? blockSize : 1),
+	  next(standard_normal_random_variables.size()) {
 }
 
 inline void NormalDistribution::reset() {
-	standard_normal_random_variables = std::stack<num>();
+	next = standard_normal_random_variables.size();
 }
 
-
-// cf. http://en.wikipedia.org/wiki/Box%E2%80%93Muller_transform#Polar_form
-// or Numerical Recipes
-inline void NormalDistribution::generate_box_muller() {
-	using namespace std;
-
-	num v1, v2, rsq;
-	do {
-		num u1 = rng.rand01();
-		num u2 = rng.rand01();
-		v1 = 2.0*u1 - 1.0;
-		v2 = 2.0*u2 - 1.0;
-		rsq = v1*v1 + v2*v2;
-	} while (rsq >= 1.0 or rsq == 0.0);		//pick v1, v2 on unit circle
-
-	// [polar] Box-Muller transform
-	num fac = sqrt(-2.0 * log(rsq) / rsq);
-	standard_normal_random_variables.push(v1 * fac);
-	standard_normal_random_variables.push(v2 * fac);
+inline void NormalDistribution::generate_block() {
+	rng.fillNormal(standard_normal_random_variables.data(),
+	               standard_normal_random_variables.size());
+	next = 0;
 }
 
 
 inline num NormalDistribution::get(num sigma, num mean) {
-	if (standard_normal_random_variables.empty()) {
-		generate_box_muller();
+	if (next == standard_normal_random_variables.size()) {
+		generate_block();
 	}
-	num var = standard_normal_random_variables.top();
-	standard_normal_random_variables.pop();
+	num var = standard_normal_random_variables[next++];
 
 	return mean + sigma * var;
 }
@@ -16,7 +16,8 @@
 
 #include "observablehandler.h"
 
-void outputResults(const std::vector<std::unique_ptr<ScalarObservableHandler>>& obsHandlers) {
+void outputResults(const std::vector<std::unique_ptr<ScalarObservableHandler>>& obsHandlers,
+                   AsyncWriter& writer) {
     typedef std::map<std::string, num> StringNumMap;
     typedef std::shared_ptr<StringNumMap> StringNumMapPtr;
 
@@ -29,18 +30,19 @@ void outputResults(const std::vector<std::unique_ptr<ScalarObservableHandler>>&
         (*values)[obsname] = val;
         (*errors)[obsname] = err;
     }
-    DataMapWriter<std::string, num> output;
-    output.setData(values);
-    output.setErrors(errors);
-    output.addHeaderText("Monte Carlo results for observable expectation values");
-    output.addMetadataMap((*obsHandlers.begin())->metaModel);
-    output.addMetadataMap((*obsHandlers.begin())->metaMC);
-    output.addMeta("key", "observable");
-    output.addHeaderText("observable\t value \t error");
-    output.writeToFile("results.values");
+    std::shared_ptr<DataMapWriter<std::string, num>> output(new DataMapWriter<std::string, num>);
+    output->setData(values);
+    output->setErrors(errors);
+    output->addHeaderText("Monte Carlo results for observable expectation values");
+    output->addMetadataMap((*obsHandlers.begin())->metaModel);
+    output->addMetadataMap((*obsHandlers.begin())->metaMC);
+    output->addMeta("key", "observable");
+    output->addHeaderText("observable\t value \t error");
+    writer.submit([output]() { output->writeToFile("results.values"); });
 }
 
-void outputResults(const std::vector<std::unique_ptr<VectorObservableHandler>>& obsHandlers) {
+void outputResults(const std::vector<std::unique_ptr<VectorObservableHandler>>& obsHandlers,
+                   AsyncWriter& writer) {
     typedef std::map<num, num> NumMap;
     typedef std::shared_ptr<NumMap> NumMapPtr;
     typedef DataMapWriter<num,num> NumMapWriter;
@@ -57,17 +59,18 @@ void outputResults(const std::vector<std::unique_ptr<VectorObservableHandler>>&
             valmap->insert(std::make_pair(index, values[counter]));
             errmap->insert(std::make_pair(index, errors[counter]));
         }
-        NumMapWriter output;
-        output.setData(valmap);
-        output.setErrors(errmap);
-        output.addHeaderText("Monte Carlo results for vector observable " + obsptr->name +
+        std::shared_ptr<NumMapWriter> output(new NumMapWriter);
+        output->setData(valmap);
+        output->setErrors(errmap);
+        output->addHeaderText("Monte Carlo results for vector observable " + obsptr->name +
                 " expectation values");
-        output.addMetadataMap(obsptr->metaModel);
-        output.addMetadataMap(obsptr->metaMC);
-        output.addMeta("key", obsptr->indexName);
-        output.addMeta("observable", obsptr->name);
-        output.addHeaderText("key\t value \t error");
-        output.writeToFile("results-" + obsptr->name + ".values");
+        output->addMetadataMap(obsptr->metaModel);
+        output->addMetadataMap(obsptr->metaMC);
+        output->addMeta("key", obsptr->indexName);
+        output->addMeta("observable", obsptr->name);
+        output->addHeaderText("key\t value \t error");
+        std::string filename = "results-" + obsptr->name + ".values";
+        writer.submit([output, filename]() { output->writeToFile(filename); });
     }
 }
 
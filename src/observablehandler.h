@@ -22,6 +22,7 @@
 // calculate expectation values and jackknife error bars
 // optionally store time series
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <map>
@@ -34,6 +35,7 @@
 #include "dataserieswritersucc.h"
 #include "datamapwriter.h"
 #include "statistics.h"
+#include "asyncwriter.h"
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
@@ -62,7 +64,7 @@ public:
           jkBlockCount(mcparams.jkBlocks),
           jkBlockSizeSweeps(mcparams.sweeps / jkBlockCount),
           lastSweepLogged(0), countValues(0),
-          jkBlockValues(jkBlockCount, zero),
+          jkBlockSums(jkBlockCount + 1, zero),
           total(zero) {
     }
 
@@ -74,12 +76,8 @@ public:
     // sweeps must be constant.
     void insertValue(uint32_t curSweep) {
         ObsType const value = obs.valRef;
-        uint32_t curJkBlock = curSweep / jkBlockSizeSweeps;
-        for (uint32_t jb = 0; jb < jkBlockCount; ++jb) {
-            if (jb != curJkBlock) {
-                jkBlockValues[jb] += value;
-            }
-        }
+        uint32_t curJkBlock = std::min(curSweep / jkBlockSizeSweeps, jkBlockCount);
+        jkBlockSums[curJkBlock] += value;
         total += value;
         ++countValues;
         lastSweepLogged = curSweep;
@@ -100,7 +98,7 @@ public:
                 uint32_t jkBlockSizeSamples = countValues / jkBlockCount;
                 uint32_t jkTotalSamples = countValues - jkBlockSizeSamples;
 //              std::cout << jkTotalSamples << std::endl;
-                std::vector<ObsType> jkBlockAverages = jkBlockValues;   //copy
+                std::vector<ObsType> jkBlockAverages = jackknifeLeaveOneOutSums(jkBlockSums, zero);
                 for (uint32_t jb = 0; jb < jkBlockCount; ++jb) {
                     jkBlockAverages[jb] /= jkTotalSamples;
                 }
@@ -124,7 +122,8 @@ protected:
     uint32_t lastSweepLogged;
     uint32_t countValues;
 
-    std::vector<ObsType> jkBlockValues;         // running counts of jackknife block values
+    std::vector<ObsType> jkBlockSums;           // running sums of values in each jackknife block,
+                                                // last entry: values after the last complete block
     ObsType total;                              // running accumulation regardless of jackknife block
 public:
     // serialization by DetQMC::serializeContents
@@ -132,8 +131,25 @@ public:
     void serializeContents(Archive &ar) {
         ar & lastSweepLogged;
         ar & countValues;
-        ar & jkBlockValues;
-        ar & total;
+        if (Archive::is_loading::value and mcparams.stateVersion < 4) {
+            //older state file: leave-one-out sums for the jackknife blocks
+            std::vector<ObsType> jkLeaveOneOutSums;
+            ar & jkLeaveOneOutSums;
+            ar & total;
+            checkJkBlockCount(jkLeaveOneOutSums.size(), jkBlockCount);
+            jkBlockSums = jackknifeBlockSumsFromLeaveOneOutSums(jkLeaveOneOutSums, total, zero);
+        } else {
+            ar & jkBlockSums;
+            ar & total;
+            checkJkBlockCount(jkBlockSums.size(), jkBlockCount + 1);
+        }
+    }
+private:
+    void checkJkBlockCount(std::size_t loaded, std::size_t expected) const {
+        if (loaded != expected) {
+            throw_GeneralError("State file holds " + numToString(loaded) + " jackknife entries for observable "
+                               + name + ", expected " + numToString(expected));
+        }
     }
 };
 
@@ -186,43 +202,59 @@ public:
     }
 
     //update timeseries file, discard batch of
-    //data written to file from memory
-    void outputTimeseries() {
+    //data written to file from memory.
+    //The batch is handed over to writer, which also exclusively
+    //accesses *storage.
+    void outputTimeseries(AsyncWriter& writer) {
         //TODO: reserve reasonable amount of memory for data to be added afterwards
         //TODO: float precision
         if (mcparams.timeseries) {
-            if (not storage) {
-                std::string filename = name + ".series";
-                if (not storageFileStarted) {
-                    storage = std::unique_ptr<DoubleVectorWriterSuccessive>(
-                            new DoubleVectorWriterSuccessive(filename,
-                                    false // create a new file
-                            ));
-                    storage->addHeaderText("Timeseries for observable " + name);
-                    storage->addMetadataMap(metaModel);
-                    storage->addMetadataMap(metaMC);
-                    storage->addMeta("observable", name);
-                    storage->writeHeader();
-                    storageFileStarted = true;
-                } else {
-                    storage = std::unique_ptr<DoubleVectorWriterSuccessive>(
-                            new DoubleVectorWriterSuccessive(filename,
-                                    true// append to file
-                            ));
+            std::shared_ptr<std::vector<num>> batch(new std::vector<num>);
+            batch->swap(timeseriesBuffer);      //no need to keep it in memory anymore
+            bool startFile = not storageFileStarted;
+            storageFileStarted = true;
+            SeriesFormat format = seriesFormat();
+            writer.submit([this, batch, startFile, format]() {
+                if (not storage) {
+                    std::string filename = name + ".series";
+                    if (startFile) {
+                        storage = std::unique_ptr<DoubleVectorWriterSuccessive>(
+                                new DoubleVectorWriterSuccessive(filename,
+                                        false, // create a new file
+                                        format
+                                ));
+                        storage->setColumnName(name);
+                        storage->addHeaderText("Timeseries for observable " + name);
+                        storage->addMetadataMap(metaModel);
+                        storage->addMetadataMap(metaMC);
+                        storage->addMeta("observable", name);
+                        storage->writeHeader();
+                    } else {
+                        storage = std::unique_ptr<DoubleVectorWriterSuccessive>(
+                                new DoubleVectorWriterSuccessive(filename,
+                                        true, // append to file
+                                        format
+                                ));
+                    }
                 }
-            }
-            storage->writeData(timeseriesBuffer);   //append last batch of measurements
-            timeseriesBuffer.resize(0);             //no need to keep it in memory anymore
+                storage->writeData(*batch);     //append last batch of measurements
+            });
         }
     }
 
     friend void outputResults(
-            const std::vector<std::unique_ptr<ScalarObservableHandler>>& obsHandlers);
+            const std::vector<std::unique_ptr<ScalarObservableHandler>>& obsHandlers,
+            AsyncWriter& writer);
 protected:
     std::vector<num> timeseriesBuffer;      // time series entries added since last call to writeData()
     std::unique_ptr<DoubleVectorWriterSuccessive> storage;
     bool storageFileStarted;
 
+    SeriesFormat seriesFormat() const {
+        return (mcparams.timeseriesFormat == DetQMCParams::TimeseriesFormatBinary)
+            ? SeriesFormatBinary : SeriesFormatText;
+    }
+
 public:
     // serialization by DetQMC::serializeContents
     template<class Archive>
@@ -264,7 +296,8 @@ public:
         return vsize;
     }
     friend void outputResults(
-            const std::vector<std::unique_ptr<VectorObservableHandler>>& obsHandlers);
+            const std::vector<std::unique_ptr<VectorObservableHandler>>& obsHandlers,
+            AsyncWriter& writer);
 protected:
     uint32_t vsize;
     arma::Col<num> indexes;
@@ -292,10 +325,13 @@ public:
 
 //Write expectation values and error bars for all observables to a file
 //take metadata to store from the first entry in obsHandlers
-void outputResults(const std::vector<std::unique_ptr<ScalarObservableHandler>>& obsHandlers);
+//[the file is written by writer]
+void outputResults(const std::vector<std::unique_ptr<ScalarObservableHandler>>& obsHandlers,
+                   AsyncWriter& writer);
 
 //write the results for each vector observable into a seperate file
-void outputResults(const std::vector<std::unique_ptr<VectorObservableHandler>>& obsHandlers);
+void outputResults(const std::vector<std::unique_ptr<VectorObservableHandler>>& obsHandlers,
+                   AsyncWriter& writer);
 
 
 #endif /* OBSERVABLEHANDLER_H_ */
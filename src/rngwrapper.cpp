@@ -22,6 +22,7 @@ extern "C" {
 
 #include <fstream>
 #include <cstdlib>
+#include <cstdint>
 #include "tools.h"
 
 std::string RngWrapper::getName() const {
@@ -48,6 +49,53 @@ RngWrapper::RngWrapper(uint32_t seed_, uint32_t processIndex_)
               << processIndex << " -> mySeed: " << mySeed << "\n";
 }
 
+void RngWrapper::fillRand01(double* array, std::size_t n) {
+    std::size_t i = 0;
+    // use up what is left in the internal state array, so that the
+    // block continues the sequence of single calls
+    while (i < n and dsfmt.idx < DSFMT_N64) {
+        array[i++] = rand01();
+    }
+    // dSFMT writes even-sized blocks of at least DSFMT_N64 numbers
+    // directly to aligned memory and keeps the last of them as its
+    // state.  The internal array is then exhausted.
+    std::size_t block = (n - i) & ~std::size_t(1);
+    if (block >= std::size_t(DSFMT_N64) and block <= std::size_t(INT32_MAX)
+        and reinterpret_cast<std::uintptr_t>(array + i) % 16 == 0) {
+        dsfmt_fill_array_open_open(&dsfmt, array + i, int(block));
+        dsfmt.idx = DSFMT_N64;
+        i += block;
+    }
+    while (i < n) {
+        array[i++] = rand01();
+    }
+}
+
+void RngWrapper::fillRange(double* array, std::size_t n, double low, double high) {
+    fillRand01(array, n);
+    for (std::size_t i = 0; i < n; ++i) {
+        array[i] = low + (high - low) * array[i];
+    }
+}
+
+void RngWrapper::fillNormal(double* array, std::size_t n) {
+    // first half of array: radial, second half: angular uniform variates.
+    // No rejection step as in the polar method, so the transformation
+    // loop has no branches.
+    std::size_t pairs = n / 2;
+    fillRand01(array, 2 * pairs);
+    for (std::size_t i = 0; i < pairs; ++i) {
+        double rad = std::sqrt(-2.0 * std::log(array[i]));
+        double angle = 2.0 * M_PI * array[pairs + i];
+        array[i] = rad * std::cos(angle);
+        array[pairs + i] = rad * std::sin(angle);
+    }
+    if (n % 2 == 1) {
+        double rad = std::sqrt(-2.0 * std::log(rand01()));
+        array[n - 1] = rad * std::cos(2.0 * M_PI * rand01());
+    }
+}
+
 void RngWrapper::saveState() const {
     //dSFMT
     char *s2 = dsfmt_state_to_str(const_cast<dsfmt_t*>(&dsfmt), NULL);
@@ -28,6 +28,7 @@ extern "C" {
 
 #include <tuple>
 #include <cmath>
+#include <cstddef>
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wpragmas"
@@ -86,6 +87,19 @@ public:
         return std::make_tuple(x, y);
     }
 
+    //Block generation: fill array[0 .. n-1].  The uniform variates are
+    //the same sequence that n calls to rand01() [randRange()] would
+    //give.  Large blocks are generated directly by dSFMT into array,
+    //which then should be 16-byte aligned (as armadillo and malloc
+    //memory is), else they fall back to single calls.
+    void fillRand01(double* array, std::size_t n);
+    void fillRange(double* array, std::size_t n, double low, double high);
+
+    //fill array[0 .. n-1] with standard normal variates, transformed
+    //blockwise from uniform variates by the basic (non-rejecting)
+    //Box-Muller method
+    void fillNormal(double* array, std::size_t n);
+
     //saving/loading state without Boost serialization
     void saveState() const;
     void loadState();
@@ -144,6 +144,50 @@ T jackknife(
 }
 
 
+//Take the sums of the values in each jackknife block, plus a trailing
+//entry holding the sum of values that belong to no complete block.
+//Return for each block the sum of all values outside of it.
+//This is derived from prefix and suffix sums, which takes O(blocks)
+//and avoids the cancellation of subtracting the block from the total.
+template<typename T>
+std::vector<T> jackknifeLeaveOneOutSums(
+        const std::vector<T>& blockSumsAndRest, const T& zeroValue = T()) {
+    assert(not blockSumsAndRest.empty());
+    std::size_t bc = blockSumsAndRest.size() - 1;
+    std::vector<T> result(bc, zeroValue);
+    T prefix = zeroValue;
+    for (std::size_t b = 0; b < bc; ++b) {
+        result[b] = prefix;
+        prefix += blockSumsAndRest[b];
+    }
+    T suffix = blockSumsAndRest[bc];
+    for (std::size_t b = bc; b-- > 0; ) {
+        result[b] += suffix;
+        suffix += blockSumsAndRest[b];
+    }
+    return result;
+}
+
+//Inverse of jackknifeLeaveOneOutSums, given the total of all values:
+//recover the block sums and the trailing rest from the leave-one-out sums
+//[as stored in older state files].  Subtracting from the total loses some
+//precision, this is only used to convert such files.
+template<typename T>
+std::vector<T> jackknifeBlockSumsFromLeaveOneOutSums(
+        const std::vector<T>& leaveOneOutSums, const T& total, const T& zeroValue = T()) {
+    std::size_t bc = leaveOneOutSums.size();
+    std::vector<T> result(bc + 1, zeroValue);
+    T rest = total;
+    for (std::size_t b = 0; b < bc; ++b) {
+        result[b] = total;
+        result[b] -= leaveOneOutSums[b];
+        rest -= result[b];
+    }
+    result[bc] = rest;
+    return result;
+}
+
+
 //Take a vector of block values, calculate their average and estimate
 //their error using standard jackknife
 template<typename T> void jackknife(T& outBlockAverage, T& outBlockError,
@@ -0,0 +1,152 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0.  See the enclosed file LICENSE for a copy or if
+ * that was not distributed with this file, You can obtain one at
+ * http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright 2017 Max H. Gerlach
+ *
+ * */
+
+/*
+ * textscan.h
+ *
+ * Scanning of ASCII data in a buffer that is not null-terminated
+ * (e.g. a MappedFile), without stringstreams and independent of the
+ * locale.
+ */
+
+#ifndef TEXTSCAN_H_
+#define TEXTSCAN_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// space, tab or carriage return -- but not a newline
+inline bool isBlank(char c) {
+    return c == ' ' or c == '\t' or c == '\r' or c == '\v' or c == '\f';
+}
+
+inline const char* skipBlanks(const char* p, const char* end) {
+    while (p < end and isBlank(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+// position just behind the next newline, or end
+inline const char* nextLine(const char* p, const char* end) {
+    const char* newline = static_cast<const char*>(std::memchr(p, '\n', std::size_t(end - p)));
+    return newline ? newline + 1 : end;
+}
+
+// position behind the whitespace delimited token at p
+inline const char* skipToken(const char* p, const char* end) {
+    while (p < end and not isBlank(*p) and *p != '\n') {
+        ++p;
+    }
+    return p;
+}
+
+// Parse a floating point number in the format of strtod() in the "C"
+// locale, starting at p.  On success value is set and the position
+// behind the number is returned, otherwise p is returned.
+//
+// Decimal numbers with at most 19 significant digits, a mantissa not
+// exceeding 2^53 and a decimal exponent in [-22, 22] are converted
+// exactly (they are products or quotients of two exactly
+// representable doubles).  Everything else -- in practice only
+// numbers written with more than 16 digits, nan and inf -- is handed
+// to strtod().
+inline const char* scanDouble(const char* p, const char* end, double& value) {
+    static const double exactPowersOfTen[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const int maxDigits = 19;   // fit into uint64_t
+    const char* q = p;
+    bool negative = false;
+    if (q < end and (*q == '-' or *q == '+')) {
+        negative = (*q == '-');
+        ++q;
+    }
+    uint64_t mantissa = 0;
+    int digits = 0;             // significant digits in mantissa
+    int exponent = 0;
+    bool truncated = false;     // digits have been dropped from mantissa
+    bool anyDigits = false;
+    for (; q < end and *q >= '0' and *q <= '9'; ++q) {
+        anyDigits = true;
+        if (digits < maxDigits) {
+            mantissa = 10 * mantissa + uint64_t(*q - '0');
+            if (mantissa > 0) ++digits;
+        } else {
+            ++exponent;
+            truncated = truncated or (*q != '0');
+        }
+    }
+    if (q < end and *q == '.') {
+        ++q;
+        for (; q < end and *q >= '0' and *q <= '9'; ++q) {
+            anyDigits = true;
+            if (digits < maxDigits) {
+                mantissa = 10 * mantissa + uint64_t(*q - '0');
+                if (mantissa > 0) ++digits;
+                --exponent;
+            } else {
+                truncated = truncated or (*q != '0');
+            }
+        }
+    }
+    if (not anyDigits) {
+        // maybe nan or inf
+        const char* e = skipToken(p, end);
+        if (e == p) {
+            return p;
+        }
+        std::string token(p, e);
+        char* tokenEnd = 0;
+        double v = std::strtod(token.c_str(), &tokenEnd);
+        if (tokenEnd == token.c_str()) {
+            return p;
+        }
+        value = v;
+        return p + (tokenEnd - token.c_str());
+    }
+    if (q < end and (*q == 'e' or *q == 'E')) {
+        const char* e = q + 1;
+        bool negativeExp = false;
+        if (e < end and (*e == '-' or *e == '+')) {
+            negativeExp = (*e == '-');
+            ++e;
+        }
+        if (e < end and *e >= '0' and *e <= '9') {
+            int exp = 0;
+            for (; e < end and *e >= '0' and *e <= '9'; ++e) {
+                if (exp < 100000) exp = 10 * exp + (*e - '0');
+            }
+            exponent += negativeExp ? -exp : exp;
+            q = e;
+        }
+        // else: the 'e' does not belong to the number
+    }
+
+    if (not truncated and mantissa <= (uint64_t(1) << 53)
+        and exponent >= -22 and exponent <= 22) {
+        double v = double(mantissa);
+        if (exponent < 0) {
+            v /= exactPowersOfTen[-exponent];
+        } else {
+            v *= exactPowersOfTen[exponent];
+        }
+        value = negative ? -v : v;
+    } else {
+        std::string token(p, q);
+        value = std::strtod(token.c_str(), 0);
+    }
+    return q;
+}
+
+
+#endif /* TEXTSCAN_H_ */
@@ -23,6 +23,8 @@
 #include <string>
 #include <map>
 #include <iostream>
+#include <mutex>
+#include <atomic>
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
 #pragma GCC diagnostic ignored "-Wshadow"
@@ -31,7 +33,7 @@
 
 class Timing {
 public:
-    Timing() : insertOrder(), timers() {
+    Timing() : concurrent(false), mutex(), insertOrder(), timers() {
     }
     //on destruction print timing summary
     ~Timing() {
@@ -40,8 +42,21 @@ public:
             std::cout << timerName << ": " << timers[timerName].format();
         }
     }
+    //call with true before timers may be used from several threads
+    //at once, and with false when the threads are done; only then
+    //start() and stop() take the lock
+    void setConcurrent(bool threadsActive) {
+        concurrent.store(threadsActive, std::memory_order_release);
+    }
     //start or resume a timer:
+    //[thread-safe while setConcurrent(true) is in effect, but if several
+    // threads use the same timer concurrently the measured time is only
+    // approximate]
     void start(const std::string& timerKey) {
+        std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+        if (concurrent.load(std::memory_order_acquire)) {
+            lock.lock();
+        }
         if (timers.count(timerKey) == 0) {
             insertOrder.push_back(timerKey);
             timers[timerKey] = boost::timer::cpu_timer();
@@ -49,9 +64,15 @@ public:
         timers[timerKey].resume();
     }
     void stop(const std::string& timerKey) {
+        std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+        if (concurrent.load(std::memory_order_acquire)) {
+            lock.lock();
+        }
         timers.at(timerKey).stop();
     }
 private:
+    std::atomic<bool> concurrent;
+    std::mutex mutex;
     std::vector<std::string> insertOrder;
     std::map<std::string,boost::timer::cpu_timer> timers;
 };
@@ -65,12 +86,23 @@ public:
     }
     ~Timing() {
     }
+    void setConcurrent(bool threadsActive) {
+        (void)threadsActive;
+    }
     void start(const std::string& timerKey) {
         (void)timerKey;
     }
     void stop(const std::string& timerKey) {
         (void)timerKey;
     }
+    //overloads for string literals, these avoid constructing a
+    //std::string [which may allocate] on every call
+    void start(const char* timerKey) {
+        (void)timerKey;
+    }
+    void stop(const char* timerKey) {
+        (void)timerKey;
+    }
 };
 
 #endif //TIMING
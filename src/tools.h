@@ -142,8 +142,9 @@ std::vector<std::string> glob(const std::string& path);
 // where no return value is expected
 struct VoidNoOp {
     void operator()() const { };
+    // take the arguments by reference: no copies of matrices passed in the sweep
     template<typename P1, typename... Params>
-    void operator()(P1 p1, Params... parameters) {
+    void operator()(const P1& p1, const Params&... parameters) {
         (void)(p1);             // we do this just to remove warnings -- we need the recursion for that
         operator()(parameters...);
     }
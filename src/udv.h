@@ -19,11 +19,15 @@
 
 #include <iostream>
 #include <complex>
+#include <vector>
+#include <algorithm>
+#include <cassert>
 #include <armadillo>
 #include "timing.h"
 #include "exceptions.h"
 #include "tools.h"
 #include "toolsdebug.h"
+#include "detmodelparams.h"      // UdVMethod
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
@@ -36,6 +40,13 @@
 //We store U, d, V_t. V_t is the conjugate-transpose of V. The Lapack-Routines
 //to compute svd(M) for a matrix M return U, d, V_t with M = U*d*V = U*d*(V_t)^(dagger).
 //Initialize at beginning of simulation by member function setupUdVStorage()
+//
+//If the decomposition is computed by a QR decomposition with column pivoting
+//instead of an SVD (UDV_QR), U is still unitary, but V is not: it is an upper
+//triangular matrix with unit-modulus diagonal elements up to a column
+//permutation (or a product of such matrices).  Then V^{-1} != V_t, use
+//udvInverseV() where the inverse is needed.
+//The method is selected by the enum UdVMethod defined in detmodelparams.h
 
 template <typename num, typename num_s = double>
 struct UdV {
@@ -48,6 +59,12 @@ struct UdV {
     UdV(uint32_t size) :
         U(arma::eye(size,size)), d(arma::ones(size)), V_t(arma::eye(size,size))
     { }
+    //exchange contents without copying the matrices
+    void swap(UdV& other) {
+        U.swap(other.U);
+        d.swap(other.d);
+        V_t.swap(other.V_t);
+    }
 private:
     //for serialization with Boost
     friend class boost::serialization::access;
@@ -65,16 +82,277 @@ UdV<std::complex<double>>::UdV(uint32_t size) :
 { }
 
 
+// Lapack routines for the QR decomposition with column pivoting and
+// the inversion of a triangular matrix, these are not wrapped by Armadillo
+extern "C" {
+    void arma_fortran_noprefix(dgeqp3)(arma::blas_int* m, arma::blas_int* n, double* a,
+                                       arma::blas_int* lda, arma::blas_int* jpvt, double* tau,
+                                       double* work, arma::blas_int* lwork, arma::blas_int* info);
+    void arma_fortran_noprefix(zgeqp3)(arma::blas_int* m, arma::blas_int* n, void* a,
+                                       arma::blas_int* lda, arma::blas_int* jpvt, void* tau,
+                                       void* work, arma::blas_int* lwork, double* rwork,
+                                       arma::blas_int* info);
+    void arma_fortran_noprefix(dtrtri)(char* uplo, char* diag, arma::blas_int* n, double* a,
+                                       arma::blas_int* lda, arma::blas_int* info);
+    void arma_fortran_noprefix(ztrtri)(char* uplo, char* diag, arma::blas_int* n, void* a,
+                                       arma::blas_int* lda, arma::blas_int* info);
+}
+
+//Scratch space for udvDecompose() and udvInverseV(): a copy of the input
+//overwritten by Lapack, pivots and the Lapack work arrays.  The buffers are
+//sized on first use and the optimal work array sizes are queried once, so
+//repeated calls for matrices of the same size do not allocate memory.
+//Do not share a workspace between threads.
+template<typename Val>
+struct UdVWorkspace {
+    arma::Mat<Val> A;           // input of gesvd, overwritten
+    arma::Mat<Val> VT;          // V = V_t^(dagger) as returned by gesvd
+    arma::Mat<Val> R;           // triangular factor for udvInverseV_qr()
+    arma::Col<Val> tau;         // scalar factors of the Householder reflectors
+    arma::Col<Val> work;
+    arma::Col<num> rwork;       // only used for complex matrices
+    std::vector<arma::blas_int> pivot;  // column pivots of geqp3, row pivots of getrf
+    std::vector<uint32_t> column;       // see udvInverseV_qr()
+    // Lapack work array sizes, 0 if not queried yet
+    arma::blas_int lwork_gesvd;
+    arma::blas_int lwork_geqp3;
+    arma::blas_int lwork_getri;
+    uint32_t size;
+
+    UdVWorkspace() :
+        A(), VT(), R(), tau(), work(), rwork(), pivot(), column(),
+        lwork_gesvd(0), lwork_geqp3(0), lwork_getri(0), size(0)
+    { }
+    //prepare for sz x sz matrices
+    void setSize(uint32_t sz) {
+        if (sz != size) {
+            A.set_size(sz, sz);
+            VT.set_size(sz, sz);
+            R.set_size(sz, sz);
+            tau.set_size(sz);
+            rwork.set_size(5 * sz);
+            pivot.resize(sz);
+            column.resize(sz);
+            lwork_gesvd = lwork_geqp3 = lwork_getri = 0;
+            size = sz;
+        }
+    }
+    //the work array with at least lwork elements
+    Val* workptr(arma::blas_int lwork) {
+        if (work.n_elem < arma::uword(lwork)) {
+            work.set_size(arma::uword(lwork));
+        }
+        return work.memptr();
+    }
+};
+
+inline double udvConj(double x) { return x; }
+inline std::complex<double> udvConj(const std::complex<double>& x) { return std::conj(x); }
+
+
+// helpers for udvDecompose(): overloaded for real and complex
+// matrices.  SVD of ws.A = U diag(d) ws.VT, ws.A is overwritten.
+inline arma::blas_int lapack_gesvd(arma::Mat<double>& U, arma::Col<num>& d, UdVWorkspace<double>& ws) {
+    char job = 'A';
+    arma::blas_int n = arma::blas_int(ws.size), info = 0;
+    if (ws.lwork_gesvd == 0) {
+        double work_query = 0;
+        arma::blas_int lwork = -1;
+        arma::lapack::gesvd(&job, &job, &n, &n, ws.A.memptr(), &n, d.memptr(), U.memptr(), &n,
+                            ws.VT.memptr(), &n, &work_query, &lwork, &info);
+        if (info != 0) {
+            return info;
+        }
+        ws.lwork_gesvd = std::max(arma::blas_int(work_query), 5*n);
+    }
+    arma::blas_int lwork = ws.lwork_gesvd;
+    arma::lapack::gesvd(&job, &job, &n, &n, ws.A.memptr(), &n, d.memptr(), U.memptr(), &n,
+                        ws.VT.memptr(), &n, ws.workptr(lwork), &lwork, &info);
+    return info;
+}
+
+inline arma::blas_int lapack_gesvd(arma::Mat<std::complex<double>>& U, arma::Col<num>& d,
+                                   UdVWorkspace<std::complex<double>>& ws) {
+    char job = 'A';
+    arma::blas_int n = arma::blas_int(ws.size), info = 0;
+    if (ws.lwork_gesvd == 0) {
+        std::complex<double> work_query = 0;
+        arma::blas_int lwork = -1;
+        arma::lapack::cx_gesvd(&job, &job, &n, &n, ws.A.memptr(), &n, d.memptr(), U.memptr(), &n,
+                               ws.VT.memptr(), &n, &work_query, &lwork, ws.rwork.memptr(), &info);
+        if (info != 0) {
+            return info;
+        }
+        ws.lwork_gesvd = std::max(arma::blas_int(work_query.real()), 3*n);
+    }
+    arma::blas_int lwork = ws.lwork_gesvd;
+    arma::lapack::cx_gesvd(&job, &job, &n, &n, ws.A.memptr(), &n, d.memptr(), U.memptr(), &n,
+                           ws.VT.memptr(), &n, ws.workptr(lwork), &lwork, ws.rwork.memptr(), &info);
+    return info;
+}
+
+// helpers for udvDecompose_qr(): overloaded for real and complex
+// matrices.  A is overwritten by the Lapack output, the pivots go
+// to ws.pivot, the Householder scalars to ws.tau.
+inline arma::blas_int lapack_geqp3(arma::Mat<double>& A, UdVWorkspace<double>& ws) {
+    arma::blas_int m = arma::blas_int(A.n_rows), n = arma::blas_int(A.n_cols), info = 0;
+    std::fill(ws.pivot.begin(), ws.pivot.end(), 0);     // 0: all columns are free for pivoting
+    if (ws.lwork_geqp3 == 0) {
+        double work_query = 0;
+        arma::blas_int lwork = -1;
+        arma_fortran_noprefix(dgeqp3)(&m, &n, A.memptr(), &m, ws.pivot.data(), ws.tau.memptr(),
+                                      &work_query, &lwork, &info);
+        if (info != 0) {
+            return info;
+        }
+        ws.lwork_geqp3 = arma::blas_int(work_query);
+    }
+    arma::blas_int lwork = ws.lwork_geqp3;
+    arma_fortran_noprefix(dgeqp3)(&m, &n, A.memptr(), &m, ws.pivot.data(), ws.tau.memptr(),
+                                  ws.workptr(lwork), &lwork, &info);
+    return info;
+}
+
+inline arma::blas_int lapack_geqp3(arma::Mat<std::complex<double>>& A, UdVWorkspace<std::complex<double>>& ws) {
+    arma::blas_int m = arma::blas_int(A.n_rows), n = arma::blas_int(A.n_cols), info = 0;
+    std::fill(ws.pivot.begin(), ws.pivot.end(), 0);     // 0: all columns are free for pivoting
+    if (ws.lwork_geqp3 == 0) {
+        std::complex<double> work_query = 0;
+        arma::blas_int lwork = -1;
+        arma_fortran_noprefix(zgeqp3)(&m, &n, A.memptr(), &m, ws.pivot.data(), ws.tau.memptr(),
+                                      &work_query, &lwork, ws.rwork.memptr(), &info);
+        if (info != 0) {
+            return info;
+        }
+        ws.lwork_geqp3 = arma::blas_int(work_query.real());
+    }
+    arma::blas_int lwork = ws.lwork_geqp3;
+    arma_fortran_noprefix(zgeqp3)(&m, &n, A.memptr(), &m, ws.pivot.data(), ws.tau.memptr(),
+                                  ws.workptr(lwork), &lwork, ws.rwork.memptr(), &info);
+    return info;
+}
+
+// form the unitary matrix Q from the Householder reflectors
+// returned by lapack_geqp3, in place
+inline arma::blas_int lapack_formQ(arma::Mat<double>& A, UdVWorkspace<double>& ws) {
+    arma::blas_int m = arma::blas_int(A.n_rows), n = arma::blas_int(A.n_cols);
+    arma::blas_int k = arma::blas_int(ws.tau.n_elem), info = 0;
+    arma::blas_int lwork = 64 * n;
+    arma::lapack::orgqr(&m, &n, &k, A.memptr(), &m, ws.tau.memptr(), ws.workptr(lwork), &lwork, &info);
+    return info;
+}
+
+inline arma::blas_int lapack_formQ(arma::Mat<std::complex<double>>& A, UdVWorkspace<std::complex<double>>& ws) {
+    arma::blas_int m = arma::blas_int(A.n_rows), n = arma::blas_int(A.n_cols);
+    arma::blas_int k = arma::blas_int(ws.tau.n_elem), info = 0;
+    arma::blas_int lwork = 64 * n;
+    arma::lapack::ungqr(&m, &n, &k, A.memptr(), &m, ws.tau.memptr(), ws.workptr(lwork), &lwork, &info);
+    return info;
+}
+
+// helpers for udvInverseV_qr(): invert a general or an upper
+// triangular square matrix A in place
+template<typename Val>
+arma::blas_int lapack_invert(arma::Mat<Val>& A, UdVWorkspace<Val>& ws) {
+    arma::blas_int n = arma::blas_int(A.n_rows), info = 0;
+    arma::lapack::getrf(&n, &n, A.memptr(), &n, ws.pivot.data(), &info);
+    if (info != 0) {
+        return info;
+    }
+    if (ws.lwork_getri == 0) {
+        Val work_query = 0;
+        arma::blas_int lwork = -1;
+        arma::lapack::getri(&n, A.memptr(), &n, ws.pivot.data(), &work_query, &lwork, &info);
+        if (info != 0) {
+            return info;
+        }
+        ws.lwork_getri = std::max(arma::blas_int(std::real(work_query)), n);
+    }
+    arma::blas_int lwork = ws.lwork_getri;
+    arma::lapack::getri(&n, A.memptr(), &n, ws.pivot.data(), ws.workptr(lwork), &lwork, &info);
+    return info;
+}
+
+inline arma::blas_int lapack_invertUpperTriangular(arma::Mat<double>& A) {
+    char uplo = 'U', diag = 'N';
+    arma::blas_int n = arma::blas_int(A.n_rows), info = 0;
+    arma_fortran_noprefix(dtrtri)(&uplo, &diag, &n, A.memptr(), &n, &info);
+    return info;
+}
+
+inline arma::blas_int lapack_invertUpperTriangular(arma::Mat<std::complex<double>>& A) {
+    char uplo = 'U', diag = 'N';
+    arma::blas_int n = arma::blas_int(A.n_rows), info = 0;
+    arma_fortran_noprefix(ztrtri)(&uplo, &diag, &n, A.memptr(), &n, &info);
+    return info;
+}
+
+
+//Decompose the square matrix M = Q R P^T by a QR decomposition with column
+//pivoting, then set U = Q, d = |diag(R)|, V = d^{-1} R P^T, V_t = V^(dagger).
+//This is considerably cheaper than the SVD, but keeps the scales in d
+//separated just as well.
+template<typename Val>
+void udvDecompose_qr(arma::Mat<Val>& U, arma::Col<num>& d, arma::Mat<Val>& V_t,
+                     const arma::Mat<Val>& input_matrix, UdVWorkspace<Val>& ws) {
+    timing.start("udvDecompose_qr");
+    const uint32_t sz = input_matrix.n_rows;
+    assert(input_matrix.n_cols == sz);
+    ws.setSize(sz);
+
+    U = input_matrix;
+    arma::blas_int info = lapack_geqp3(U, ws);
+    if (info != 0) {
+        std::cerr << "QR decomposition failed!  I will now save its input, then abort.\n";
+        debugSaveMatrixRealOrCpx(input_matrix, "failedQR_input_matrix");
+        FREEZE_FOR_DEBUGGER();
+        throw_GeneralError("QR decomposition failed (geqp3)");
+    }
+
+    // upper triangle of U now holds R, scale its rows and store its
+    // (permuted) conjugate transpose in V_t
+    d.set_size(sz);
+    V_t.set_size(sz, sz);
+    for (uint32_t i = 0; i < sz; ++i) {
+        d[i] = std::abs(U(i, i));
+        if (d[i] == 0) {
+            throw_GeneralError("QR decomposition failed: singular matrix");
+        }
+    }
+    for (uint32_t j = 0; j < sz; ++j) {
+        // column j of M P is column (jpvt[j]-1) of M
+        const uint32_t c = uint32_t(ws.pivot[j] - 1);
+        for (uint32_t i = 0; i <= j; ++i) {
+            V_t(c, i) = udvConj(U(i, j)) / d[i];
+        }
+        for (uint32_t i = j + 1; i < sz; ++i) {
+            V_t(c, i) = 0;
+        }
+    }
+
+    info = lapack_formQ(U, ws);
+    if (info != 0) {
+        throw_GeneralError("QR decomposition failed (orgqr/ungqr)");
+    }
+    timing.stop("udvDecompose_qr");
+}
+
 template<typename Val>
 void udvDecompose(arma::Mat<Val>& U, arma::Col<num>& d, arma::Mat<Val>& V_t,
-                  const arma::Mat<Val>& input_matrix) {
+                  const arma::Mat<Val>& input_matrix, UdVWorkspace<Val>& ws) {
     timing.start("udvDecompose");
-    //Use std algorithm -- more precise than divide&conquer -- this
-    //leads to much higher stability, with actually not much longer
-    //runtimes
-    // bool ok = arma::svd(udv_out.U, udv_out.d, udv_out.V_t, mat, "std");
-    bool ok = arma::svd(U, d, V_t, input_matrix, "std");
-    if (not ok) {
+    const uint32_t sz = input_matrix.n_rows;
+    assert(input_matrix.n_cols == sz);
+    ws.setSize(sz);
+    //Use std algorithm (gesvd, as arma::svd(U, d, V_t, input_matrix, "std"))
+    //-- more precise than divide&conquer -- this leads to much higher
+    //stability, with actually not much longer runtimes
+    ws.A = input_matrix;
+    U.set_size(sz, sz);
+    d.set_size(sz);
+    arma::blas_int info = lapack_gesvd(U, d, ws);
+    V_t = arma::trans(ws.VT);
+    if (info != 0) {
         std::cerr << "SVD failed!  I will now save the output of the routine and its input, then abort.\n";
 
         debugSaveMatrixRealOrCpx(U, "failedSVD_U");
@@ -89,11 +367,108 @@ void udvDecompose(arma::Mat<Val>& U, arma::Col<num>& d, arma::Mat<Val>& V_t,
     timing.stop("udvDecompose");
 }
 
+template<typename Val>
+void udvDecompose(arma::Mat<Val>& U, arma::Col<num>& d, arma::Mat<Val>& V_t,
+                  const arma::Mat<Val>& input_matrix) {
+    UdVWorkspace<Val> ws;
+    udvDecompose(U, d, V_t, input_matrix, ws);
+}
+
+template<typename Val>
+void udvDecompose(arma::Mat<Val>& U, arma::Col<num>& d, arma::Mat<Val>& V_t,
+                  const arma::Mat<Val>& input_matrix, UdVMethod method, UdVWorkspace<Val>& ws) {
+    if (method == UDV_QR) {
+        udvDecompose_qr(U, d, V_t, input_matrix, ws);
+    } else {
+        udvDecompose(U, d, V_t, input_matrix, ws);
+    }
+}
+
 template<typename Val>
 void udvDecompose(UdV<Val>& udv_out, const arma::Mat<Val>& mat) {
     udvDecompose(udv_out.U, udv_out.d, udv_out.V_t, mat);
 }
 
+template<typename Val>
+void udvDecompose(UdV<Val>& udv_out, const arma::Mat<Val>& mat, UdVMethod method, UdVWorkspace<Val>& ws) {
+    udvDecompose(udv_out.U, udv_out.d, udv_out.V_t, mat, method, ws);
+}
+
+//Compute V^{-1} for V = V_t^(dagger) with UDV_QR.  If V comes from a single
+//decomposition it is R P^T with R upper triangular: then column c of V is
+//column j of R, where j is the last non-zero row of that column, and
+//V^{-1} = P R^{-1} is obtained by a triangular inversion.  Products of several
+//such factors (as kept in the UdV storage after storeUdVProduct) have no
+//structure, they are inverted in general.
+template<typename Val>
+void udvInverseV_qr(arma::Mat<Val>& out, const arma::Mat<Val>& V_t, UdVWorkspace<Val>& ws) {
+    const uint32_t sz = V_t.n_rows;
+    ws.setSize(sz);
+    const uint32_t none = sz;
+    std::vector<uint32_t>& column = ws.column;  // column[j]: column of V holding column j of R
+    std::fill(column.begin(), column.end(), none);
+    bool triangular = true;
+    for (uint32_t c = 0; c < sz and triangular; ++c) {
+        // last non-zero entry in column c of V, i.e. in row c of V_t
+        uint32_t j = sz - 1;
+        while (j > 0 and V_t(c, j) == Val(0)) {
+            --j;
+        }
+        if (column[j] != none) {
+            // not a permuted triangular matrix
+            triangular = false;
+        }
+        column[j] = c;
+    }
+    arma::blas_int info = 0;
+    if (not triangular) {
+        out = arma::trans(V_t);
+        info = lapack_invert(out, ws);
+    } else {
+        arma::Mat<Val>& R = ws.R;
+        for (uint32_t j = 0; j < sz; ++j) {
+            for (uint32_t i = 0; i < sz; ++i) {
+                R(i, j) = udvConj(V_t(column[j], i));
+            }
+        }
+        info = lapack_invertUpperTriangular(R);
+        out.set_size(sz, sz);
+        for (uint32_t j = 0; j < sz; ++j) {
+            out.row(column[j]) = R.row(j);
+        }
+    }
+    if (info != 0) {
+        throw_GeneralError("inversion of V failed (UDV_QR)");
+    }
+}
+
+//Return V^{-1} for a decomposition M = U d V obtained with the given method,
+//where V_t = V^(dagger) is passed.  For the SVD this is just V_t.
+template<typename Val>
+arma::Mat<Val> udvInverseV(const arma::Mat<Val>& V_t, UdVMethod method) {
+    if (method == UDV_QR) {
+        arma::Mat<Val> V_inv;
+        UdVWorkspace<Val> ws;
+        udvInverseV_qr(V_inv, V_t, ws);
+        return V_inv;
+    } else {
+        return V_t;
+    }
+}
+
+//variant that does not copy: return a reference to V_t itself if V is unitary,
+//otherwise compute the inverse into the passed buffer and return a reference to that
+template<typename Val>
+const arma::Mat<Val>& udvInverseV(arma::Mat<Val>& buffer, const arma::Mat<Val>& V_t, UdVMethod method,
+                                  UdVWorkspace<Val>& ws) {
+    if (method == UDV_QR) {
+        udvInverseV_qr(buffer, V_t, ws);
+        return buffer;
+    } else {
+        return V_t;
+    }
+}
+
 template<typename Val>
 UdV<Val> udvDecompose(const arma::Mat<Val>& mat) {
     UdV<Val> result;